@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+namespace flarenet {
+
+// ############# Activation Arena ############# //
+//Places the activation tensors of a layer graph in one preallocated slab. The graph is given as a sequence of steps
+//(layers or fused stages) with the tensors each step reads and writes; a tensor lives from the first step that writes it
+//to the last step that reads it, so long-lived tensors such as the skip connections block their memory across the
+//whole encoder-decoder span while short-lived ones share memory. Offsets are assigned largest tensor first, each at the
+//lowest 64-byte-aligned offset that does not overlap a tensor with an intersecting lifetime. A step may not read and
+//write the same tensor (no layer runs in place), so the inputs and outputs of a step never share memory.
+class ActivationArena {
+public:
+	static const size_t alignment = 64;
+
+	//Registers a tensor of count floats (or of count elements of element_bytes bytes) and returns its id.
+	int add_tensor(size_t count, size_t element_bytes = sizeof(float));
+
+	//Appends the next step of the graph.
+	void add_step(const std::vector<int>& reads, const std::vector<int>& writes);
+
+	//Computes lifetimes and offsets and allocates the slab. Called once, after the whole graph has been added.
+	void plan();
+
+	float* data(int tensor) const;
+	//Start of a tensor of another element type.
+	void* raw_data(int tensor) const;
+
+	//Size of the slab: the peak activation memory.
+	size_t peak_bytes() const { return slab_bytes; }
+	//Memory without reuse (every tensor in its own buffer).
+	size_t total_bytes() const;
+	//Largest sum of the tensors live in one step; no placement can use less than this.
+	size_t lower_bound_bytes() const;
+
+private:
+	struct Tensor {
+		size_t bytes;
+		size_t offset;
+		int first_step;
+		int last_step;
+	};
+
+	std::vector<Tensor> tensors;
+	int steps = 0;
+	size_t slab_bytes = 0;
+	std::vector<char> storage;
+	char* slab = nullptr;
+};
+
+}
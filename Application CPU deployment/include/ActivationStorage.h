@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstdint>
+#include "Isa.h"
+
+namespace flarenet {
+
+// ############# 16-bit Activation Storage ############# //
+//Element type of the activation tensors an Engine keeps across the encoder-decoder span. fp16 is IEEE half precision
+//(11 significant bits, values up to 65504), bf16 the upper half of a float (8 significant bits, the float range). Both
+//round to nearest even; kernels compute in float and convert rows as they store and load them.
+enum class ActivationStorage { fp32, fp16, bf16 };
+
+const char* storage_name(ActivationStorage storage);
+
+//Bytes per stored activation value.
+int storage_bytes(ActivationStorage storage);
+
+//Converts count floats to 16-bit values of storage (fp16 or bf16), and back. fp16 uses F16C (avx2) or AVX-512F, bf16
+//the AVX512-BF16 conversion where the host has it; the scalar variants give the same results.
+void store_activations(const float* input, uint16_t* output, long count, ActivationStorage storage, Isa isa = best_isa());
+void load_activations(const uint16_t* input, float* output, long count, ActivationStorage storage, Isa isa = best_isa());
+
+}
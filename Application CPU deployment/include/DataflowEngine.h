@@ -0,0 +1,72 @@
+#pragma once
+
+#include <vector>
+#include "FlareNetEngine.h"
+#include "Stream.h"
+
+namespace flarenet {
+
+struct ModelWeights;
+
+// ############# FlareNet Dataflow Engine ############# //
+//Software counterpart of the #pragma HLS DATAFLOW region of FlareNet(): each of its processes (the input loop, the 11
+//layer calls and the output loop) runs on a thread of its own, and the processes are connected by the streams of
+//FlareNet() as bounded lock-free Streams. A process reads the input rows its next output rows need, runs the Engine
+//kernels on them as a view and writes its output rows. All layers of a frame therefore work at the same time, as they do
+//in hardware, and the frames of run_batch() overlap too: the encoder starts on a frame while the decoder finishes the
+//one before it.
+//Streams carry the values of FlareNet() in the same order (HWC), and processes move whole rows. The streams of the
+//layer chain hold stream_rows rows of their tensor. The skip connections (stream_skip_1 and stream_skip_2) must hold what
+//the encoder writes until the decoder adds it back, so they get room for their whole tensor. stream_stats() reports
+//the peak and mean occupancy of every stream, which is the FIFO depth each stream needs in hardware.
+//The encoder layers are fused with their pooling layers as in FlareNet(), and the Add layers run as processes of their
+//own. The output is identical to the fp32 output of Engine.
+class DataflowEngine {
+public:
+	static const int default_stream_rows = 4;
+
+	//Frame sizes as for Engine (std::invalid_argument otherwise).
+	explicit DataflowEngine(int height = Engine::input_size, int width = Engine::input_size, int stream_rows = default_stream_rows);
+	DataflowEngine(const ModelWeights& model, int height = Engine::input_size, int width = Engine::input_size, int stream_rows = default_stream_rows);
+	~DataflowEngine();
+
+	int height() const { return frame_height; }
+	int width() const { return frame_width; }
+	long frame_values() const { return (long)frame_height * frame_width * Engine::input_depth; }
+
+	//Processes of the dataflow region, each on a thread while running.
+	static const int processes = 13;
+
+	//Run inference on one frame or on n consecutive frames, with the buffer layouts of Engine::run() and
+	//Engine::run_batch(). The processes run on threads started for the call.
+	void run(const float* in, float* out);
+	void run_batch(const float* in, float* out, int n);
+
+	//Occupancy of every stream, in the order of FlareNet(), accumulated over runs until reset.
+	std::vector<StreamStats> stream_stats() const;
+	void reset_stream_stats();
+
+private:
+	int frame_height, frame_width;
+
+	//Weights converted to float (layouts as in ModelWeights), and the input layer weights for Winograd F(2x2, 3x3), used
+	//where Engine uses them by default (AVX-512 hosts).
+	std::vector<float> weights_0, winograd_weights_0, bias_0;
+	std::vector<float> depth_weights_1, point_weights_1, bias_1;
+	std::vector<float> depth_weights_2, point_weights_2, bias_2;
+	std::vector<float> depth_weights_3, point_weights_3, bias_3;
+	std::vector<float> weights_4, bias_4;
+	std::vector<float> weights_5, bias_5;
+	std::vector<float> weights_6, bias_6;
+	std::vector<float> weights_7, bias_7;
+	std::vector<float> weights_8, bias_8;
+	bool winograd;
+
+	//Streams of FlareNet().
+	Stream<float> input_stream, stream_skip_1, stream_1, stream_3, stream_skip_2, stream_5, stream_7;
+	Stream<float> stream_8, stream_9, stream_10, stream_11, stream_12, stream_13, output_stream;
+	//All of them, in the order of FlareNet().
+	std::vector<Stream<float>*> streams;
+};
+
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace flarenet {
+
+struct ModelWeights;
+
+// ############# FlareNet Fixed-Point Engine ############# //
+//Bit-exact emulation of the ap_fixed<18,8> arithmetic of FlareNet() ("HLS Hardware Design/FlareNet.cpp").
+//Values are raw fixed-point integers (value * 1024, sign-extended from 18 bits) processed in int32 lanes, so the
+//outputs equal the C-simulation results (data/golden_*.txt) bit for bit at native speed.
+class FixedEngine {
+public:
+	static const int input_size = 256;
+	static const int input_depth = 3;
+	static const int output_depth = 3;
+
+	FixedEngine();
+	explicit FixedEngine(const ModelWeights& model);
+
+	//Run inference on one 256x256x3 frame of raw ap_fixed<18,8> values (interleaved HWC, 196608 values each).
+	void run(const int32_t* in, int32_t* out);
+
+	//Same, with the sigmoid output stage of FlareNet() built with FLARENET_PIXEL_OUTPUT: 8-bit pixels, equal to the
+	//HLS pixels bit for bit.
+	void run(const int32_t* in, uint8_t* out);
+
+	//Conversion from double as done by the ap_fixed<18,8> constructor (AP_TRN rounding, AP_WRAP overflow).
+	static int32_t quantize(double value);
+	static double to_double(int32_t value);
+	//sigmoid_pixel() of FlareNet.cpp on a raw logit (same table, sigmoid_table.h).
+	static uint8_t sigmoid_pixel(int32_t logit);
+
+private:
+	std::vector<int32_t> weights_0, bias_0;
+	std::vector<int32_t> depth_weights_1, point_weights_1, bias_1;
+	std::vector<int32_t> depth_weights_2, point_weights_2, bias_2;
+	std::vector<int32_t> depth_weights_3, point_weights_3, bias_3;
+	std::vector<int32_t> weights_4, bias_4;
+	std::vector<int32_t> weights_5, bias_5;
+	std::vector<int32_t> weights_6, bias_6;
+	std::vector<int32_t> weights_7, bias_7;
+	std::vector<int32_t> weights_8, bias_8;
+
+	std::vector<int32_t> stream_0, stream_1, stream_2, stream_3, stream_4, stream_5, stream_6, stream_7;
+	std::vector<int32_t> stream_8, stream_10, stream_11, stream_13;
+	//Logits of run() with pixel output.
+	std::vector<int32_t> logits;
+};
+
+}
@@ -0,0 +1,404 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include "Kernels.h"
+
+// Bit-exact ap_fixed<18,8> versions of the kernels in Kernels.h.
+// Values are raw fixed-point integers (value * 2^10) held in int32 lanes. The HLS layers accumulate in
+// ap_fixed<18,8> with the default AP_TRN/AP_WRAP modes, so every product of two Q8.10 values is truncated
+// towards minus infinity (arithmetic >> 10) and every sum wraps to 18 bits. Wrapping is addition modulo 2^18,
+// which does not depend on the order of the additions: a kernel may therefore accumulate in plain int32 and wrap
+// once before each comparison (ReLU, max-pooling) or store, and still match the C-simulation bit for bit.
+// Products are exact in int32 as long as |weight| < 8 (checked by FixedEngine).
+
+namespace flarenet {
+
+typedef int32_t ivec8 __attribute__((vector_size(32)));
+typedef uint32_t uvec8 __attribute__((vector_size(32)));
+
+static const int fixed_fraction_bits = 10;
+static const int fixed_total_bits = 18;
+
+inline ivec8 load_ivec(const int32_t* address) {
+	ivec8 value;
+	std::memcpy(&value, address, sizeof(value));
+	return value;
+}
+
+inline void store_ivec(int32_t* address, ivec8 value) {
+	std::memcpy(address, &value, sizeof(value));
+}
+
+inline ivec8 broadcast_ivec(int32_t value) {
+	return ivec8{value, value, value, value, value, value, value, value};
+}
+
+//Wrap to a signed 18-bit value (AP_WRAP).
+inline int32_t wrap_fixed(int32_t value) {
+	return (int32_t)((uint32_t)value << (32 - fixed_total_bits)) >> (32 - fixed_total_bits);
+}
+
+inline ivec8 wrap_ivec(ivec8 value) {
+	return (ivec8)((uvec8)value << (32 - fixed_total_bits)) >> (32 - fixed_total_bits);
+}
+
+inline ivec8 relu_ivec(ivec8 value) {
+	const ivec8 zero = broadcast_ivec(0);
+	return value < zero ? zero : value;
+}
+
+//Truncated (AP_TRN) product of two Q8.10 values.
+inline ivec8 fixed_mul(ivec8 weight, ivec8 value) {
+	return (weight * value) >> fixed_fraction_bits;
+}
+
+//Zero pixel used in place of out-of-tensor taps (zero padding).
+static const int32_t zero_fixed_pixel[64] = {};
+
+// ############# 2D Convolutional Layer - RELU ############# //
+template <int block, int kernel_size, int input_depth, int output_depth>
+inline void fixed_conv2d_relu_pixels(const int32_t* input, int32_t* output, int height, int width, int x, int y, const int32_t* weight_filt, const int32_t* bias) {
+
+	const int pad = kernel_size / 2;
+	const int V = output_depth / vec_width;
+	ivec8 acc[block][V];
+	for (int b = 0; b < block; b++) {
+		for (int v = 0; v < V; v++) {
+			acc[b][v] = load_ivec(bias + v * vec_width);
+		}
+	}
+	for (int win_x = 0; win_x < kernel_size; win_x++) {
+		const int in_x = x + win_x - pad;
+		if (in_x < 0 or in_x >= height) {
+			continue;
+		}
+		for (int win_y = 0; win_y < kernel_size; win_y++) {
+			const int32_t* pixel[block];
+			for (int b = 0; b < block; b++) {
+				const int in_y = y + b + win_y - pad;
+				pixel[b] = (in_y < 0 or in_y >= width) ? zero_fixed_pixel : input + ((long)in_x * width + in_y) * input_depth;
+			}
+			const int32_t* weights = weight_filt + (win_x * kernel_size + win_y) * input_depth * output_depth;
+			for (int win_chn = 0; win_chn < input_depth; win_chn++) {
+				ivec8 weight[V];
+				for (int v = 0; v < V; v++) {
+					weight[v] = load_ivec(weights + win_chn * output_depth + v * vec_width);
+				}
+				for (int b = 0; b < block; b++) {
+					const ivec8 pixel_val = broadcast_ivec(pixel[b][win_chn]);
+					for (int v = 0; v < V; v++) {
+						acc[b][v] += fixed_mul(weight[v], pixel_val);
+					}
+				}
+			}
+		}
+	}
+	for (int b = 0; b < block; b++) {
+		int32_t* out = output + ((long)x * width + y + b) * output_depth;
+		for (int v = 0; v < V; v++) {
+			store_ivec(out + v * vec_width, relu_ivec(wrap_ivec(acc[b][v])));
+		}
+	}
+}
+
+template <int kernel_size, int input_depth, int output_depth>
+void fixed_conv2d_relu(const int32_t* input, int32_t* output, int height, int width, const int32_t* weight_filt, const int32_t* bias) {
+
+	const int block = pixel_block<output_depth>::size;
+	const int blocked_width = width - width % block;
+	for (int x = 0; x < height; x++) {
+		for (int y = 0; y < blocked_width; y += block) {
+			fixed_conv2d_relu_pixels<block, kernel_size, input_depth, output_depth>(input, output, height, width, x, y, weight_filt, bias);
+		}
+		for (int y = blocked_width; y < width; y++) {
+			fixed_conv2d_relu_pixels<1, kernel_size, input_depth, output_depth>(input, output, height, width, x, y, weight_filt, bias);
+		}
+	}
+}
+
+// ############# Depthwise Separable 2D Convolutional Layer ############# //
+template <int kernel_size, int input_depth, int output_depth>
+void fixed_separable_dw2d_relu(const int32_t* input, int32_t* output, int height, int width, const int32_t* weight_depth_filt, const int32_t* weight_point_filt, const int32_t* bias) {
+
+	const int pad = kernel_size / 2;
+	const int U = input_depth / vec_width;
+	const int V = output_depth / vec_width;
+	int32_t depthwise_vector[input_depth];
+
+	for (int x = 0; x < height; x++) {
+		for (int y = 0; y < width; y++) {
+			//Depth-wise convolution; depthwise_vector holds ap_fixed values, so it is wrapped before the point-wise pass.
+			ivec8 depthwise_res[U];
+			for (int u = 0; u < U; u++) {
+				depthwise_res[u] = broadcast_ivec(0);
+			}
+			for (int win_x = 0; win_x < kernel_size; win_x++) {
+				const int in_x = x + win_x - pad;
+				if (in_x < 0 or in_x >= height) {
+					continue;
+				}
+				for (int win_y = 0; win_y < kernel_size; win_y++) {
+					const int in_y = y + win_y - pad;
+					if (in_y < 0 or in_y >= width) {
+						continue;
+					}
+					const int32_t* pixel = input + ((long)in_x * width + in_y) * input_depth;
+					const int32_t* weights = weight_depth_filt + (win_x * kernel_size + win_y) * input_depth;
+					for (int u = 0; u < U; u++) {
+						depthwise_res[u] += fixed_mul(load_ivec(weights + u * vec_width), load_ivec(pixel + u * vec_width));
+					}
+				}
+			}
+			for (int u = 0; u < U; u++) {
+				store_ivec(depthwise_vector + u * vec_width, wrap_ivec(depthwise_res[u]));
+			}
+			//Point-wise convolution.
+			ivec8 pointwise_res[V];
+			for (int v = 0; v < V; v++) {
+				pointwise_res[v] = load_ivec(bias + v * vec_width);
+			}
+			for (int win_chn = 0; win_chn < input_depth; win_chn++) {
+				const ivec8 depthwise_val = broadcast_ivec(depthwise_vector[win_chn]);
+				for (int v = 0; v < V; v++) {
+					pointwise_res[v] += fixed_mul(load_ivec(weight_point_filt + win_chn * output_depth + v * vec_width), depthwise_val);
+				}
+			}
+			int32_t* out = output + ((long)x * width + y) * output_depth;
+			for (int v = 0; v < V; v++) {
+				store_ivec(out + v * vec_width, relu_ivec(wrap_ivec(pointwise_res[v])));
+			}
+		}
+	}
+}
+
+// ############# Transposed 2D Convolutional Layer ############# //
+template <int block, int kernel_size, int stride, int input_depth, int output_depth>
+inline void fixed_conv2d_transposed_pixels(const int32_t* input, int32_t* output, int height, int width, int x, int y, const int32_t* weight_filt) {
+
+	const int V = output_depth / vec_width;
+	const int output_height = height * stride;
+	const int output_width = width * stride;
+	const int32_t* pixel_vec = input + ((long)x * width + y) * input_depth;
+
+	for (int win_x = 0; win_x < kernel_size; win_x++) {
+		const int out_x = x * stride + win_x;
+		if (out_x >= output_height) {
+			continue;
+		}
+		for (int win_y = 0; win_y < kernel_size; win_y++) {
+			//Taps cropped at the right border accumulate into a scratch pixel and are dropped.
+			int32_t scratch[output_depth] = {};
+			int32_t* out[block];
+			ivec8 conv_res[block][V];
+			for (int b = 0; b < block; b++) {
+				const int out_y = (y + b) * stride + win_y;
+				out[b] = out_y < output_width ? output + ((long)out_x * output_width + out_y) * output_depth : scratch;
+				for (int v = 0; v < V; v++) {
+					conv_res[b][v] = load_ivec(out[b] + v * vec_width);
+				}
+			}
+			const int32_t* weights = weight_filt + (win_x * kernel_size + win_y) * input_depth * output_depth;
+			for (int win_chn = 0; win_chn < input_depth; win_chn++) {
+				ivec8 weight[V];
+				for (int v = 0; v < V; v++) {
+					weight[v] = load_ivec(weights + win_chn * output_depth + v * vec_width);
+				}
+				for (int b = 0; b < block; b++) {
+					const ivec8 pixel_val = broadcast_ivec(pixel_vec[b * input_depth + win_chn]);
+					for (int v = 0; v < V; v++) {
+						conv_res[b][v] += fixed_mul(weight[v], pixel_val);
+					}
+				}
+			}
+			for (int b = 0; b < block; b++) {
+				for (int v = 0; v < V; v++) {
+					store_ivec(out[b] + v * vec_width, conv_res[b][v]);
+				}
+			}
+		}
+	}
+}
+
+//Output rows accumulate unwrapped sums and are wrapped when they are complete (see conv2d_transposed).
+template <int kernel_size, int stride, int input_depth, int output_depth>
+void fixed_conv2d_transposed(const int32_t* input, int32_t* output, int height, int width, const int32_t* weight_filt, const int32_t* bias, const int32_t* skip = nullptr) {
+
+	const int V = output_depth / vec_width;
+	const int block = pixel_block<output_depth>::size;
+	const int blocked_width = width - width % block;
+	const int output_height = height * stride;
+	const long row_values = (long)width * stride * output_depth;
+	int initialized_rows = 0;
+
+	for (int x = 0; x < height; x++) {
+		const int last_row = std::min(x * stride + kernel_size, output_height);
+		for (; initialized_rows < last_row; initialized_rows++) {
+			int32_t* row = output + initialized_rows * row_values;
+			for (long value = 0; value < row_values; value += output_depth) {
+				for (int v = 0; v < V; v++) {
+					store_ivec(row + value + v * vec_width, load_ivec(bias + v * vec_width));
+				}
+			}
+		}
+		for (int y = 0; y < blocked_width; y += block) {
+			fixed_conv2d_transposed_pixels<block, kernel_size, stride, input_depth, output_depth>(input, output, height, width, x, y, weight_filt);
+		}
+		for (int y = blocked_width; y < width; y++) {
+			fixed_conv2d_transposed_pixels<1, kernel_size, stride, input_depth, output_depth>(input, output, height, width, x, y, weight_filt);
+		}
+		int32_t* rows = output + x * stride * row_values;
+		if (skip == nullptr) {
+			for (long value = 0; value < stride * row_values; value += vec_width) {
+				store_ivec(rows + value, relu_ivec(wrap_ivec(load_ivec(rows + value))));
+			}
+		}
+		else {
+			const int32_t* skip_rows = skip + x * stride * row_values;
+			for (long value = 0; value < stride * row_values; value += vec_width) {
+				const ivec8 conv_res = relu_ivec(wrap_ivec(load_ivec(rows + value)));
+				store_ivec(rows + value, relu_ivec(wrap_ivec(conv_res + load_ivec(skip_rows + value))));
+			}
+		}
+	}
+}
+
+// ############# Sub-pixel Transposed 2D Convolutional Layer ############# //
+//Gather form of fixed_conv2d_transposed<3, 2> (see TransposedConv.h): block output pixels of one row and one column
+//phase, i.e. columns 2 * (j + b) + phase_y, each summing only the taps of its phase. The sums are the same products as
+//in the scatter form, and wrapping is order-independent, so the result is bit-identical.
+template <int block, int input_depth, int output_depth>
+inline void fixed_subpixel_pixels(const int32_t* input, int32_t* output, int height, int width, int out_x, int phase_y, int j, const int32_t* weight_filt, const int32_t* bias, const int32_t* skip) {
+
+	const int kernel_size = 3;
+	const int V = output_depth / vec_width;
+	//Kernel row/column 1 for odd output coordinates, kernel rows/columns 0 (same input) and 2 (previous input) for even ones.
+	const int row_taps = out_x % 2 == 0 ? 2 : 1;
+	const int col_taps = phase_y == 0 ? 2 : 1;
+	ivec8 conv_res[block][V];
+	for (int b = 0; b < block; b++) {
+		for (int v = 0; v < V; v++) {
+			conv_res[b][v] = load_ivec(bias + v * vec_width);
+		}
+	}
+	for (int row_tap = 0; row_tap < row_taps; row_tap++) {
+		const int win_x = out_x % 2 == 0 ? row_tap * 2 : 1;
+		const int in_x = out_x / 2 - row_tap;
+		if (in_x < 0 or in_x >= height) {
+			continue;
+		}
+		for (int col_tap = 0; col_tap < col_taps; col_tap++) {
+			const int win_y = phase_y == 0 ? col_tap * 2 : 1;
+			const int in_y = j - col_tap;
+			//Only the j == 0 pixel of the even phase has no previous column; it is always computed on its own.
+			if (in_y < 0) {
+				continue;
+			}
+			const int32_t* pixel_vec = input + ((long)in_x * width + in_y) * input_depth;
+			const int32_t* weights = weight_filt + (win_x * kernel_size + win_y) * input_depth * output_depth;
+			for (int win_chn = 0; win_chn < input_depth; win_chn++) {
+				ivec8 weight[V];
+				for (int v = 0; v < V; v++) {
+					weight[v] = load_ivec(weights + win_chn * output_depth + v * vec_width);
+				}
+				for (int b = 0; b < block; b++) {
+					const ivec8 pixel_val = broadcast_ivec(pixel_vec[b * input_depth + win_chn]);
+					for (int v = 0; v < V; v++) {
+						conv_res[b][v] += fixed_mul(weight[v], pixel_val);
+					}
+				}
+			}
+		}
+	}
+	for (int b = 0; b < block; b++) {
+		const long offset = ((long)out_x * width * 2 + 2 * (j + b) + phase_y) * output_depth;
+		for (int v = 0; v < V; v++) {
+			ivec8 value = relu_ivec(wrap_ivec(conv_res[b][v]));
+			if (skip != nullptr) {
+				value = relu_ivec(wrap_ivec(value + load_ivec(skip + offset + v * vec_width)));
+			}
+			store_ivec(output + offset + v * vec_width, value);
+		}
+	}
+}
+
+template <int input_depth, int output_depth>
+void fixed_subpixel_conv2d_transposed(const int32_t* input, int32_t* output, int height, int width, const int32_t* weight_filt, const int32_t* bias, const int32_t* skip = nullptr) {
+
+	const int block = pixel_block<output_depth>::size;
+	for (int out_x = 0; out_x < height * 2; out_x++) {
+		for (int phase_y = 0; phase_y < 2; phase_y++) {
+			const int first = phase_y == 0 ? 1 : 0;
+			const int blocked_width = width - (width - first) % block;
+			if (first == 1) {
+				fixed_subpixel_pixels<1, input_depth, output_depth>(input, output, height, width, out_x, phase_y, 0, weight_filt, bias, skip);
+			}
+			for (int j = first; j < blocked_width; j += block) {
+				fixed_subpixel_pixels<block, input_depth, output_depth>(input, output, height, width, out_x, phase_y, j, weight_filt, bias, skip);
+			}
+			for (int j = blocked_width; j < width; j++) {
+				fixed_subpixel_pixels<1, input_depth, output_depth>(input, output, height, width, out_x, phase_y, j, weight_filt, bias, skip);
+			}
+		}
+	}
+}
+
+// ############# 2D Max Pooling Layer ############# //
+template <int pool_size, int depth>
+void fixed_max_pooling2d(const int32_t* input, int32_t* output, int height, int width) {
+
+	const int V = depth / vec_width;
+	const int output_height = height / pool_size;
+	const int output_width = width / pool_size;
+
+	for (int x = 0; x < output_height; x++) {
+		for (int y = 0; y < output_width; y++) {
+			ivec8 maxpool_val[V];
+			for (int v = 0; v < V; v++) {
+				maxpool_val[v] = broadcast_ivec(0);
+			}
+			for (int win_x = 0; win_x < pool_size; win_x++) {
+				for (int win_y = 0; win_y < pool_size; win_y++) {
+					const int32_t* pixel = input + ((long)(x * pool_size + win_x) * width + (y * pool_size + win_y)) * depth;
+					for (int v = 0; v < V; v++) {
+						const ivec8 pixel_val = load_ivec(pixel + v * vec_width);
+						maxpool_val[v] = maxpool_val[v] < pixel_val ? pixel_val : maxpool_val[v];
+					}
+				}
+			}
+			int32_t* out = output + ((long)x * output_width + y) * depth;
+			for (int v = 0; v < V; v++) {
+				store_ivec(out + v * vec_width, maxpool_val[v]);
+			}
+		}
+	}
+}
+
+// ############# 2D Convolutional Layer - SIGMOID ############# //
+template <int input_depth, int output_depth>
+void fixed_conv2d_sigmoid(const int32_t* input, int32_t* output, int height, int width, const int32_t* weight_filt, const int32_t* bias) {
+
+	static_assert(output_depth <= vec_width, "fixed_conv2d_sigmoid keeps all filters of a pixel in one vector");
+	const long pixels = (long)height * width;
+	ivec8 weight_rows[input_depth];
+	ivec8 bias_vec = broadcast_ivec(0);
+	for (int filter = 0; filter < output_depth; filter++) {
+		bias_vec[filter] = bias[filter];
+	}
+	for (int win_chn = 0; win_chn < input_depth; win_chn++) {
+		weight_rows[win_chn] = broadcast_ivec(0);
+		for (int filter = 0; filter < output_depth; filter++) {
+			weight_rows[win_chn][filter] = weight_filt[win_chn * output_depth + filter];
+		}
+	}
+	for (long pixel = 0; pixel < pixels; pixel++) {
+		ivec8 window_conv_result = bias_vec;
+		for (int win_chn = 0; win_chn < input_depth; win_chn++) {
+			window_conv_result += fixed_mul(weight_rows[win_chn], broadcast_ivec(input[pixel * input_depth + win_chn]));
+		}
+		window_conv_result = wrap_ivec(window_conv_result);
+		std::memcpy(output + pixel * output_depth, &window_conv_result, output_depth * sizeof(int32_t));
+	}
+}
+
+}
@@ -0,0 +1,148 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "ActivationArena.h"
+#include "ActivationStorage.h"
+#include "TransposedConv.h"
+
+namespace flarenet {
+
+struct ModelWeights;
+class ThreadPool;
+
+// ############# FlareNet Native CPU Engine ############# //
+//Runs the FlareNet-simple layer sequence of FlareNet() ("HLS Hardware Design/FlareNet.cpp") on float tensors.
+//Weights are converted once at construction (from weights.h by default) and all activation buffers, including the
+//scratch tile of every thread, are placed in the arena up front, so run() and run_batch() do no heap allocation, from
+//the first frame on, and activations().peak_bytes() is all the memory a frame uses.
+//The network is fully convolutional, so the frame size is a runtime parameter: any height and width that are multiples
+//of 16 (four 2x2 poolings followed by four 2x upsamplings), 256x256 by default as in the HLS design. Every tensor and
+//band is sized from it at construction.
+//With threads > 1 every layer is split into horizontal bands of output rows that run on a thread pool; a band reads the
+//rows around it (its receptive-field halo) from the complete input tensor of the layer, so the bands of one layer are
+//independent and the output is identical to the single-threaded one. The encoder layers are fused with the pooling
+//layers after them and the 1x1 layer shares the bands of the last transposed convolution, so a frame has one barrier
+//per stage instead of one per layer.
+//run_batch() runs up to batch_frames frames stage by stage: every band of a stage goes through all frames of the batch
+//before the next stage starts, so the weights of a layer are brought into cache once per batch instead of once per
+//frame. Each frame slot has its own activation tensors in the arena.
+//With 16-bit activation storage (fp16 or bf16) the two skip connections, the largest tensors and the only ones kept
+//across the encoder-decoder span, are stored in 16 bits. The encoder layers write them a few rows at a time through a
+//float scratch that is converted as soon as it is complete, and the decoder layers convert the rows they add back to
+//float the same way; every kernel still computes in float.
+//The weights are analysed at construction: a transposed convolution whose kernel has zero (tap, input channel) rows, as
+//left by prune_weights() (Pruning.h), runs on its compacted kernel and skips them.
+class Engine {
+public:
+	static const int input_size = 256;
+	static const int input_depth = 3;
+	static const int output_depth = 3;
+
+	//Frame sizes must be multiples of size_multiple (std::invalid_argument otherwise).
+	static const int size_multiple = 16;
+
+	//Algorithm of the input convolution (conv2d_weights_0), the only dense 3x3 layer with stride 1; the transposed
+	//layers are computed sub-pixel (at most 2x2 taps per output pixel), so they have no 3x3 window to transform.
+	//Winograd F(2x2, 3x3) is the default where AVX-512 is available, where it is slightly faster than the direct kernel;
+	//its portable variant is slower than the direct AVX2 kernel.
+	enum class ConvAlgorithm { direct, winograd };
+
+	explicit Engine(int threads = 1, int batch_frames = 1, int height = input_size, int width = input_size, ActivationStorage storage = ActivationStorage::fp32);
+	explicit Engine(const ModelWeights& model, int threads = 1, int batch_frames = 1, int height = input_size, int width = input_size, ActivationStorage storage = ActivationStorage::fp32);
+	~Engine();
+
+	int threads() const;
+	int batch_frames() const { return (int)frames.size(); }
+	int height() const { return frame_height; }
+	int width() const { return frame_width; }
+	//Floats in one input or output frame (height x width x 3).
+	long frame_values() const { return (long)frame_height * frame_width * input_depth; }
+
+	ActivationStorage activation_storage() const { return storage; }
+
+	//Zero weight rows the transposed convolutions skip, out of 1872.
+	int skipped_weight_rows() const;
+
+	ConvAlgorithm input_conv_algorithm() const { return input_conv; }
+	void set_input_conv_algorithm(ConvAlgorithm algorithm) { input_conv = algorithm; }
+
+	//Activation memory, with the peak (slab size) and the memory without reuse.
+	const ActivationArena& activations() const { return arena; }
+
+	//Run inference on one height x width x 3 frame. Both buffers are interleaved HWC (frame_values() floats);
+	//input values are normalized between 0 and 1, output values are the logits of the last 1x1 layer.
+	void run(const float* in, float* out);
+
+	//Run inference on n consecutive frames (n * frame_values() floats in each buffer), batch_frames() at a time.
+	void run_batch(const float* in, float* out, int n);
+
+	//Same, with the sigmoid output stage: out receives interleaved 8-bit RGB pixels, round(255 * sigmoid(logit)) within
+	//1, computed from the logits of each band while they are in cache (see conv2d_sigmoid_uint8 in Kernels.h).
+	void run(const float* in, uint8_t* out);
+	void run_batch(const float* in, uint8_t* out, int n);
+
+	//8-bit data path: in holds interleaved 8-bit RGB pixels (0 - 255, as decoded from an image or video frame) and out
+	//receives 8-bit pixels as above. The 1/255 normalization is folded into the input layer weights, so frames are
+	//never converted or stored as float and move a quarter of the bytes of the float interface.
+	void run(const uint8_t* in, uint8_t* out);
+	void run_batch(const uint8_t* in, uint8_t* out, int n);
+
+private:
+	int frame_height, frame_width;
+	ActivationStorage storage;
+	ConvAlgorithm input_conv;
+
+	//Weights converted to float (layouts as in ModelWeights).
+	std::vector<float> weights_0, bias_0;
+	//weights_0 transformed for Winograd F(2x2, 3x3).
+	std::vector<float> winograd_weights_0;
+	//weights_0 and winograd_weights_0 divided by 255, for 8-bit input.
+	std::vector<float> pixel_weights_0, pixel_winograd_weights_0;
+	std::vector<float> depth_weights_1, point_weights_1, bias_1;
+	std::vector<float> depth_weights_2, point_weights_2, bias_2;
+	std::vector<float> depth_weights_3, point_weights_3, bias_3;
+	std::vector<float> weights_4, bias_4;
+	std::vector<float> weights_5, bias_5;
+	std::vector<float> weights_6, bias_6;
+	std::vector<float> weights_7, bias_7;
+	std::vector<float> weights_8, bias_8;
+	//Compacted transposed convolution kernels, empty (input_depth 0) when the kernel has no zero row.
+	CompactKernel compact_4, compact_5, compact_6, compact_7;
+
+	//Runs count frames (at most batch_frames()) stage by stage, reading in or, if in is null, 8-bit pixels from
+	//pixels_in, and writing logits to out or, if out is null, pixels to pixels_out.
+	void run_frames(const float* in, const uint8_t* pixels_in, float* out, uint8_t* pixels_out, int count);
+
+	//The input layer fused with pooling (with the input_conv algorithm) on pooled rows first_row .. last_row - 1 of a
+	//frame of height rows, from float or 8-bit input.
+	//scratch is the scratch tile of the band.
+	void input_layer(const float* in, float* output, float* skip, int height, int first_row, int last_row, float* scratch) const;
+	void input_layer(const uint8_t* in, float* output, float* skip, int height, int first_row, int last_row, float* scratch) const;
+
+	//Activation tensors of one frame slot, named after the streams of FlareNet() and placed in one slab by their
+	//lifetimes in run_frames(). stream_skip_1/2 alias stream_0/4, and stream_9/12 are never stored because the Add layers
+	//are fused into the transposed convolutions that produce them. stream_2 and stream_6 are never stored either: their
+	//layers are fused with the pooling layers that read them. stream_13 only exists a few rows at a time in output_tiles
+	//(one per band), between the last transposed convolution and the 1x1 layer.
+	//With 16-bit storage, stream_0 and stream_4 are null and skip_1 and skip_2 hold them.
+	struct Frame {
+		float *stream_0, *stream_1, *stream_3, *stream_4, *stream_5, *stream_7;
+		float *stream_8, *stream_10, *stream_11;
+		uint16_t *skip_1, *skip_2;
+	};
+
+	ActivationArena arena;
+	std::vector<Frame> frames;
+	std::vector<float*> output_tiles;
+	//Scratch tile of every band, also in the arena: kernel_scratch_values floats for the encoder kernels, then (with
+	//16-bit storage) the float skip rows converted by the band.
+	std::vector<float*> scratch_tiles;
+	long kernel_scratch_values = 0;
+
+	//Null when running single-threaded.
+	std::unique_ptr<ThreadPool> pool;
+};
+
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "Isa.h"
+
+namespace flarenet {
+
+// ############# Input Convolutional Layer ############# //
+//First layer of FlareNet(), Conv2D_relu_2streams<256, 3, 3, 16>: same-padded 3x3 convolution from 3 to 16 channels
+//with ReLU, on HWC tensors of any size. weight_filt is [3][3][3][16] as in weights.h. If skip is not null, the
+//skip-connection copy is written in the same pass. An isa the host does not support falls back to scalar code.
+void input_conv2d_relu(const float* input, float* output, float* skip, int height, int width, const float* weight_filt, const float* bias, Isa isa = best_isa());
+
+//Computes output rows first_row .. last_row - 1 only. The rows just above and below the band are read from input as its
+//halo, so the bands of one layer can run on different threads.
+void input_conv2d_relu(const float* input, float* output, float* skip, int height, int width, const float* weight_filt, const float* bias, int first_row, int last_row, Isa isa = best_isa());
+
+//Conv2D_relu_2streams fused with the MaxPooling2D<256, 2, 16> after it: output receives the pooled (height/2)x(width/2)
+//tensor and skip the full-resolution one, each pair of rows being pooled right after it is computed. first_row and
+//last_row count pooled rows.
+void input_conv2d_relu_maxpool(const float* input, float* output, float* skip, int height, int width, const float* weight_filt, const float* bias, Isa isa = best_isa());
+//The banded form takes scratch, the tile of the calling thread for the full-resolution rows when skip is null (see
+//input_conv_scratch()).
+void input_conv2d_relu_maxpool(const float* input, float* output, float* skip, int height, int width, const float* weight_filt, const float* bias, int first_row, int last_row, float* scratch, Isa isa = best_isa());
+
+//input_conv2d_relu_maxpool computed with Winograd F(2x2, 3x3): every pooling window is one 2x2 output tile, obtained from
+//the 4x4 input patch under it with 16 products per input channel instead of 36. winograd_weights are the filters
+//transformed once by input_winograd_weights(). Height and width must be even. The result differs from the direct
+//kernel by rounding only. avx2 hosts use the portable variant on Kernels.h vectors.
+std::vector<float> input_winograd_weights(const float* weight_filt);
+void input_conv2d_relu_maxpool_winograd(const float* input, float* output, float* skip, int height, int width, const float* winograd_weights, const float* bias, Isa isa = best_isa());
+void input_conv2d_relu_maxpool_winograd(const float* input, float* output, float* skip, int height, int width, const float* winograd_weights, const float* bias, int first_row, int last_row, Isa isa = best_isa());
+
+//Both fused layers on interleaved 8-bit RGB input (0 - 255, not normalized). The 1/255 normalization is left to the
+//weights: weight_filt or winograd_weights must be scaled by it (as Engine does at construction). The input rows of a few
+//pooled rows at a time are converted to float in scratch, so the frame is never stored as float.
+void input_conv2d_relu_maxpool(const uint8_t* input, float* output, float* skip, int height, int width, const float* weight_filt, const float* bias, int first_row, int last_row, float* scratch, Isa isa = best_isa());
+void input_conv2d_relu_maxpool_winograd(const uint8_t* input, float* output, float* skip, int height, int width, const float* winograd_weights, const float* bias, int first_row, int last_row, float* scratch, Isa isa = best_isa());
+
+//Floats of the scratch tile any banded input_conv2d_relu_maxpool() variant needs per thread at this width: the float rows
+//of an 8-bit chunk and the three full-resolution rows of a pooled pair.
+long input_conv_scratch(int width);
+
+}
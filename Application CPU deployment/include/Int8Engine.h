@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Int8Kernels.h"
+
+namespace flarenet {
+
+struct ModelWeights;
+
+// ############# FlareNet Int8 Engine ############# //
+//Runs FlareNet() with int8 weights (one scale per output channel) and uint8 activations (one scale per tensor, see
+//Int8Kernels.h). Weights are quantized at construction from the float model; activation scales are calibrated by
+//running the float layers on calibration_frames and taking the largest value of every tensor.
+//The quantized layers are already packed the way the kernels read them, so save() can store them in a cache file that
+//later engines load as is: no float model, calibration or quantization at startup.
+class Int8Engine {
+public:
+	static const int input_size = 256;
+	static const int input_depth = 3;
+	static const int output_depth = 3;
+
+	//calibration_frames are 256x256x3 frames as passed to run().
+	explicit Int8Engine(const std::vector<const float*>& calibration_frames);
+	Int8Engine(const ModelWeights& model, const std::vector<const float*>& calibration_frames);
+
+	//Loads an engine written by save(). Throws std::runtime_error if path cannot be read or does not hold the layers of
+	//this model in the current format.
+	explicit Int8Engine(const std::string& path);
+
+	//Writes the packed layers and scales to path, in the byte order of the host (std::runtime_error on failure).
+	void save(const std::string& path) const;
+
+	//Run inference on one 256x256x3 frame with the same interface as Engine::run(): input values between 0 and 1
+	//(quantized to 8 bits), output values are the float logits of the last 1x1 layer.
+	void run(const float* in, float* out);
+
+private:
+	//Allocates the activation buffers.
+	Int8Engine();
+
+	Int8Conv conv_0;
+	Int8Separable separable_1, separable_2, separable_3;
+	Int8Conv transposed_4, transposed_5, transposed_6, transposed_7;
+	Int8Conv conv_8;
+	//Scales of the skip tensors relative to the outputs they are added to.
+	float skip_scale_5, skip_scale_7;
+
+	//Activation buffers as in Engine, one byte per value.
+	std::vector<uint8_t> input;
+	std::vector<uint8_t> stream_0, stream_1, stream_2, stream_3, stream_4, stream_5, stream_6, stream_7;
+	std::vector<uint8_t> stream_8, stream_10, stream_11, stream_13;
+};
+
+}
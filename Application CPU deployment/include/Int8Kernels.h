@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include "Isa.h"
+
+// Int8 versions of the FlareNet layers. Every stored activation follows a ReLU, so activations are uint8 with one scale
+// per tensor and no zero point (value = q * scale). Weights are int8 with one scale per output channel, accumulated in
+// int32 and requantized in the epilogue of each layer (scale, bias, ReLU and the skip-connection Add in one pass).
+// Dense layers (input convolution, pointwise, transposed convolutions, last 1x1) run on 4-byte uint8 x int8 dot products:
+// vpdpbusd with AVX-512 VNNI, pmaddubsw + pmaddwd with AVX2. Dense weights use the reduced range [-63, 63] so that the
+// 16-bit pair sums of pmaddubsw cannot saturate; every instruction set therefore produces the same int32 sums and the same
+// outputs bit for bit. Isa::avx512 needs VNNI as well, hosts without it run the AVX2 kernels.
+
+namespace flarenet {
+
+// ############# Quantized Dense Layer ############# //
+//weights is packed as [tap][tap_depth / 4][output_depth][4] (tap_depth = input_depth rounded up to 4, output_depth
+//rounded up to 16), so one 32-bit broadcast of 4 input channels meets 4 weights of each output channel.
+//The int32 sum acc of output channel c becomes acc * scale[c] + offset[c] in units of the output scale.
+struct Int8Conv {
+	std::vector<int8_t> weights;
+	std::vector<float> scale, offset;
+};
+
+//Quantizes weights [taps][input_depth][output_depth] and bias of a dense layer. input_zero_point is subtracted from
+//every input value (folded into offset). An output_scale of 0 leaves the result in real units (logits).
+Int8Conv quantize_int8_conv(const std::vector<double>& weights, const std::vector<double>& bias, int taps, int input_depth, int output_depth, double input_scale, double output_scale, int input_zero_point = 0);
+
+// ############# Quantized Depthwise Separable Layer ############# //
+//The depthwise result is not followed by a ReLU, so it is stored as uint8 with zero point 128 before the pointwise
+//step. Depthwise taps hold int8 values as floats: 9 products of uint8 and int8 values sum exactly in float lanes.
+struct Int8Separable {
+	std::vector<float> depth_weights;
+	//Per channel: input scale * weight scale / depthwise scale.
+	std::vector<float> depth_scale;
+	Int8Conv pointwise;
+};
+
+static const int int8_depthwise_zero_point = 128;
+
+Int8Separable quantize_int8_separable(const std::vector<double>& depth_weights, const std::vector<double>& point_weights, const std::vector<double>& bias, int input_depth, int output_depth, double input_scale, double depthwise_scale, double output_scale);
+
+// ############# Int8 Layers ############# //
+//Conv2D_relu_2streams<3, 3, 16> of FlareNet(). layer is quantized with 3 taps (kernel rows) of 9 values (3 pixels x 3
+//channels), so weights_0 ([3][3][3][16]) can be used as is.
+void int8_input_conv2d_relu(const uint8_t* input, uint8_t* output, int height, int width, const Int8Conv& layer, Isa isa = best_isa());
+
+//SeparableDW2D_relu with a 3x3 depthwise kernel.
+template <int input_depth, int output_depth>
+void int8_separable_dw2d_relu(const uint8_t* input, uint8_t* output, int height, int width, const Int8Separable& layer, Isa isa = best_isa());
+
+//Sub-pixel form of Conv2D_transposed<3, 2> (see TransposedConv.h). If skip is given, relu(output) + skip * skip_scale
+//is stored (the Add layer), with skip_scale = skip scale / output scale.
+template <int input_depth, int output_depth>
+void int8_subpixel_conv2d_transposed(const uint8_t* input, uint8_t* output, int height, int width, const Int8Conv& layer, const uint8_t* skip = nullptr, float skip_scale = 0, Isa isa = best_isa());
+
+//Last 1x1 layer (16 -> 3), written as float logits.
+void int8_conv2d_logits(const uint8_t* input, float* output, int height, int width, const Int8Conv& layer, Isa isa = best_isa());
+
+//16 uint8 lanes (GCC/Clang vector extension, as vec8 in Kernels.h).
+typedef uint8_t byte16 __attribute__((vector_size(16)));
+
+//Max pooling commutes with the (monotonic) quantization, so it runs on the uint8 values directly. depth must be a
+//multiple of 16.
+template <int pool_size, int depth>
+void int8_max_pooling2d(const uint8_t* input, uint8_t* output, int height, int width) {
+
+	const int V = depth / 16;
+	const int output_height = height / pool_size;
+	const int output_width = width / pool_size;
+	for (int x = 0; x < output_height; x++) {
+		for (int y = 0; y < output_width; y++) {
+			byte16 maxpool_val[V] = {};
+			for (int win_x = 0; win_x < pool_size; win_x++) {
+				for (int win_y = 0; win_y < pool_size; win_y++) {
+					const uint8_t* pixel = input + ((long)(x * pool_size + win_x) * width + (y * pool_size + win_y)) * depth;
+					for (int v = 0; v < V; v++) {
+						byte16 pixel_val;
+						std::memcpy(&pixel_val, pixel + v * 16, sizeof(pixel_val));
+						maxpool_val[v] = maxpool_val[v] < pixel_val ? pixel_val : maxpool_val[v];
+					}
+				}
+			}
+			std::memcpy(output + ((long)x * output_width + y) * depth, maxpool_val, sizeof(maxpool_val));
+		}
+	}
+}
+
+}
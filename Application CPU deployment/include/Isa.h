@@ -0,0 +1,22 @@
+#pragma once
+
+// Hand-written SIMD variants are compiled with per-function target attributes (GCC/Clang, x86 only), so a single
+// binary runs on any x86-64 host and picks the widest instruction set at runtime.
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define FLARENET_X86_SIMD 1
+#endif
+
+namespace flarenet {
+
+// ############# Instruction Set Selection ############# //
+enum class Isa { scalar, avx2, avx512 };
+
+//True if this build has kernels for the instruction set and the host CPU can run them.
+bool isa_supported(Isa isa);
+
+//Widest supported instruction set, detected once.
+Isa best_isa();
+
+const char* isa_name(Isa isa);
+
+}
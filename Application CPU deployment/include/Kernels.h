@@ -0,0 +1,458 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// Blocked float kernels used by flarenet::Engine. They compute the same layers as the reference templates in
+// Layers.h, but keep the output channels of a block of pixels in 8-wide vector accumulators (GCC/Clang vector
+// extensions, lowered to whatever SIMD the target has) so every weight row loaded is reused across the block.
+// All output depths must be multiples of 8; input depths are arbitrary.
+
+namespace flarenet {
+
+typedef float vec8 __attribute__((vector_size(32)));
+
+static const int vec_width = 8;
+
+inline vec8 load_vec(const float* address) {
+	vec8 value;
+	std::memcpy(&value, address, sizeof(value));
+	return value;
+}
+
+inline void store_vec(float* address, vec8 value) {
+	std::memcpy(address, &value, sizeof(value));
+}
+
+inline vec8 broadcast_vec(float value) {
+	return vec8{value, value, value, value, value, value, value, value};
+}
+
+inline vec8 relu_vec(vec8 value) {
+	const vec8 zero = broadcast_vec(0);
+	return value < zero ? zero : value;
+}
+
+//Vector accumulators a kernel may keep live, leaving room for the weight row: 32 registers with AVX-512, 16 otherwise.
+#ifdef __AVX512F__
+static const int accumulator_registers = 24;
+#else
+static const int accumulator_registers = 12;
+#endif
+
+//Number of neighbouring pixels computed together: keeps block * output_depth / 8 accumulators within the register file.
+template <int output_depth>
+struct pixel_block {
+	static const int accumulators = accumulator_registers / (output_depth / 8);
+	static const int size = accumulators > 8 ? 8 : (accumulators < 1 ? 1 : accumulators);
+};
+
+//Zero pixel used in place of out-of-tensor taps (zero padding), large enough for any FlareNet layer.
+static const float zero_pixel[64] = {};
+
+// ############# 2D Convolutional Layer - RELU ############# //
+//Computes block output pixels starting at (x, y) of a same-padded stride-1 convolution.
+template <int block, int kernel_size, int input_depth, int output_depth>
+inline void conv2d_relu_pixels(const float* input, float* output, int height, int width, int x, int y, const float* weight_filt, const float* bias) {
+
+	const int pad = kernel_size / 2;
+	const int V = output_depth / vec_width;
+	vec8 acc[block][V];
+	for (int b = 0; b < block; b++) {
+		for (int v = 0; v < V; v++) {
+			acc[b][v] = load_vec(bias + v * vec_width);
+		}
+	}
+	for (int win_x = 0; win_x < kernel_size; win_x++) {
+		const int in_x = x + win_x - pad;
+		if (in_x < 0 or in_x >= height) {
+			continue;
+		}
+		for (int win_y = 0; win_y < kernel_size; win_y++) {
+			const float* pixel[block];
+			for (int b = 0; b < block; b++) {
+				const int in_y = y + b + win_y - pad;
+				pixel[b] = (in_y < 0 or in_y >= width) ? zero_pixel : input + ((long)in_x * width + in_y) * input_depth;
+			}
+			const float* weights = weight_filt + (win_x * kernel_size + win_y) * input_depth * output_depth;
+			for (int win_chn = 0; win_chn < input_depth; win_chn++) {
+				vec8 weight[V];
+				for (int v = 0; v < V; v++) {
+					weight[v] = load_vec(weights + win_chn * output_depth + v * vec_width);
+				}
+				for (int b = 0; b < block; b++) {
+					const vec8 pixel_val = broadcast_vec(pixel[b][win_chn]);
+					for (int v = 0; v < V; v++) {
+						acc[b][v] += weight[v] * pixel_val;
+					}
+				}
+			}
+		}
+	}
+	for (int b = 0; b < block; b++) {
+		float* out = output + ((long)x * width + y + b) * output_depth;
+		for (int v = 0; v < V; v++) {
+			store_vec(out + v * vec_width, relu_vec(acc[b][v]));
+		}
+	}
+}
+
+template <int kernel_size, int input_depth, int output_depth>
+void conv2d_relu(const float* input, float* output, int height, int width, const float* weight_filt, const float* bias) {
+
+	const int block = pixel_block<output_depth>::size;
+	const int blocked_width = width - width % block;
+	for (int x = 0; x < height; x++) {
+		for (int y = 0; y < blocked_width; y += block) {
+			conv2d_relu_pixels<block, kernel_size, input_depth, output_depth>(input, output, height, width, x, y, weight_filt, bias);
+		}
+		for (int y = blocked_width; y < width; y++) {
+			conv2d_relu_pixels<1, kernel_size, input_depth, output_depth>(input, output, height, width, x, y, weight_filt, bias);
+		}
+	}
+}
+
+// ############# Depthwise Separable 2D Convolutional Layer ############# //
+//Computes output rows first_row .. last_row - 1 (a band of the layer); the rows around the band are read as its halo.
+template <int kernel_size, int input_depth, int output_depth>
+void separable_dw2d_relu(const float* input, float* output, int height, int width, const float* weight_depth_filt, const float* weight_point_filt, const float* bias, int first_row, int last_row) {
+
+	const int pad = kernel_size / 2;
+	const int U = input_depth / vec_width;
+	const int V = output_depth / vec_width;
+	float depthwise_vector[input_depth];
+
+	for (int x = first_row; x < last_row; x++) {
+		for (int y = 0; y < width; y++) {
+			//Depth-wise convolution, vectorized over input channels.
+			vec8 depthwise_res[U];
+			for (int u = 0; u < U; u++) {
+				depthwise_res[u] = broadcast_vec(0);
+			}
+			for (int win_x = 0; win_x < kernel_size; win_x++) {
+				const int in_x = x + win_x - pad;
+				if (in_x < 0 or in_x >= height) {
+					continue;
+				}
+				for (int win_y = 0; win_y < kernel_size; win_y++) {
+					const int in_y = y + win_y - pad;
+					if (in_y < 0 or in_y >= width) {
+						continue;
+					}
+					const float* pixel = input + ((long)in_x * width + in_y) * input_depth;
+					const float* weights = weight_depth_filt + (win_x * kernel_size + win_y) * input_depth;
+					for (int u = 0; u < U; u++) {
+						depthwise_res[u] += load_vec(weights + u * vec_width) * load_vec(pixel + u * vec_width);
+					}
+				}
+			}
+			for (int u = 0; u < U; u++) {
+				store_vec(depthwise_vector + u * vec_width, depthwise_res[u]);
+			}
+			//Point-wise convolution, vectorized over output filters.
+			vec8 pointwise_res[V];
+			for (int v = 0; v < V; v++) {
+				pointwise_res[v] = load_vec(bias + v * vec_width);
+			}
+			for (int win_chn = 0; win_chn < input_depth; win_chn++) {
+				const vec8 depthwise_val = broadcast_vec(depthwise_vector[win_chn]);
+				for (int v = 0; v < V; v++) {
+					pointwise_res[v] += load_vec(weight_point_filt + win_chn * output_depth + v * vec_width) * depthwise_val;
+				}
+			}
+			float* out = output + ((long)x * width + y) * output_depth;
+			for (int v = 0; v < V; v++) {
+				store_vec(out + v * vec_width, relu_vec(pointwise_res[v]));
+			}
+		}
+	}
+}
+
+template <int kernel_size, int input_depth, int output_depth>
+void separable_dw2d_relu(const float* input, float* output, int height, int width, const float* weight_depth_filt, const float* weight_point_filt, const float* bias) {
+	separable_dw2d_relu<kernel_size, input_depth, output_depth>(input, output, height, width, weight_depth_filt, weight_point_filt, bias, 0, height);
+}
+
+// ############# Transposed 2D Convolutional Layer ############# //
+//Scatters block input pixels of row x, starting at column y, into the output (which already holds the bias).
+template <int block, int kernel_size, int stride, int input_depth, int output_depth>
+inline void conv2d_transposed_pixels(const float* input, float* output, int height, int width, int x, int y, const float* weight_filt) {
+
+	const int V = output_depth / vec_width;
+	const int output_height = height * stride;
+	const int output_width = width * stride;
+	const float* pixel_vec = input + ((long)x * width + y) * input_depth;
+
+	for (int win_x = 0; win_x < kernel_size; win_x++) {
+		const int out_x = x * stride + win_x;
+		if (out_x >= output_height) {
+			continue;
+		}
+		for (int win_y = 0; win_y < kernel_size; win_y++) {
+			//Taps cropped at the right border accumulate into a scratch pixel and are dropped.
+			float scratch[output_depth] = {};
+			float* out[block];
+			vec8 conv_res[block][V];
+			for (int b = 0; b < block; b++) {
+				const int out_y = (y + b) * stride + win_y;
+				out[b] = out_y < output_width ? output + ((long)out_x * output_width + out_y) * output_depth : scratch;
+				for (int v = 0; v < V; v++) {
+					conv_res[b][v] = load_vec(out[b] + v * vec_width);
+				}
+			}
+			const float* weights = weight_filt + (win_x * kernel_size + win_y) * input_depth * output_depth;
+			for (int win_chn = 0; win_chn < input_depth; win_chn++) {
+				vec8 weight[V];
+				for (int v = 0; v < V; v++) {
+					weight[v] = load_vec(weights + win_chn * output_depth + v * vec_width);
+				}
+				for (int b = 0; b < block; b++) {
+					const vec8 pixel_val = broadcast_vec(pixel_vec[b * input_depth + win_chn]);
+					for (int v = 0; v < V; v++) {
+						conv_res[b][v] += weight[v] * pixel_val;
+					}
+				}
+			}
+			for (int b = 0; b < block; b++) {
+				for (int v = 0; v < V; v++) {
+					store_vec(out[b] + v * vec_width, conv_res[b][v]);
+				}
+			}
+		}
+	}
+}
+
+//Like tran_buff in the HLS layer, output rows are initialized with the bias just before the first input row that
+//touches them and get their ReLU as soon as no later input row can reach them, so both passes stay in cache.
+//If skip is given, the following Add layer (skip connection + ReLU) is applied in the same pass.
+template <int kernel_size, int stride, int input_depth, int output_depth>
+void conv2d_transposed(const float* input, float* output, int height, int width, const float* weight_filt, const float* bias, const float* skip = nullptr) {
+
+	const int V = output_depth / vec_width;
+	const int block = pixel_block<output_depth>::size;
+	const int blocked_width = width - width % block;
+	const int output_height = height * stride;
+	const long row_values = (long)width * stride * output_depth;
+	int initialized_rows = 0;
+
+	for (int x = 0; x < height; x++) {
+		//Initialize the output rows reached by input row x with bias filter values.
+		const int last_row = std::min(x * stride + kernel_size, output_height);
+		for (; initialized_rows < last_row; initialized_rows++) {
+			float* row = output + initialized_rows * row_values;
+			for (long value = 0; value < row_values; value += output_depth) {
+				for (int v = 0; v < V; v++) {
+					store_vec(row + value + v * vec_width, load_vec(bias + v * vec_width));
+				}
+			}
+		}
+		for (int y = 0; y < blocked_width; y += block) {
+			conv2d_transposed_pixels<block, kernel_size, stride, input_depth, output_depth>(input, output, height, width, x, y, weight_filt);
+		}
+		for (int y = blocked_width; y < width; y++) {
+			conv2d_transposed_pixels<1, kernel_size, stride, input_depth, output_depth>(input, output, height, width, x, y, weight_filt);
+		}
+		//Rows x*stride .. x*stride+stride-1 are complete: apply ReLU activation function.
+		float* rows = output + x * stride * row_values;
+		if (skip == nullptr) {
+			for (long value = 0; value < stride * row_values; value += vec_width) {
+				store_vec(rows + value, relu_vec(load_vec(rows + value)));
+			}
+		}
+		else {
+			const float* skip_rows = skip + x * stride * row_values;
+			for (long value = 0; value < stride * row_values; value += vec_width) {
+				store_vec(rows + value, relu_vec(relu_vec(load_vec(rows + value)) + load_vec(skip_rows + value)));
+			}
+		}
+	}
+}
+
+// ############# 2D Max Pooling Layer ############# //
+template <int pool_size, int depth>
+void max_pooling2d(const float* input, float* output, int height, int width) {
+
+	const int V = depth / vec_width;
+	const int output_height = height / pool_size;
+	const int output_width = width / pool_size;
+
+	for (int x = 0; x < output_height; x++) {
+		for (int y = 0; y < output_width; y++) {
+			vec8 maxpool_val[V];
+			for (int v = 0; v < V; v++) {
+				maxpool_val[v] = broadcast_vec(0);
+			}
+			for (int win_x = 0; win_x < pool_size; win_x++) {
+				for (int win_y = 0; win_y < pool_size; win_y++) {
+					const float* pixel = input + ((long)(x * pool_size + win_x) * width + (y * pool_size + win_y)) * depth;
+					for (int v = 0; v < V; v++) {
+						const vec8 pixel_val = load_vec(pixel + v * vec_width);
+						maxpool_val[v] = maxpool_val[v] < pixel_val ? pixel_val : maxpool_val[v];
+					}
+				}
+			}
+			float* out = output + ((long)x * output_width + y) * depth;
+			for (int v = 0; v < V; v++) {
+				store_vec(out + v * vec_width, maxpool_val[v]);
+			}
+		}
+	}
+}
+
+// ############# Fused 2D Max Pooling ############# //
+//Computes pooled rows first_row .. last_row - 1 of a same-padded 3x3 layer followed by max_pooling2d<2, depth>. The two
+//full-resolution rows under a pooled row are computed by band(input, output, height, first, last) (a banded layer
+//kernel, rows first .. last - 1) and pooled while they are still in cache. If skip is given the full-resolution rows are
+//kept there for the skip connection; otherwise they go to scratch, a three-row tile (pooled_row_scratch() floats) owned
+//by the calling thread, and the full-resolution tensor is never stored. The tile is filled through a view of the input
+//rows the pair reads, so the kernel sees the real neighbouring rows as its halo and zero padding only at the borders of
+//the tensor.
+inline long pooled_row_scratch(int width, int depth) {
+	return 3L * width * depth;
+}
+
+template <int input_depth, int depth, typename Band>
+void pooled_row_pairs(const float* input, float* output, float* skip, int height, int width, int first_row, int last_row, float* scratch, Band band) {
+
+	const long input_row = (long)width * input_depth;
+	const long row = (long)width * depth;
+	for (int x = first_row; x < last_row; x++) {
+		const int first = 2 * x;
+		const float* rows;
+		if (skip != nullptr) {
+			band(input, skip, height, first, first + 2);
+			rows = skip + first * row;
+		}
+		else {
+			const int view_first = std::max(first - 1, 0);
+			const int view_last = std::min(first + 3, height);
+			band(input + view_first * input_row, scratch, view_last - view_first, first - view_first, first - view_first + 2);
+			rows = scratch + (first - view_first) * row;
+		}
+		max_pooling2d<2, depth>(rows, output + (long)x * (width / 2) * depth, 2, width);
+	}
+}
+
+// ############# 2D Adding Layer ############# //
+template <int depth>
+void add_relu(const float* input_1, const float* input_2, float* output, int height, int width) {
+
+	const long values = (long)height * width * depth;
+	for (long value = 0; value < values; value += vec_width) {
+		store_vec(output + value, relu_vec(load_vec(input_1 + value) + load_vec(input_2 + value)));
+	}
+}
+
+// ############# 2D Convolutional Layer - SIGMOID ############# //
+//1x1 output layer with at most 8 filters (sigmoid disabled, see Layers.h). The filters of one pixel share a vector
+//accumulator and a block of pixels is computed together to hide the FMA latency.
+template <int block, int input_depth, int output_depth>
+inline void conv2d_sigmoid_pixels(const float* input, float* output, const vec8 weight_rows[input_depth], vec8 bias_vec) {
+
+	vec8 window_conv_result[block];
+	for (int b = 0; b < block; b++) {
+		window_conv_result[b] = bias_vec;
+	}
+	for (int win_chn = 0; win_chn < input_depth; win_chn++) {
+		for (int b = 0; b < block; b++) {
+			window_conv_result[b] += weight_rows[win_chn] * broadcast_vec(input[b * input_depth + win_chn]);
+		}
+	}
+	for (int b = 0; b < block; b++) {
+		std::memcpy(output + b * output_depth, &window_conv_result[b], output_depth * sizeof(float));
+	}
+}
+
+template <int input_depth, int output_depth>
+void conv2d_sigmoid(const float* input, float* output, int height, int width, const float* weight_filt, const float* bias) {
+
+	static_assert(output_depth <= vec_width, "conv2d_sigmoid keeps all filters of a pixel in one vector");
+	const int block = 8;
+	const long pixels = (long)height * width;
+	const long blocked_pixels = pixels - pixels % block;
+	//Pad every weight row and the bias to a full vector.
+	vec8 weight_rows[input_depth];
+	vec8 bias_vec = broadcast_vec(0);
+	for (int filter = 0; filter < output_depth; filter++) {
+		bias_vec[filter] = bias[filter];
+	}
+	for (int win_chn = 0; win_chn < input_depth; win_chn++) {
+		weight_rows[win_chn] = broadcast_vec(0);
+		for (int filter = 0; filter < output_depth; filter++) {
+			weight_rows[win_chn][filter] = weight_filt[win_chn * output_depth + filter];
+		}
+	}
+	for (long pixel = 0; pixel < blocked_pixels; pixel += block) {
+		conv2d_sigmoid_pixels<block, input_depth, output_depth>(input + pixel * input_depth, output + pixel * output_depth, weight_rows, bias_vec);
+	}
+	for (long pixel = blocked_pixels; pixel < pixels; pixel++) {
+		conv2d_sigmoid_pixels<1, input_depth, output_depth>(input + pixel * input_depth, output + pixel * output_depth, weight_rows, bias_vec);
+	}
+}
+
+
+typedef int32_t ivec8 __attribute__((vector_size(32)));
+typedef uint8_t byte8 __attribute__((vector_size(8)));
+
+//Sigmoid scaled to 8-bit pixels, round(255 / (1 + exp(-x))), as sigmoid(x) = (1 + tanh(x / 2)) / 2 with the Padé [7/6]
+//approximation of tanh on x / 2 clamped to [-5, 5]: within 5e-5 of the sigmoid, so a pixel is off by at most 1 (only
+//next to rounding ties). One division and no exp per vector; the scaled value is clamped to [0, 255] before rounding.
+inline vec8 sigmoid_pixel_vec(vec8 x) {
+
+	const vec8 limit = broadcast_vec(5.0f);
+	vec8 u = x * 0.5f;
+	u = u < -limit ? -limit : u;
+	u = u > limit ? limit : u;
+	const vec8 u2 = u * u;
+	const vec8 numerator = u * (135135.0f + u2 * (17325.0f + u2 * (378.0f + u2)));
+	const vec8 denominator = 135135.0f + u2 * (62370.0f + u2 * (3150.0f + u2 * 28.0f));
+	vec8 pixel = 127.5f + 127.5f * numerator / denominator;
+	pixel = pixel < 0.0f ? broadcast_vec(0) : pixel;
+	pixel = pixel > 255.0f ? broadcast_vec(255) : pixel;
+	return pixel + 0.5f;
+}
+
+//conv2d_sigmoid with the sigmoid applied and the result written as 8-bit pixels. The logits of a block of 8 pixels stay
+//in registers and a small buffer and go through sigmoid_pixel_vec densely packed (output_depth per pixel), so the float
+//logits never reach memory.
+template <int input_depth, int output_depth>
+void conv2d_sigmoid_uint8(const float* input, uint8_t* output, int height, int width, const float* weight_filt, const float* bias) {
+
+	static_assert(output_depth <= vec_width, "conv2d_sigmoid_uint8 keeps all filters of a pixel in one vector");
+	const int block = 8;
+	const long pixels = (long)height * width;
+	vec8 weight_rows[input_depth];
+	vec8 bias_vec = broadcast_vec(0);
+	for (int filter = 0; filter < output_depth; filter++) {
+		bias_vec[filter] = bias[filter];
+	}
+	for (int win_chn = 0; win_chn < input_depth; win_chn++) {
+		weight_rows[win_chn] = broadcast_vec(0);
+		for (int filter = 0; filter < output_depth; filter++) {
+			weight_rows[win_chn][filter] = weight_filt[win_chn * output_depth + filter];
+		}
+	}
+	//Logits of one block, padded to whole vectors (plus the unused lanes written by the last pixel).
+	float logits[block * output_depth + vec_width];
+	for (long pixel = 0; pixel < pixels; pixel += block) {
+		const int count = (int)std::min<long>(block, pixels - pixel);
+		if (count == block) {
+			conv2d_sigmoid_pixels<block, input_depth, output_depth>(input + pixel * input_depth, logits, weight_rows, bias_vec);
+		}
+		else {
+			for (int b = 0; b < count; b++) {
+				conv2d_sigmoid_pixels<1, input_depth, output_depth>(input + (pixel + b) * input_depth, logits + b * output_depth, weight_rows, bias_vec);
+			}
+		}
+		const int values = count * output_depth;
+		for (int value = 0; value < values; value += vec_width) {
+			//Through int32 lanes: narrowing int32 to 8 bits is one instruction with AVX-512, float to 8 bits is scalar code.
+			const byte8 pixel_vec = __builtin_convertvector(__builtin_convertvector(sigmoid_pixel_vec(load_vec(logits + value)), ivec8), byte8);
+			std::memcpy(output + pixel * output_depth + value, &pixel_vec, std::min(vec_width, values - value));
+		}
+	}
+}
+
+}
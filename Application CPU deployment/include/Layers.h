@@ -0,0 +1,229 @@
+#pragma once
+
+// Float versions of the layer templates in "HLS Hardware Design/FlareNet.cpp".
+// Tensors are contiguous HWC buffers (channel fastest), exactly the order in which the HLS layers
+// read and write their streams. Channel counts are template parameters so the compiler can keep a
+// pixel's output channels in vector registers; spatial sizes are passed at runtime.
+
+namespace flarenet {
+
+// ############# 2D Convolutional Layer - RELU ############# //
+//Same-padded (zero border) stride-1 convolution. weight_filt is [kernel_size][kernel_size][input_depth][output_depth].
+template <int kernel_size, int input_depth, int output_depth>
+void Conv2D_relu(const float* input, float* output, int height, int width, const float* weight_filt, const float* bias) {
+
+	const int pad = kernel_size / 2;
+	float window_conv_result[output_depth];
+
+	//Iterate through all rows of input tensor.
+	for (int x = 0; x < height; x++) {
+		//Iterate through all columns of input tensor.
+		for (int y = 0; y < width; y++) {
+			for (int filter = 0; filter < output_depth; filter++) {
+				window_conv_result[filter] = bias[filter];
+			}
+			//Accumulate every kernel tap that falls inside the tensor (outside taps are the zero padding).
+			for (int win_x = 0; win_x < kernel_size; win_x++) {
+				const int in_x = x + win_x - pad;
+				if (in_x < 0 or in_x >= height) {
+					continue;
+				}
+				for (int win_y = 0; win_y < kernel_size; win_y++) {
+					const int in_y = y + win_y - pad;
+					if (in_y < 0 or in_y >= width) {
+						continue;
+					}
+					const float* pixel = input + ((long)in_x * width + in_y) * input_depth;
+					const float* weights = weight_filt + (win_x * kernel_size + win_y) * input_depth * output_depth;
+					for (int win_chn = 0; win_chn < input_depth; win_chn++) {
+						const float pixel_val = pixel[win_chn];
+						for (int filter = 0; filter < output_depth; filter++) {
+							window_conv_result[filter] += weights[win_chn * output_depth + filter] * pixel_val;
+						}
+					}
+				}
+			}
+			//Apply ReLU activation function and write output pixel.
+			float* out = output + ((long)x * width + y) * output_depth;
+			for (int filter = 0; filter < output_depth; filter++) {
+				out[filter] = window_conv_result[filter] < 0 ? 0 : window_conv_result[filter];
+			}
+		}
+	}
+}
+
+// ############# Depthwise Separable 2D Convolutional Layer ############# //
+//weight_depth_filt is [kernel_size][kernel_size][input_depth], weight_point_filt is [input_depth][output_depth].
+template <int kernel_size, int input_depth, int output_depth>
+void SeparableDW2D_relu(const float* input, float* output, int height, int width, const float* weight_depth_filt, const float* weight_point_filt, const float* bias) {
+
+	const int pad = kernel_size / 2;
+	float depthwise_vector[input_depth];
+	float pointwise_res[output_depth];
+
+	for (int x = 0; x < height; x++) {
+		for (int y = 0; y < width; y++) {
+			//Depth-wise convolution for every input channel.
+			for (int win_chn = 0; win_chn < input_depth; win_chn++) {
+				depthwise_vector[win_chn] = 0;
+			}
+			for (int win_x = 0; win_x < kernel_size; win_x++) {
+				const int in_x = x + win_x - pad;
+				if (in_x < 0 or in_x >= height) {
+					continue;
+				}
+				for (int win_y = 0; win_y < kernel_size; win_y++) {
+					const int in_y = y + win_y - pad;
+					if (in_y < 0 or in_y >= width) {
+						continue;
+					}
+					const float* pixel = input + ((long)in_x * width + in_y) * input_depth;
+					const float* weights = weight_depth_filt + (win_x * kernel_size + win_y) * input_depth;
+					for (int win_chn = 0; win_chn < input_depth; win_chn++) {
+						depthwise_vector[win_chn] += weights[win_chn] * pixel[win_chn];
+					}
+				}
+			}
+			//Point-wise convolution between depthwise_vector and every output filter.
+			for (int filter = 0; filter < output_depth; filter++) {
+				pointwise_res[filter] = bias[filter];
+			}
+			for (int win_chn = 0; win_chn < input_depth; win_chn++) {
+				const float depthwise_res = depthwise_vector[win_chn];
+				for (int filter = 0; filter < output_depth; filter++) {
+					pointwise_res[filter] += weight_point_filt[win_chn * output_depth + filter] * depthwise_res;
+				}
+			}
+			//Apply ReLU activation function and write output pixel.
+			float* out = output + ((long)x * width + y) * output_depth;
+			for (int filter = 0; filter < output_depth; filter++) {
+				out[filter] = pointwise_res[filter] < 0 ? 0 : pointwise_res[filter];
+			}
+		}
+	}
+}
+
+// ############# Transposed 2D Convolutional Layer ############# //
+//Output is (stride*height)x(stride*width). Each input pixel adds its kernel_size x kernel_size contribution starting
+//at (stride*x, stride*y); contributions past the last row/column are cropped, as in tran_buff of the HLS layer.
+//weight_filt is [kernel_size][kernel_size][input_depth][output_depth] (repacked from the Keras [..][output][input] order).
+template <int kernel_size, int stride, int input_depth, int output_depth>
+void Conv2D_transposed(const float* input, float* output, int height, int width, const float* weight_filt, const float* bias) {
+
+	const int output_height = height * stride;
+	const int output_width = width * stride;
+	const long output_pixels = (long)output_height * output_width;
+
+	//Initialize output with bias filter values.
+	for (long pixel = 0; pixel < output_pixels; pixel++) {
+		for (int filter = 0; filter < output_depth; filter++) {
+			output[pixel * output_depth + filter] = bias[filter];
+		}
+	}
+
+	//Scatter every input pixel into its output window.
+	for (int x = 0; x < height; x++) {
+		for (int y = 0; y < width; y++) {
+			const float* pixel_vec = input + ((long)x * width + y) * input_depth;
+			for (int win_x = 0; win_x < kernel_size; win_x++) {
+				const int out_x = x * stride + win_x;
+				if (out_x >= output_height) {
+					continue;
+				}
+				for (int win_y = 0; win_y < kernel_size; win_y++) {
+					const int out_y = y * stride + win_y;
+					if (out_y >= output_width) {
+						continue;
+					}
+					float* out = output + ((long)out_x * output_width + out_y) * output_depth;
+					const float* weights = weight_filt + (win_x * kernel_size + win_y) * input_depth * output_depth;
+					float conv_res[output_depth];
+					for (int filter = 0; filter < output_depth; filter++) {
+						conv_res[filter] = out[filter];
+					}
+					for (int win_chn = 0; win_chn < input_depth; win_chn++) {
+						const float pixel_val = pixel_vec[win_chn];
+						for (int filter = 0; filter < output_depth; filter++) {
+							conv_res[filter] += weights[win_chn * output_depth + filter] * pixel_val;
+						}
+					}
+					for (int filter = 0; filter < output_depth; filter++) {
+						out[filter] = conv_res[filter];
+					}
+				}
+			}
+		}
+	}
+
+	//Apply ReLU activation function.
+	for (long value = 0; value < output_pixels * output_depth; value++) {
+		if (output[value] < 0) {
+			output[value] = 0;
+		}
+	}
+}
+
+// ############# 2D Max Pooling Layer ############# //
+//Non-overlapping pool_size x pool_size windows. As in the HLS layer the running maximum starts at 0.
+template <int pool_size, int depth>
+void MaxPooling2D(const float* input, float* output, int height, int width) {
+
+	const int output_height = height / pool_size;
+	const int output_width = width / pool_size;
+
+	for (int x = 0; x < output_height; x++) {
+		for (int y = 0; y < output_width; y++) {
+			float maxpool_val[depth];
+			for (int win_chn = 0; win_chn < depth; win_chn++) {
+				maxpool_val[win_chn] = 0;
+			}
+			for (int win_x = 0; win_x < pool_size; win_x++) {
+				for (int win_y = 0; win_y < pool_size; win_y++) {
+					const float* pixel = input + ((long)(x * pool_size + win_x) * width + (y * pool_size + win_y)) * depth;
+					for (int win_chn = 0; win_chn < depth; win_chn++) {
+						if (maxpool_val[win_chn] < pixel[win_chn]) {
+							maxpool_val[win_chn] = pixel[win_chn];
+						}
+					}
+				}
+			}
+			float* out = output + ((long)x * output_width + y) * depth;
+			for (int win_chn = 0; win_chn < depth; win_chn++) {
+				out[win_chn] = maxpool_val[win_chn];
+			}
+		}
+	}
+}
+
+// ############# 2D Adding Layer ############# //
+template <int depth>
+void Add(const float* input_1, const float* input_2, float* output, int height, int width) {
+
+	const long values = (long)height * width * depth;
+	for (long value = 0; value < values; value++) {
+		const float adding_result = input_1[value] + input_2[value];
+		//Apply ReLU activation function.
+		output[value] = adding_result < 0 ? 0 : adding_result;
+	}
+}
+
+// ############# 2D Convolutional Layer - SIGMOID ############# //
+//1x1 output convolution. The sigmoid is disabled, as in the HLS layer, so the outputs are the logits stored in golden_*.txt.
+template <int input_depth, int output_depth>
+void Conv2D_sigmoid(const float* input, float* output, int height, int width, const float* weight_filt, const float* bias) {
+
+	const long pixels = (long)height * width;
+	for (long pixel = 0; pixel < pixels; pixel++) {
+		const float* window = input + pixel * input_depth;
+		float* out = output + pixel * output_depth;
+		for (int filter = 0; filter < output_depth; filter++) {
+			float window_conv_result = bias[filter];
+			for (int win_chn = 0; win_chn < input_depth; win_chn++) {
+				window_conv_result += weight_filt[win_chn * output_depth + filter] * window[win_chn];
+			}
+			out[filter] = window_conv_result;
+		}
+	}
+}
+
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <vector>
+
+namespace flarenet {
+
+// ############# FlareNet Model Weights ############# //
+//All layer weights of weights.h in double precision, loaded once and shared by every engine. Layouts follow weights.h,
+//except for the transposed convolutions, which are repacked from [kx][ky][output][input] to [kx][ky][input][output]
+//so that every kernel reads its weights as [tap][input][output].
+struct ModelWeights {
+	std::vector<double> weights_0, bias_0;
+	std::vector<double> depth_weights_1, point_weights_1, bias_1;
+	std::vector<double> depth_weights_2, point_weights_2, bias_2;
+	std::vector<double> depth_weights_3, point_weights_3, bias_3;
+	std::vector<double> weights_4, bias_4;
+	std::vector<double> weights_5, bias_5;
+	std::vector<double> weights_6, bias_6;
+	std::vector<double> weights_7, bias_7;
+	std::vector<double> weights_8, bias_8;
+};
+
+const ModelWeights& model_weights();
+
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <vector>
+#include "ModelWeights.h"
+
+namespace flarenet {
+
+// ############# Structured Pruning ############# //
+//Load-time structured pruning of the pointwise and transposed convolutions of FlareNet, which hold 98% of its weights.
+//The depthwise kernels have a single weight per tap and channel, so there is no structure to drop, and the input and 1x1
+//output layers have 3 input or output channels: their rows are single weights, and pruning the output layer moves the
+//logits by more than the golden tolerance at a threshold of 0.05. A weight row, the output weights of one (tap, input channel), is set to zero when its largest
+//magnitude is at most threshold, and so is an output channel when its largest weight is; a pruned output channel is
+//relu(bias) everywhere. Threshold 0 only finds rows and channels that are zero already.
+//The result is a ModelWeights like any other. Engine compacts the transposed convolutions of the weights it is given
+//(CompactKernel in TransposedConv.h) and skips their zero rows; those layers hold three quarters of the
+//multiply-accumulates of a frame.
+struct LayerPruning {
+	const char* name;
+	int rows, pruned_rows;
+	int output_channels, pruned_output_channels;
+	//Weights of the layer, and those that are zero after pruning.
+	long weights, zero_weights;
+};
+
+struct PruningReport {
+	double threshold = 0;
+	std::vector<LayerPruning> layers;
+
+	long weights() const;
+	long zero_weights() const;
+};
+
+ModelWeights prune_weights(const ModelWeights& model, double threshold, PruningReport* report = nullptr);
+
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "Isa.h"
+
+namespace flarenet {
+
+// ############# Fused Depthwise Separable 2D Convolutional Layer ############# //
+//SeparableDW2D_relu of FlareNet() with a 3x3 depthwise kernel, on HWC tensors of any size. weight_depth_filt is
+//[3][3][input_depth] and weight_point_filt is [input_depth][output_depth], as in weights.h.
+//The depthwise results of a block of pixels are kept in an L1 panel and fed straight into a register-tiled pointwise
+//micro-GEMM with bias and ReLU, so depthwise_vector never goes through memory per pixel. Instantiated for the three
+//encoder layers (16->32, 32->48, 48->64). An isa the host does not support falls back to the Kernels.h kernel.
+template <int input_depth, int output_depth>
+void fused_separable_dw2d_relu(const float* input, float* output, int height, int width, const float* weight_depth_filt, const float* weight_point_filt, const float* bias, Isa isa = best_isa());
+
+//Computes output rows first_row .. last_row - 1 only, reading the rows around the band from input as its halo.
+template <int input_depth, int output_depth>
+void fused_separable_dw2d_relu(const float* input, float* output, int height, int width, const float* weight_depth_filt, const float* weight_point_filt, const float* bias, int first_row, int last_row, Isa isa = best_isa());
+
+//SeparableDW2D_relu fused with the MaxPooling2D<..., 2, output_depth> after it: output receives the pooled
+//(height/2)x(width/2) tensor, each pair of rows being pooled right after it is computed. The full-resolution tensor is
+//only written if skip is given (the layer feeds a skip connection). first_row and last_row count pooled rows.
+template <int input_depth, int output_depth>
+void fused_separable_dw2d_relu_maxpool(const float* input, float* output, float* skip, int height, int width, const float* weight_depth_filt, const float* weight_point_filt, const float* bias, Isa isa = best_isa());
+
+//Without skip, the full-resolution rows of the band go through scratch, pooled_row_scratch(width, output_depth) floats
+//(Kernels.h) that no other thread uses at the same time.
+template <int input_depth, int output_depth>
+void fused_separable_dw2d_relu_maxpool(const float* input, float* output, float* skip, int height, int width, const float* weight_depth_filt, const float* weight_point_filt, const float* bias, int first_row, int last_row, float* scratch, Isa isa = best_isa());
+
+}
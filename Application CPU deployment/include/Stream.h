@@ -0,0 +1,178 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace flarenet {
+
+//Occupancy of a Stream since it was created or its statistics were reset. Occupancy is sampled after every write (a
+//bulk write that has to wait for room counts once per part), so mean_occupancy averages over writes, not over time.
+struct StreamStats {
+	std::string name;
+	long capacity;
+	//Values written.
+	long values;
+	long max_occupancy;
+	double mean_occupancy;
+	//Writes that found the stream full and reads that found it empty, and had to wait.
+	long full_waits, empty_waits;
+};
+
+// ############# SPSC Stream ############# //
+//Bounded FIFO between one producer thread and one consumer thread, with the interface of hls::stream (read(), write(),
+//>>, <<, empty(), full(), read_nb(), write_nb(), size()), so the processes of a DATAFLOW region can run as threads.
+//A ring of capacity values indexed by two monotonic counters: the producer only advances tail and the consumer only
+//advances head, each publishing with release and observing the other with acquire, so neither side takes a lock.
+//Blocking calls spin while the other side is expected soon and then back off to short sleeps, since a pipeline usually
+//has more processes than cores. The bulk read() and write() move count values in as few steps as the room allows, for
+//processes that move whole rows.
+template <typename T>
+class Stream {
+public:
+	explicit Stream(long capacity, const std::string& name = "") : buffer(capacity), stream_name(name) {}
+
+	Stream(const Stream&) = delete;
+	Stream& operator=(const Stream&) = delete;
+
+	long capacity() const { return (long)buffer.size(); }
+	const std::string& name() const { return stream_name; }
+
+	//Values in the stream (exact only when called by the producer or the consumer with the other side idle).
+	long size() const { return (long)(tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire)); }
+	bool empty() const { return size() == 0; }
+	bool full() const { return size() == capacity(); }
+
+	void write(const T& value) { write(&value, 1); }
+	T read() {
+		T value;
+		read(&value, 1);
+		return value;
+	}
+	void read(T& value) { read(&value, 1); }
+	Stream& operator<<(const T& value) {
+		write(value);
+		return *this;
+	}
+	Stream& operator>>(T& value) {
+		read(value);
+		return *this;
+	}
+
+	//Non-blocking variants: return false instead of waiting.
+	bool write_nb(const T& value) {
+		if (full()) {
+			return false;
+		}
+		write(value);
+		return true;
+	}
+	bool read_nb(T& value) {
+		if (empty()) {
+			return false;
+		}
+		read(value);
+		return true;
+	}
+
+	void write(const T* values, long count) {
+
+		const size_t capacity = buffer.size();
+		size_t position = tail.load(std::memory_order_relaxed);
+		bool waited = false;
+		while (count > 0) {
+			size_t room = capacity - (position - head.load(std::memory_order_acquire));
+			for (int spins = 0; room == 0; room = capacity - (position - head.load(std::memory_order_acquire))) {
+				waited = true;
+				back_off(spins);
+			}
+			const size_t part = std::min(room, (size_t)count);
+			copy_in(values, position, part);
+			position += part;
+			tail.store(position, std::memory_order_release);
+			values += part;
+			count -= (long)part;
+
+			const long occupancy = (long)(capacity - room + part);
+			written += (long)part;
+			max_occupancy = std::max(max_occupancy, occupancy);
+			occupancy_sum += occupancy;
+			samples++;
+		}
+		full_waits += waited ? 1 : 0;
+	}
+
+	void read(T* values, long count) {
+
+		size_t position = head.load(std::memory_order_relaxed);
+		bool waited = false;
+		while (count > 0) {
+			size_t available = tail.load(std::memory_order_acquire) - position;
+			for (int spins = 0; available == 0; available = tail.load(std::memory_order_acquire) - position) {
+				waited = true;
+				back_off(spins);
+			}
+			const size_t part = std::min(available, (size_t)count);
+			copy_out(values, position, part);
+			position += part;
+			head.store(position, std::memory_order_release);
+			values += part;
+			count -= (long)part;
+		}
+		empty_waits += waited ? 1 : 0;
+	}
+
+	//Statistics and their reset must not run while a producer or consumer is active.
+	StreamStats stats() const {
+		return {stream_name, capacity(), written, max_occupancy, samples == 0 ? 0.0 : occupancy_sum / samples, full_waits, empty_waits};
+	}
+	void reset_stats() {
+		written = max_occupancy = samples = full_waits = empty_waits = 0;
+		occupancy_sum = 0;
+	}
+
+private:
+	//Yields the core for the first spins, then sleeps in 20 us steps.
+	static void back_off(int& spins) {
+		if (++spins < 64) {
+			std::this_thread::yield();
+		}
+		else {
+			std::this_thread::sleep_for(std::chrono::microseconds(20));
+		}
+	}
+
+	void copy_in(const T* values, size_t position, size_t count) {
+		const size_t first = position % buffer.size();
+		const size_t first_part = std::min(count, buffer.size() - first);
+		std::copy(values, values + first_part, buffer.begin() + first);
+		std::copy(values + first_part, values + count, buffer.begin());
+	}
+
+	void copy_out(T* values, size_t position, size_t count) const {
+		const size_t first = position % buffer.size();
+		const size_t first_part = std::min(count, buffer.size() - first);
+		std::copy(buffer.begin() + first, buffer.begin() + first + first_part, values);
+		std::copy(buffer.begin(), buffer.begin() + (count - first_part), values + first_part);
+	}
+
+	std::vector<T> buffer;
+	std::string stream_name;
+	//Consumer and producer counters on separate cache lines.
+	std::atomic<size_t> head{0};
+	char head_padding[64 - sizeof(std::atomic<size_t>)];
+	std::atomic<size_t> tail{0};
+	char tail_padding[64 - sizeof(std::atomic<size_t>)];
+
+	//Producer side.
+	long written = 0, max_occupancy = 0, samples = 0, full_waits = 0;
+	double occupancy_sum = 0;
+	//Consumer side.
+	long empty_waits = 0;
+};
+
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace flarenet {
+
+// ############# Thread Pool ############# //
+//Fixed set of worker threads for data-parallel loops. parallel_for(count, task) runs task(0) .. task(count - 1) on the
+//workers and the calling thread and returns once all of them are done, so consecutive calls act as barriers between
+//layers. A pool of size 1 starts no threads and runs every task on the caller.
+class ThreadPool {
+public:
+	explicit ThreadPool(int threads);
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	//Number of threads that run tasks, the caller included.
+	int size() const { return (int)workers.size() + 1; }
+
+	//task is any callable taking the index. It is called through a function pointer on the caller's object, never copied,
+	//so a loop does no heap allocation (a std::function would copy a capturing lambda to the heap).
+	template <typename Task>
+	void parallel_for(int count, const Task& task) {
+		run_loop(count, &task, [](const void* context, int index) { (*static_cast<const Task*>(context))(index); });
+	}
+
+private:
+	void run_loop(int count, const void* task, void (*invoke)(const void*, int));
+	void work();
+	//Claims and runs tasks of the current loop until none is left.
+	void run_tasks();
+
+	std::vector<std::thread> workers;
+	std::mutex mutex;
+	std::condition_variable start, done;
+	//Task of the current loop and the function that calls it, null between loops.
+	const void* current = nullptr;
+	void (*invoke_current)(const void*, int) = nullptr;
+	int task_count = 0;
+	int next_task = 0;
+	int finished_tasks = 0;
+	//Incremented for every loop so that sleeping workers can tell a new loop from a spurious wake-up.
+	unsigned long generation = 0;
+	bool stopping = false;
+};
+
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "FlareNetEngine.h"
+
+namespace flarenet {
+
+struct ModelWeights;
+class ThreadPool;
+
+// ############# FlareNet Tiled Engine ############# //
+//Runs frames of any size (4K video, 12MP stills) as overlapping tile_size x tile_size tiles on single-threaded Engines,
+//so the activations of a tile stay in cache and the memory is bounded by one tile arena per thread instead of growing
+//with the frame. Tiles overlap their neighbours by overlap pixels and start on the 16-pixel grid of the pooling layers,
+//like the tiles of the whole frame would; the last tile of a row or column ends on the frame border (or at most 15
+//pixels past it), and the part of a tile past the frame is zero padded. Each output pixel is the average of the tiles
+//covering it, weighted by a separable feather that rises linearly from zero towards the inside of the tile at every tile edge
+//inside the frame.
+//An output pixel depends on the input pixels from 30 to 45 pixels before it to 15 to 30 pixels after it, depending on
+//its position on the grid; next to a tile edge on the grid, the first context_before pixels after the edge and the last
+//context_after pixels before it see part of the zero padding. The feather is zero on those pixels when the overlap
+//leaves room for a ramp after both (64 pixels and more), so every pixel is taken only from tiles that see all of its
+//context, and the output equals the whole-frame output of Engine up to rounding. Smaller overlaps trade seams for fewer
+//tiles.
+//Tiles run on a thread pool, one Engine per thread, and are blended in tile order, so the output does not depend on the
+//number of threads.
+class TiledEngine {
+public:
+	static const int context_before = 32;
+	static const int context_after = 16;
+	static const int default_tile_size = 256;
+	static const int default_overlap = 64;
+
+	//tile_size must be a positive multiple of Engine::size_multiple and overlap a multiple of it, at most tile_size / 2
+	//(std::invalid_argument otherwise); height and width may be anything.
+	TiledEngine(int height, int width, int threads = 1, int tile_size = default_tile_size, int overlap = default_overlap);
+	TiledEngine(const ModelWeights& model, int height, int width, int threads = 1, int tile_size = default_tile_size, int overlap = default_overlap);
+	~TiledEngine();
+
+	int threads() const { return (int)engines.size(); }
+	int tiles() const { return (int)(row_starts.size() * column_starts.size()); }
+	long frame_values() const { return (long)frame_height * frame_width * Engine::input_depth; }
+
+	//Activation arenas and tile buffers of all threads.
+	size_t memory_bytes() const;
+
+	//Run inference on one height x width x 3 frame, with the buffer layout of Engine::run().
+	void run(const float* in, float* out);
+
+private:
+	int frame_height, frame_width, tile_size;
+	//Tile origins along each axis and the normalized feather weight of every tile row or column, per origin.
+	std::vector<int> row_starts, column_starts;
+	std::vector<std::vector<float>> row_weights, column_weights;
+
+	//Per thread: an Engine for one tile and its input and output tiles.
+	std::vector<std::unique_ptr<Engine>> engines;
+	std::vector<std::vector<float>> tile_inputs, tile_outputs;
+
+	//Threads claim tiles in order from next_tile and blend them strictly in order: a thread waits until blended_tiles
+	//reaches its tile.
+	std::atomic<int> next_tile;
+	std::mutex blend_mutex;
+	std::condition_variable blend_turn;
+	int blended_tiles = 0;
+
+	//Null when running single-threaded.
+	std::unique_ptr<ThreadPool> pool;
+
+	//Claims, runs and blends tiles on the engine of thread until none is left.
+	void run_tiles(const float* in, float* out, int thread);
+	void blend(float* out, int tile, const float* tile_output);
+};
+
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <vector>
+#include "Isa.h"
+
+namespace flarenet {
+
+// ############# Sub-pixel Transposed 2D Convolutional Layer ############# //
+//Conv2D_transposed<3, 2> of FlareNet() (3x3 kernel, stride 2, output cropped to 2*height x 2*width), computed gather-style.
+//Output pixel (2a+px, 2b+py) only sees the kernel taps of its phase (px, py): 4 taps for (0, 0), 2 for (0, 1) and (1, 0),
+//1 for (1, 1). Each output pixel is therefore a dense sum over at most 4 input pixels, written once, with no accumulation
+//buffer. weight_filt is [3][3][input_depth][output_depth] (ModelWeights layout). If skip is given, the following Add layer
+//(skip connection + ReLU) is applied on the way out. Instantiated for the four decoder layers (64->64, 64->48, 48->32,
+//32->16). With AVX2, the dense 64->64 layer is scattered tap by tap instead, which is faster for that layer. An isa the
+//host does not support falls back to a portable gather kernel on Kernels.h vectors.
+template <int input_depth, int output_depth>
+void subpixel_conv2d_transposed(const float* input, float* output, int height, int width, const float* weight_filt, const float* bias, const float* skip = nullptr, Isa isa = best_isa());
+
+//Computes output rows first_row .. last_row - 1 (of the 2*height output rows) only. Output row 2a+px reads input rows a
+//and, for px = 0, a - 1, so a band's halo is the input row above it. Throws std::invalid_argument unless
+//0 <= first_row <= last_row <= 2*height.
+template <int input_depth, int output_depth>
+void subpixel_conv2d_transposed(const float* input, float* output, int height, int width, const float* weight_filt, const float* bias, const float* skip, int first_row, int last_row, Isa isa = best_isa());
+
+//Input rows read by output rows first .. last - 1 of a transposed convolution: output row o reads input rows (o - 1) / 2
+//to o / 2. Run on a view of rows input_first .. input_last - 1, the layer's output starts at row output_first, up to two
+//rows above first.
+struct TransposedView {
+	int input_first, input_last, output_first;
+	TransposedView(int first, int last) : input_first(first == 0 ? 0 : (first - 1) / 2), input_last((last - 1) / 2 + 1), output_first(2 * input_first) {}
+};
+
+//A [3][3][input_depth][output_depth] kernel without its zero (tap, input channel) rows, for weights pruned at load time
+//(see Pruning.h). Per tap (kx * 3 + ky): the input channels of its nonzero rows and those rows, [row][output_depth].
+//Per kernel row kx: the input channels with a nonzero row in any of its three taps and the rows of the three taps for
+//them, [ky][row][output_depth], for the kernels that compute both column phases of a row together.
+struct CompactKernel {
+	int input_depth = 0, output_depth = 0;
+	std::vector<int> tap_channels[9];
+	std::vector<float> tap_weights[9];
+	std::vector<int> row_channels[3];
+	std::vector<float> row_weights[3];
+
+	//Rows kept, out of 9 * input_depth.
+	int rows() const;
+};
+
+CompactKernel compact_kernel(const float* weight_filt, int input_depth, int output_depth);
+
+//Same, on a compacted kernel: the kernels only visit the rows it keeps, so each pruned row saves its multiply-accumulates
+//at every output pixel of its phase. The output is that of the dense kernel with the zero rows (up to the sign of zero).
+//A kernel compacted for another layer throws std::invalid_argument.
+template <int input_depth, int output_depth>
+void subpixel_conv2d_transposed(const float* input, float* output, int height, int width, const CompactKernel& kernel, const float* bias, const float* skip, int first_row, int last_row, Isa isa = best_isa());
+
+}
@@ -0,0 +1,104 @@
+#include <algorithm>
+#include <cstdint>
+#include "ActivationArena.h"
+
+namespace flarenet {
+
+namespace {
+
+size_t align_up(size_t bytes) {
+	return (bytes + ActivationArena::alignment - 1) / ActivationArena::alignment * ActivationArena::alignment;
+}
+
+}
+
+int ActivationArena::add_tensor(size_t count, size_t element_bytes) {
+	tensors.push_back({align_up(count * element_bytes), 0, -1, -1});
+	return (int)tensors.size() - 1;
+}
+
+void ActivationArena::add_step(const std::vector<int>& reads, const std::vector<int>& writes) {
+
+	for (int tensor : writes) {
+		if (tensors[tensor].first_step < 0) {
+			tensors[tensor].first_step = steps;
+		}
+		tensors[tensor].last_step = std::max(tensors[tensor].last_step, steps);
+	}
+	for (int tensor : reads) {
+		tensors[tensor].last_step = std::max(tensors[tensor].last_step, steps);
+	}
+	steps++;
+}
+
+void ActivationArena::plan() {
+
+	std::vector<int> order(tensors.size());
+	for (size_t tensor = 0; tensor < tensors.size(); tensor++) {
+		order[tensor] = (int)tensor;
+	}
+	std::stable_sort(order.begin(), order.end(), [this](int a, int b) { return tensors[a].bytes > tensors[b].bytes; });
+
+	slab_bytes = 0;
+	std::vector<int> placed;
+	for (int tensor : order) {
+		Tensor& current = tensors[tensor];
+		//Tensors already placed whose lifetimes intersect this one, by offset.
+		std::vector<const Tensor*> live;
+		for (int other : placed) {
+			if (tensors[other].first_step <= current.last_step and current.first_step <= tensors[other].last_step) {
+				live.push_back(&tensors[other]);
+			}
+		}
+		std::sort(live.begin(), live.end(), [](const Tensor* a, const Tensor* b) { return a->offset < b->offset; });
+		//Lowest gap that fits.
+		size_t offset = 0;
+		for (const Tensor* other : live) {
+			if (offset + current.bytes <= other->offset) {
+				break;
+			}
+			offset = std::max(offset, other->offset + other->bytes);
+		}
+		current.offset = offset;
+		slab_bytes = std::max(slab_bytes, offset + current.bytes);
+		placed.push_back(tensor);
+	}
+
+	storage.assign(slab_bytes + alignment, 0);
+	const uintptr_t address = reinterpret_cast<uintptr_t>(storage.data());
+	slab = storage.data() + (alignment - address % alignment) % alignment;
+}
+
+float* ActivationArena::data(int tensor) const {
+	return reinterpret_cast<float*>(slab + tensors[tensor].offset);
+}
+
+void* ActivationArena::raw_data(int tensor) const {
+	return slab + tensors[tensor].offset;
+}
+
+size_t ActivationArena::total_bytes() const {
+
+	size_t bytes = 0;
+	for (const Tensor& tensor : tensors) {
+		bytes += tensor.bytes;
+	}
+	return bytes;
+}
+
+size_t ActivationArena::lower_bound_bytes() const {
+
+	size_t bound = 0;
+	for (int step = 0; step < steps; step++) {
+		size_t bytes = 0;
+		for (const Tensor& tensor : tensors) {
+			if (tensor.first_step <= step and step <= tensor.last_step) {
+				bytes += tensor.bytes;
+			}
+		}
+		bound = std::max(bound, bytes);
+	}
+	return bound;
+}
+
+}
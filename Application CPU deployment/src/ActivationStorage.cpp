@@ -0,0 +1,216 @@
+#include <cmath>
+#include <cstring>
+#include "ActivationStorage.h"
+#ifdef FLARENET_X86_SIMD
+#include <immintrin.h>
+#endif
+
+namespace flarenet {
+
+namespace {
+
+uint32_t float_bits(float value) {
+	uint32_t bits;
+	std::memcpy(&bits, &value, sizeof(bits));
+	return bits;
+}
+
+float bits_float(uint32_t bits) {
+	float value;
+	std::memcpy(&value, &bits, sizeof(value));
+	return value;
+}
+
+uint16_t float_to_fp16(float value) {
+
+	const uint32_t bits = float_bits(value);
+	const uint16_t sign = (bits >> 16) & 0x8000;
+	const uint32_t magnitude = bits & 0x7fffffff;
+	if (magnitude > 0x7f800000) {
+		return sign | 0x7e00;
+	}
+	if (magnitude >= 0x47800000) {
+		//65536 and above (and infinity) overflow.
+		return sign | 0x7c00;
+	}
+	if (magnitude < 0x38800000) {
+		//Below 2^-14: a subnormal half, a multiple of 2^-24 (exact in float, rounded to nearest even by nearbyint).
+		return sign | (uint16_t)std::nearbyint(std::fabs(value) * 16777216.0f);
+	}
+	//Rebias the exponent and round the 13 dropped mantissa bits to nearest even; a carry moves into the exponent.
+	uint32_t half = magnitude - 0x38000000;
+	half += 0x0fff + ((half >> 13) & 1);
+	return sign | (uint16_t)(half >> 13);
+}
+
+float fp16_to_float(uint16_t value) {
+
+	const uint32_t sign = (uint32_t)(value & 0x8000) << 16;
+	const uint32_t exponent = (value >> 10) & 0x1f;
+	const uint32_t mantissa = value & 0x3ff;
+	if (exponent == 0) {
+		const float magnitude = mantissa / 16777216.0f;
+		return sign != 0 ? -magnitude : magnitude;
+	}
+	if (exponent == 31) {
+		return bits_float(sign | 0x7f800000 | mantissa << 13);
+	}
+	return bits_float(sign | (exponent + 112) << 23 | mantissa << 13);
+}
+
+//Rounds to nearest even and flushes float denormals to zero, as VCVTNEPS2BF16 does.
+uint16_t float_to_bf16(float value) {
+
+	const uint32_t bits = float_bits(value);
+	if ((bits & 0x7fffffff) > 0x7f800000) {
+		return (bits >> 16) | 0x40;
+	}
+	if ((bits & 0x7f800000) == 0) {
+		return (bits >> 16) & 0x8000;
+	}
+	return (uint16_t)((bits + 0x7fff + ((bits >> 16) & 1)) >> 16);
+}
+
+float bf16_to_float(uint16_t value) {
+	return bits_float((uint32_t)value << 16);
+}
+
+void store_scalar(const float* input, uint16_t* output, long count, ActivationStorage storage) {
+	for (long value = 0; value < count; value++) {
+		output[value] = storage == ActivationStorage::fp16 ? float_to_fp16(input[value]) : float_to_bf16(input[value]);
+	}
+}
+
+void load_scalar(const uint16_t* input, float* output, long count, ActivationStorage storage) {
+	for (long value = 0; value < count; value++) {
+		output[value] = storage == ActivationStorage::fp16 ? fp16_to_float(input[value]) : bf16_to_float(input[value]);
+	}
+}
+
+#ifdef FLARENET_X86_SIMD
+bool f16c_supported() {
+	static const bool supported = __builtin_cpu_supports("f16c");
+	return supported;
+}
+
+bool avx512_bf16_supported() {
+	static const bool supported = __builtin_cpu_supports("avx512bf16");
+	return supported;
+}
+
+__attribute__((target("avx2,f16c")))
+long store_fp16_avx2(const float* input, uint16_t* output, long count) {
+	long value = 0;
+	for (; value + 8 <= count; value += 8) {
+		_mm_storeu_si128((__m128i*)(output + value), _mm256_cvtps_ph(_mm256_loadu_ps(input + value), _MM_FROUND_TO_NEAREST_INT));
+	}
+	return value;
+}
+
+__attribute__((target("avx2,f16c")))
+long load_fp16_avx2(const uint16_t* input, float* output, long count) {
+	long value = 0;
+	for (; value + 8 <= count; value += 8) {
+		_mm256_storeu_ps(output + value, _mm256_cvtph_ps(_mm_loadu_si128((const __m128i*)(input + value))));
+	}
+	return value;
+}
+
+__attribute__((target("avx512f")))
+long store_fp16_avx512(const float* input, uint16_t* output, long count) {
+	long value = 0;
+	for (; value + 16 <= count; value += 16) {
+		_mm256_storeu_si256((__m256i*)(output + value), _mm512_cvtps_ph(_mm512_loadu_ps(input + value), _MM_FROUND_TO_NEAREST_INT));
+	}
+	return value;
+}
+
+__attribute__((target("avx512f")))
+long load_fp16_avx512(const uint16_t* input, float* output, long count) {
+	long value = 0;
+	for (; value + 16 <= count; value += 16) {
+		_mm512_storeu_ps(output + value, _mm512_cvtph_ps(_mm256_loadu_si256((const __m256i*)(input + value))));
+	}
+	return value;
+}
+
+__attribute__((target("avx512f,avx512bf16")))
+long store_bf16_avx512(const float* input, uint16_t* output, long count) {
+	long value = 0;
+	for (; value + 16 <= count; value += 16) {
+		const __m256bh converted = _mm512_cvtneps_pbh(_mm512_loadu_ps(input + value));
+		std::memcpy(output + value, &converted, sizeof(converted));
+	}
+	return value;
+}
+
+//A bf16 value is the upper half of a float: widen and shift, no BF16 instruction needed.
+__attribute__((target("avx512f")))
+long load_bf16_avx512(const uint16_t* input, float* output, long count) {
+	long value = 0;
+	for (; value + 16 <= count; value += 16) {
+		const __m512i widened = _mm512_cvtepu16_epi32(_mm256_loadu_si256((const __m256i*)(input + value)));
+		_mm512_storeu_ps(output + value, _mm512_castsi512_ps(_mm512_slli_epi32(widened, 16)));
+	}
+	return value;
+}
+#endif
+
+}
+
+const char* storage_name(ActivationStorage storage) {
+	switch (storage) {
+	case ActivationStorage::fp16:
+		return "fp16";
+	case ActivationStorage::bf16:
+		return "bf16";
+	default:
+		return "fp32";
+	}
+}
+
+int storage_bytes(ActivationStorage storage) {
+	return storage == ActivationStorage::fp32 ? 4 : 2;
+}
+
+void store_activations(const float* input, uint16_t* output, long count, ActivationStorage storage, Isa isa) {
+
+	if (!isa_supported(isa)) {
+		isa = Isa::scalar;
+	}
+	long done = 0;
+#ifdef FLARENET_X86_SIMD
+	if (storage == ActivationStorage::fp16 and isa == Isa::avx512) {
+		done = store_fp16_avx512(input, output, count);
+	}
+	else if (storage == ActivationStorage::fp16 and isa == Isa::avx2 and f16c_supported()) {
+		done = store_fp16_avx2(input, output, count);
+	}
+	else if (storage == ActivationStorage::bf16 and isa == Isa::avx512 and avx512_bf16_supported()) {
+		done = store_bf16_avx512(input, output, count);
+	}
+#endif
+	store_scalar(input + done, output + done, count - done, storage);
+}
+
+void load_activations(const uint16_t* input, float* output, long count, ActivationStorage storage, Isa isa) {
+
+	if (!isa_supported(isa)) {
+		isa = Isa::scalar;
+	}
+	long done = 0;
+#ifdef FLARENET_X86_SIMD
+	if (storage == ActivationStorage::fp16 and isa == Isa::avx512) {
+		done = load_fp16_avx512(input, output, count);
+	}
+	else if (storage == ActivationStorage::fp16 and isa == Isa::avx2 and f16c_supported()) {
+		done = load_fp16_avx2(input, output, count);
+	}
+	else if (storage == ActivationStorage::bf16 and isa == Isa::avx512) {
+		done = load_bf16_avx512(input, output, count);
+	}
+#endif
+	load_scalar(input + done, output + done, count - done, storage);
+}
+
+}
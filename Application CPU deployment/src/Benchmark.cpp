@@ -0,0 +1,172 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "DataflowEngine.h"
+#include "FlareNetEngine.h"
+#include "Int8Engine.h"
+#include "TiledEngine.h"
+
+using namespace std::chrono;
+
+// Times engine.run() on input, after a warm-up frame.
+template <typename EngineType, typename Input, typename Output>
+static void report(const char* name, EngineType& engine, const std::vector<Input>& input, std::vector<Output>& output, int iterations) {
+
+	//Warm up caches before timing.
+	engine.run(input.data(), output.data());
+
+	//Time every frame: the average is the sustained rate, the best frame shows the rate without scheduler noise.
+	double total_ms = 0;
+	double best_ms = 1e9;
+	for (int i = 0; i < iterations; i++) {
+		auto start_inference = high_resolution_clock::now();
+		engine.run(input.data(), output.data());
+		const double frame_ms = duration_cast<microseconds>(high_resolution_clock::now() - start_inference).count() / 1000.0;
+		total_ms += frame_ms;
+		best_ms = std::min(best_ms, frame_ms);
+	}
+
+	const double mean_ms = total_ms / iterations;
+	std::cout << name << '\n';
+	std::cout << "Average execution time (ms): " << mean_ms << " (" << 1000.0 / mean_ms << " fps)\n";
+	std::cout << "Best execution time (ms): " << best_ms << " (" << 1000.0 / best_ms << " fps)\n";
+}
+
+// Single-threaded throughput of the native float and int8 engines on a 256x256x3 frame (the float engine also with 8-bit
+// pixels in and out, and the startup time of the int8 engine, calibrated or loaded from its weight cache), the latency of the float
+// engine with row-band parallelism for 1 to max_threads threads (second argument, 32 by default) and on the dataflow
+// engine (one thread per layer process), and the single-threaded
+// throughput of run_batch() for batches of 1 to 64 frames (best of batch_iterations batches), then the float engine on
+// full-HD frames (1920x1080 padded to 1088 rows, the next multiple of 16) with 1 thread and with every hardware thread,
+// the float engine with its skip connections stored in fp16 and bf16 (256x256 and full HD), and finally 4K frames on the
+// whole-frame engine and on TiledEngine, and 12MP stills (4000x3000) on TiledEngine.
+int main(int argc, char** argv) {
+
+	const int iterations = argc > 1 ? std::atoi(argv[1]) : 200;
+	const int max_threads = argc > 2 ? std::atoi(argv[2]) : 32;
+	const int batch_iterations = std::max(iterations / 20, 3);
+	const int num_values = flarenet::Engine::input_size * flarenet::Engine::input_size * flarenet::Engine::input_depth;
+	std::vector<float> input(num_values), output(num_values);
+	for (int x = 0; x < num_values; x++) {
+		input[x] = (x % 255) / 255.0f;
+	}
+
+	flarenet::Engine engine;
+	const flarenet::ActivationArena& activations = engine.activations();
+	std::cout << "Activation memory (MB): peak " << activations.peak_bytes() / 1e6 << ", lower bound " << activations.lower_bound_bytes() / 1e6 << ", without reuse " << activations.total_bytes() / 1e6 << '\n';
+	report("float engine", engine, input, output, iterations);
+	std::vector<uint8_t> pixel_input(num_values), pixel_output(num_values);
+	for (int x = 0; x < num_values; x++) {
+		pixel_input[x] = (uint8_t)(x % 255);
+	}
+	report("float engine, 8-bit pixels in and out", engine, pixel_input, pixel_output, iterations);
+	auto start_construction = high_resolution_clock::now();
+	flarenet::Int8Engine int8_engine({input.data()});
+	const double calibrated_ms = duration_cast<microseconds>(high_resolution_clock::now() - start_construction).count() / 1000.0;
+	report("int8 engine", int8_engine, input, output, iterations);
+	int8_engine.save("int8_weights.cache");
+	start_construction = high_resolution_clock::now();
+	flarenet::Int8Engine cached_int8_engine("int8_weights.cache");
+	const double cached_ms = duration_cast<microseconds>(high_resolution_clock::now() - start_construction).count() / 1000.0;
+	std::remove("int8_weights.cache");
+	std::cout << "int8 engine startup (ms): " << calibrated_ms << " calibrated on one frame, " << cached_ms << " from the weight cache\n";
+
+	std::cout << "\nThread scaling (" << std::thread::hardware_concurrency() << " hardware threads)\n";
+	for (int threads : {1, 2, 4, 8, 12, 16, 24, 32}) {
+		if (threads > max_threads) {
+			break;
+		}
+		flarenet::Engine threaded_engine(threads);
+		report(("float engine, " + std::to_string(threads) + " threads").c_str(), threaded_engine, input, output, iterations);
+	}
+
+	std::cout << "\nDataflow engine (" << flarenet::DataflowEngine::processes << " processes on threads)\n";
+	{
+		flarenet::DataflowEngine dataflow_engine;
+		report("dataflow engine", dataflow_engine, input, output, iterations);
+	}
+
+	std::cout << "\nBatch throughput (" << batch_iterations << " batches each)\n";
+	for (int batch : {1, 2, 4, 8, 16, 32, 64}) {
+		flarenet::Engine batch_engine(1, batch);
+		std::vector<float> batch_input((long)batch * num_values), batch_output((long)batch * num_values);
+		for (int frame = 0; frame < batch; frame++) {
+			std::copy(input.begin(), input.end(), batch_input.begin() + (long)frame * num_values);
+		}
+		batch_engine.run_batch(batch_input.data(), batch_output.data(), batch);
+		double best_ms = 1e9;
+		for (int i = 0; i < batch_iterations; i++) {
+			auto start_batch = high_resolution_clock::now();
+			batch_engine.run_batch(batch_input.data(), batch_output.data(), batch);
+			best_ms = std::min(best_ms, duration_cast<microseconds>(high_resolution_clock::now() - start_batch).count() / 1000.0);
+		}
+		std::cout << "batch " << batch << ": " << best_ms / batch << " ms per frame (" << 1000.0 * batch / best_ms << " fps), activation memory " << batch_engine.activations().peak_bytes() / 1e6 << " MB\n";
+	}
+
+	std::cout << "\nFull HD (1920x1088)\n";
+	const int hd_iterations = std::max(iterations / 20, 3);
+	for (int threads : {1, (int)std::thread::hardware_concurrency()}) {
+		flarenet::Engine hd_engine(threads, 1, 1088, 1920);
+		std::vector<float> hd_input(hd_engine.frame_values()), hd_output(hd_engine.frame_values());
+		for (long x = 0; x < hd_engine.frame_values(); x++) {
+			hd_input[x] = (x % 255) / 255.0f;
+		}
+		std::cout << "activation memory " << hd_engine.activations().peak_bytes() / 1e6 << " MB\n";
+		report(("float engine, " + std::to_string(threads) + " threads").c_str(), hd_engine, hd_input, hd_output, hd_iterations);
+		std::vector<uint8_t> hd_pixel_input(hd_engine.frame_values()), hd_pixel_output(hd_engine.frame_values());
+		for (long x = 0; x < hd_engine.frame_values(); x++) {
+			hd_pixel_input[x] = (uint8_t)(x % 255);
+		}
+		report(("float engine, " + std::to_string(threads) + " threads, 8-bit pixels in and out").c_str(), hd_engine, hd_pixel_input, hd_pixel_output, hd_iterations);
+		if (threads == 1 and std::thread::hardware_concurrency() <= 1) {
+			break;
+		}
+	}
+
+	std::cout << "\nSkip connections stored in 16 bits (1 thread)\n";
+	for (int height : {256, 1088}) {
+		const int width = height == 256 ? 256 : 1920;
+		for (flarenet::ActivationStorage storage : {flarenet::ActivationStorage::fp32, flarenet::ActivationStorage::fp16, flarenet::ActivationStorage::bf16}) {
+			flarenet::Engine storage_engine(1, 1, height, width, storage);
+			std::vector<float> storage_input(storage_engine.frame_values()), storage_output(storage_engine.frame_values());
+			for (long x = 0; x < storage_engine.frame_values(); x++) {
+				storage_input[x] = (x % 255) / 255.0f;
+			}
+			const std::string name = std::to_string(width) + "x" + std::to_string(height) + ", " + flarenet::storage_name(storage);
+			std::cout << name << ": activation memory " << storage_engine.activations().peak_bytes() / 1e6 << " MB\n";
+			report(name.c_str(), storage_engine, storage_input, storage_output, height == 256 ? iterations : hd_iterations);
+		}
+	}
+
+	std::cout << "\n4K (3840x2160) and 12MP (4000x3000)\n";
+	{
+		flarenet::Engine uhd_engine(1, 1, 2160, 3840);
+		std::vector<float> uhd_input(uhd_engine.frame_values()), uhd_output(uhd_engine.frame_values());
+		for (long x = 0; x < uhd_engine.frame_values(); x++) {
+			uhd_input[x] = (x % 255) / 255.0f;
+		}
+		std::cout << "whole frame: activation memory " << uhd_engine.activations().peak_bytes() / 1e6 << " MB\n";
+		report("float engine, 4K, 1 thread", uhd_engine, uhd_input, uhd_output, 3);
+	}
+	for (int height : {2160, 3000}) {
+		const int width = height == 2160 ? 3840 : 4000;
+		for (int threads : {1, (int)std::thread::hardware_concurrency()}) {
+			flarenet::TiledEngine tiled_engine(height, width, threads);
+			std::vector<float> tiled_input(tiled_engine.frame_values()), tiled_output(tiled_engine.frame_values());
+			for (long x = 0; x < tiled_engine.frame_values(); x++) {
+				tiled_input[x] = (x % 255) / 255.0f;
+			}
+			std::cout << tiled_engine.tiles() << " tiles: memory " << tiled_engine.memory_bytes() / 1e6 << " MB\n";
+			report(("tiled engine, " + std::to_string(width) + "x" + std::to_string(height) + ", " + std::to_string(threads) + " threads").c_str(), tiled_engine, tiled_input, tiled_output, 3);
+			if (threads == 1 and std::thread::hardware_concurrency() <= 1) {
+				break;
+			}
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,262 @@
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+#include "DataflowEngine.h"
+#include "InputConv.h"
+#include "Kernels.h"
+#include "ModelWeights.h"
+#include "SeparableConv.h"
+#include "TransposedConv.h"
+
+namespace flarenet {
+
+namespace {
+
+std::vector<float> to_float(const std::vector<double>& values) {
+	return std::vector<float>(values.begin(), values.end());
+}
+
+int frame_size(int size) {
+	if (size <= 0 or size % Engine::size_multiple != 0) {
+		throw std::invalid_argument("DataflowEngine: frame height and width must be positive multiples of 16");
+	}
+	return size;
+}
+
+int stream_row_count(int rows) {
+	if (rows <= 0) {
+		throw std::invalid_argument("DataflowEngine: streams must hold at least one row");
+	}
+	return rows;
+}
+
+//The rows of a layer's input that its process currently needs, read from the input stream as they are first needed.
+//Rows first .. loaded - 1 are contiguous in a buffer of four times the largest view, which is compacted when a new row
+//would not fit, so rows are moved once every few views at most.
+class RowWindow {
+public:
+	RowWindow(Stream<float>& stream, long row_values, int max_rows) : stream(stream), row_values(row_values), capacity_rows(4 * max_rows), buffer(row_values * capacity_rows) {}
+
+	void reset() {
+		first = loaded = base = 0;
+	}
+
+	//Rows first_row .. last_row - 1 as a view, dropping the rows before first_row. first_row never decreases.
+	const float* rows(int first_row, int last_row) {
+		base += first_row - first;
+		first = first_row;
+		if (base + (last_row - first) > capacity_rows) {
+			std::memmove(buffer.data(), buffer.data() + base * row_values, (loaded - first) * row_values * sizeof(float));
+			base = 0;
+		}
+		if (last_row > loaded) {
+			stream.read(buffer.data() + (base + loaded - first) * row_values, (last_row - loaded) * row_values);
+			loaded = last_row;
+		}
+		return buffer.data() + base * row_values;
+	}
+
+private:
+	Stream<float>& stream;
+	long row_values;
+	int capacity_rows;
+	std::vector<float> buffer;
+	int first = 0, loaded = 0, base = 0;
+};
+
+//An encoder layer fused with pooling, layer(input, output, skip, height, first_row, last_row, scratch) on a view of its
+//input, one pooled row at a time: the view starts on the even row above the halo row of the pooled row and ends after
+//the halo row below it, like the chunks of store_skip_chunks() in FlareNetEngine.cpp. The pooled row goes to output and,
+//if skip is given, the two full-resolution rows to skip; otherwise they go through the scratch tile of the process.
+template <typename Layer>
+void encoder_process(Stream<float>& input, Stream<float>& output, Stream<float>* skip, int height, int width, int input_depth, int depth, int frames, Layer layer) {
+
+	const long input_row = (long)width * input_depth, row = (long)width * depth, pooled_row = (long)(width / 2) * depth;
+	RowWindow window(input, input_row, 6);
+	std::vector<float> pooled(3 * pooled_row), full(6 * row), scratch(skip == nullptr ? pooled_row_scratch(width, depth) : 0);
+	for (int frame = 0; frame < frames; frame++) {
+		window.reset();
+		for (int r = 0; r < height / 2; r++) {
+			const int view_first = std::max(2 * r - 2, 0);
+			const int view_last = std::min(2 * r + 4, height);
+			const int offset = view_first / 2;
+			layer(window.rows(view_first, view_last), pooled.data(), skip == nullptr ? nullptr : full.data(), view_last - view_first, r - offset, r - offset + 1, scratch.data());
+			output.write(pooled.data() + (r - offset) * pooled_row, pooled_row);
+			if (skip != nullptr) {
+				skip->write(full.data() + (2 * r - view_first) * row, 2 * row);
+			}
+		}
+	}
+}
+
+//A transposed convolution, layer(input, output, height, first_row, last_row) on a view of its input, two output rows
+//(one input row) at a time (TransposedView in TransposedConv.h).
+template <typename Layer>
+void transposed_process(Stream<float>& input, Stream<float>& output, int height, int width, int input_depth, int depth, int frames, Layer layer) {
+
+	const long input_row = (long)width * input_depth, row = (long)(2 * width) * depth;
+	RowWindow window(input, input_row, 2);
+	std::vector<float> rows(4 * row);
+	for (int frame = 0; frame < frames; frame++) {
+		window.reset();
+		for (int first = 0; first < 2 * height; first += 2) {
+			const TransposedView view(first, first + 2);
+			layer(window.rows(view.input_first, view.input_last), rows.data(), view.input_last - view.input_first, first - view.output_first, first - view.output_first + 2);
+			output.write(rows.data() + (first - view.output_first) * row, 2 * row);
+		}
+	}
+}
+
+//Add<depth> (skip connection plus ReLU), row by row.
+template <int depth>
+void add_process(Stream<float>& input_1, Stream<float>& input_2, Stream<float>& output, int height, int width, int frames) {
+
+	const long row = (long)width * depth;
+	std::vector<float> row_1(row), row_2(row), sum(row);
+	for (long x = 0; x < (long)frames * height; x++) {
+		input_1.read(row_1.data(), row);
+		input_2.read(row_2.data(), row);
+		add_relu<depth>(row_1.data(), row_2.data(), sum.data(), 1, width);
+		output.write(sum.data(), row);
+	}
+}
+
+}
+
+DataflowEngine::DataflowEngine(int height, int width, int stream_rows) : DataflowEngine(model_weights(), height, width, stream_rows) {
+}
+
+DataflowEngine::DataflowEngine(const ModelWeights& model, int height, int width, int stream_rows)
+	: frame_height(frame_size(height)), frame_width(frame_size(width)),
+	  weights_0(to_float(model.weights_0)), winograd_weights_0(input_winograd_weights(weights_0.data())), bias_0(to_float(model.bias_0)),
+	  depth_weights_1(to_float(model.depth_weights_1)), point_weights_1(to_float(model.point_weights_1)), bias_1(to_float(model.bias_1)),
+	  depth_weights_2(to_float(model.depth_weights_2)), point_weights_2(to_float(model.point_weights_2)), bias_2(to_float(model.bias_2)),
+	  depth_weights_3(to_float(model.depth_weights_3)), point_weights_3(to_float(model.point_weights_3)), bias_3(to_float(model.bias_3)),
+	  weights_4(to_float(model.weights_4)), bias_4(to_float(model.bias_4)),
+	  weights_5(to_float(model.weights_5)), bias_5(to_float(model.bias_5)),
+	  weights_6(to_float(model.weights_6)), bias_6(to_float(model.bias_6)),
+	  weights_7(to_float(model.weights_7)), bias_7(to_float(model.bias_7)),
+	  weights_8(to_float(model.weights_8)), bias_8(to_float(model.bias_8)),
+	  winograd(best_isa() == Isa::avx512),
+	  input_stream((long)stream_row_count(stream_rows) * width * 3, "input_stream"),
+	  stream_skip_1((long)height * width * 16, "stream_skip_1"),
+	  stream_1((long)stream_rows * (width / 2) * 16, "stream_1"),
+	  stream_3((long)stream_rows * (width / 4) * 32, "stream_3"),
+	  stream_skip_2((long)(height / 4) * (width / 4) * 48, "stream_skip_2"),
+	  stream_5((long)stream_rows * (width / 8) * 48, "stream_5"),
+	  stream_7((long)stream_rows * (width / 16) * 64, "stream_7"),
+	  stream_8((long)stream_rows * (width / 8) * 64, "stream_8"),
+	  stream_9((long)stream_rows * (width / 4) * 48, "stream_9"),
+	  stream_10((long)stream_rows * (width / 4) * 48, "stream_10"),
+	  stream_11((long)stream_rows * (width / 2) * 32, "stream_11"),
+	  stream_12((long)stream_rows * width * 16, "stream_12"),
+	  stream_13((long)stream_rows * width * 16, "stream_13"),
+	  output_stream((long)stream_rows * width * 3, "output_stream") {
+
+	streams = {&input_stream, &stream_skip_1, &stream_1, &stream_3, &stream_skip_2, &stream_5, &stream_7, &stream_8, &stream_9, &stream_10, &stream_11, &stream_12, &stream_13, &output_stream};
+}
+
+DataflowEngine::~DataflowEngine() {
+}
+
+void DataflowEngine::run(const float* in, float* out) {
+	run_batch(in, out, 1);
+}
+
+void DataflowEngine::run_batch(const float* in, float* out, int n) {
+
+	const int h = frame_height, w = frame_width;
+	std::vector<std::thread> threads;
+
+	//Read the frames into the input stream.
+	threads.emplace_back([&]() {
+		input_stream.write(in, n * frame_values());
+	});
+	//Encoder Layers (every convolution is fused with the MaxPooling2D that follows it)
+	threads.emplace_back([&]() {
+		encoder_process(input_stream, stream_1, &stream_skip_1, h, w, 3, 16, n, [&](const float* input, float* output, float* skip, int height, int first, int last, float* scratch) {
+			if (winograd) {
+				input_conv2d_relu_maxpool_winograd(input, output, skip, height, w, winograd_weights_0.data(), bias_0.data(), first, last);
+			}
+			else {
+				input_conv2d_relu_maxpool(input, output, skip, height, w, weights_0.data(), bias_0.data(), first, last, scratch);
+			}
+		});
+	});
+	threads.emplace_back([&]() {
+		encoder_process(stream_1, stream_3, nullptr, h / 2, w / 2, 16, 32, n, [&](const float* input, float* output, float* skip, int height, int first, int last, float* scratch) {
+			fused_separable_dw2d_relu_maxpool<16, 32>(input, output, skip, height, w / 2, depth_weights_1.data(), point_weights_1.data(), bias_1.data(), first, last, scratch);
+		});
+	});
+	threads.emplace_back([&]() {
+		encoder_process(stream_3, stream_5, &stream_skip_2, h / 4, w / 4, 32, 48, n, [&](const float* input, float* output, float* skip, int height, int first, int last, float* scratch) {
+			fused_separable_dw2d_relu_maxpool<32, 48>(input, output, skip, height, w / 4, depth_weights_2.data(), point_weights_2.data(), bias_2.data(), first, last, scratch);
+		});
+	});
+	threads.emplace_back([&]() {
+		encoder_process(stream_5, stream_7, nullptr, h / 8, w / 8, 48, 64, n, [&](const float* input, float* output, float* skip, int height, int first, int last, float* scratch) {
+			fused_separable_dw2d_relu_maxpool<48, 64>(input, output, skip, height, w / 8, depth_weights_3.data(), point_weights_3.data(), bias_3.data(), first, last, scratch);
+		});
+	});
+	//Decoder Layers
+	threads.emplace_back([&]() {
+		transposed_process(stream_7, stream_8, h / 16, w / 16, 64, 64, n, [&](const float* input, float* output, int height, int first, int last) {
+			subpixel_conv2d_transposed<64, 64>(input, output, height, w / 16, weights_4.data(), bias_4.data(), nullptr, first, last);
+		});
+	});
+	threads.emplace_back([&]() {
+		transposed_process(stream_8, stream_9, h / 8, w / 8, 64, 48, n, [&](const float* input, float* output, int height, int first, int last) {
+			subpixel_conv2d_transposed<64, 48>(input, output, height, w / 8, weights_5.data(), bias_5.data(), nullptr, first, last);
+		});
+	});
+	threads.emplace_back([&]() {
+		add_process<48>(stream_skip_2, stream_9, stream_10, h / 4, w / 4, n);
+	});
+	threads.emplace_back([&]() {
+		transposed_process(stream_10, stream_11, h / 4, w / 4, 48, 32, n, [&](const float* input, float* output, int height, int first, int last) {
+			subpixel_conv2d_transposed<48, 32>(input, output, height, w / 4, weights_6.data(), bias_6.data(), nullptr, first, last);
+		});
+	});
+	threads.emplace_back([&]() {
+		transposed_process(stream_11, stream_12, h / 2, w / 2, 32, 16, n, [&](const float* input, float* output, int height, int first, int last) {
+			subpixel_conv2d_transposed<32, 16>(input, output, height, w / 2, weights_7.data(), bias_7.data(), nullptr, first, last);
+		});
+	});
+	threads.emplace_back([&]() {
+		add_process<16>(stream_skip_1, stream_12, stream_13, h, w, n);
+	});
+	threads.emplace_back([&]() {
+		const long row = (long)w * 16;
+		std::vector<float> input(row), output((long)w * 3);
+		for (long x = 0; x < (long)n * h; x++) {
+			stream_13.read(input.data(), row);
+			conv2d_sigmoid<16, 3>(input.data(), output.data(), 1, w, weights_8.data(), bias_8.data());
+			output_stream.write(output.data(), (long)w * 3);
+		}
+	});
+	//Write the output stream into the output frames.
+	threads.emplace_back([&]() {
+		output_stream.read(out, n * frame_values());
+	});
+
+	for (std::thread& thread : threads) {
+		thread.join();
+	}
+}
+
+std::vector<StreamStats> DataflowEngine::stream_stats() const {
+	std::vector<StreamStats> stats;
+	for (const Stream<float>* stream : streams) {
+		stats.push_back(stream->stats());
+	}
+	return stats;
+}
+
+void DataflowEngine::reset_stream_stats() {
+	for (Stream<float>* stream : streams) {
+		stream->reset_stats();
+	}
+}
+
+}
@@ -0,0 +1,92 @@
+#include <cmath>
+#include <cstdlib>
+#include <stdexcept>
+#include "FixedEngine.h"
+#include "FixedKernels.h"
+#include "ModelWeights.h"
+#include "sigmoid_table.h"
+
+namespace flarenet {
+
+namespace {
+
+//Products of a weight and an 18-bit activation stay exact in int32 only if the weight is below 8 in magnitude.
+const double max_fixed_weight = 8.0;
+
+std::vector<int32_t> to_fixed(const std::vector<double>& values) {
+	std::vector<int32_t> fixed(values.size());
+	for (size_t x = 0; x < values.size(); x++) {
+		if (std::fabs(values[x]) >= max_fixed_weight) {
+			throw std::runtime_error("FixedEngine: weight magnitude exceeds the int32 product range");
+		}
+		fixed[x] = FixedEngine::quantize(values[x]);
+	}
+	return fixed;
+}
+
+}
+
+int32_t FixedEngine::quantize(double value) {
+	return wrap_fixed((int32_t)(int64_t)std::floor(std::ldexp(value, fixed_fraction_bits)));
+}
+
+double FixedEngine::to_double(int32_t value) {
+	return std::ldexp((double)value, -fixed_fraction_bits);
+}
+
+uint8_t FixedEngine::sigmoid_pixel(int32_t logit) {
+
+	//|logit| * sigmoid_table_steps, truncated: the raw magnitude without its last 10 - 6 fraction bits.
+	const int step = std::abs(logit) >> (fixed_fraction_bits - 6);
+	static_assert(sigmoid_table_steps == 1 << 6, "sigmoid table steps must be 1/64");
+	const uint8_t pixel = step < sigmoid_table_size ? sigmoid_table[step] : 255;
+	return logit < 0 ? 255 - pixel : pixel;
+}
+
+FixedEngine::FixedEngine() : FixedEngine(model_weights()) {
+}
+
+FixedEngine::FixedEngine(const ModelWeights& model)
+	: weights_0(to_fixed(model.weights_0)), bias_0(to_fixed(model.bias_0)),
+	  depth_weights_1(to_fixed(model.depth_weights_1)), point_weights_1(to_fixed(model.point_weights_1)), bias_1(to_fixed(model.bias_1)),
+	  depth_weights_2(to_fixed(model.depth_weights_2)), point_weights_2(to_fixed(model.point_weights_2)), bias_2(to_fixed(model.bias_2)),
+	  depth_weights_3(to_fixed(model.depth_weights_3)), point_weights_3(to_fixed(model.point_weights_3)), bias_3(to_fixed(model.bias_3)),
+	  weights_4(to_fixed(model.weights_4)), bias_4(to_fixed(model.bias_4)),
+	  weights_5(to_fixed(model.weights_5)), bias_5(to_fixed(model.bias_5)),
+	  weights_6(to_fixed(model.weights_6)), bias_6(to_fixed(model.bias_6)),
+	  weights_7(to_fixed(model.weights_7)), bias_7(to_fixed(model.bias_7)),
+	  weights_8(to_fixed(model.weights_8)), bias_8(to_fixed(model.bias_8)),
+	  stream_0(256 * 256 * 16), stream_1(128 * 128 * 16), stream_2(128 * 128 * 32), stream_3(64 * 64 * 32),
+	  stream_4(64 * 64 * 48), stream_5(32 * 32 * 48), stream_6(32 * 32 * 64), stream_7(16 * 16 * 64),
+	  stream_8(32 * 32 * 64), stream_10(64 * 64 * 48), stream_11(128 * 128 * 32), stream_13(256 * 256 * 16),
+	  logits(256 * 256 * 3) {
+}
+
+void FixedEngine::run(const int32_t* in, uint8_t* out) {
+
+	run(in, logits.data());
+	for (size_t value = 0; value < logits.size(); value++) {
+		out[value] = sigmoid_pixel(logits[value]);
+	}
+}
+
+void FixedEngine::run(const int32_t* in, int32_t* out) {
+
+	//Encoder Layers
+	fixed_conv2d_relu<3, 3, 16>(in, stream_0.data(), 256, 256, weights_0.data(), bias_0.data());
+	fixed_max_pooling2d<2, 16>(stream_0.data(), stream_1.data(), 256, 256);
+	fixed_separable_dw2d_relu<3, 16, 32>(stream_1.data(), stream_2.data(), 128, 128, depth_weights_1.data(), point_weights_1.data(), bias_1.data());
+	fixed_max_pooling2d<2, 32>(stream_2.data(), stream_3.data(), 128, 128);
+	fixed_separable_dw2d_relu<3, 32, 48>(stream_3.data(), stream_4.data(), 64, 64, depth_weights_2.data(), point_weights_2.data(), bias_2.data());
+	fixed_max_pooling2d<2, 48>(stream_4.data(), stream_5.data(), 64, 64);
+	fixed_separable_dw2d_relu<3, 48, 64>(stream_5.data(), stream_6.data(), 32, 32, depth_weights_3.data(), point_weights_3.data(), bias_3.data());
+	fixed_max_pooling2d<2, 64>(stream_6.data(), stream_7.data(), 32, 32);
+	//Decoder Layers (gather-style transposed convolutions; each Add layer is applied as output pixels are written)
+	fixed_subpixel_conv2d_transposed<64, 64>(stream_7.data(), stream_8.data(), 16, 16, weights_4.data(), bias_4.data());
+	fixed_subpixel_conv2d_transposed<64, 48>(stream_8.data(), stream_10.data(), 32, 32, weights_5.data(), bias_5.data(), stream_4.data());
+	fixed_subpixel_conv2d_transposed<48, 32>(stream_10.data(), stream_11.data(), 64, 64, weights_6.data(), bias_6.data());
+	fixed_subpixel_conv2d_transposed<32, 16>(stream_11.data(), stream_13.data(), 128, 128, weights_7.data(), bias_7.data(), stream_0.data());
+	fixed_conv2d_sigmoid<16, 3>(stream_13.data(), out, 256, 256, weights_8.data(), bias_8.data());
+}
+
+}
@@ -0,0 +1,385 @@
+#include <algorithm>
+#include <stdexcept>
+#include "FlareNetEngine.h"
+#include "InputConv.h"
+#include "Kernels.h"
+#include "ModelWeights.h"
+#include "SeparableConv.h"
+#include "ThreadPool.h"
+#include "TransposedConv.h"
+
+namespace flarenet {
+
+namespace {
+
+std::vector<float> to_float(const std::vector<double>& values) {
+	return std::vector<float>(values.begin(), values.end());
+}
+
+//Folds the 1/255 normalization of 8-bit input into the weights of the input layer.
+std::vector<float> pixel_weights(const std::vector<double>& values) {
+
+	std::vector<float> weights(values.size());
+	for (size_t value = 0; value < values.size(); value++) {
+		weights[value] = (float)(values[value] / 255.0);
+	}
+	return weights;
+}
+
+//Compacted form of a transposed convolution kernel that has zero rows (weights pruned at load time), or an empty kernel
+//(input_depth 0) when every row is used.
+CompactKernel compact_pruned(const std::vector<float>& weights, int input_depth, int output_depth) {
+	const CompactKernel kernel = compact_kernel(weights.data(), input_depth, output_depth);
+	return kernel.rows() < 9 * input_depth ? kernel : CompactKernel();
+}
+
+//A transposed convolution on its compacted kernel if it has one, on the dense kernel otherwise.
+template <int input_depth, int output_depth>
+void transposed_layer(const float* input, float* output, int height, int width, const std::vector<float>& weights, const CompactKernel& compact, const float* bias, const float* skip, int first_row, int last_row) {
+	if (compact.input_depth != 0) {
+		subpixel_conv2d_transposed<input_depth, output_depth>(input, output, height, width, compact, bias, skip, first_row, last_row);
+	}
+	else {
+		subpixel_conv2d_transposed<input_depth, output_depth>(input, output, height, width, weights.data(), bias, skip, first_row, last_row);
+	}
+}
+
+//Rows of stream_13 computed at a time by the last stage.
+const int output_tile_rows = 4;
+//Pooled rows of an encoder layer computed at a time when its skip output is stored in 16 bits.
+const int skip_chunk_rows = 4;
+
+//Floats of the scratch of store_skip_chunks() for a layer with full-resolution rows of row values: the rows of a chunk
+//and the halo rows of its view.
+long skip_chunk_scratch(long row) {
+	return (2 * skip_chunk_rows + 4) * row;
+}
+
+//Runs an encoder layer fused with pooling, layer(input, output, skip, height, first_row, last_row), on pooled rows
+//first_row .. last_row - 1 and stores its full-resolution output in 16 bits. Chunks of skip_chunk_rows pooled rows run as
+//a frame of their own on the input rows they read (from an even row, with the halo row above and below), writing their
+//full-resolution rows to scratch (skip_chunk_scratch() floats), which is converted right away.
+template <typename Input, typename Layer>
+void store_skip_chunks(const Input* input, float* output, uint16_t* skip, int height, int width, int input_depth, int depth, int first_row, int last_row, ActivationStorage storage, float* scratch, Layer layer) {
+
+	const long input_row = (long)width * input_depth;
+	const long row = (long)width * depth;
+	for (int r = first_row; r < last_row; r += skip_chunk_rows) {
+		const int last = std::min(r + skip_chunk_rows, last_row);
+		const int view_first = std::max(2 * r - 2, 0);
+		const int view_last = std::min(2 * last + 2, height);
+		const int offset = view_first / 2;
+		layer(input + view_first * input_row, output + (long)offset * (width / 2) * depth, scratch, view_last - view_first, r - offset, last - offset);
+		store_activations(scratch + (2 * r - view_first) * row, skip + 2 * r * row, 2 * (last - r) * row, storage);
+	}
+}
+
+//Converts rows first .. last - 1 of a 16-bit skip tensor to float, at the same rows relative to view_first: the skip
+//rows added by a transposed convolution on a view whose output starts at row view_first. The rows go to scratch, which
+//must hold last - view_first rows.
+const float* load_skip_rows(const uint16_t* skip, int first, int last, int view_first, long row, ActivationStorage storage, float* scratch) {
+	load_activations(skip + first * row, scratch + (first - view_first) * row, (last - first) * row, storage);
+	return scratch;
+}
+
+//Splits rows into bands (at least min_rows rows each, except for a smaller remainder) and runs
+//band(index, first_row, last_row) for each of them, on pool when there is one. There are at most threads() bands.
+template <typename Band>
+void for_bands(ThreadPool* pool, int rows, int min_rows, Band band) {
+
+	if (pool == nullptr) {
+		band(0, 0, rows);
+		return;
+	}
+	const int bands = std::max(1, std::min(pool->size(), rows / min_rows));
+	pool->parallel_for(bands, [&](int index) {
+		band(index, rows * index / bands, rows * (index + 1) / bands);
+	});
+}
+
+}
+
+Engine::Engine(int threads, int batch_frames, int height, int width, ActivationStorage storage)
+	: Engine(model_weights(), threads, batch_frames, height, width, storage) {
+}
+
+Engine::Engine(const ModelWeights& model, int threads, int batch_frames, int height, int width, ActivationStorage storage)
+	: frame_height(height), frame_width(width), storage(storage), input_conv(best_isa() == Isa::avx512 ? ConvAlgorithm::winograd : ConvAlgorithm::direct),
+	  weights_0(to_float(model.weights_0)), bias_0(to_float(model.bias_0)), winograd_weights_0(input_winograd_weights(weights_0.data())),
+	  pixel_weights_0(pixel_weights(model.weights_0)), pixel_winograd_weights_0(input_winograd_weights(pixel_weights_0.data())),
+	  depth_weights_1(to_float(model.depth_weights_1)), point_weights_1(to_float(model.point_weights_1)), bias_1(to_float(model.bias_1)),
+	  depth_weights_2(to_float(model.depth_weights_2)), point_weights_2(to_float(model.point_weights_2)), bias_2(to_float(model.bias_2)),
+	  depth_weights_3(to_float(model.depth_weights_3)), point_weights_3(to_float(model.point_weights_3)), bias_3(to_float(model.bias_3)),
+	  weights_4(to_float(model.weights_4)), bias_4(to_float(model.bias_4)),
+	  weights_5(to_float(model.weights_5)), bias_5(to_float(model.bias_5)),
+	  weights_6(to_float(model.weights_6)), bias_6(to_float(model.bias_6)),
+	  weights_7(to_float(model.weights_7)), bias_7(to_float(model.bias_7)),
+	  weights_8(to_float(model.weights_8)), bias_8(to_float(model.bias_8)),
+	  compact_4(compact_pruned(weights_4, 64, 64)), compact_5(compact_pruned(weights_5, 64, 48)),
+	  compact_6(compact_pruned(weights_6, 48, 32)), compact_7(compact_pruned(weights_7, 32, 16)),
+	  pool(threads > 1 ? new ThreadPool(threads) : nullptr) {
+
+	if (height <= 0 or width <= 0 or height % size_multiple != 0 or width % size_multiple != 0) {
+		throw std::invalid_argument("Engine: frame height and width must be positive multiples of 16");
+	}
+
+	//Layer graph of run_frames(), one step per stage over all frame slots.
+	const int slots = std::max(batch_frames, 1);
+	const int tensors = 9;
+	//Pixels at full, 1/2, 1/4, 1/8 and 1/16 resolution.
+	const size_t pixels[5] = {(size_t)height * width, (size_t)height * width / 4, (size_t)height * width / 16, (size_t)height * width / 64, (size_t)height * width / 256};
+	const size_t sizes[tensors] = {pixels[0] * 16, pixels[1] * 16, pixels[2] * 32, pixels[2] * 48, pixels[3] * 48, pixels[4] * 64, pixels[3] * 64, pixels[2] * 48, pixels[1] * 32};
+	enum { tensor_0, tensor_1, tensor_3, tensor_4, tensor_5, tensor_7, tensor_8, tensor_10, tensor_11 };
+	std::vector<std::vector<int>> slot_tensors(slots);
+	for (std::vector<int>& ids : slot_tensors) {
+		for (int tensor = 0; tensor < tensors; tensor++) {
+			const bool skip = tensor == tensor_0 or tensor == tensor_4;
+			ids.push_back(arena.add_tensor(sizes[tensor], skip ? storage_bytes(storage) : sizeof(float)));
+		}
+	}
+	//A tile holds output_tile_rows rows plus the two rows above them that the transposed convolution may produce.
+	std::vector<int> tile_tensors;
+	for (int band = 0; band < this->threads(); band++) {
+		tile_tensors.push_back(arena.add_tensor((size_t)(output_tile_rows + 2) * width * 16));
+	}
+	//The scratch of a band: the full-resolution rows of the encoder layers that pool them away (and the float rows of
+	//8-bit input), followed with 16-bit storage by the float skip rows being stored or added. Live in every stage.
+	kernel_scratch_values = std::max({input_conv_scratch(width), pooled_row_scratch(width / 2, 32), pooled_row_scratch(width / 8, 64)});
+	long skip_scratch_values = 0;
+	if (storage != ActivationStorage::fp32) {
+		skip_scratch_values = std::max({skip_chunk_scratch((long)width * 16), skip_chunk_scratch((long)(width / 4) * 48), (long)(2 * skip_chunk_rows + 2) * (width / 4) * 48, (long)(output_tile_rows + 2) * width * 16});
+	}
+	std::vector<int> scratch_tensors;
+	for (int band = 0; band < this->threads(); band++) {
+		scratch_tensors.push_back(arena.add_tensor(kernel_scratch_values + skip_scratch_values));
+	}
+	//Reads and writes of one stage: the given tensors of every slot.
+	auto of_slots = [&](std::initializer_list<int> stage_tensors) {
+		std::vector<int> ids;
+		for (const std::vector<int>& slot : slot_tensors) {
+			for (int tensor : stage_tensors) {
+				ids.push_back(slot[tensor]);
+			}
+		}
+		return ids;
+	};
+	std::vector<int> first_writes = of_slots({tensor_0, tensor_1});
+	first_writes.insert(first_writes.end(), scratch_tensors.begin(), scratch_tensors.end());
+	arena.add_step({}, first_writes);
+	arena.add_step(of_slots({tensor_1}), of_slots({tensor_3}));
+	arena.add_step(of_slots({tensor_3}), of_slots({tensor_4, tensor_5}));
+	arena.add_step(of_slots({tensor_5}), of_slots({tensor_7}));
+	arena.add_step(of_slots({tensor_7}), of_slots({tensor_8}));
+	arena.add_step(of_slots({tensor_8, tensor_4}), of_slots({tensor_10}));
+	arena.add_step(of_slots({tensor_10}), of_slots({tensor_11}));
+	std::vector<int> last_reads = of_slots({tensor_11, tensor_0});
+	last_reads.insert(last_reads.end(), scratch_tensors.begin(), scratch_tensors.end());
+	arena.add_step(last_reads, tile_tensors);
+	arena.plan();
+
+	for (const std::vector<int>& slot : slot_tensors) {
+		Frame frame;
+		frame.stream_0 = arena.data(slot[tensor_0]);
+		frame.stream_1 = arena.data(slot[tensor_1]);
+		frame.stream_3 = arena.data(slot[tensor_3]);
+		frame.stream_4 = arena.data(slot[tensor_4]);
+		frame.stream_5 = arena.data(slot[tensor_5]);
+		frame.stream_7 = arena.data(slot[tensor_7]);
+		frame.stream_8 = arena.data(slot[tensor_8]);
+		frame.stream_10 = arena.data(slot[tensor_10]);
+		frame.stream_11 = arena.data(slot[tensor_11]);
+		frame.skip_1 = frame.skip_2 = nullptr;
+		if (storage != ActivationStorage::fp32) {
+			frame.skip_1 = static_cast<uint16_t*>(arena.raw_data(slot[tensor_0]));
+			frame.skip_2 = static_cast<uint16_t*>(arena.raw_data(slot[tensor_4]));
+			frame.stream_0 = frame.stream_4 = nullptr;
+		}
+		frames.push_back(frame);
+	}
+	for (int tile : tile_tensors) {
+		output_tiles.push_back(arena.data(tile));
+	}
+	for (int tile : scratch_tensors) {
+		scratch_tiles.push_back(arena.data(tile));
+	}
+}
+
+Engine::~Engine() {
+}
+
+int Engine::skipped_weight_rows() const {
+	int rows = 0;
+	for (const CompactKernel* kernel : {&compact_4, &compact_5, &compact_6, &compact_7}) {
+		rows += kernel->input_depth == 0 ? 0 : 9 * kernel->input_depth - kernel->rows();
+	}
+	return rows;
+}
+
+int Engine::threads() const {
+	return pool == nullptr ? 1 : pool->size();
+}
+
+void Engine::run(const float* in, float* out) {
+	run_frames(in, nullptr, out, nullptr, 1);
+}
+
+void Engine::run_batch(const float* in, float* out, int n) {
+
+	for (int first = 0; first < n; first += batch_frames()) {
+		run_frames(in + first * frame_values(), nullptr, out + first * frame_values(), nullptr, std::min(batch_frames(), n - first));
+	}
+}
+
+void Engine::run(const float* in, uint8_t* out) {
+	run_frames(in, nullptr, nullptr, out, 1);
+}
+
+void Engine::run_batch(const float* in, uint8_t* out, int n) {
+
+	for (int first = 0; first < n; first += batch_frames()) {
+		run_frames(in + first * frame_values(), nullptr, nullptr, out + first * frame_values(), std::min(batch_frames(), n - first));
+	}
+}
+
+void Engine::run(const uint8_t* in, uint8_t* out) {
+	run_frames(nullptr, in, nullptr, out, 1);
+}
+
+void Engine::run_batch(const uint8_t* in, uint8_t* out, int n) {
+
+	for (int first = 0; first < n; first += batch_frames()) {
+		run_frames(nullptr, in + first * frame_values(), nullptr, out + first * frame_values(), std::min(batch_frames(), n - first));
+	}
+}
+
+void Engine::input_layer(const float* in, float* output, float* skip, int height, int first_row, int last_row, float* scratch) const {
+
+	if (input_conv == ConvAlgorithm::winograd) {
+		input_conv2d_relu_maxpool_winograd(in, output, skip, height, frame_width, winograd_weights_0.data(), bias_0.data(), first_row, last_row);
+	}
+	else {
+		input_conv2d_relu_maxpool(in, output, skip, height, frame_width, weights_0.data(), bias_0.data(), first_row, last_row, scratch);
+	}
+}
+
+void Engine::input_layer(const uint8_t* in, float* output, float* skip, int height, int first_row, int last_row, float* scratch) const {
+
+	if (input_conv == ConvAlgorithm::winograd) {
+		input_conv2d_relu_maxpool_winograd(in, output, skip, height, frame_width, pixel_winograd_weights_0.data(), bias_0.data(), first_row, last_row, scratch);
+	}
+	else {
+		input_conv2d_relu_maxpool(in, output, skip, height, frame_width, pixel_weights_0.data(), bias_0.data(), first_row, last_row, scratch);
+	}
+}
+
+void Engine::run_frames(const float* in, const uint8_t* pixels_in, float* out, uint8_t* pixels_out, int count) {
+
+	//Rows and columns at full resolution (h, w) and after each pooling layer.
+	const int h = frame_height, w = frame_width;
+	//Encoder Layers, each fused with its pooling layer and banded in pooled rows. Only the layers feeding a skip connection
+	//store their full-resolution output (stream_0 = stream_skip_1, stream_4 = stream_skip_2), in 16 bits through
+	//store_skip_chunks() unless the storage is fp32.
+	//Every band has a scratch tile in the arena: the kernel scratch of the encoder layers, followed by the float skip rows
+	//of 16-bit storage.
+	auto input_stage = [&](const auto* input, const Frame& frame, int first_row, int last_row, float* scratch) {
+		if (storage == ActivationStorage::fp32) {
+			input_layer(input, frame.stream_1, frame.stream_0, h, first_row, last_row, scratch);
+		}
+		else {
+			store_skip_chunks(input, frame.stream_1, frame.skip_1, h, w, 3, 16, first_row, last_row, storage, scratch + kernel_scratch_values,
+				[&](const auto* view, float* output, float* skip, int height, int first, int last) { input_layer(view, output, skip, height, first, last, scratch); });
+		}
+	};
+	for_bands(pool.get(), h / 2, 2, [&](int band, int first_row, int last_row) {
+		for (int f = 0; f < count; f++) {
+			if (in == nullptr) {
+				input_stage(pixels_in + f * frame_values(), frames[f], first_row, last_row, scratch_tiles[band]);
+			}
+			else {
+				input_stage(in + f * frame_values(), frames[f], first_row, last_row, scratch_tiles[band]);
+			}
+		}
+	});
+	for_bands(pool.get(), h / 4, 2, [&](int band, int first_row, int last_row) {
+		for (int f = 0; f < count; f++) {
+			const Frame& frame = frames[f];
+			fused_separable_dw2d_relu_maxpool<16, 32>(frame.stream_1, frame.stream_3, nullptr, h / 2, w / 2, depth_weights_1.data(), point_weights_1.data(), bias_1.data(), first_row, last_row, scratch_tiles[band]);
+		}
+	});
+	for_bands(pool.get(), h / 8, 1, [&](int band, int first_row, int last_row) {
+		for (int f = 0; f < count; f++) {
+			const Frame& frame = frames[f];
+			//The skip output is never null here, so the layer needs no kernel scratch.
+			auto layer = [&](const float* input, float* output, float* skip, int height, int first, int last) {
+				fused_separable_dw2d_relu_maxpool<32, 48>(input, output, skip, height, w / 4, depth_weights_2.data(), point_weights_2.data(), bias_2.data(), first, last, nullptr);
+			};
+			if (storage == ActivationStorage::fp32) {
+				layer(frame.stream_3, frame.stream_5, frame.stream_4, h / 4, first_row, last_row);
+			}
+			else {
+				store_skip_chunks(frame.stream_3, frame.stream_5, frame.skip_2, h / 4, w / 4, 32, 48, first_row, last_row, storage, scratch_tiles[band] + kernel_scratch_values, layer);
+			}
+		}
+	});
+	for_bands(pool.get(), h / 16, 1, [&](int band, int first_row, int last_row) {
+		for (int f = 0; f < count; f++) {
+			const Frame& frame = frames[f];
+			fused_separable_dw2d_relu_maxpool<48, 64>(frame.stream_5, frame.stream_7, nullptr, h / 8, w / 8, depth_weights_3.data(), point_weights_3.data(), bias_3.data(), first_row, last_row, scratch_tiles[band]);
+		}
+	});
+	//Decoder Layers (gather-style transposed convolutions; each Add layer is applied as output pixels are written)
+	for_bands(pool.get(), h / 8, 1, [&](int, int first_row, int last_row) {
+		for (int f = 0; f < count; f++) {
+			const Frame& frame = frames[f];
+			transposed_layer<64, 64>(frame.stream_7, frame.stream_8, h / 16, w / 16, weights_4, compact_4, bias_4.data(), nullptr, first_row, last_row);
+		}
+	});
+	for_bands(pool.get(), h / 4, 2, [&](int band, int first_row, int last_row) {
+		for (int f = 0; f < count; f++) {
+			const Frame& frame = frames[f];
+			if (storage == ActivationStorage::fp32) {
+				transposed_layer<64, 48>(frame.stream_8, frame.stream_10, h / 8, w / 8, weights_5, compact_5, bias_5.data(), frame.stream_4, first_row, last_row);
+				continue;
+			}
+			//Chunks of rows on views of stream_8, adding stream_skip_2 rows converted from 16 bits.
+			const long row = (long)(w / 4) * 48;
+			for (int first = first_row; first < last_row; first += 2 * skip_chunk_rows) {
+				const int last = std::min(first + 2 * skip_chunk_rows, last_row);
+				const TransposedView view(first, last);
+				const float* skip = load_skip_rows(frame.skip_2, first, last, view.output_first, row, storage, scratch_tiles[band] + kernel_scratch_values);
+				transposed_layer<64, 48>(frame.stream_8 + (long)view.input_first * (w / 8) * 64, frame.stream_10 + view.output_first * row, view.input_last - view.input_first, w / 8, weights_5, compact_5, bias_5.data(), skip, first - view.output_first, last - view.output_first);
+			}
+		}
+	});
+	for_bands(pool.get(), h / 2, 2, [&](int, int first_row, int last_row) {
+		for (int f = 0; f < count; f++) {
+			const Frame& frame = frames[f];
+			transposed_layer<48, 32>(frame.stream_10, frame.stream_11, h / 4, w / 4, weights_6, compact_6, bias_6.data(), nullptr, first_row, last_row);
+		}
+	});
+	//The last transposed convolution (with the stream_skip_1 Add) and the 1x1 layer run output_tile_rows rows at a time
+	//through the band's tile. The transposed convolution sees a view of the stream_11 rows the tile reads (TransposedView),
+	//and the tile starts at the first output row of the view.
+	for_bands(pool.get(), h, 4, [&](int band, int first_row, int last_row) {
+		float* tile = output_tiles[band];
+		for (int f = 0; f < count; f++) {
+			const Frame& frame = frames[f];
+			for (int first = first_row; first < last_row; first += output_tile_rows) {
+				const int last = std::min(first + output_tile_rows, last_row);
+				const TransposedView view(first, last);
+				const int tile_first = first - view.output_first;
+				const float* skip = storage == ActivationStorage::fp32 ? frame.stream_0 + (long)view.output_first * w * 16 : load_skip_rows(frame.skip_1, first, last, view.output_first, (long)w * 16, storage, scratch_tiles[band] + kernel_scratch_values);
+				transposed_layer<32, 16>(frame.stream_11 + (long)view.input_first * (w / 2) * 32, tile, view.input_last - view.input_first, w / 2, weights_7, compact_7, bias_7.data(), skip, tile_first, tile_first + last - first);
+				const long output_offset = f * frame_values() + (long)first * w * 3;
+				if (out != nullptr) {
+					conv2d_sigmoid<16, 3>(tile + (long)tile_first * w * 16, out + output_offset, last - first, w, weights_8.data(), bias_8.data());
+				}
+				else {
+					conv2d_sigmoid_uint8<16, 3>(tile + (long)tile_first * w * 16, pixels_out + output_offset, last - first, w, weights_8.data(), bias_8.data());
+				}
+			}
+		}
+	});
+}
+
+}
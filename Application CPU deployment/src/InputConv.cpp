@@ -0,0 +1,525 @@
+#include <algorithm>
+#include "InputConv.h"
+#include "Kernels.h"
+#ifdef FLARENET_X86_SIMD
+#include <immintrin.h>
+#endif
+
+namespace flarenet {
+
+namespace {
+
+const int kernel_size = 3;
+const int input_depth = 3;
+const int output_depth = 16;
+//Taps of one kernel row: kernel_size neighbouring pixels of input_depth channels, contiguous in an HWC row.
+const int row_taps = kernel_size * input_depth;
+const int taps = kernel_size * row_taps;
+//Output pixels computed together by the SIMD variants: as many independent accumulator chains as the register file
+//holds next to the weight and broadcast registers (2 ymm per pixel for AVX2, 1 zmm per pixel for AVX-512).
+const int avx2_block = 6;
+const int avx512_block = 12;
+//Pooled rows whose input rows are converted together by the uint8 variants.
+const int pixel_chunk_rows = 4;
+//Input values under a pixel block in the top and bottom zero padding rows.
+const float zero_pixels[((avx512_block > avx2_block ? avx512_block : avx2_block) + kernel_size - 1) * input_depth] = {};
+
+//Computes output pixel y of a row with bounds checks. rows[win_x] is the input row under kernel row win_x,
+//or null in the zero padding. This is the scalar variant.
+void input_conv_pixel(const float* const rows[kernel_size], float* output, float* skip, int width, int y, const float* weight_filt, const float* bias) {
+
+	float window_conv_result[output_depth];
+	for (int filter = 0; filter < output_depth; filter++) {
+		window_conv_result[filter] = bias[filter];
+	}
+	for (int win_x = 0; win_x < kernel_size; win_x++) {
+		if (rows[win_x] == nullptr) {
+			continue;
+		}
+		for (int win_y = 0; win_y < kernel_size; win_y++) {
+			const int in_y = y + win_y - kernel_size / 2;
+			if (in_y < 0 or in_y >= width) {
+				continue;
+			}
+			const float* pixel = rows[win_x] + in_y * input_depth;
+			const float* weights = weight_filt + (win_x * kernel_size + win_y) * input_depth * output_depth;
+			for (int win_chn = 0; win_chn < input_depth; win_chn++) {
+				for (int filter = 0; filter < output_depth; filter++) {
+					window_conv_result[filter] += weights[win_chn * output_depth + filter] * pixel[win_chn];
+				}
+			}
+		}
+	}
+	for (int filter = 0; filter < output_depth; filter++) {
+		const float value = window_conv_result[filter] < 0 ? 0 : window_conv_result[filter];
+		output[y * output_depth + filter] = value;
+		if (skip != nullptr) {
+			skip[y * output_depth + filter] = value;
+		}
+	}
+}
+
+void input_conv_row_scalar(const float* const rows[kernel_size], float* output, float* skip, int width, const float* weight_filt, const float* bias) {
+	for (int y = 0; y < width; y++) {
+		input_conv_pixel(rows, output, skip, width, y, weight_filt, bias);
+	}
+}
+
+//Copies the zero-padded 3x3 neighbourhood of border pixel y, so that the SIMD variants see it as three contiguous rows.
+void border_patch(const float* const rows[kernel_size], int width, int y, float patch[kernel_size][row_taps]) {
+	for (int win_x = 0; win_x < kernel_size; win_x++) {
+		for (int win_y = 0; win_y < kernel_size; win_y++) {
+			const int in_y = y + win_y - kernel_size / 2;
+			for (int win_chn = 0; win_chn < input_depth; win_chn++) {
+				const bool inside = rows[win_x] != nullptr and in_y >= 0 and in_y < width;
+				patch[win_x][win_y * input_depth + win_chn] = inside ? rows[win_x][in_y * input_depth + win_chn] : 0;
+			}
+		}
+	}
+}
+
+//Runs a float input layer fused with pooling on pooled rows first_row .. last_row - 1 of an 8-bit input. Chunks of
+//pixel_chunk_rows pooled rows are converted to float with the input row above and below them, from an even input row so
+//that band(view, output, skip, view_height, first, last) sees them as a frame of its own whose pooled rows line up with
+//the frame's. The float rows go to the start of scratch, and band gets the rest of it (pooled_row_scratch() floats) as
+//the scratch of the float layer.
+template <typename Band>
+void pixel_row_chunks(const uint8_t* input, float* output, float* skip, int height, int width, int first_row, int last_row, float* scratch, Band band) {
+
+	const long input_row = (long)width * input_depth;
+	float* view = scratch;
+	float* layer_scratch = scratch + (2 * pixel_chunk_rows + 4) * input_row;
+	for (int r = first_row; r < last_row; r += pixel_chunk_rows) {
+		const int last = std::min(r + pixel_chunk_rows, last_row);
+		const int view_first = std::max(2 * r - 2, 0);
+		const int view_last = std::min(2 * last + 2, height);
+		const long values = (view_last - view_first) * input_row;
+		const uint8_t* pixels = input + view_first * input_row;
+		for (long value = 0; value < values; value++) {
+			view[value] = pixels[value];
+		}
+		const int offset = view_first / 2;
+		band(view, output + (long)offset * (width / 2) * output_depth, skip == nullptr ? nullptr : skip + (long)view_first * width * output_depth, view_last - view_first, r - offset, last - offset, layer_scratch);
+	}
+}
+
+#ifdef FLARENET_X86_SIMD
+//Computes count neighbouring output pixels; pixel[win_x] points to the first input value under kernel row win_x.
+//Two ymm vectors per output pixel: each weight row is loaded once and reused across the pixel block.
+template <int count>
+__attribute__((target("avx2,fma"))) inline
+void input_conv_block_avx2(const float* const pixel[kernel_size], float* output, float* skip, const float* weight_filt, const float* bias) {
+
+	__m256 acc[count][2];
+	for (int b = 0; b < count; b++) {
+		acc[b][0] = _mm256_loadu_ps(bias);
+		acc[b][1] = _mm256_loadu_ps(bias + 8);
+	}
+	for (int tap = 0; tap < taps; tap++) {
+		const __m256 weight_0 = _mm256_loadu_ps(weight_filt + tap * output_depth);
+		const __m256 weight_1 = _mm256_loadu_ps(weight_filt + tap * output_depth + 8);
+		for (int b = 0; b < count; b++) {
+			const __m256 pixel_val = _mm256_broadcast_ss(pixel[tap / row_taps] + b * input_depth + tap % row_taps);
+			acc[b][0] = _mm256_fmadd_ps(weight_0, pixel_val, acc[b][0]);
+			acc[b][1] = _mm256_fmadd_ps(weight_1, pixel_val, acc[b][1]);
+		}
+	}
+	const __m256 zero = _mm256_setzero_ps();
+	for (int b = 0; b < count; b++) {
+		const __m256 value_0 = _mm256_max_ps(acc[b][0], zero);
+		const __m256 value_1 = _mm256_max_ps(acc[b][1], zero);
+		_mm256_storeu_ps(output + b * output_depth, value_0);
+		_mm256_storeu_ps(output + b * output_depth + 8, value_1);
+		if (skip != nullptr) {
+			_mm256_storeu_ps(skip + b * output_depth, value_0);
+			_mm256_storeu_ps(skip + b * output_depth + 8, value_1);
+		}
+	}
+}
+
+//One zmm vector per output pixel. The caller loads the 27 weight vectors once per row; each is then reused by all pixels
+//of the block, with input values broadcast straight from memory. Pinning all 27 in registers would leave only 4 or 5
+//accumulator chains, which measured slower than 12 chains with the weights reloaded from L1.
+template <int count>
+__attribute__((target("avx512f"))) inline
+void input_conv_block_avx512(const float* const pixel[kernel_size], float* output, float* skip, const __m512 weight[taps], __m512 bias_vec) {
+
+	__m512 acc[count];
+	for (int b = 0; b < count; b++) {
+		acc[b] = bias_vec;
+	}
+	for (int tap = 0; tap < taps; tap++) {
+		for (int b = 0; b < count; b++) {
+			acc[b] = _mm512_fmadd_ps(weight[tap], _mm512_set1_ps(pixel[tap / row_taps][b * input_depth + tap % row_taps]), acc[b]);
+		}
+	}
+	const __m512 zero = _mm512_setzero_ps();
+	for (int b = 0; b < count; b++) {
+		const __m512 value = _mm512_max_ps(acc[b], zero);
+		_mm512_storeu_ps(output + b * output_depth, value);
+		if (skip != nullptr) {
+			_mm512_storeu_ps(skip + b * output_depth, value);
+		}
+	}
+}
+
+//Walks one output row: border columns from zero-padded patches, interior pixels straight from the input rows
+//in blocks of block pixels, then one by one. Top and bottom padding rows read zero_pixels.
+template <int block, typename BlockKernel, typename PixelKernel>
+inline void input_conv_row(const float* const rows[kernel_size], float* output, float* skip, int width, BlockKernel block_kernel, PixelKernel pixel_kernel) {
+
+	float patch[kernel_size][row_taps];
+	const float* patch_rows[kernel_size] = {patch[0], patch[1], patch[2]};
+	const float* pixel[kernel_size];
+	border_patch(rows, width, 0, patch);
+	pixel_kernel(patch_rows, output, skip);
+	int y = 1;
+	for (; y + block <= width - 1; y += block) {
+		for (int win_x = 0; win_x < kernel_size; win_x++) {
+			//The 3x3 neighbourhood row of pixel y starts at column y-1.
+			pixel[win_x] = rows[win_x] == nullptr ? zero_pixels : rows[win_x] + (y - 1) * input_depth;
+		}
+		block_kernel(pixel, output + y * output_depth, skip == nullptr ? nullptr : skip + y * output_depth);
+	}
+	for (; y < width; y++) {
+		if (y == width - 1) {
+			border_patch(rows, width, y, patch);
+			std::copy(patch_rows, patch_rows + kernel_size, pixel);
+		}
+		else {
+			for (int win_x = 0; win_x < kernel_size; win_x++) {
+				pixel[win_x] = rows[win_x] == nullptr ? zero_pixels : rows[win_x] + (y - 1) * input_depth;
+			}
+		}
+		pixel_kernel(pixel, output + y * output_depth, skip == nullptr ? nullptr : skip + y * output_depth);
+	}
+}
+
+__attribute__((target("avx2,fma")))
+void input_conv_row_avx2(const float* const rows[kernel_size], float* output, float* skip, int width, const float* weight_filt, const float* bias) {
+	input_conv_row<avx2_block>(rows, output, skip, width,
+		[&](const float* const pixel[kernel_size], float* out, float* skip_out) __attribute__((target("avx2,fma"))) {
+			input_conv_block_avx2<avx2_block>(pixel, out, skip_out, weight_filt, bias);
+		},
+		[&](const float* const pixel[kernel_size], float* out, float* skip_out) __attribute__((target("avx2,fma"))) {
+			input_conv_block_avx2<1>(pixel, out, skip_out, weight_filt, bias);
+		});
+}
+
+__attribute__((target("avx512f")))
+void input_conv_row_avx512(const float* const rows[kernel_size], float* output, float* skip, int width, const float* weight_filt, const float* bias) {
+
+	__m512 weight[taps];
+	for (int tap = 0; tap < taps; tap++) {
+		weight[tap] = _mm512_loadu_ps(weight_filt + tap * output_depth);
+	}
+	const __m512 bias_vec = _mm512_loadu_ps(bias);
+	input_conv_row<avx512_block>(rows, output, skip, width,
+		[&](const float* const pixel[kernel_size], float* out, float* skip_out) __attribute__((target("avx512f"))) {
+			input_conv_block_avx512<avx512_block>(pixel, out, skip_out, weight, bias_vec);
+		},
+		[&](const float* const pixel[kernel_size], float* out, float* skip_out) __attribute__((target("avx512f"))) {
+			input_conv_block_avx512<1>(pixel, out, skip_out, weight, bias_vec);
+		});
+}
+#endif
+
+// ############# Winograd F(2x2, 3x3) ############# //
+//A 2x2 output tile is A^T [(G g G^T) . (B^T d B)] A, with d the 4x4 input patch under the tile and g a 3x3 filter: 16
+//products per input channel instead of 36. The 2x2 tiles of a pooled row are exactly its pooling windows.
+const int winograd_positions = 16;
+//Transformed input of one tile: [position][input_depth], with room for the 16-float stores of the AVX-512 variant.
+const int winograd_tile_values = winograd_positions * input_depth;
+
+//Copies the 4x4 input patch of tile column c (input columns 2c - 1 .. 2c + 2) into patch[row][pixel * 3 + channel],
+//with zeros outside the tensor. rows[i] is input row 2r - 1 + i, or null in the zero padding.
+void winograd_patch(const float* const rows[4], int width, int c, float patch[4][4 * input_depth]) {
+	for (int i = 0; i < 4; i++) {
+		for (int j = 0; j < 4; j++) {
+			const int in_y = 2 * c - 1 + j;
+			for (int win_chn = 0; win_chn < input_depth; win_chn++) {
+				const bool inside = rows[i] != nullptr and in_y >= 0 and in_y < width;
+				patch[i][j * input_depth + win_chn] = inside ? rows[i][in_y * input_depth + win_chn] : 0;
+			}
+		}
+	}
+}
+
+//B^T d B of one tile, into transformed[(4 * i + j) * input_depth + channel].
+void winograd_input_transform(const float* const patch[4], float* transformed) {
+
+	float columns[4][4 * input_depth];
+	for (int i = 0; i < 4; i++) {
+		const float* p = patch[i];
+		for (int win_chn = 0; win_chn < input_depth; win_chn++) {
+			columns[i][0 * input_depth + win_chn] = p[0 * input_depth + win_chn] - p[2 * input_depth + win_chn];
+			columns[i][1 * input_depth + win_chn] = p[1 * input_depth + win_chn] + p[2 * input_depth + win_chn];
+			columns[i][2 * input_depth + win_chn] = p[2 * input_depth + win_chn] - p[1 * input_depth + win_chn];
+			columns[i][3 * input_depth + win_chn] = p[1 * input_depth + win_chn] - p[3 * input_depth + win_chn];
+		}
+	}
+	for (int value = 0; value < 4 * input_depth; value++) {
+		transformed[0 * 4 * input_depth + value] = columns[0][value] - columns[2][value];
+		transformed[1 * 4 * input_depth + value] = columns[1][value] + columns[2][value];
+		transformed[2 * 4 * input_depth + value] = columns[2][value] - columns[1][value];
+		transformed[3 * 4 * input_depth + value] = columns[1][value] - columns[3][value];
+	}
+}
+
+//Portable tile row on Kernels.h vectors: products per position, then A^T M A, bias, ReLU, skip stores and pooling.
+void winograd_row_vec(const float* const rows[4], float* output, float* skip_rows[2], int width, const float* weights, const float* bias) {
+
+	const int V = output_depth / vec_width;
+	float patch[4][4 * input_depth];
+	float transformed[winograd_tile_values];
+	for (int c = 0; c < width / 2; c++) {
+		const float* patch_rows[4];
+		const bool inside = c > 0 and 2 * c + 2 < width;
+		if (inside) {
+			for (int i = 0; i < 4; i++) {
+				patch_rows[i] = rows[i] == nullptr ? zero_pixels : rows[i] + (2 * c - 1) * input_depth;
+			}
+		}
+		else {
+			winograd_patch(rows, width, c, patch);
+			for (int i = 0; i < 4; i++) {
+				patch_rows[i] = patch[i];
+			}
+		}
+		winograd_input_transform(patch_rows, transformed);
+
+		vec8 m[winograd_positions][V];
+		for (int position = 0; position < winograd_positions; position++) {
+			for (int v = 0; v < V; v++) {
+				vec8 acc = broadcast_vec(0);
+				for (int win_chn = 0; win_chn < input_depth; win_chn++) {
+					acc += load_vec(weights + (position * input_depth + win_chn) * output_depth + v * vec_width) * broadcast_vec(transformed[position * input_depth + win_chn]);
+				}
+				m[position][v] = acc;
+			}
+		}
+		for (int v = 0; v < V; v++) {
+			vec8 a[4], b[4];
+			for (int k = 0; k < 4; k++) {
+				a[k] = m[k][v] + m[4 + k][v] + m[8 + k][v];
+				b[k] = m[4 + k][v] - m[8 + k][v] - m[12 + k][v];
+			}
+			const vec8 bias_vec = load_vec(bias + v * vec_width);
+			const vec8 y[2][2] = {{relu_vec(a[0] + a[1] + a[2] + bias_vec), relu_vec(a[1] - a[2] - a[3] + bias_vec)},
+				{relu_vec(b[0] + b[1] + b[2] + bias_vec), relu_vec(b[1] - b[2] - b[3] + bias_vec)}};
+			for (int x = 0; x < 2; x++) {
+				if (skip_rows[x] != nullptr) {
+					store_vec(skip_rows[x] + (2 * c) * output_depth + v * vec_width, y[x][0]);
+					store_vec(skip_rows[x] + (2 * c + 1) * output_depth + v * vec_width, y[x][1]);
+				}
+			}
+			vec8 pooled = y[0][0];
+			for (const vec8& value : {y[0][1], y[1][0], y[1][1]}) {
+				pooled = pooled < value ? value : pooled;
+			}
+			store_vec(output + c * output_depth + v * vec_width, pooled);
+		}
+	}
+}
+
+#ifdef FLARENET_X86_SIMD
+//B^T d B of tile column c, with the 4x4 patch rows of 12 floats transformed by two permutes and an FMA each.
+__attribute__((target("avx512f")))
+void winograd_input_transform_avx512(const float* const rows[4], int width, int c, float* transformed) {
+
+	//[p0 p1 p2 p3] -> [p0 p1 p2 p1] + sign * [p2 p2 p1 p3], pixel by pixel (3 channels each).
+	const __m512i first_index = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 3, 4, 5, 0, 0, 0, 0);
+	const __m512i second_index = _mm512_setr_epi32(6, 7, 8, 6, 7, 8, 3, 4, 5, 9, 10, 11, 0, 0, 0, 0);
+	const __m512 sign = _mm512_setr_ps(-1, -1, -1, 1, 1, 1, -1, -1, -1, -1, -1, -1, 0, 0, 0, 0);
+	float patch[4][4 * input_depth];
+	const bool inside = c > 0 and 2 * c + 2 < width;
+	if (!inside) {
+		winograd_patch(rows, width, c, patch);
+	}
+	__m512 columns[4];
+	for (int i = 0; i < 4; i++) {
+		const float* p = inside ? (rows[i] == nullptr ? zero_pixels : rows[i] + (2 * c - 1) * input_depth) : patch[i];
+		const __m512 values = _mm512_maskz_loadu_ps(0x0FFF, p);
+		columns[i] = _mm512_fmadd_ps(sign, _mm512_permutexvar_ps(second_index, values), _mm512_permutexvar_ps(first_index, values));
+	}
+	//Stored in order, each 16-float store overwrites the 4 unused lanes of the previous one.
+	_mm512_storeu_ps(transformed + 0 * 4 * input_depth, _mm512_sub_ps(columns[0], columns[2]));
+	_mm512_storeu_ps(transformed + 1 * 4 * input_depth, _mm512_add_ps(columns[1], columns[2]));
+	_mm512_storeu_ps(transformed + 2 * 4 * input_depth, _mm512_sub_ps(columns[2], columns[1]));
+	_mm512_storeu_ps(transformed + 3 * 4 * input_depth, _mm512_sub_ps(columns[1], columns[3]));
+}
+
+//AVX-512 tile row. The 16 products of a position are one zmm, with the weights read from L1 as memory operands. A^T is
+//folded into the accumulation: a_k sums the products of rows 0 to 2 of column k and b_k takes row 1 minus rows 2 and 3,
+//then the outputs are a_0 + a_1 + a_2, a_1 - a_2 - a_3 and the same on b.
+__attribute__((target("avx512f")))
+void winograd_row_avx512(const float* const rows[4], float* output, float* skip_rows[2], int width, const float* weights, const float* bias) {
+
+	const __m512 bias_vec = _mm512_loadu_ps(bias);
+	const __m512 zero = _mm512_setzero_ps();
+	alignas(64) float transformed[winograd_tile_values + 4];
+	for (int c = 0; c < width / 2; c++) {
+		winograd_input_transform_avx512(rows, width, c, transformed);
+		__m512 a[4], b[4];
+		for (int k = 0; k < 4; k++) {
+			for (int i = 0; i < 4; i++) {
+				const float* weight = weights + (i * 4 + k) * input_depth * output_depth;
+				const float* value = transformed + (i * 4 + k) * input_depth;
+				__m512 m = _mm512_mul_ps(_mm512_loadu_ps(weight), _mm512_set1_ps(value[0]));
+				m = _mm512_fmadd_ps(_mm512_loadu_ps(weight + output_depth), _mm512_set1_ps(value[1]), m);
+				m = _mm512_fmadd_ps(_mm512_loadu_ps(weight + 2 * output_depth), _mm512_set1_ps(value[2]), m);
+				if (i == 0) {
+					a[k] = m;
+				}
+				else if (i == 1) {
+					a[k] = _mm512_add_ps(a[k], m);
+					b[k] = m;
+				}
+				else if (i == 2) {
+					a[k] = _mm512_add_ps(a[k], m);
+					b[k] = _mm512_sub_ps(b[k], m);
+				}
+				else {
+					b[k] = _mm512_sub_ps(b[k], m);
+				}
+			}
+		}
+		const __m512 y[2][2] = {
+			{_mm512_max_ps(_mm512_add_ps(_mm512_add_ps(_mm512_add_ps(a[0], a[1]), a[2]), bias_vec), zero),
+			 _mm512_max_ps(_mm512_add_ps(_mm512_sub_ps(_mm512_sub_ps(a[1], a[2]), a[3]), bias_vec), zero)},
+			{_mm512_max_ps(_mm512_add_ps(_mm512_add_ps(_mm512_add_ps(b[0], b[1]), b[2]), bias_vec), zero),
+			 _mm512_max_ps(_mm512_add_ps(_mm512_sub_ps(_mm512_sub_ps(b[1], b[2]), b[3]), bias_vec), zero)}};
+		for (int x = 0; x < 2; x++) {
+			if (skip_rows[x] != nullptr) {
+				_mm512_storeu_ps(skip_rows[x] + (2 * c) * output_depth, y[x][0]);
+				_mm512_storeu_ps(skip_rows[x] + (2 * c + 1) * output_depth, y[x][1]);
+			}
+		}
+		_mm512_storeu_ps(output + c * output_depth, _mm512_max_ps(_mm512_max_ps(y[0][0], y[0][1]), _mm512_max_ps(y[1][0], y[1][1])));
+	}
+}
+#endif
+
+}
+
+std::vector<float> input_winograd_weights(const float* weight_filt) {
+
+	//G = [1 0 0; 1/2 1/2 1/2; 1/2 -1/2 1/2; 0 0 1]
+	const float G[4][kernel_size] = {{1, 0, 0}, {0.5f, 0.5f, 0.5f}, {0.5f, -0.5f, 0.5f}, {0, 0, 1}};
+	std::vector<float> transformed(winograd_positions * input_depth * output_depth);
+	for (int i = 0; i < 4; i++) {
+		for (int j = 0; j < 4; j++) {
+			for (int win_chn = 0; win_chn < input_depth; win_chn++) {
+				for (int filter = 0; filter < output_depth; filter++) {
+					double value = 0;
+					for (int win_x = 0; win_x < kernel_size; win_x++) {
+						for (int win_y = 0; win_y < kernel_size; win_y++) {
+							value += G[i][win_x] * G[j][win_y] * weight_filt[((win_x * kernel_size + win_y) * input_depth + win_chn) * output_depth + filter];
+						}
+					}
+					transformed[((i * 4 + j) * input_depth + win_chn) * output_depth + filter] = (float)value;
+				}
+			}
+		}
+	}
+	return transformed;
+}
+
+void input_conv2d_relu_maxpool_winograd(const float* input, float* output, float* skip, int height, int width, const float* winograd_weights, const float* bias, Isa isa) {
+	input_conv2d_relu_maxpool_winograd(input, output, skip, height, width, winograd_weights, bias, 0, height / 2, isa);
+}
+
+void input_conv2d_relu_maxpool_winograd(const float* input, float* output, float* skip, int height, int width, const float* winograd_weights, const float* bias, int first_row, int last_row, Isa isa) {
+
+	if (!isa_supported(isa)) {
+		isa = Isa::scalar;
+	}
+	for (int r = first_row; r < last_row; r++) {
+		const float* rows[4];
+		for (int i = 0; i < 4; i++) {
+			const int in_x = 2 * r - 1 + i;
+			rows[i] = (in_x < 0 or in_x >= height) ? nullptr : input + (long)in_x * width * input_depth;
+		}
+		float* out_row = output + (long)r * (width / 2) * output_depth;
+		float* skip_rows[2] = {nullptr, nullptr};
+		if (skip != nullptr) {
+			skip_rows[0] = skip + (long)(2 * r) * width * output_depth;
+			skip_rows[1] = skip_rows[0] + (long)width * output_depth;
+		}
+		switch (isa) {
+#ifdef FLARENET_X86_SIMD
+		case Isa::avx512:
+			winograd_row_avx512(rows, out_row, skip_rows, width, winograd_weights, bias);
+			break;
+#endif
+		default:
+			winograd_row_vec(rows, out_row, skip_rows, width, winograd_weights, bias);
+			break;
+		}
+	}
+}
+
+void input_conv2d_relu(const float* input, float* output, float* skip, int height, int width, const float* weight_filt, const float* bias, Isa isa) {
+	input_conv2d_relu(input, output, skip, height, width, weight_filt, bias, 0, height, isa);
+}
+
+void input_conv2d_relu(const float* input, float* output, float* skip, int height, int width, const float* weight_filt, const float* bias, int first_row, int last_row, Isa isa) {
+
+	if (!isa_supported(isa)) {
+		isa = Isa::scalar;
+	}
+	for (int x = first_row; x < last_row; x++) {
+		const float* rows[kernel_size];
+		for (int win_x = 0; win_x < kernel_size; win_x++) {
+			const int in_x = x + win_x - kernel_size / 2;
+			rows[win_x] = (in_x < 0 or in_x >= height) ? nullptr : input + (long)in_x * width * input_depth;
+		}
+		float* out_row = output + (long)x * width * output_depth;
+		float* skip_row = skip == nullptr ? nullptr : skip + (long)x * width * output_depth;
+		switch (isa) {
+#ifdef FLARENET_X86_SIMD
+		case Isa::avx512:
+			input_conv_row_avx512(rows, out_row, skip_row, width, weight_filt, bias);
+			break;
+		case Isa::avx2:
+			input_conv_row_avx2(rows, out_row, skip_row, width, weight_filt, bias);
+			break;
+#endif
+		default:
+			input_conv_row_scalar(rows, out_row, skip_row, width, weight_filt, bias);
+			break;
+		}
+	}
+}
+
+long input_conv_scratch(int width) {
+	return (2 * pixel_chunk_rows + 4) * (long)width * input_depth + pooled_row_scratch(width, output_depth);
+}
+
+void input_conv2d_relu_maxpool(const float* input, float* output, float* skip, int height, int width, const float* weight_filt, const float* bias, Isa isa) {
+	std::vector<float> scratch(skip == nullptr ? pooled_row_scratch(width, output_depth) : 0);
+	input_conv2d_relu_maxpool(input, output, skip, height, width, weight_filt, bias, 0, height / 2, scratch.data(), isa);
+}
+
+void input_conv2d_relu_maxpool(const float* input, float* output, float* skip, int height, int width, const float* weight_filt, const float* bias, int first_row, int last_row, float* scratch, Isa isa) {
+	pooled_row_pairs<input_depth, output_depth>(input, output, skip, height, width, first_row, last_row, scratch,
+		[&](const float* band_input, float* band_output, int band_height, int first, int last) {
+			input_conv2d_relu(band_input, band_output, nullptr, band_height, width, weight_filt, bias, first, last, isa);
+		});
+}
+
+void input_conv2d_relu_maxpool(const uint8_t* input, float* output, float* skip, int height, int width, const float* weight_filt, const float* bias, int first_row, int last_row, float* scratch, Isa isa) {
+	pixel_row_chunks(input, output, skip, height, width, first_row, last_row, scratch,
+		[&](const float* view, float* view_output, float* view_skip, int view_height, int first, int last, float* layer_scratch) {
+			input_conv2d_relu_maxpool(view, view_output, view_skip, view_height, width, weight_filt, bias, first, last, layer_scratch, isa);
+		});
+}
+
+void input_conv2d_relu_maxpool_winograd(const uint8_t* input, float* output, float* skip, int height, int width, const float* winograd_weights, const float* bias, int first_row, int last_row, float* scratch, Isa isa) {
+	pixel_row_chunks(input, output, skip, height, width, first_row, last_row, scratch,
+		[&](const float* view, float* view_output, float* view_skip, int view_height, int first, int last, float*) {
+			input_conv2d_relu_maxpool_winograd(view, view_output, view_skip, view_height, width, winograd_weights, bias, first, last, isa);
+		});
+}
+
+}
@@ -0,0 +1,256 @@
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <stdexcept>
+#include "Int8Engine.h"
+#include "Kernels.h"
+#include "ModelWeights.h"
+
+namespace flarenet {
+
+namespace {
+
+//Largest value of every quantized tensor over the calibration frames (depthwise_* are largest magnitudes).
+struct ActivationRanges {
+	double stream_0 = 0, depthwise_1 = 0, stream_2 = 0, depthwise_2 = 0, stream_4 = 0, depthwise_3 = 0, stream_6 = 0;
+	double stream_8 = 0, stream_10 = 0, stream_11 = 0, stream_13 = 0;
+};
+
+std::vector<float> to_float(const std::vector<double>& values) {
+	return std::vector<float>(values.begin(), values.end());
+}
+
+void update_range(double& range, const std::vector<float>& tensor) {
+	for (float value : tensor) {
+		range = std::max(range, (double)value);
+	}
+}
+
+//Depthwise step of a separable layer on its own (Kernels.h fuses it with the pointwise step).
+template <int depth>
+void update_depthwise_range(double& range, const std::vector<float>& input, int height, int width, const std::vector<float>& depth_weights) {
+	const int kernel_size = 3;
+	for (int x = 0; x < height; x++) {
+		for (int y = 0; y < width; y++) {
+			for (int win_chn = 0; win_chn < depth; win_chn++) {
+				float depthwise_res = 0;
+				for (int win_x = 0; win_x < kernel_size; win_x++) {
+					const int in_x = x + win_x - kernel_size / 2;
+					for (int win_y = 0; win_y < kernel_size; win_y++) {
+						const int in_y = y + win_y - kernel_size / 2;
+						if (in_x >= 0 and in_x < height and in_y >= 0 and in_y < width) {
+							depthwise_res += depth_weights[(win_x * kernel_size + win_y) * depth + win_chn] * input[((long)in_x * width + in_y) * depth + win_chn];
+						}
+					}
+				}
+				range = std::max(range, (double)std::fabs(depthwise_res));
+			}
+		}
+	}
+}
+
+//Runs the float layers of Engine (generic kernels of Kernels.h) on every calibration frame.
+ActivationRanges calibrate(const ModelWeights& model, const std::vector<const float*>& frames) {
+
+	const std::vector<float> weights_0 = to_float(model.weights_0), bias_0 = to_float(model.bias_0);
+	const std::vector<float> depth_weights_1 = to_float(model.depth_weights_1), point_weights_1 = to_float(model.point_weights_1), bias_1 = to_float(model.bias_1);
+	const std::vector<float> depth_weights_2 = to_float(model.depth_weights_2), point_weights_2 = to_float(model.point_weights_2), bias_2 = to_float(model.bias_2);
+	const std::vector<float> depth_weights_3 = to_float(model.depth_weights_3), point_weights_3 = to_float(model.point_weights_3), bias_3 = to_float(model.bias_3);
+	const std::vector<float> weights_4 = to_float(model.weights_4), bias_4 = to_float(model.bias_4);
+	const std::vector<float> weights_5 = to_float(model.weights_5), bias_5 = to_float(model.bias_5);
+	const std::vector<float> weights_6 = to_float(model.weights_6), bias_6 = to_float(model.bias_6);
+	const std::vector<float> weights_7 = to_float(model.weights_7), bias_7 = to_float(model.bias_7);
+	std::vector<float> stream_0(256 * 256 * 16), stream_1(128 * 128 * 16), stream_2(128 * 128 * 32), stream_3(64 * 64 * 32);
+	std::vector<float> stream_4(64 * 64 * 48), stream_5(32 * 32 * 48), stream_6(32 * 32 * 64), stream_7(16 * 16 * 64);
+	std::vector<float> stream_8(32 * 32 * 64), stream_10(64 * 64 * 48), stream_11(128 * 128 * 32), stream_13(256 * 256 * 16);
+
+	ActivationRanges ranges;
+	for (const float* frame : frames) {
+		conv2d_relu<3, 3, 16>(frame, stream_0.data(), 256, 256, weights_0.data(), bias_0.data());
+		max_pooling2d<2, 16>(stream_0.data(), stream_1.data(), 256, 256);
+		update_depthwise_range<16>(ranges.depthwise_1, stream_1, 128, 128, depth_weights_1);
+		separable_dw2d_relu<3, 16, 32>(stream_1.data(), stream_2.data(), 128, 128, depth_weights_1.data(), point_weights_1.data(), bias_1.data());
+		max_pooling2d<2, 32>(stream_2.data(), stream_3.data(), 128, 128);
+		update_depthwise_range<32>(ranges.depthwise_2, stream_3, 64, 64, depth_weights_2);
+		separable_dw2d_relu<3, 32, 48>(stream_3.data(), stream_4.data(), 64, 64, depth_weights_2.data(), point_weights_2.data(), bias_2.data());
+		max_pooling2d<2, 48>(stream_4.data(), stream_5.data(), 64, 64);
+		update_depthwise_range<48>(ranges.depthwise_3, stream_5, 32, 32, depth_weights_3);
+		separable_dw2d_relu<3, 48, 64>(stream_5.data(), stream_6.data(), 32, 32, depth_weights_3.data(), point_weights_3.data(), bias_3.data());
+		max_pooling2d<2, 64>(stream_6.data(), stream_7.data(), 32, 32);
+		conv2d_transposed<3, 2, 64, 64>(stream_7.data(), stream_8.data(), 16, 16, weights_4.data(), bias_4.data());
+		conv2d_transposed<3, 2, 64, 48>(stream_8.data(), stream_10.data(), 32, 32, weights_5.data(), bias_5.data(), stream_4.data());
+		conv2d_transposed<3, 2, 48, 32>(stream_10.data(), stream_11.data(), 64, 64, weights_6.data(), bias_6.data());
+		conv2d_transposed<3, 2, 32, 16>(stream_11.data(), stream_13.data(), 128, 128, weights_7.data(), bias_7.data(), stream_0.data());
+		update_range(ranges.stream_0, stream_0);
+		update_range(ranges.stream_2, stream_2);
+		update_range(ranges.stream_4, stream_4);
+		update_range(ranges.stream_6, stream_6);
+		update_range(ranges.stream_8, stream_8);
+		update_range(ranges.stream_10, stream_10);
+		update_range(ranges.stream_11, stream_11);
+		update_range(ranges.stream_13, stream_13);
+	}
+	return ranges;
+}
+
+//Scale of a uint8 tensor (or of the int8 range of a depthwise result) covering range.
+double activation_scale(double range, int levels) {
+	return range > 0 ? range / levels : 1.0;
+}
+
+// ############# Weight Cache File ############# //
+//cache_magic and cache_version, then every array of the layers in member order, each as its element count (uint64)
+//followed by the values. Counts are checked against the layer sizes on load, so a cache of another packing or model
+//is rejected instead of being read out of place.
+const char cache_magic[8] = {'F', 'L', 'A', 'R', 'E', 'I', 'N', '8'};
+const uint32_t cache_version = 1;
+
+template <typename T>
+void write_array(std::ofstream& out, const std::vector<T>& values) {
+	const uint64_t count = values.size();
+	out.write(reinterpret_cast<const char*>(&count), sizeof(count));
+	out.write(reinterpret_cast<const char*>(values.data()), count * sizeof(T));
+}
+
+template <typename T>
+void read_array(std::ifstream& in, std::vector<T>& values, size_t expected_count) {
+	uint64_t count = 0;
+	in.read(reinterpret_cast<char*>(&count), sizeof(count));
+	if (!in or count != expected_count) {
+		throw std::runtime_error("Int8Engine: weight cache does not match the model");
+	}
+	values.resize(count);
+	in.read(reinterpret_cast<char*>(values.data()), count * sizeof(T));
+}
+
+void write_conv(std::ofstream& out, const Int8Conv& layer) {
+	write_array(out, layer.weights);
+	write_array(out, layer.scale);
+	write_array(out, layer.offset);
+}
+
+//Sizes as packed by quantize_int8_conv().
+void read_conv(std::ifstream& in, Int8Conv& layer, int taps, int input_depth, int output_depth) {
+	const int tap_depth = (input_depth + 3) / 4 * 4;
+	const int packed_depth = (output_depth + 15) / 16 * 16;
+	read_array(in, layer.weights, (size_t)taps * tap_depth * packed_depth);
+	read_array(in, layer.scale, packed_depth);
+	read_array(in, layer.offset, packed_depth);
+}
+
+void write_separable(std::ofstream& out, const Int8Separable& layer) {
+	write_array(out, layer.depth_weights);
+	write_array(out, layer.depth_scale);
+	write_conv(out, layer.pointwise);
+}
+
+void read_separable(std::ifstream& in, Int8Separable& layer, int input_depth, int output_depth) {
+	read_array(in, layer.depth_weights, 9 * input_depth);
+	read_array(in, layer.depth_scale, input_depth);
+	read_conv(in, layer.pointwise, 1, input_depth, output_depth);
+}
+
+}
+
+Int8Engine::Int8Engine(const std::vector<const float*>& calibration_frames) : Int8Engine(model_weights(), calibration_frames) {
+}
+
+Int8Engine::Int8Engine()
+	: input(256 * 256 * 3),
+	  stream_0(256 * 256 * 16), stream_1(128 * 128 * 16), stream_2(128 * 128 * 32), stream_3(64 * 64 * 32),
+	  stream_4(64 * 64 * 48), stream_5(32 * 32 * 48), stream_6(32 * 32 * 64), stream_7(16 * 16 * 64),
+	  stream_8(32 * 32 * 64), stream_10(64 * 64 * 48), stream_11(128 * 128 * 32), stream_13(256 * 256 * 16) {
+}
+
+Int8Engine::Int8Engine(const ModelWeights& model, const std::vector<const float*>& calibration_frames) : Int8Engine() {
+
+	const ActivationRanges ranges = calibrate(model, calibration_frames);
+	const double input_scale = 1.0 / 255;
+	const double scale_0 = activation_scale(ranges.stream_0, 255), scale_2 = activation_scale(ranges.stream_2, 255);
+	const double scale_4 = activation_scale(ranges.stream_4, 255), scale_6 = activation_scale(ranges.stream_6, 255);
+	const double scale_8 = activation_scale(ranges.stream_8, 255), scale_10 = activation_scale(ranges.stream_10, 255);
+	const double scale_11 = activation_scale(ranges.stream_11, 255), scale_13 = activation_scale(ranges.stream_13, 255);
+
+	conv_0 = quantize_int8_conv(model.weights_0, model.bias_0, 3, 9, 16, input_scale, scale_0);
+	separable_1 = quantize_int8_separable(model.depth_weights_1, model.point_weights_1, model.bias_1, 16, 32, scale_0, activation_scale(ranges.depthwise_1, 127), scale_2);
+	separable_2 = quantize_int8_separable(model.depth_weights_2, model.point_weights_2, model.bias_2, 32, 48, scale_2, activation_scale(ranges.depthwise_2, 127), scale_4);
+	separable_3 = quantize_int8_separable(model.depth_weights_3, model.point_weights_3, model.bias_3, 48, 64, scale_4, activation_scale(ranges.depthwise_3, 127), scale_6);
+	transposed_4 = quantize_int8_conv(model.weights_4, model.bias_4, 9, 64, 64, scale_6, scale_8);
+	transposed_5 = quantize_int8_conv(model.weights_5, model.bias_5, 9, 64, 48, scale_8, scale_10);
+	transposed_6 = quantize_int8_conv(model.weights_6, model.bias_6, 9, 48, 32, scale_10, scale_11);
+	transposed_7 = quantize_int8_conv(model.weights_7, model.bias_7, 9, 32, 16, scale_11, scale_13);
+	conv_8 = quantize_int8_conv(model.weights_8, model.bias_8, 1, 16, 3, scale_13, 0);
+	skip_scale_5 = (float)(scale_4 / scale_10);
+	skip_scale_7 = (float)(scale_0 / scale_13);
+}
+
+Int8Engine::Int8Engine(const std::string& path) : Int8Engine() {
+
+	std::ifstream in(path, std::ifstream::binary);
+	char magic[sizeof(cache_magic)] = {};
+	uint32_t version = 0;
+	in.read(magic, sizeof(magic));
+	in.read(reinterpret_cast<char*>(&version), sizeof(version));
+	if (!in or !std::equal(magic, magic + sizeof(magic), cache_magic) or version != cache_version) {
+		throw std::runtime_error("Int8Engine: cannot read weight cache " + path);
+	}
+	read_conv(in, conv_0, 3, 9, 16);
+	read_separable(in, separable_1, 16, 32);
+	read_separable(in, separable_2, 32, 48);
+	read_separable(in, separable_3, 48, 64);
+	read_conv(in, transposed_4, 9, 64, 64);
+	read_conv(in, transposed_5, 9, 64, 48);
+	read_conv(in, transposed_6, 9, 48, 32);
+	read_conv(in, transposed_7, 9, 32, 16);
+	read_conv(in, conv_8, 1, 16, 3);
+	in.read(reinterpret_cast<char*>(&skip_scale_5), sizeof(skip_scale_5));
+	in.read(reinterpret_cast<char*>(&skip_scale_7), sizeof(skip_scale_7));
+	if (!in or in.peek() != std::ifstream::traits_type::eof()) {
+		throw std::runtime_error("Int8Engine: weight cache does not match the model");
+	}
+}
+
+void Int8Engine::save(const std::string& path) const {
+
+	std::ofstream out(path, std::ofstream::binary);
+	out.write(cache_magic, sizeof(cache_magic));
+	out.write(reinterpret_cast<const char*>(&cache_version), sizeof(cache_version));
+	write_conv(out, conv_0);
+	write_separable(out, separable_1);
+	write_separable(out, separable_2);
+	write_separable(out, separable_3);
+	write_conv(out, transposed_4);
+	write_conv(out, transposed_5);
+	write_conv(out, transposed_6);
+	write_conv(out, transposed_7);
+	write_conv(out, conv_8);
+	out.write(reinterpret_cast<const char*>(&skip_scale_5), sizeof(skip_scale_5));
+	out.write(reinterpret_cast<const char*>(&skip_scale_7), sizeof(skip_scale_7));
+	if (!out) {
+		throw std::runtime_error("Int8Engine: cannot write weight cache " + path);
+	}
+}
+
+void Int8Engine::run(const float* in, float* out) {
+
+	for (size_t value = 0; value < input.size(); value++) {
+		input[value] = (uint8_t)std::nearbyint(std::min(std::max(in[value], 0.0f), 1.0f) * 255.0f);
+	}
+	//Encoder Layers
+	int8_input_conv2d_relu(input.data(), stream_0.data(), 256, 256, conv_0);
+	int8_max_pooling2d<2, 16>(stream_0.data(), stream_1.data(), 256, 256);
+	int8_separable_dw2d_relu<16, 32>(stream_1.data(), stream_2.data(), 128, 128, separable_1);
+	int8_max_pooling2d<2, 32>(stream_2.data(), stream_3.data(), 128, 128);
+	int8_separable_dw2d_relu<32, 48>(stream_3.data(), stream_4.data(), 64, 64, separable_2);
+	int8_max_pooling2d<2, 48>(stream_4.data(), stream_5.data(), 64, 64);
+	int8_separable_dw2d_relu<48, 64>(stream_5.data(), stream_6.data(), 32, 32, separable_3);
+	int8_max_pooling2d<2, 64>(stream_6.data(), stream_7.data(), 32, 32);
+	//Decoder Layers (each Add layer is requantized together with its transposed convolution)
+	int8_subpixel_conv2d_transposed<64, 64>(stream_7.data(), stream_8.data(), 16, 16, transposed_4);
+	int8_subpixel_conv2d_transposed<64, 48>(stream_8.data(), stream_10.data(), 32, 32, transposed_5, stream_4.data(), skip_scale_5);
+	int8_subpixel_conv2d_transposed<48, 32>(stream_10.data(), stream_11.data(), 64, 64, transposed_6);
+	int8_subpixel_conv2d_transposed<32, 16>(stream_11.data(), stream_13.data(), 128, 128, transposed_7, stream_0.data(), skip_scale_7);
+	int8_conv2d_logits(stream_13.data(), out, 256, 256, conv_8);
+}
+
+}
@@ -0,0 +1,629 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include "Int8Kernels.h"
+#ifdef FLARENET_X86_SIMD
+#include <immintrin.h>
+#endif
+
+namespace flarenet {
+
+namespace {
+
+const int kernel_size = 3;
+//Largest dense weight magnitude (7 bits, see Int8Kernels.h) and largest depthwise weight magnitude.
+const int dense_weight_max = 63;
+const int depthwise_weight_max = 127;
+//The input convolution has one tap per kernel row: 3 pixels of 3 channels, padded to 12 values.
+const int input_depth = 3;
+const int input_tap_depth = 12;
+const int input_conv_depth = 16;
+const int logits_depth = 3;
+//Transposed-convolution output pixels see at most 2x2 input pixels.
+const int max_taps = 4;
+
+//Zero pixel used in place of out-of-tensor taps, large enough for any FlareNet layer.
+const uint8_t zero_pixel[64] = {};
+
+inline int32_t load_int32(const uint8_t* address) {
+	int32_t value;
+	std::memcpy(&value, address, sizeof(value));
+	return value;
+}
+
+//count pixels of the last layer: acc * scale + offset of the 3 filters, as float logits.
+template <int depth>
+inline void logits_pixels(const int32_t* acc, int count, const Int8Conv& layer, float* out) {
+	for (int b = 0; b < count; b++) {
+		for (int filter = 0; filter < logits_depth; filter++) {
+			out[b * logits_depth + filter] = std::fma((float)acc[b * depth + filter], layer.scale[filter], layer.offset[filter]);
+		}
+	}
+}
+
+//Reference versions; the SIMD variants below must produce the same values bit for bit. Pixel b of a block is at
+//first + b * stride in every buffer (taps: input pixels, acc: int32 sums, out/skip: output pixels).
+struct ScalarOps {
+	static constexpr int block(int) {
+		return 4;
+	}
+
+	//acc[block][output_depth] = sum over taps t of the tap_depth uint8 values of pixel b of taps[t] times tap_weights[t].
+	template <int block, int output_depth>
+	static void dot(const uint8_t* const* taps, const int8_t* const* tap_weights, int tap_count, int tap_depth, long stride, int32_t* acc) {
+		std::fill(acc, acc + block * output_depth, 0);
+		for (int t = 0; t < tap_count; t++) {
+			for (int win_chn = 0; win_chn < tap_depth; win_chn++) {
+				const int8_t* weights = tap_weights[t] + ((win_chn / 4) * output_depth) * 4 + win_chn % 4;
+				for (int b = 0; b < block; b++) {
+					const int32_t pixel_val = taps[t][b * stride + win_chn];
+					for (int filter = 0; filter < output_depth; filter++) {
+						acc[b * output_depth + filter] += pixel_val * weights[filter * 4];
+					}
+				}
+			}
+		}
+	}
+
+	//count output pixels: relu(acc * scale + offset), plus skip * skip_scale if skip is given, rounded to uint8.
+	template <int output_depth>
+	static void requantize(const int32_t* acc, int count, const Int8Conv& layer, const uint8_t* skip, float skip_scale, uint8_t* out, long stride) {
+		for (int b = 0; b < count; b++) {
+			for (int filter = 0; filter < output_depth; filter++) {
+				float value = std::max(std::fma((float)acc[b * output_depth + filter], layer.scale[filter], layer.offset[filter]), 0.0f);
+				if (skip != nullptr) {
+					value = std::fma((float)skip[b * stride + filter], skip_scale, value);
+				}
+				out[b * stride + filter] = (uint8_t)std::nearbyint(std::min(value, 255.0f));
+			}
+		}
+	}
+
+	template <int depth>
+	static void logits(const int32_t* acc, int count, const Int8Conv& layer, float* out) {
+		logits_pixels<depth>(acc, count, layer, out);
+	}
+
+	//Depthwise results of count consecutive pixels of row x (from column y), stored with zero point 128.
+	template <int depth>
+	static void depthwise(const uint8_t* input, int height, int width, int x, int y, int count, const Int8Separable& layer, uint8_t* panel) {
+		for (int b = 0; b < count; b++) {
+			for (int win_chn = 0; win_chn < depth; win_chn++) {
+				float depthwise_res = 0;
+				for (int win_x = 0; win_x < kernel_size; win_x++) {
+					const int in_x = x + win_x - kernel_size / 2;
+					for (int win_y = 0; win_y < kernel_size; win_y++) {
+						const int in_y = y + b + win_y - kernel_size / 2;
+						if (in_x >= 0 and in_x < height and in_y >= 0 and in_y < width) {
+							depthwise_res += layer.depth_weights[(win_x * kernel_size + win_y) * depth + win_chn] * input[((long)in_x * width + in_y) * depth + win_chn];
+						}
+					}
+				}
+				const float value = std::min(std::max(depthwise_res * layer.depth_scale[win_chn], -128.0f), 127.0f);
+				panel[b * depth + win_chn] = (uint8_t)(std::nearbyint(value) + int8_depthwise_zero_point);
+			}
+		}
+	}
+};
+
+#ifdef FLARENET_X86_SIMD
+struct Avx2Ops {
+	//12 accumulators of the 16 ymm registers (6 pixels x 16 outputs), repeated over the output channels.
+	static constexpr int block(int) {
+		return 6;
+	}
+
+	template <int block, int output_depth>
+	__attribute__((target("avx2,fma")))
+	static void dot(const uint8_t* const* taps, const int8_t* const* tap_weights, int tap_count, int tap_depth, long stride, int32_t* acc) {
+		const __m256i ones = _mm256_set1_epi16(1);
+		for (int filter = 0; filter < output_depth; filter += 16) {
+			__m256i dot_res[block][2];
+			for (int b = 0; b < block; b++) {
+				dot_res[b][0] = _mm256_setzero_si256();
+				dot_res[b][1] = _mm256_setzero_si256();
+			}
+			for (int t = 0; t < tap_count; t++) {
+				for (int group = 0; group < tap_depth / 4; group++) {
+					const int8_t* weights = tap_weights[t] + (group * output_depth + filter) * 4;
+					const __m256i weight_0 = _mm256_loadu_si256((const __m256i*)weights);
+					const __m256i weight_1 = _mm256_loadu_si256((const __m256i*)(weights + 32));
+					for (int b = 0; b < block; b++) {
+						const __m256i pixel_val = _mm256_set1_epi32(load_int32(taps[t] + b * stride + group * 4));
+						//uint8 x int8 pairs to int16 (cannot saturate with 7-bit weights), then pairs of int16 to int32.
+						dot_res[b][0] = _mm256_add_epi32(dot_res[b][0], _mm256_madd_epi16(_mm256_maddubs_epi16(pixel_val, weight_0), ones));
+						dot_res[b][1] = _mm256_add_epi32(dot_res[b][1], _mm256_madd_epi16(_mm256_maddubs_epi16(pixel_val, weight_1), ones));
+					}
+				}
+			}
+			for (int b = 0; b < block; b++) {
+				_mm256_storeu_si256((__m256i*)(acc + b * output_depth + filter), dot_res[b][0]);
+				_mm256_storeu_si256((__m256i*)(acc + b * output_depth + filter + 8), dot_res[b][1]);
+			}
+		}
+	}
+
+	template <int output_depth>
+	__attribute__((target("avx2,fma")))
+	static void requantize(const int32_t* acc, int count, const Int8Conv& layer, const uint8_t* skip, float skip_scale, uint8_t* out, long stride) {
+		const __m256 zero = _mm256_setzero_ps();
+		const __m256 max_value = _mm256_set1_ps(255.0f);
+		for (int b = 0; b < count; b++) {
+			for (int filter = 0; filter < output_depth; filter += 8) {
+				const __m256 acc_val = _mm256_cvtepi32_ps(_mm256_loadu_si256((const __m256i*)(acc + b * output_depth + filter)));
+				__m256 value = _mm256_max_ps(_mm256_fmadd_ps(acc_val, _mm256_loadu_ps(&layer.scale[filter]), _mm256_loadu_ps(&layer.offset[filter])), zero);
+				if (skip != nullptr) {
+					const __m256 skip_val = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(skip + b * stride + filter))));
+					value = _mm256_fmadd_ps(skip_val, _mm256_set1_ps(skip_scale), value);
+				}
+				const __m256i rounded = _mm256_cvtps_epi32(_mm256_min_ps(value, max_value));
+				const __m128i words = _mm_packus_epi32(_mm256_castsi256_si128(rounded), _mm256_extracti128_si256(rounded, 1));
+				_mm_storel_epi64((__m128i*)(out + b * stride + filter), _mm_packus_epi16(words, words));
+			}
+		}
+	}
+
+	template <int depth>
+	__attribute__((target("avx2,fma")))
+	static void logits(const int32_t* acc, int count, const Int8Conv& layer, float* out) {
+		logits_pixels<depth>(acc, count, layer, out);
+	}
+
+	template <int depth>
+	__attribute__((target("avx2,fma")))
+	static void depthwise(const uint8_t* input, int height, int width, int x, int y, int count, const Int8Separable& layer, uint8_t* panel) {
+		const int U = depth / 8;
+		const __m256 low = _mm256_set1_ps(-128.0f);
+		const __m256 high = _mm256_set1_ps(127.0f);
+		const __m256i zero_point = _mm256_set1_epi32(int8_depthwise_zero_point);
+		for (int b = 0; b < count; b++) {
+			__m256 depthwise_res[U];
+			for (int u = 0; u < U; u++) {
+				depthwise_res[u] = _mm256_setzero_ps();
+			}
+			for (int win_x = 0; win_x < kernel_size; win_x++) {
+				const int in_x = x + win_x - kernel_size / 2;
+				if (in_x < 0 or in_x >= height) {
+					continue;
+				}
+				for (int win_y = 0; win_y < kernel_size; win_y++) {
+					const int in_y = y + b + win_y - kernel_size / 2;
+					if (in_y < 0 or in_y >= width) {
+						continue;
+					}
+					const uint8_t* pixel = input + ((long)in_x * width + in_y) * depth;
+					const float* weights = &layer.depth_weights[(win_x * kernel_size + win_y) * depth];
+					for (int u = 0; u < U; u++) {
+						const __m256 pixel_val = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(pixel + u * 8))));
+						depthwise_res[u] = _mm256_fmadd_ps(_mm256_loadu_ps(weights + u * 8), pixel_val, depthwise_res[u]);
+					}
+				}
+			}
+			for (int u = 0; u < U; u++) {
+				const __m256 value = _mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(depthwise_res[u], _mm256_loadu_ps(&layer.depth_scale[u * 8])), low), high);
+				const __m256i shifted = _mm256_add_epi32(_mm256_cvtps_epi32(value), zero_point);
+				const __m128i words = _mm_packus_epi32(_mm256_castsi256_si128(shifted), _mm256_extracti128_si256(shifted, 1));
+				_mm_storel_epi64((__m128i*)(panel + b * depth + u * 8), _mm_packus_epi16(words, words));
+			}
+		}
+	}
+};
+
+struct Vnni512Ops {
+	//24 accumulators of the 32 zmm registers; the tile spans all output channels (24 pixels for 16 outputs, 6 for 64).
+	static constexpr int block(int output_depth) {
+		return 24 / (output_depth / 16);
+	}
+
+	template <int block, int output_depth>
+	__attribute__((target("avx512f,avx512vnni")))
+	static void dot(const uint8_t* const* taps, const int8_t* const* tap_weights, int tap_count, int tap_depth, long stride, int32_t* acc) {
+		const int V = output_depth / 16;
+		__m512i dot_res[block][V];
+		for (int b = 0; b < block; b++) {
+			for (int v = 0; v < V; v++) {
+				dot_res[b][v] = _mm512_setzero_si512();
+			}
+		}
+		for (int t = 0; t < tap_count; t++) {
+			for (int group = 0; group < tap_depth / 4; group++) {
+				__m512i weight[V];
+				for (int v = 0; v < V; v++) {
+					weight[v] = _mm512_loadu_si512(tap_weights[t] + (group * output_depth + v * 16) * 4);
+				}
+				for (int b = 0; b < block; b++) {
+					const __m512i pixel_val = _mm512_set1_epi32(load_int32(taps[t] + b * stride + group * 4));
+					for (int v = 0; v < V; v++) {
+						dot_res[b][v] = _mm512_dpbusd_epi32(dot_res[b][v], pixel_val, weight[v]);
+					}
+				}
+			}
+		}
+		for (int b = 0; b < block; b++) {
+			for (int v = 0; v < V; v++) {
+				_mm512_storeu_si512(acc + b * output_depth + v * 16, dot_res[b][v]);
+			}
+		}
+	}
+
+	template <int output_depth>
+	__attribute__((target("avx512f")))
+	static void requantize(const int32_t* acc, int count, const Int8Conv& layer, const uint8_t* skip, float skip_scale, uint8_t* out, long stride) {
+		const __m512 zero = _mm512_setzero_ps();
+		const __m512 max_value = _mm512_set1_ps(255.0f);
+		for (int b = 0; b < count; b++) {
+			for (int filter = 0; filter < output_depth; filter += 16) {
+				const __m512 acc_val = _mm512_cvtepi32_ps(_mm512_loadu_si512(acc + b * output_depth + filter));
+				__m512 value = _mm512_max_ps(_mm512_fmadd_ps(acc_val, _mm512_loadu_ps(&layer.scale[filter]), _mm512_loadu_ps(&layer.offset[filter])), zero);
+				if (skip != nullptr) {
+					const __m512 skip_val = _mm512_cvtepi32_ps(_mm512_cvtepu8_epi32(_mm_loadu_si128((const __m128i*)(skip + b * stride + filter))));
+					value = _mm512_fmadd_ps(skip_val, _mm512_set1_ps(skip_scale), value);
+				}
+				_mm_storeu_si128((__m128i*)(out + b * stride + filter), _mm512_cvtepi32_epi8(_mm512_cvtps_epi32(_mm512_min_ps(value, max_value))));
+			}
+		}
+	}
+
+	template <int depth>
+	__attribute__((target("avx512f")))
+	static void logits(const int32_t* acc, int count, const Int8Conv& layer, float* out) {
+		logits_pixels<depth>(acc, count, layer, out);
+	}
+
+	template <int depth>
+	__attribute__((target("avx512f")))
+	static void depthwise(const uint8_t* input, int height, int width, int x, int y, int count, const Int8Separable& layer, uint8_t* panel) {
+		const int U = depth / 16;
+		const __m512 low = _mm512_set1_ps(-128.0f);
+		const __m512 high = _mm512_set1_ps(127.0f);
+		const __m512i zero_point = _mm512_set1_epi32(int8_depthwise_zero_point);
+		for (int b = 0; b < count; b++) {
+			__m512 depthwise_res[U];
+			for (int u = 0; u < U; u++) {
+				depthwise_res[u] = _mm512_setzero_ps();
+			}
+			for (int win_x = 0; win_x < kernel_size; win_x++) {
+				const int in_x = x + win_x - kernel_size / 2;
+				if (in_x < 0 or in_x >= height) {
+					continue;
+				}
+				for (int win_y = 0; win_y < kernel_size; win_y++) {
+					const int in_y = y + b + win_y - kernel_size / 2;
+					if (in_y < 0 or in_y >= width) {
+						continue;
+					}
+					const uint8_t* pixel = input + ((long)in_x * width + in_y) * depth;
+					const float* weights = &layer.depth_weights[(win_x * kernel_size + win_y) * depth];
+					for (int u = 0; u < U; u++) {
+						const __m512 pixel_val = _mm512_cvtepi32_ps(_mm512_cvtepu8_epi32(_mm_loadu_si128((const __m128i*)(pixel + u * 16))));
+						depthwise_res[u] = _mm512_fmadd_ps(_mm512_loadu_ps(weights + u * 16), pixel_val, depthwise_res[u]);
+					}
+				}
+			}
+			for (int u = 0; u < U; u++) {
+				const __m512 value = _mm512_min_ps(_mm512_max_ps(_mm512_mul_ps(depthwise_res[u], _mm512_loadu_ps(&layer.depth_scale[u * 16])), low), high);
+				_mm_storeu_si128((__m128i*)(panel + b * depth + u * 16), _mm512_cvtepi32_epi8(_mm512_add_epi32(_mm512_cvtps_epi32(value), zero_point)));
+			}
+		}
+	}
+};
+#endif
+
+//Copies the 3x3x3 window of pixel (x, y) into a patch of 3 row taps of 12 bytes (zero padding).
+void input_patch(const uint8_t* input, int height, int width, int x, int y, uint8_t* patch) {
+
+	std::memset(patch, 0, kernel_size * input_tap_depth);
+	for (int win_x = 0; win_x < kernel_size; win_x++) {
+		const int in_x = x + win_x - kernel_size / 2;
+		for (int win_y = 0; win_y < kernel_size; win_y++) {
+			const int in_y = y + win_y - kernel_size / 2;
+			if (in_x >= 0 and in_x < height and in_y >= 0 and in_y < width) {
+				std::memcpy(patch + win_x * input_tap_depth + win_y * input_depth, input + ((long)in_x * width + in_y) * input_depth, input_depth);
+			}
+		}
+	}
+}
+
+//Each kernel row is one tap of 12 bytes read straight from the input row: the 3 pixels of the window plus 3 bytes of
+//the next pixel, which meet zero weights. Pixels whose 12 bytes would leave the row (first column, last two columns)
+//go through zero-padded patches instead.
+template <typename Ops>
+void input_conv_layer(const uint8_t* input, uint8_t* output, int height, int width, const Int8Conv& layer) {
+
+	const int block = Ops::block(input_conv_depth);
+	const long row_values = (long)width * input_depth;
+	int32_t acc[block * input_conv_depth];
+	uint8_t patch[kernel_size * input_tap_depth];
+	const uint8_t* patch_taps[kernel_size] = {patch, patch + input_tap_depth, patch + 2 * input_tap_depth};
+	const int8_t* tap_weights[kernel_size];
+	for (int win_x = 0; win_x < kernel_size; win_x++) {
+		tap_weights[win_x] = layer.weights.data() + win_x * input_tap_depth * input_conv_depth;
+	}
+	const int last = width - 2;
+	for (int x = 0; x < height; x++) {
+		uint8_t* output_row = output + (long)x * width * input_conv_depth;
+		//Rows above and below the tensor are dropped.
+		const int first_tap = x == 0 ? 1 : 0;
+		const int tap_count = (x == height - 1 ? 2 : 3) - first_tap;
+		const uint8_t* tap_rows[kernel_size];
+		for (int t = 0; t < tap_count; t++) {
+			tap_rows[t] = input + (x + first_tap + t - 1) * row_values - input_depth;
+		}
+		for (int y = 0; y < width; y++) {
+			if (y == 1 and last - 1 >= block) {
+				//Full blocks over columns 1 .. width - 3; the last one is moved back to end there.
+				for (int j = 1; j < last; j += block) {
+					const int start = std::min(j, last - block);
+					const uint8_t* taps[kernel_size];
+					for (int t = 0; t < tap_count; t++) {
+						taps[t] = tap_rows[t] + start * input_depth;
+					}
+					Ops::template dot<block, input_conv_depth>(taps, tap_weights + first_tap, tap_count, input_tap_depth, input_depth, acc);
+					Ops::template requantize<input_conv_depth>(acc, block, layer, nullptr, 0, output_row + start * input_conv_depth, input_conv_depth);
+				}
+				y = last - 1;
+				continue;
+			}
+			input_patch(input, height, width, x, y, patch);
+			Ops::template dot<1, input_conv_depth>(patch_taps, tap_weights, kernel_size, input_tap_depth, 0, acc);
+			Ops::template requantize<input_conv_depth>(acc, 1, layer, nullptr, 0, output_row + y * input_conv_depth, input_conv_depth);
+		}
+	}
+}
+
+//Depthwise results of a block of pixels go to an L1 panel that feeds the pointwise dot products (as in SeparableConv.cpp).
+template <typename Ops, int input_depth, int output_depth>
+void separable_layer(const uint8_t* input, uint8_t* output, int height, int width, const Int8Separable& layer) {
+
+	const int block = Ops::block(output_depth);
+	uint8_t depthwise_panel[block * input_depth];
+	int32_t acc[block * output_depth];
+	const uint8_t* taps = depthwise_panel;
+	const int8_t* weights = layer.pointwise.weights.data();
+	std::fill(depthwise_panel, depthwise_panel + block * input_depth, int8_depthwise_zero_point);
+	for (int x = 0; x < height; x++) {
+		for (int y = 0; y < width; y += block) {
+			const int count = std::min(block, width - y);
+			Ops::template depthwise<input_depth>(input, height, width, x, y, count, layer, depthwise_panel);
+			Ops::template dot<block, output_depth>(&taps, &weights, 1, input_depth, input_depth, acc);
+			Ops::template requantize<output_depth>(acc, count, layer.pointwise, nullptr, 0, output + ((long)x * width + y) * output_depth, output_depth);
+		}
+	}
+}
+
+//Output row out_x, column phase phase_y: pixels at columns 2 * j + phase_y share their kernel taps, and the input pixels
+//of one tap are consecutive (fixed_subpixel_conv2d_transposed in FixedKernels.h has the same decomposition). Taps of
+//the row above the tensor are dropped; column j = 0 of the even phase has no left neighbour and is computed on its own.
+template <typename Ops, int input_depth, int output_depth>
+void subpixel_layer(const uint8_t* input, uint8_t* output, int height, int width, const Int8Conv& layer, const uint8_t* skip, float skip_scale) {
+
+	const int block = Ops::block(output_depth);
+	const long row_values = (long)width * input_depth;
+	const long output_stride = 2 * output_depth;
+	int32_t acc[block * output_depth];
+	for (int out_x = 0; out_x < height * 2; out_x++) {
+		//Kernel row/column 1 for odd output coordinates, kernel rows/columns 0 (same input) and 2 (previous input) for even ones.
+		const int row_taps = out_x % 2 == 1 ? 1 : (out_x == 0 ? 1 : 2);
+		for (int phase_y = 0; phase_y < 2; phase_y++) {
+			const int col_taps = phase_y == 0 ? 2 : 1;
+			int tap_count = 0;
+			const uint8_t* tap_rows[max_taps];
+			const int8_t* tap_weights[max_taps];
+			const uint8_t* taps[max_taps];
+			for (int row_tap = 0; row_tap < row_taps; row_tap++) {
+				const int win_x = out_x % 2 == 0 ? row_tap * 2 : 1;
+				for (int col_tap = 0; col_tap < col_taps; col_tap++) {
+					const int win_y = phase_y == 0 ? col_tap * 2 : 1;
+					//Tap col_tap reads input column j - col_tap.
+					tap_rows[tap_count] = input + (out_x / 2 - row_tap) * row_values - col_tap * input_depth;
+					tap_weights[tap_count] = layer.weights.data() + (win_x * kernel_size + win_y) * input_depth * output_depth;
+					tap_count++;
+				}
+			}
+			const uint8_t* skip_row = skip == nullptr ? nullptr : skip + ((long)out_x * width * 2 + phase_y) * output_depth;
+			uint8_t* output_row = output + ((long)out_x * width * 2 + phase_y) * output_depth;
+			int first = 0;
+			if (phase_y == 0) {
+				//Only the col_tap 0 taps (even indices) exist for j = 0.
+				const uint8_t* left_taps[max_taps];
+				const int8_t* left_weights[max_taps];
+				for (int t = 0; t < tap_count / 2; t++) {
+					left_taps[t] = tap_rows[t * 2];
+					left_weights[t] = tap_weights[t * 2];
+				}
+				Ops::template dot<1, output_depth>(left_taps, left_weights, tap_count / 2, input_depth, input_depth, acc);
+				Ops::template requantize<output_depth>(acc, 1, layer, skip_row, skip_scale, output_row, output_stride);
+				first = 1;
+			}
+			//Full blocks; the last one is moved back to end at the row end and recomputes a few pixels.
+			for (int j = first; j < width and width - first >= block; j += block) {
+				const int start = std::min(j, width - block);
+				for (int t = 0; t < tap_count; t++) {
+					taps[t] = tap_rows[t] + (long)start * input_depth;
+				}
+				Ops::template dot<block, output_depth>(taps, tap_weights, tap_count, input_depth, input_depth, acc);
+				Ops::template requantize<output_depth>(acc, block, layer, skip_row == nullptr ? nullptr : skip_row + start * output_stride, skip_scale, output_row + start * output_stride, output_stride);
+			}
+			for (int j = first; j < width and width - first < block; j++) {
+				for (int t = 0; t < tap_count; t++) {
+					taps[t] = tap_rows[t] + (long)j * input_depth;
+				}
+				Ops::template dot<1, output_depth>(taps, tap_weights, tap_count, input_depth, input_depth, acc);
+				Ops::template requantize<output_depth>(acc, 1, layer, skip_row == nullptr ? nullptr : skip_row + j * output_stride, skip_scale, output_row + j * output_stride, output_stride);
+			}
+		}
+	}
+}
+
+template <typename Ops>
+void logits_layer(const uint8_t* input, float* output, int height, int width, const Int8Conv& layer) {
+
+	//The 3 filters are padded to one 16-channel dot product.
+	const int depth = 16;
+	const int block = Ops::block(depth);
+	uint8_t tile[block * depth];
+	int32_t acc[block * depth];
+	const int8_t* weights = layer.weights.data();
+	const long num_pixels = (long)height * width;
+	for (long first = 0; first < num_pixels; first += block) {
+		//The last partial block is copied to a zero-padded tile instead of reading past the tensor.
+		const int count = (int)std::min<long>(block, num_pixels - first);
+		const uint8_t* taps = input + first * depth;
+		if (count < block) {
+			std::fill(tile, tile + block * depth, 0);
+			std::copy(taps, taps + count * depth, tile);
+			taps = tile;
+		}
+		Ops::template dot<block, depth>(&taps, &weights, 1, depth, depth, acc);
+		Ops::template logits<depth>(acc, count, layer, output + first * logits_depth);
+	}
+}
+
+//Instruction set the int8 kernels run for isa (AVX-512 kernels need VNNI).
+Isa int8_isa(Isa isa) {
+	if (!isa_supported(isa)) {
+		return Isa::scalar;
+	}
+#ifdef FLARENET_X86_SIMD
+	if (isa == Isa::avx512 and !__builtin_cpu_supports("avx512vnni")) {
+		return Isa::avx2;
+	}
+#endif
+	return isa;
+}
+
+}
+
+Int8Conv quantize_int8_conv(const std::vector<double>& weights, const std::vector<double>& bias, int taps, int input_depth, int output_depth, double input_scale, double output_scale, int input_zero_point) {
+
+	const int tap_depth = (input_depth + 3) / 4 * 4;
+	const int packed_depth = (output_depth + 15) / 16 * 16;
+	const double output_unit = output_scale > 0 ? output_scale : 1.0;
+	Int8Conv layer;
+	layer.weights.assign((size_t)taps * tap_depth * packed_depth, 0);
+	layer.scale.assign(packed_depth, 0.0f);
+	layer.offset.assign(packed_depth, 0.0f);
+	for (int filter = 0; filter < output_depth; filter++) {
+		double max_weight = 0;
+		for (int value = 0; value < taps * input_depth; value++) {
+			max_weight = std::max(max_weight, std::fabs(weights[(size_t)value * output_depth + filter]));
+		}
+		const double weight_scale = max_weight > 0 ? max_weight / dense_weight_max : 1.0;
+		long weight_sum = 0;
+		for (int t = 0; t < taps; t++) {
+			for (int win_chn = 0; win_chn < input_depth; win_chn++) {
+				const long quantized = std::lround(weights[((size_t)t * input_depth + win_chn) * output_depth + filter] / weight_scale);
+				const int8_t weight = (int8_t)std::min<long>(std::max<long>(quantized, -dense_weight_max), dense_weight_max);
+				const size_t group = (size_t)t * (tap_depth / 4) + win_chn / 4;
+				layer.weights[(group * packed_depth + filter) * 4 + win_chn % 4] = weight;
+				weight_sum += weight;
+			}
+		}
+		layer.scale[filter] = (float)(input_scale * weight_scale / output_unit);
+		layer.offset[filter] = (float)((bias[filter] - input_scale * weight_scale * input_zero_point * weight_sum) / output_unit);
+	}
+	return layer;
+}
+
+Int8Separable quantize_int8_separable(const std::vector<double>& depth_weights, const std::vector<double>& point_weights, const std::vector<double>& bias, int input_depth, int output_depth, double input_scale, double depthwise_scale, double output_scale) {
+
+	const int taps = kernel_size * kernel_size;
+	Int8Separable layer;
+	layer.depth_weights.assign(taps * input_depth, 0.0f);
+	layer.depth_scale.assign(input_depth, 0.0f);
+	for (int win_chn = 0; win_chn < input_depth; win_chn++) {
+		double max_weight = 0;
+		for (int t = 0; t < taps; t++) {
+			max_weight = std::max(max_weight, std::fabs(depth_weights[t * input_depth + win_chn]));
+		}
+		const double weight_scale = max_weight > 0 ? max_weight / depthwise_weight_max : 1.0;
+		for (int t = 0; t < taps; t++) {
+			layer.depth_weights[t * input_depth + win_chn] = (float)std::lround(depth_weights[t * input_depth + win_chn] / weight_scale);
+		}
+		layer.depth_scale[win_chn] = (float)(input_scale * weight_scale / depthwise_scale);
+	}
+	layer.pointwise = quantize_int8_conv(point_weights, bias, 1, input_depth, output_depth, depthwise_scale, output_scale, int8_depthwise_zero_point);
+	return layer;
+}
+
+void int8_input_conv2d_relu(const uint8_t* input, uint8_t* output, int height, int width, const Int8Conv& layer, Isa isa) {
+
+	switch (int8_isa(isa)) {
+#ifdef FLARENET_X86_SIMD
+	case Isa::avx512:
+		input_conv_layer<Vnni512Ops>(input, output, height, width, layer);
+		break;
+	case Isa::avx2:
+		input_conv_layer<Avx2Ops>(input, output, height, width, layer);
+		break;
+#endif
+	default:
+		input_conv_layer<ScalarOps>(input, output, height, width, layer);
+		break;
+	}
+}
+
+template <int input_depth, int output_depth>
+void int8_separable_dw2d_relu(const uint8_t* input, uint8_t* output, int height, int width, const Int8Separable& layer, Isa isa) {
+
+	static_assert(input_depth % 16 == 0 and output_depth % 16 == 0, "depths must be multiples of 16");
+	switch (int8_isa(isa)) {
+#ifdef FLARENET_X86_SIMD
+	case Isa::avx512:
+		separable_layer<Vnni512Ops, input_depth, output_depth>(input, output, height, width, layer);
+		break;
+	case Isa::avx2:
+		separable_layer<Avx2Ops, input_depth, output_depth>(input, output, height, width, layer);
+		break;
+#endif
+	default:
+		separable_layer<ScalarOps, input_depth, output_depth>(input, output, height, width, layer);
+		break;
+	}
+}
+
+template <int input_depth, int output_depth>
+void int8_subpixel_conv2d_transposed(const uint8_t* input, uint8_t* output, int height, int width, const Int8Conv& layer, const uint8_t* skip, float skip_scale, Isa isa) {
+
+	static_assert(input_depth % 16 == 0 and output_depth % 16 == 0, "depths must be multiples of 16");
+	switch (int8_isa(isa)) {
+#ifdef FLARENET_X86_SIMD
+	case Isa::avx512:
+		subpixel_layer<Vnni512Ops, input_depth, output_depth>(input, output, height, width, layer, skip, skip_scale);
+		break;
+	case Isa::avx2:
+		subpixel_layer<Avx2Ops, input_depth, output_depth>(input, output, height, width, layer, skip, skip_scale);
+		break;
+#endif
+	default:
+		subpixel_layer<ScalarOps, input_depth, output_depth>(input, output, height, width, layer, skip, skip_scale);
+		break;
+	}
+}
+
+void int8_conv2d_logits(const uint8_t* input, float* output, int height, int width, const Int8Conv& layer, Isa isa) {
+
+	switch (int8_isa(isa)) {
+#ifdef FLARENET_X86_SIMD
+	case Isa::avx512:
+		logits_layer<Vnni512Ops>(input, output, height, width, layer);
+		break;
+	case Isa::avx2:
+		logits_layer<Avx2Ops>(input, output, height, width, layer);
+		break;
+#endif
+	default:
+		logits_layer<ScalarOps>(input, output, height, width, layer);
+		break;
+	}
+}
+
+template void int8_separable_dw2d_relu<16, 32>(const uint8_t*, uint8_t*, int, int, const Int8Separable&, Isa);
+template void int8_separable_dw2d_relu<32, 48>(const uint8_t*, uint8_t*, int, int, const Int8Separable&, Isa);
+template void int8_separable_dw2d_relu<48, 64>(const uint8_t*, uint8_t*, int, int, const Int8Separable&, Isa);
+template void int8_subpixel_conv2d_transposed<64, 64>(const uint8_t*, uint8_t*, int, int, const Int8Conv&, const uint8_t*, float, Isa);
+template void int8_subpixel_conv2d_transposed<64, 48>(const uint8_t*, uint8_t*, int, int, const Int8Conv&, const uint8_t*, float, Isa);
+template void int8_subpixel_conv2d_transposed<48, 32>(const uint8_t*, uint8_t*, int, int, const Int8Conv&, const uint8_t*, float, Isa);
+template void int8_subpixel_conv2d_transposed<32, 16>(const uint8_t*, uint8_t*, int, int, const Int8Conv&, const uint8_t*, float, Isa);
+
+}
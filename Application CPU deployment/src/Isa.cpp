@@ -0,0 +1,36 @@
+#include "Isa.h"
+
+namespace flarenet {
+
+bool isa_supported(Isa isa) {
+#ifdef FLARENET_X86_SIMD
+	switch (isa) {
+	case Isa::avx512:
+		return __builtin_cpu_supports("avx512f");
+	case Isa::avx2:
+		return __builtin_cpu_supports("avx2") and __builtin_cpu_supports("fma");
+	default:
+		return true;
+	}
+#else
+	return isa == Isa::scalar;
+#endif
+}
+
+Isa best_isa() {
+	static const Isa isa = isa_supported(Isa::avx512) ? Isa::avx512 : (isa_supported(Isa::avx2) ? Isa::avx2 : Isa::scalar);
+	return isa;
+}
+
+const char* isa_name(Isa isa) {
+	switch (isa) {
+	case Isa::avx512:
+		return "avx512";
+	case Isa::avx2:
+		return "avx2";
+	default:
+		return "scalar";
+	}
+}
+
+}
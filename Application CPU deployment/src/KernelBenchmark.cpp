@@ -0,0 +1,209 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <vector>
+#include "InputConv.h"
+#include "Int8Kernels.h"
+#include "Kernels.h"
+#include "Layers.h"
+#include "SeparableConv.h"
+#include "TransposedConv.h"
+
+using namespace std::chrono;
+
+// Single-layer microbenchmarks on FlareNet layer shapes. Every variant is reported in GMAC/s (multiply-accumulates of
+// the layer, not instructions executed) next to the scalar reference template of Layers.h.
+
+static std::vector<float> random_values(size_t count, float low, float high) {
+	std::vector<float> values(count);
+	for (float& value : values) {
+		value = low + (high - low) * (std::rand() / (float)RAND_MAX);
+	}
+	return values;
+}
+
+//uint8 activations and double weights for the int8 kernels, from the float test tensors.
+static std::vector<uint8_t> to_bytes(const std::vector<float>& values) {
+	std::vector<uint8_t> bytes(values.size());
+	for (size_t x = 0; x < values.size(); x++) {
+		bytes[x] = (uint8_t)(values[x] * 255.0f);
+	}
+	return bytes;
+}
+
+static std::vector<double> to_double(const std::vector<float>& values) {
+	return std::vector<double>(values.begin(), values.end());
+}
+
+//Runs kernel repeatedly and prints the best time of iterations runs.
+static void report(const char* name, double macs, int iterations, const std::function<void()>& kernel) {
+	kernel();
+	double best_ms = 1e9;
+	for (int i = 0; i < iterations; i++) {
+		auto start = high_resolution_clock::now();
+		kernel();
+		best_ms = std::min(best_ms, duration_cast<microseconds>(high_resolution_clock::now() - start).count() / 1000.0);
+	}
+	std::cout << "  " << name << ": " << best_ms << " ms, " << macs / (best_ms * 1e6) << " GMAC/s\n";
+}
+
+template <int input_depth, int output_depth>
+static void separable_benchmark(int size, int iterations) {
+
+	std::vector<float> input = random_values(size * size * input_depth, 0, 1), depth_weights = random_values(3 * 3 * input_depth, -1, 1);
+	std::vector<float> point_weights = random_values(input_depth * output_depth, -1, 1), bias = random_values(output_depth, -1, 1);
+	std::vector<float> output(size * size * output_depth);
+	const double macs = (double)size * size * (3 * 3 * input_depth + input_depth * output_depth);
+	std::cout << "SeparableDW2D_relu<" << size << ", 3, " << input_depth << ", " << output_depth << ">\n";
+	report("Layers.h SeparableDW2D_relu", macs, iterations, [&]() {
+		flarenet::SeparableDW2D_relu<3, input_depth, output_depth>(input.data(), output.data(), size, size, depth_weights.data(), point_weights.data(), bias.data());
+	});
+	report("Kernels.h separable_dw2d_relu", macs, iterations, [&]() {
+		flarenet::separable_dw2d_relu<3, input_depth, output_depth>(input.data(), output.data(), size, size, depth_weights.data(), point_weights.data(), bias.data());
+	});
+	for (flarenet::Isa isa : {flarenet::Isa::avx2, flarenet::Isa::avx512}) {
+		if (!flarenet::isa_supported(isa)) {
+			continue;
+		}
+		report((std::string("fused_separable_dw2d_relu ") + flarenet::isa_name(isa)).c_str(), macs, iterations, [&]() {
+			flarenet::fused_separable_dw2d_relu<input_depth, output_depth>(input.data(), output.data(), size, size, depth_weights.data(), point_weights.data(), bias.data(), isa);
+		});
+	}
+	//Layer plus the following 2x2 max pooling, unfused and fused (no full-resolution output written).
+	std::vector<float> pooled((size / 2) * (size / 2) * output_depth);
+	report("fused_separable_dw2d_relu + max_pooling2d", macs, iterations, [&]() {
+		flarenet::fused_separable_dw2d_relu<input_depth, output_depth>(input.data(), output.data(), size, size, depth_weights.data(), point_weights.data(), bias.data());
+		flarenet::max_pooling2d<2, output_depth>(output.data(), pooled.data(), size, size);
+	});
+	report("fused_separable_dw2d_relu_maxpool", macs, iterations, [&]() {
+		flarenet::fused_separable_dw2d_relu_maxpool<input_depth, output_depth>(input.data(), pooled.data(), nullptr, size, size, depth_weights.data(), point_weights.data(), bias.data());
+	});
+	const flarenet::Int8Separable int8_layer = flarenet::quantize_int8_separable(to_double(depth_weights), to_double(point_weights), to_double(bias), input_depth, output_depth, 1.0 / 255, 4.0 / 127, 4.0 / 255);
+	const std::vector<uint8_t> int8_input = to_bytes(input);
+	std::vector<uint8_t> int8_output(size * size * output_depth);
+	for (flarenet::Isa isa : {flarenet::Isa::avx2, flarenet::Isa::avx512}) {
+		if (!flarenet::isa_supported(isa)) {
+			continue;
+		}
+		report((std::string("int8_separable_dw2d_relu ") + flarenet::isa_name(isa)).c_str(), macs, iterations, [&]() {
+			flarenet::int8_separable_dw2d_relu<input_depth, output_depth>(int8_input.data(), int8_output.data(), size, size, int8_layer, isa);
+		});
+	}
+}
+
+template <int input_depth, int output_depth>
+static void transposed_benchmark(int size, int iterations) {
+
+	std::vector<float> input = random_values(size * size * input_depth, 0, 1), weights = random_values(3 * 3 * input_depth * output_depth, -1, 1);
+	std::vector<float> bias = random_values(output_depth, -1, 1), output(size * size * 4 * output_depth);
+	//Multiply-accumulates that reach the cropped output: 9 taps per input pixel, minus the taps of the last row and column.
+	const double macs = (double)(3 * size - 1) * (3 * size - 1) * input_depth * output_depth;
+	std::cout << "Conv2D_transposed<" << size * 2 << ", 3, 2, " << input_depth << ", " << output_depth << ">\n";
+	report("Layers.h Conv2D_transposed", macs, iterations, [&]() {
+		flarenet::Conv2D_transposed<3, 2, input_depth, output_depth>(input.data(), output.data(), size, size, weights.data(), bias.data());
+	});
+	report("Kernels.h conv2d_transposed", macs, iterations, [&]() {
+		flarenet::conv2d_transposed<3, 2, input_depth, output_depth>(input.data(), output.data(), size, size, weights.data(), bias.data());
+	});
+	for (flarenet::Isa isa : {flarenet::Isa::avx2, flarenet::Isa::avx512}) {
+		if (!flarenet::isa_supported(isa)) {
+			continue;
+		}
+		report((std::string("subpixel_conv2d_transposed ") + flarenet::isa_name(isa)).c_str(), macs, iterations, [&]() {
+			flarenet::subpixel_conv2d_transposed<input_depth, output_depth>(input.data(), output.data(), size, size, weights.data(), bias.data(), nullptr, isa);
+		});
+	}
+	//Half of the weight rows zero, as left by pruning: rates are in multiply-accumulates of the dense layer, so the ideal
+	//compacted kernel runs at twice the dense rate.
+	std::vector<float> pruned_weights = weights;
+	for (int row = 0; row < 9 * input_depth; row += 2) {
+		std::fill(pruned_weights.begin() + row * output_depth, pruned_weights.begin() + (row + 1) * output_depth, 0.0f);
+	}
+	const flarenet::CompactKernel kernel = flarenet::compact_kernel(pruned_weights.data(), input_depth, output_depth);
+	for (flarenet::Isa isa : {flarenet::Isa::avx2, flarenet::Isa::avx512}) {
+		if (!flarenet::isa_supported(isa)) {
+			continue;
+		}
+		report((std::string("subpixel_conv2d_transposed, half the rows compacted ") + flarenet::isa_name(isa)).c_str(), macs, iterations, [&]() {
+			flarenet::subpixel_conv2d_transposed<input_depth, output_depth>(input.data(), output.data(), size, size, kernel, bias.data(), nullptr, 0, size * 2, isa);
+		});
+	}
+	const flarenet::Int8Conv int8_layer = flarenet::quantize_int8_conv(to_double(weights), to_double(bias), 9, input_depth, output_depth, 1.0 / 255, 4.0 / 255);
+	const std::vector<uint8_t> int8_input = to_bytes(input);
+	std::vector<uint8_t> int8_output(size * size * 4 * output_depth);
+	for (flarenet::Isa isa : {flarenet::Isa::avx2, flarenet::Isa::avx512}) {
+		if (!flarenet::isa_supported(isa)) {
+			continue;
+		}
+		report((std::string("int8_subpixel_conv2d_transposed ") + flarenet::isa_name(isa)).c_str(), macs, iterations, [&]() {
+			flarenet::int8_subpixel_conv2d_transposed<input_depth, output_depth>(int8_input.data(), int8_output.data(), size, size, int8_layer, nullptr, 0, isa);
+		});
+	}
+}
+
+int main(int argc, char** argv) {
+
+	const int iterations = argc > 1 ? std::atoi(argv[1]) : 50;
+	std::srand(1);
+
+	{
+		const int size = 256;
+		std::vector<float> input = random_values(size * size * 3, 0, 1), weights = random_values(3 * 3 * 3 * 16, -1, 1), bias = random_values(16, -1, 1);
+		std::vector<float> output(size * size * 16), skip(size * size * 16);
+		const double macs = (double)size * size * 3 * 3 * 3 * 16;
+		std::cout << "Conv2D_relu_2streams<256, 3, 3, 16>\n";
+		report("Layers.h Conv2D_relu", macs, iterations, [&]() {
+			flarenet::Conv2D_relu<3, 3, 16>(input.data(), output.data(), size, size, weights.data(), bias.data());
+		});
+		report("Kernels.h conv2d_relu", macs, iterations, [&]() {
+			flarenet::conv2d_relu<3, 3, 16>(input.data(), output.data(), size, size, weights.data(), bias.data());
+		});
+		for (flarenet::Isa isa : {flarenet::Isa::scalar, flarenet::Isa::avx2, flarenet::Isa::avx512}) {
+			if (!flarenet::isa_supported(isa)) {
+				continue;
+			}
+			const std::string name = std::string("input_conv2d_relu ") + flarenet::isa_name(isa);
+			report(name.c_str(), macs, iterations, [&]() {
+				flarenet::input_conv2d_relu(input.data(), output.data(), nullptr, size, size, weights.data(), bias.data(), isa);
+			});
+			report((name + " + skip").c_str(), macs, iterations, [&]() {
+				flarenet::input_conv2d_relu(input.data(), output.data(), skip.data(), size, size, weights.data(), bias.data(), isa);
+			});
+		}
+		//Fused with max pooling, direct and Winograd F(2x2, 3x3); MACs are those of the direct convolution.
+		std::vector<float> pooled((size / 2) * (size / 2) * 16);
+		const std::vector<float> winograd_weights = flarenet::input_winograd_weights(weights.data());
+		for (flarenet::Isa isa : {flarenet::Isa::scalar, flarenet::Isa::avx2, flarenet::Isa::avx512}) {
+			if (!flarenet::isa_supported(isa)) {
+				continue;
+			}
+			report((std::string("input_conv2d_relu_maxpool + skip ") + flarenet::isa_name(isa)).c_str(), macs, iterations, [&]() {
+				flarenet::input_conv2d_relu_maxpool(input.data(), pooled.data(), skip.data(), size, size, weights.data(), bias.data(), isa);
+			});
+			report((std::string("input_conv2d_relu_maxpool_winograd + skip ") + flarenet::isa_name(isa)).c_str(), macs, iterations, [&]() {
+				flarenet::input_conv2d_relu_maxpool_winograd(input.data(), pooled.data(), skip.data(), size, size, winograd_weights.data(), bias.data(), isa);
+			});
+		}
+		const flarenet::Int8Conv int8_layer = flarenet::quantize_int8_conv(to_double(weights), to_double(bias), 3, 9, 16, 1.0 / 255, 4.0 / 255);
+		const std::vector<uint8_t> int8_input = to_bytes(input);
+		std::vector<uint8_t> int8_output(size * size * 16);
+		for (flarenet::Isa isa : {flarenet::Isa::avx2, flarenet::Isa::avx512}) {
+			if (!flarenet::isa_supported(isa)) {
+				continue;
+			}
+			report((std::string("int8_input_conv2d_relu ") + flarenet::isa_name(isa)).c_str(), macs, iterations, [&]() {
+				flarenet::int8_input_conv2d_relu(int8_input.data(), int8_output.data(), size, size, int8_layer, isa);
+			});
+		}
+	}
+	separable_benchmark<16, 32>(128, iterations);
+	separable_benchmark<32, 48>(64, iterations);
+	separable_benchmark<48, 64>(32, iterations);
+	transposed_benchmark<64, 64>(16, iterations);
+	transposed_benchmark<64, 48>(32, iterations);
+	transposed_benchmark<48, 32>(64, iterations);
+	transposed_benchmark<32, 16>(128, iterations);
+	return 0;
+}
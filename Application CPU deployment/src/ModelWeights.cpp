@@ -0,0 +1,66 @@
+#include <cstddef>
+#include "ModelWeights.h"
+#include "weights.h"
+
+namespace flarenet {
+
+namespace {
+
+//Copy a weights.h array, keeping its layout.
+template <typename T, std::size_t N>
+std::vector<double> load(const T (&array)[N]) {
+	const model_type_weights* first = reinterpret_cast<const model_type_weights*>(array);
+	const std::size_t count = sizeof(array) / sizeof(model_type_weights);
+	return std::vector<double>(first, first + count);
+}
+
+//Repack a transposed-convolution kernel from [kx][ky][output][input] to [kx][ky][input][output].
+template <int kernel_size, int output_depth, int input_depth>
+std::vector<double> load_transposed(const model_type_weights (&weight_filt)[kernel_size][kernel_size][output_depth][input_depth]) {
+	std::vector<double> packed(kernel_size * kernel_size * input_depth * output_depth);
+	for (int win_x = 0; win_x < kernel_size; win_x++) {
+		for (int win_y = 0; win_y < kernel_size; win_y++) {
+			for (int filter = 0; filter < output_depth; filter++) {
+				for (int win_chn = 0; win_chn < input_depth; win_chn++) {
+					packed[((win_x * kernel_size + win_y) * input_depth + win_chn) * output_depth + filter] = weight_filt[win_x][win_y][filter][win_chn];
+				}
+			}
+		}
+	}
+	return packed;
+}
+
+ModelWeights load_model_weights() {
+	ModelWeights model;
+	model.weights_0 = load(conv2d_weights_0);
+	model.bias_0 = load(conv2d_bias_0);
+	model.depth_weights_1 = load(conv2d_depth_weights_1);
+	model.point_weights_1 = load(conv2d_point_weights_1);
+	model.bias_1 = load(conv2d_depthwise_bias_1);
+	model.depth_weights_2 = load(conv2d_depth_weights_2);
+	model.point_weights_2 = load(conv2d_point_weights_2);
+	model.bias_2 = load(conv2d_depthwise_bias_2);
+	model.depth_weights_3 = load(conv2d_depth_weights_3);
+	model.point_weights_3 = load(conv2d_point_weights_3);
+	model.bias_3 = load(conv2d_depthwise_bias_3);
+	model.weights_4 = load_transposed(conv2d_weights_4);
+	model.bias_4 = load(conv2d_bias_4);
+	model.weights_5 = load_transposed(conv2d_weights_5);
+	model.bias_5 = load(conv2d_bias_5);
+	model.weights_6 = load_transposed(conv2d_weights_6);
+	model.bias_6 = load(conv2d_bias_6);
+	model.weights_7 = load_transposed(conv2d_weights_7);
+	model.bias_7 = load(conv2d_bias_7);
+	model.weights_8 = load(conv2d_weights_8);
+	model.bias_8 = load(conv2d_bias_8);
+	return model;
+}
+
+}
+
+const ModelWeights& model_weights() {
+	static const ModelWeights model = load_model_weights();
+	return model;
+}
+
+}
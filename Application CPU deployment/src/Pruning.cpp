@@ -0,0 +1,94 @@
+#include <algorithm>
+#include <cmath>
+#include "Pruning.h"
+
+namespace flarenet {
+
+namespace {
+
+//A dense layer of ModelWeights, [taps][input_depth][output_depth].
+struct DenseLayer {
+	const char* name;
+	std::vector<double> ModelWeights::*weights;
+	int taps, input_depth, output_depth;
+};
+
+const DenseLayer dense_layers[] = {
+	{"pointwise_1", &ModelWeights::point_weights_1, 1, 16, 32},
+	{"pointwise_2", &ModelWeights::point_weights_2, 1, 32, 48},
+	{"pointwise_3", &ModelWeights::point_weights_3, 1, 48, 64},
+	{"transposed_4", &ModelWeights::weights_4, 9, 64, 64},
+	{"transposed_5", &ModelWeights::weights_5, 9, 64, 48},
+	{"transposed_6", &ModelWeights::weights_6, 9, 48, 32},
+	{"transposed_7", &ModelWeights::weights_7, 9, 32, 16},
+};
+
+LayerPruning prune_layer(const DenseLayer& layer, std::vector<double>& weights, double threshold) {
+
+	const int rows = layer.taps * layer.input_depth;
+	LayerPruning pruning = {layer.name, rows, 0, layer.output_depth, 0, (long)weights.size(), 0};
+	//Decide on the original weights, then zero: a row and a channel may overlap.
+	std::vector<bool> pruned_rows(rows), pruned_channels(layer.output_depth);
+	for (int row = 0; row < rows; row++) {
+		double largest = 0;
+		for (int filter = 0; filter < layer.output_depth; filter++) {
+			largest = std::max(largest, std::fabs(weights[(long)row * layer.output_depth + filter]));
+		}
+		pruned_rows[row] = largest <= threshold;
+	}
+	for (int filter = 0; filter < layer.output_depth; filter++) {
+		double largest = 0;
+		for (int row = 0; row < rows; row++) {
+			largest = std::max(largest, std::fabs(weights[(long)row * layer.output_depth + filter]));
+		}
+		pruned_channels[filter] = largest <= threshold;
+	}
+	for (int row = 0; row < rows; row++) {
+		for (int filter = 0; filter < layer.output_depth; filter++) {
+			double& weight = weights[(long)row * layer.output_depth + filter];
+			if (pruned_rows[row] or pruned_channels[filter]) {
+				weight = 0;
+			}
+			pruning.zero_weights += weight == 0 ? 1 : 0;
+		}
+	}
+	pruning.pruned_rows = (int)std::count(pruned_rows.begin(), pruned_rows.end(), true);
+	pruning.pruned_output_channels = (int)std::count(pruned_channels.begin(), pruned_channels.end(), true);
+	return pruning;
+}
+
+}
+
+long PruningReport::weights() const {
+	long count = 0;
+	for (const LayerPruning& layer : layers) {
+		count += layer.weights;
+	}
+	return count;
+}
+
+long PruningReport::zero_weights() const {
+	long count = 0;
+	for (const LayerPruning& layer : layers) {
+		count += layer.zero_weights;
+	}
+	return count;
+}
+
+ModelWeights prune_weights(const ModelWeights& model, double threshold, PruningReport* report) {
+
+	ModelWeights pruned = model;
+	if (report != nullptr) {
+		report->threshold = threshold;
+		report->layers.clear();
+	}
+	for (const DenseLayer& layer : dense_layers) {
+		const LayerPruning pruning = prune_layer(layer, pruned.*layer.weights, threshold);
+		if (report != nullptr) {
+			report->layers.push_back(pruning);
+		}
+	}
+	return pruned;
+}
+
+}
@@ -0,0 +1,268 @@
+#include <algorithm>
+#include "Kernels.h"
+#include "SeparableConv.h"
+#ifdef FLARENET_X86_SIMD
+#include <immintrin.h>
+#endif
+
+namespace flarenet {
+
+namespace {
+
+const int kernel_size = 3;
+
+//Runs the layer over output rows first_row .. last_row - 1 in raster order, block pixels at a time. Blocks may wrap around
+//row ends (the pointwise step does not care where its pixels are), so only the last block of the band can be partial; it
+//is computed into a scratch tile. depthwise_kernel(first, count, panel) writes the depthwise results of pixels first..first+count-1 as
+//panel[count][input_depth]; pointwise_kernel(panel, out) writes block output pixels.
+template <int block, int input_depth, int output_depth, typename DepthwiseKernel, typename PointwiseKernel>
+void separable_blocks(float* output, int width, int first_row, int last_row, DepthwiseKernel depthwise_kernel, PointwiseKernel pointwise_kernel) {
+
+	float depthwise_panel[block * input_depth];
+	float scratch[block * output_depth];
+	const long pixels = (long)last_row * width;
+	for (long first = (long)first_row * width; first < pixels; first += block) {
+		const int count = pixels - first < block ? (int)(pixels - first) : block;
+		depthwise_kernel(first, count, depthwise_panel);
+		if (count == block) {
+			pointwise_kernel(depthwise_panel, output + first * output_depth);
+		}
+		else {
+			std::fill(depthwise_panel + count * input_depth, depthwise_panel + block * input_depth, 0.0f);
+			pointwise_kernel(depthwise_panel, scratch);
+			std::copy(scratch, scratch + count * output_depth, output + first * output_depth);
+		}
+	}
+}
+
+#ifdef FLARENET_X86_SIMD
+//Depthwise 3x3 convolution of count consecutive pixels (raster order, starting at pixel first), vectorized over channels.
+template <int input_depth>
+__attribute__((target("avx2,fma")))
+void depthwise_pixels_avx2(const float* input, int height, int width, long first, int count, const float* weight_depth_filt, float* depthwise_panel) {
+
+	const int U = input_depth / 8;
+	int x = first / width;
+	int y = first % width;
+	for (int b = 0; b < count; b++) {
+		__m256 depthwise_res[U];
+		for (int u = 0; u < U; u++) {
+			depthwise_res[u] = _mm256_setzero_ps();
+		}
+		for (int win_x = 0; win_x < kernel_size; win_x++) {
+			const int in_x = x + win_x - kernel_size / 2;
+			if (in_x < 0 or in_x >= height) {
+				continue;
+			}
+			for (int win_y = 0; win_y < kernel_size; win_y++) {
+				const int in_y = y + win_y - kernel_size / 2;
+				if (in_y < 0 or in_y >= width) {
+					continue;
+				}
+				const float* pixel = input + ((long)in_x * width + in_y) * input_depth;
+				const float* weights = weight_depth_filt + (win_x * kernel_size + win_y) * input_depth;
+				for (int u = 0; u < U; u++) {
+					depthwise_res[u] = _mm256_fmadd_ps(_mm256_loadu_ps(weights + u * 8), _mm256_loadu_ps(pixel + u * 8), depthwise_res[u]);
+				}
+			}
+		}
+		for (int u = 0; u < U; u++) {
+			_mm256_storeu_ps(depthwise_panel + b * input_depth + u * 8, depthwise_res[u]);
+		}
+		if (++y == width) {
+			y = 0;
+			x++;
+		}
+	}
+}
+
+//Pointwise micro-GEMM: block pixels x 16 output channels (2 ymm each) per register tile, repeated over the output
+//channels. Each weight row segment is loaded once per tile and reused by all pixels of the block.
+template <int block, int input_depth, int output_depth>
+__attribute__((target("avx2,fma")))
+void pointwise_block_avx2(const float* depthwise_panel, const float* weight_point_filt, const float* bias, float* output) {
+
+	const __m256 zero = _mm256_setzero_ps();
+	for (int filter = 0; filter < output_depth; filter += 16) {
+		__m256 pointwise_res[block][2];
+		for (int b = 0; b < block; b++) {
+			pointwise_res[b][0] = _mm256_loadu_ps(bias + filter);
+			pointwise_res[b][1] = _mm256_loadu_ps(bias + filter + 8);
+		}
+		for (int win_chn = 0; win_chn < input_depth; win_chn++) {
+			const __m256 weight_0 = _mm256_loadu_ps(weight_point_filt + win_chn * output_depth + filter);
+			const __m256 weight_1 = _mm256_loadu_ps(weight_point_filt + win_chn * output_depth + filter + 8);
+			for (int b = 0; b < block; b++) {
+				const __m256 depthwise_val = _mm256_broadcast_ss(depthwise_panel + b * input_depth + win_chn);
+				pointwise_res[b][0] = _mm256_fmadd_ps(weight_0, depthwise_val, pointwise_res[b][0]);
+				pointwise_res[b][1] = _mm256_fmadd_ps(weight_1, depthwise_val, pointwise_res[b][1]);
+			}
+		}
+		for (int b = 0; b < block; b++) {
+			_mm256_storeu_ps(output + b * output_depth + filter, _mm256_max_ps(pointwise_res[b][0], zero));
+			_mm256_storeu_ps(output + b * output_depth + filter + 8, _mm256_max_ps(pointwise_res[b][1], zero));
+		}
+	}
+}
+
+template <int input_depth, int output_depth>
+__attribute__((target("avx2,fma")))
+void separable_avx2(const float* input, float* output, int height, int width, const float* weight_depth_filt, const float* weight_point_filt, const float* bias, int first_row, int last_row) {
+
+	//12 accumulators of the 16 ymm registers, leaving room for the weight pair and the broadcast value.
+	const int block = 6;
+	separable_blocks<block, input_depth, output_depth>(output, width, first_row, last_row,
+		[&](long first, int count, float* depthwise_panel) {
+			depthwise_pixels_avx2<input_depth>(input, height, width, first, count, weight_depth_filt, depthwise_panel);
+		},
+		[&](const float* depthwise_panel, float* out) {
+			pointwise_block_avx2<block, input_depth, output_depth>(depthwise_panel, weight_point_filt, bias, out);
+		});
+}
+
+template <int input_depth>
+__attribute__((target("avx512f")))
+void depthwise_pixels_avx512(const float* input, int height, int width, long first, int count, const float* weight_depth_filt, float* depthwise_panel) {
+
+	const int U = input_depth / 16;
+	int x = first / width;
+	int y = first % width;
+	for (int b = 0; b < count; b++) {
+		__m512 depthwise_res[U];
+		for (int u = 0; u < U; u++) {
+			depthwise_res[u] = _mm512_setzero_ps();
+		}
+		for (int win_x = 0; win_x < kernel_size; win_x++) {
+			const int in_x = x + win_x - kernel_size / 2;
+			if (in_x < 0 or in_x >= height) {
+				continue;
+			}
+			for (int win_y = 0; win_y < kernel_size; win_y++) {
+				const int in_y = y + win_y - kernel_size / 2;
+				if (in_y < 0 or in_y >= width) {
+					continue;
+				}
+				const float* pixel = input + ((long)in_x * width + in_y) * input_depth;
+				const float* weights = weight_depth_filt + (win_x * kernel_size + win_y) * input_depth;
+				for (int u = 0; u < U; u++) {
+					depthwise_res[u] = _mm512_fmadd_ps(_mm512_loadu_ps(weights + u * 16), _mm512_loadu_ps(pixel + u * 16), depthwise_res[u]);
+				}
+			}
+		}
+		for (int u = 0; u < U; u++) {
+			_mm512_storeu_ps(depthwise_panel + b * input_depth + u * 16, depthwise_res[u]);
+		}
+		if (++y == width) {
+			y = 0;
+			x++;
+		}
+	}
+}
+
+//Pointwise micro-GEMM: the register tile spans all output channels (output_depth / 16 zmm per pixel), so each
+//depthwise value is broadcast once and every weight row is loaded once per block.
+template <int block, int input_depth, int output_depth>
+__attribute__((target("avx512f")))
+void pointwise_block_avx512(const float* depthwise_panel, const float* weight_point_filt, const float* bias, float* output) {
+
+	const int V = output_depth / 16;
+	__m512 pointwise_res[block][V];
+	for (int b = 0; b < block; b++) {
+		for (int v = 0; v < V; v++) {
+			pointwise_res[b][v] = _mm512_loadu_ps(bias + v * 16);
+		}
+	}
+	for (int win_chn = 0; win_chn < input_depth; win_chn++) {
+		__m512 weight[V];
+		for (int v = 0; v < V; v++) {
+			weight[v] = _mm512_loadu_ps(weight_point_filt + win_chn * output_depth + v * 16);
+		}
+		for (int b = 0; b < block; b++) {
+			const __m512 depthwise_val = _mm512_set1_ps(depthwise_panel[b * input_depth + win_chn]);
+			for (int v = 0; v < V; v++) {
+				pointwise_res[b][v] = _mm512_fmadd_ps(weight[v], depthwise_val, pointwise_res[b][v]);
+			}
+		}
+	}
+	const __m512 zero = _mm512_setzero_ps();
+	for (int b = 0; b < block; b++) {
+		for (int v = 0; v < V; v++) {
+			_mm512_storeu_ps(output + b * output_depth + v * 16, _mm512_max_ps(pointwise_res[b][v], zero));
+		}
+	}
+}
+
+template <int input_depth, int output_depth>
+__attribute__((target("avx512f")))
+void separable_avx512(const float* input, float* output, int height, int width, const float* weight_depth_filt, const float* weight_point_filt, const float* bias, int first_row, int last_row) {
+
+	//24 accumulators of the 32 zmm registers: 12 pixels for 32 outputs, 8 for 48, 6 for 64.
+	const int block = 24 / (output_depth / 16);
+	separable_blocks<block, input_depth, output_depth>(output, width, first_row, last_row,
+		[&](long first, int count, float* depthwise_panel) {
+			depthwise_pixels_avx512<input_depth>(input, height, width, first, count, weight_depth_filt, depthwise_panel);
+		},
+		[&](const float* depthwise_panel, float* out) {
+			pointwise_block_avx512<block, input_depth, output_depth>(depthwise_panel, weight_point_filt, bias, out);
+		});
+}
+#endif
+
+}
+
+template <int input_depth, int output_depth>
+void fused_separable_dw2d_relu(const float* input, float* output, int height, int width, const float* weight_depth_filt, const float* weight_point_filt, const float* bias, Isa isa) {
+	fused_separable_dw2d_relu<input_depth, output_depth>(input, output, height, width, weight_depth_filt, weight_point_filt, bias, 0, height, isa);
+}
+
+template <int input_depth, int output_depth>
+void fused_separable_dw2d_relu(const float* input, float* output, int height, int width, const float* weight_depth_filt, const float* weight_point_filt, const float* bias, int first_row, int last_row, Isa isa) {
+
+	static_assert(input_depth % 16 == 0 and output_depth % 16 == 0, "depths must be multiples of 16");
+	if (!isa_supported(isa)) {
+		isa = Isa::scalar;
+	}
+	switch (isa) {
+#ifdef FLARENET_X86_SIMD
+	case Isa::avx512:
+		separable_avx512<input_depth, output_depth>(input, output, height, width, weight_depth_filt, weight_point_filt, bias, first_row, last_row);
+		break;
+	case Isa::avx2:
+		separable_avx2<input_depth, output_depth>(input, output, height, width, weight_depth_filt, weight_point_filt, bias, first_row, last_row);
+		break;
+#endif
+	default:
+		separable_dw2d_relu<kernel_size, input_depth, output_depth>(input, output, height, width, weight_depth_filt, weight_point_filt, bias, first_row, last_row);
+		break;
+	}
+}
+
+template <int input_depth, int output_depth>
+void fused_separable_dw2d_relu_maxpool(const float* input, float* output, float* skip, int height, int width, const float* weight_depth_filt, const float* weight_point_filt, const float* bias, Isa isa) {
+	std::vector<float> scratch(skip == nullptr ? pooled_row_scratch(width, output_depth) : 0);
+	fused_separable_dw2d_relu_maxpool<input_depth, output_depth>(input, output, skip, height, width, weight_depth_filt, weight_point_filt, bias, 0, height / 2, scratch.data(), isa);
+}
+
+template <int input_depth, int output_depth>
+void fused_separable_dw2d_relu_maxpool(const float* input, float* output, float* skip, int height, int width, const float* weight_depth_filt, const float* weight_point_filt, const float* bias, int first_row, int last_row, float* scratch, Isa isa) {
+	pooled_row_pairs<input_depth, output_depth>(input, output, skip, height, width, first_row, last_row, scratch,
+		[&](const float* band_input, float* band_output, int band_height, int first, int last) {
+			fused_separable_dw2d_relu<input_depth, output_depth>(band_input, band_output, band_height, width, weight_depth_filt, weight_point_filt, bias, first, last, isa);
+		});
+}
+
+template void fused_separable_dw2d_relu<16, 32>(const float*, float*, int, int, const float*, const float*, const float*, Isa);
+template void fused_separable_dw2d_relu<16, 32>(const float*, float*, int, int, const float*, const float*, const float*, int, int, Isa);
+template void fused_separable_dw2d_relu<32, 48>(const float*, float*, int, int, const float*, const float*, const float*, Isa);
+template void fused_separable_dw2d_relu<32, 48>(const float*, float*, int, int, const float*, const float*, const float*, int, int, Isa);
+template void fused_separable_dw2d_relu<48, 64>(const float*, float*, int, int, const float*, const float*, const float*, Isa);
+template void fused_separable_dw2d_relu<48, 64>(const float*, float*, int, int, const float*, const float*, const float*, int, int, Isa);
+
+template void fused_separable_dw2d_relu_maxpool<16, 32>(const float*, float*, float*, int, int, const float*, const float*, const float*, Isa);
+template void fused_separable_dw2d_relu_maxpool<16, 32>(const float*, float*, float*, int, int, const float*, const float*, const float*, int, int, float*, Isa);
+template void fused_separable_dw2d_relu_maxpool<32, 48>(const float*, float*, float*, int, int, const float*, const float*, const float*, Isa);
+template void fused_separable_dw2d_relu_maxpool<32, 48>(const float*, float*, float*, int, int, const float*, const float*, const float*, int, int, float*, Isa);
+template void fused_separable_dw2d_relu_maxpool<48, 64>(const float*, float*, float*, int, int, const float*, const float*, const float*, Isa);
+template void fused_separable_dw2d_relu_maxpool<48, 64>(const float*, float*, float*, int, int, const float*, const float*, const float*, int, int, float*, Isa);
+
+}
@@ -0,0 +1,79 @@
+#include "ThreadPool.h"
+
+namespace flarenet {
+
+ThreadPool::ThreadPool(int threads) {
+	for (int thread = 1; thread < threads; thread++) {
+		workers.emplace_back(&ThreadPool::work, this);
+	}
+}
+
+ThreadPool::~ThreadPool() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	start.notify_all();
+	for (std::thread& worker : workers) {
+		worker.join();
+	}
+}
+
+void ThreadPool::run_loop(int count, const void* task, void (*invoke)(const void*, int)) {
+
+	if (workers.empty() or count == 1) {
+		for (int index = 0; index < count; index++) {
+			invoke(task, index);
+		}
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		current = task;
+		invoke_current = invoke;
+		task_count = count;
+		next_task = 0;
+		finished_tasks = 0;
+		generation++;
+	}
+	start.notify_all();
+	run_tasks();
+	std::unique_lock<std::mutex> lock(mutex);
+	done.wait(lock, [this]() { return finished_tasks == task_count; });
+	current = nullptr;
+	invoke_current = nullptr;
+}
+
+void ThreadPool::work() {
+
+	unsigned long seen_generation = 0;
+	for (;;) {
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			start.wait(lock, [&]() { return stopping or generation != seen_generation; });
+			if (stopping) {
+				return;
+			}
+			seen_generation = generation;
+		}
+		run_tasks();
+	}
+}
+
+void ThreadPool::run_tasks() {
+
+	std::unique_lock<std::mutex> lock(mutex);
+	while (current != nullptr and next_task < task_count) {
+		const int index = next_task++;
+		const void* task = current;
+		void (*invoke)(const void*, int) = invoke_current;
+		lock.unlock();
+		invoke(task, index);
+		lock.lock();
+		if (++finished_tasks == task_count) {
+			done.notify_all();
+		}
+	}
+}
+
+}
@@ -0,0 +1,180 @@
+#include <algorithm>
+#include <stdexcept>
+#include "ModelWeights.h"
+#include "ThreadPool.h"
+#include "TiledEngine.h"
+
+namespace flarenet {
+
+namespace {
+
+//Origins of the tiles along an axis of size pixels: every tile_size - overlap pixels, and a last tile that ends on the
+//border, or up to 15 pixels past it so that its origin stays on the grid of Engine::size_multiple (a single tile when the
+//axis is no longer than a tile).
+std::vector<int> tile_starts(int size, int tile_size, int overlap) {
+
+	std::vector<int> starts;
+	int start = 0;
+	for (; start + tile_size < size; start += tile_size - overlap) {
+		starts.push_back(start);
+	}
+	const int last = std::max(size - tile_size, 0);
+	starts.push_back((last + Engine::size_multiple - 1) / Engine::size_multiple * Engine::size_multiple);
+	return starts;
+}
+
+//Feather weights of the tile_size pixels of a tile starting at start, 0 for the padding past the end of the frame. At each
+//edge that has a neighbour the weight is 0 over the pixels that lack context on that side, then rises linearly to 1 over
+//the rest of the overlap. Overlaps with no room for a ramp after both margins keep a third of the overlap for the ramp and
+//shrink the margins in proportion. The ramps of two neighbours cover each other's margins, so every pixel has a positive
+//weight.
+std::vector<float> tile_weights(int start, int size, int tile_size, int overlap) {
+
+	const int before = TiledEngine::context_before, after = TiledEngine::context_after;
+	const int ramp = overlap > before + after ? overlap - before - after : overlap / 3;
+	//Margin at the leading edge (its pixels lack context before them) and at the trailing edge.
+	const int leading_margin = (overlap - ramp) * before / (before + after);
+	const int trailing_margin = (overlap - ramp) * after / (before + after);
+	auto rise = [&](int distance, int margin) { return std::min(1.0f, std::max(0.0f, (distance + 1 - margin) / (float)(ramp + 1))); };
+
+	std::vector<float> weights(tile_size);
+	for (int i = 0; i < tile_size; i++) {
+		float weight = start + i < size ? 1.0f : 0.0f;
+		if (start > 0) {
+			weight = std::min(weight, rise(i, leading_margin));
+		}
+		if (start + tile_size < size) {
+			weight = std::min(weight, rise(tile_size - 1 - i, trailing_margin));
+		}
+		weights[i] = weight;
+	}
+	return weights;
+}
+
+//Feather weights of the tiles starting at starts, divided by their sum at every pixel of the axis. Tiles form a grid, so
+//the weight of a tile at a pixel is the product of its row and column weights and the product of the normalized weights
+//sums to 1 over the tiles covering the pixel.
+std::vector<std::vector<float>> normalized_weights(const std::vector<int>& starts, int size, int tile_size, int overlap) {
+
+	std::vector<std::vector<float>> weights;
+	std::vector<float> sums(size);
+	for (int start : starts) {
+		weights.push_back(tile_weights(start, size, tile_size, overlap));
+		for (int i = 0; i < tile_size and start + i < size; i++) {
+			sums[start + i] += weights.back()[i];
+		}
+	}
+	for (size_t tile = 0; tile < starts.size(); tile++) {
+		for (int i = 0; i < tile_size and starts[tile] + i < size; i++) {
+			weights[tile][i] /= sums[starts[tile] + i];
+		}
+	}
+	return weights;
+}
+
+}
+
+TiledEngine::TiledEngine(int height, int width, int threads, int tile_size, int overlap) : TiledEngine(model_weights(), height, width, threads, tile_size, overlap) {
+}
+
+TiledEngine::TiledEngine(const ModelWeights& model, int height, int width, int threads, int tile_size, int overlap)
+	: frame_height(height), frame_width(width), tile_size(tile_size), next_tile(0) {
+
+	//tile_starts() only terminates on a positive stride of tile_size - overlap.
+	if (tile_size <= 0 or tile_size % Engine::size_multiple != 0 or overlap >= tile_size) {
+		throw std::invalid_argument("TiledEngine: invalid tile size");
+	}
+	if (height <= 0 or width <= 0 or overlap < 0 or overlap > tile_size / 2 or overlap % Engine::size_multiple != 0) {
+		throw std::invalid_argument("TiledEngine: invalid frame size or overlap");
+	}
+	row_starts = tile_starts(height, tile_size, overlap);
+	column_starts = tile_starts(width, tile_size, overlap);
+	row_weights = normalized_weights(row_starts, height, tile_size, overlap);
+	column_weights = normalized_weights(column_starts, width, tile_size, overlap);
+
+	const int tile_values = tile_size * tile_size * Engine::input_depth;
+	const int engine_count = std::max(1, std::min(threads, tiles()));
+	for (int thread = 0; thread < engine_count; thread++) {
+		engines.emplace_back(new Engine(model, 1, 1, tile_size, tile_size));
+		tile_inputs.emplace_back(tile_values);
+		tile_outputs.emplace_back(tile_values);
+	}
+	if (engine_count > 1) {
+		pool.reset(new ThreadPool(engine_count));
+	}
+}
+
+TiledEngine::~TiledEngine() {
+}
+
+size_t TiledEngine::memory_bytes() const {
+
+	size_t bytes = 0;
+	for (size_t thread = 0; thread < engines.size(); thread++) {
+		bytes += engines[thread]->activations().peak_bytes() + (tile_inputs[thread].size() + tile_outputs[thread].size()) * sizeof(float);
+	}
+	return bytes;
+}
+
+void TiledEngine::run(const float* in, float* out) {
+
+	std::fill(out, out + frame_values(), 0.0f);
+	next_tile = 0;
+	blended_tiles = 0;
+	if (pool == nullptr) {
+		run_tiles(in, out, 0);
+	}
+	else {
+		pool->parallel_for(threads(), [&](int thread) { run_tiles(in, out, thread); });
+	}
+}
+
+void TiledEngine::run_tiles(const float* in, float* out, int thread) {
+
+	const int depth = Engine::input_depth;
+	float* tile_input = tile_inputs[thread].data();
+	float* tile_output = tile_outputs[thread].data();
+	for (int tile = next_tile++; tile < tiles(); tile = next_tile++) {
+		const int first_row = row_starts[tile / column_starts.size()];
+		const int first_column = column_starts[tile % column_starts.size()];
+		//Copy the tile, zero padding whatever lies past the frame.
+		const int rows = std::min(tile_size, frame_height - first_row);
+		const int columns = std::min(tile_size, frame_width - first_column);
+		std::fill(tile_inputs[thread].begin(), tile_inputs[thread].end(), 0.0f);
+		for (int x = 0; x < rows; x++) {
+			const float* row = in + ((long)(first_row + x) * frame_width + first_column) * depth;
+			std::copy(row, row + columns * depth, tile_input + (long)x * tile_size * depth);
+		}
+		engines[thread]->run(tile_input, tile_output);
+
+		std::unique_lock<std::mutex> lock(blend_mutex);
+		blend_turn.wait(lock, [&]() { return blended_tiles == tile; });
+		blend(out, tile, tile_output);
+		blended_tiles++;
+		blend_turn.notify_all();
+	}
+}
+
+void TiledEngine::blend(float* out, int tile, const float* tile_output) {
+
+	const int depth = Engine::output_depth;
+	const int row_tile = tile / column_starts.size();
+	const int column_tile = tile % column_starts.size();
+	const int first_row = row_starts[row_tile];
+	const int first_column = column_starts[column_tile];
+	const int rows = std::min(tile_size, frame_height - first_row);
+	const int columns = std::min(tile_size, frame_width - first_column);
+	for (int x = 0; x < rows; x++) {
+		const float row_weight = row_weights[row_tile][x];
+		float* out_row = out + ((long)(first_row + x) * frame_width + first_column) * depth;
+		const float* tile_row = tile_output + (long)x * tile_size * depth;
+		for (int y = 0; y < columns; y++) {
+			const float weight = row_weight * column_weights[column_tile][y];
+			for (int channel = 0; channel < depth; channel++) {
+				out_row[y * depth + channel] += weight * tile_row[y * depth + channel];
+			}
+		}
+	}
+}
+
+}
@@ -0,0 +1,599 @@
+#include <algorithm>
+#include <stdexcept>
+#include "Kernels.h"
+#include "TransposedConv.h"
+#ifdef FLARENET_X86_SIMD
+#include <immintrin.h>
+#endif
+
+namespace flarenet {
+
+namespace {
+
+const int kernel_size = 3;
+const int stride = 2;
+
+//Kernel taps of one output pixel. input[t] is the input pixel of tap t for the first pixel of a block; the pixel of the
+//next output of the same phase (two columns to the right) is the next input pixel. On a compacted kernel, tap t has
+//rows[t] weight rows, for input channels channels[t]; on a dense kernel every tap has input_depth rows.
+struct PhaseTaps {
+	int count;
+	const float* input[4];
+	const float* weights[4];
+	const int* channels[4];
+	int rows[4];
+};
+
+//Weight rows of tap win_x * 3 + win_y, from the dense kernel or, if kernel is given, its compacted form.
+template <int input_depth, int output_depth>
+void tap_rows(const float* weight_filt, const CompactKernel* kernel, int win_x, int win_y, PhaseTaps& taps) {
+	const int tap = win_x * kernel_size + win_y;
+	if (kernel == nullptr) {
+		taps.weights[taps.count] = weight_filt + tap * input_depth * output_depth;
+		taps.channels[taps.count] = nullptr;
+		taps.rows[taps.count] = input_depth;
+	}
+	else {
+		taps.weights[taps.count] = kernel->tap_weights[tap].data();
+		taps.channels[taps.count] = kernel->tap_channels[tap].data();
+		taps.rows[taps.count] = (int)kernel->tap_channels[tap].size();
+	}
+	taps.count++;
+}
+
+//Gathers the taps of output pixel (out_x, 2*b + phase_y), input rows first, then input columns, ascending.
+template <int input_depth, int output_depth>
+void phase_taps(const float* input, int width, const float* weight_filt, const CompactKernel* kernel, int out_x, int b, int phase_y, PhaseTaps& taps) {
+
+	//Kernel rows reaching out_x, with their input rows.
+	int win_x[2], in_x[2];
+	int rows = 0;
+	if (out_x % stride == 0) {
+		if (out_x >= stride) {
+			win_x[rows] = 2;
+			in_x[rows++] = out_x / stride - 1;
+		}
+		win_x[rows] = 0;
+		in_x[rows++] = out_x / stride;
+	}
+	else {
+		win_x[rows] = 1;
+		in_x[rows++] = out_x / stride;
+	}
+	taps.count = 0;
+	for (int r = 0; r < rows; r++) {
+		const float* row = input + (long)in_x[r] * width * input_depth;
+		if (phase_y == 0) {
+			if (b >= 1) {
+				taps.input[taps.count] = row + (b - 1) * input_depth;
+				tap_rows<input_depth, output_depth>(weight_filt, kernel, win_x[r], 2, taps);
+			}
+			taps.input[taps.count] = row + b * input_depth;
+			tap_rows<input_depth, output_depth>(weight_filt, kernel, win_x[r], 0, taps);
+		}
+		else {
+			taps.input[taps.count] = row + b * input_depth;
+			tap_rows<input_depth, output_depth>(weight_filt, kernel, win_x[r], 1, taps);
+		}
+	}
+}
+
+//Walks output rows first_row .. last_row - 1 and, per row, both column phases: block output pixels at a time where every pixel has the same
+//taps, one at a time elsewhere (the first even column misses its left taps, and the row remainder).
+//block_kernel(taps, out, skip) computes block pixels, pixel_kernel(taps, out, skip) one pixel; both write output pixels
+//stride pixels apart.
+template <int block, int input_depth, int output_depth, typename BlockKernel, typename PixelKernel>
+void subpixel_rows(const float* input, float* output, int width, int first_row, int last_row, const float* weight_filt, const CompactKernel* kernel, const float* skip, BlockKernel block_kernel, PixelKernel pixel_kernel) {
+
+	const int output_width = width * stride;
+	PhaseTaps taps;
+	for (int out_x = first_row; out_x < last_row; out_x++) {
+		const long row_offset = (long)out_x * output_width * output_depth;
+		for (int phase_y = 0; phase_y < stride; phase_y++) {
+			int b = 0;
+			for (; b < width; ) {
+				const long offset = row_offset + (long)(b * stride + phase_y) * output_depth;
+				phase_taps<input_depth, output_depth>(input, width, weight_filt, kernel, out_x, b, phase_y, taps);
+				if ((b >= 1 or phase_y == 1) and b + block <= width) {
+					block_kernel(taps, output + offset, skip == nullptr ? nullptr : skip + offset);
+					b += block;
+				}
+				else {
+					pixel_kernel(taps, output + offset, skip == nullptr ? nullptr : skip + offset);
+					b++;
+				}
+			}
+		}
+	}
+}
+
+//Portable variant: block pixels x 8 output channels per vec8 tile (Kernels.h vector extensions), used when the host has
+//neither AVX2 nor AVX-512.
+template <int block, int input_depth, int output_depth, bool compact>
+void gather_block_vec(const PhaseTaps& taps, const float* bias, float* output, const float* skip) {
+
+	for (int filter = 0; filter < output_depth; filter += vec_width) {
+		vec8 conv_res[block];
+		for (int b = 0; b < block; b++) {
+			conv_res[b] = load_vec(bias + filter);
+		}
+		for (int tap = 0; tap < taps.count; tap++) {
+			const float* pixel_vec = taps.input[tap];
+			const float* weights = taps.weights[tap] + filter;
+			const int rows = compact ? taps.rows[tap] : input_depth;
+			for (int row = 0; row < rows; row++) {
+				const int win_chn = compact ? taps.channels[tap][row] : row;
+				const vec8 weight = load_vec(weights + row * output_depth);
+				for (int b = 0; b < block; b++) {
+					conv_res[b] += weight * broadcast_vec(pixel_vec[b * input_depth + win_chn]);
+				}
+			}
+		}
+		for (int b = 0; b < block; b++) {
+			vec8 value = relu_vec(conv_res[b]);
+			if (skip != nullptr) {
+				value = relu_vec(value + load_vec(skip + b * stride * output_depth + filter));
+			}
+			store_vec(output + b * stride * output_depth + filter, value);
+		}
+	}
+}
+
+template <int input_depth, int output_depth, bool compact>
+void subpixel_vec(const float* input, float* output, int width, int first_row, int last_row, const float* weight_filt, const CompactKernel* kernel, const float* bias, const float* skip) {
+
+	const int block = 4;
+	subpixel_rows<block, input_depth, output_depth>(input, output, width, first_row, last_row, weight_filt, kernel, skip,
+		[&](const PhaseTaps& taps, float* out, const float* skip_out) {
+			gather_block_vec<block, input_depth, output_depth, compact>(taps, bias, out, skip_out);
+		},
+		[&](const PhaseTaps& taps, float* out, const float* skip_out) {
+			gather_block_vec<1, input_depth, output_depth, compact>(taps, bias, out, skip_out);
+		});
+}
+
+#ifdef FLARENET_X86_SIMD
+//block pixels x 16 output channels (2 ymm each) per register tile, repeated over the output channels.
+template <int block, int input_depth, int output_depth, bool compact>
+__attribute__((target("avx2,fma")))
+void gather_block_avx2(const PhaseTaps& taps, const float* bias, float* output, const float* skip) {
+
+	const __m256 zero = _mm256_setzero_ps();
+	for (int filter = 0; filter < output_depth; filter += 16) {
+		__m256 conv_res[block][2];
+		for (int b = 0; b < block; b++) {
+			conv_res[b][0] = _mm256_loadu_ps(bias + filter);
+			conv_res[b][1] = _mm256_loadu_ps(bias + filter + 8);
+		}
+		for (int tap = 0; tap < taps.count; tap++) {
+			const float* pixel_vec = taps.input[tap];
+			const float* weights = taps.weights[tap] + filter;
+			const int rows = compact ? taps.rows[tap] : input_depth;
+			for (int row = 0; row < rows; row++) {
+				const int win_chn = compact ? taps.channels[tap][row] : row;
+				const __m256 weight_0 = _mm256_loadu_ps(weights + row * output_depth);
+				const __m256 weight_1 = _mm256_loadu_ps(weights + row * output_depth + 8);
+				for (int b = 0; b < block; b++) {
+					const __m256 pixel_val = _mm256_broadcast_ss(pixel_vec + b * input_depth + win_chn);
+					conv_res[b][0] = _mm256_fmadd_ps(weight_0, pixel_val, conv_res[b][0]);
+					conv_res[b][1] = _mm256_fmadd_ps(weight_1, pixel_val, conv_res[b][1]);
+				}
+			}
+		}
+		for (int b = 0; b < block; b++) {
+			float* out = output + b * stride * output_depth + filter;
+			for (int half = 0; half < 2; half++) {
+				__m256 value = _mm256_max_ps(conv_res[b][half], zero);
+				if (skip != nullptr) {
+					value = _mm256_max_ps(_mm256_add_ps(value, _mm256_loadu_ps(skip + b * stride * output_depth + filter + half * 8)), zero);
+				}
+				_mm256_storeu_ps(out + half * 8, value);
+			}
+		}
+	}
+}
+
+template <int input_depth, int output_depth, bool compact>
+__attribute__((target("avx2,fma")))
+void subpixel_avx2(const float* input, float* output, int width, int first_row, int last_row, const float* weight_filt, const CompactKernel* kernel, const float* bias, const float* skip) {
+
+	const int block = 6;
+	subpixel_rows<block, input_depth, output_depth>(input, output, width, first_row, last_row, weight_filt, kernel, skip,
+		[&](const PhaseTaps& taps, float* out, const float* skip_out) {
+			gather_block_avx2<block, input_depth, output_depth, compact>(taps, bias, out, skip_out);
+		},
+		[&](const PhaseTaps& taps, float* out, const float* skip_out) {
+			gather_block_avx2<1, input_depth, output_depth, compact>(taps, bias, out, skip_out);
+		});
+}
+
+//Scatter form for AVX2 (conv2d_transposed of Kernels.h on ymm registers), restricted to output rows first_row ..
+//last_row - 1: scatters block input pixels of row x, starting at column y, into the output rows of the band. Output
+//channels go 32 at a time, so the 4 weight vectors of an input channel feed block x 4 accumulators.
+template <int block, int input_depth, int output_depth>
+__attribute__((target("avx2,fma")))
+void scatter_pixels_avx2(const float* input, float* output, int width, int x, int y, int first_row, int last_row, const float* weight_filt) {
+
+	const int output_width = width * stride;
+	const float* pixel_vec = input + ((long)x * width + y) * input_depth;
+
+	for (int win_x = 0; win_x < kernel_size; win_x++) {
+		const int out_x = x * stride + win_x;
+		if (out_x < first_row or out_x >= last_row) {
+			continue;
+		}
+		for (int win_y = 0; win_y < kernel_size; win_y++) {
+			//Taps cropped at the right border accumulate into a scratch pixel and are dropped.
+			float scratch[output_depth];
+			float* out[block];
+			for (int b = 0; b < block; b++) {
+				const int out_y = (y + b) * stride + win_y;
+				out[b] = output + ((long)out_x * output_width + out_y) * output_depth;
+				if (out_y >= output_width) {
+					std::fill(scratch, scratch + output_depth, 0.0f);
+					out[b] = scratch;
+				}
+			}
+			const float* weights = weight_filt + (win_x * kernel_size + win_y) * input_depth * output_depth;
+			for (int filter = 0; filter < output_depth; filter += 32) {
+				__m256 conv_res[block][4];
+				for (int b = 0; b < block; b++) {
+					for (int v = 0; v < 4; v++) {
+						conv_res[b][v] = _mm256_loadu_ps(out[b] + filter + v * 8);
+					}
+				}
+				for (int win_chn = 0; win_chn < input_depth; win_chn++) {
+					__m256 weight[4];
+					for (int v = 0; v < 4; v++) {
+						weight[v] = _mm256_loadu_ps(weights + win_chn * output_depth + filter + v * 8);
+					}
+					for (int b = 0; b < block; b++) {
+						const __m256 pixel_val = _mm256_broadcast_ss(pixel_vec + b * input_depth + win_chn);
+						for (int v = 0; v < 4; v++) {
+							conv_res[b][v] = _mm256_fmadd_ps(weight[v], pixel_val, conv_res[b][v]);
+						}
+					}
+				}
+				for (int b = 0; b < block; b++) {
+					for (int v = 0; v < 4; v++) {
+						_mm256_storeu_ps(out[b] + filter + v * 8, conv_res[b][v]);
+					}
+				}
+			}
+		}
+	}
+}
+
+//Output rows of the band are initialized with the bias just before the first input row that touches them and get their
+//ReLU (and skip Add) once input row x has completed rows 2x and 2x+1, so both passes stay in cache.
+template <int input_depth, int output_depth>
+__attribute__((target("avx2,fma")))
+void scatter_avx2(const float* input, float* output, int width, int first_row, int last_row, const float* weight_filt, const float* bias, const float* skip) {
+
+	const int block = 3;
+	const int blocked_width = width - width % block;
+	const long row_values = (long)width * stride * output_depth;
+	const __m256 zero = _mm256_setzero_ps();
+	int initialized_rows = first_row;
+
+	//Input row x reaches output rows 2x .. 2x+2.
+	for (int x = std::max(first_row - 1, 0) / stride; x < (last_row + 1) / stride; x++) {
+		for (; initialized_rows < std::min(x * stride + kernel_size, last_row); initialized_rows++) {
+			float* row = output + initialized_rows * row_values;
+			for (long value = 0; value < row_values; value += 8) {
+				_mm256_storeu_ps(row + value, _mm256_loadu_ps(bias + value % output_depth));
+			}
+		}
+		for (int y = 0; y < blocked_width; y += block) {
+			scatter_pixels_avx2<block, input_depth, output_depth>(input, output, width, x, y, first_row, last_row, weight_filt);
+		}
+		for (int y = blocked_width; y < width; y++) {
+			scatter_pixels_avx2<1, input_depth, output_depth>(input, output, width, x, y, first_row, last_row, weight_filt);
+		}
+		for (int out_x = std::max(x * stride, first_row); out_x < std::min(x * stride + stride, last_row); out_x++) {
+			float* row = output + out_x * row_values;
+			for (long value = 0; value < row_values; value += 8) {
+				__m256 result = _mm256_max_ps(_mm256_loadu_ps(row + value), zero);
+				if (skip != nullptr) {
+					result = _mm256_max_ps(_mm256_add_ps(result, _mm256_loadu_ps(skip + out_x * row_values + value)), zero);
+				}
+				_mm256_storeu_ps(row + value, result);
+			}
+		}
+	}
+}
+
+//The register tile spans all output channels (output_depth / 16 zmm per pixel): every input value is broadcast once
+//and every weight row is loaded once per block.
+template <int block, int input_depth, int output_depth, bool compact>
+__attribute__((target("avx512f")))
+void gather_block_avx512(const PhaseTaps& taps, const float* bias, float* output, const float* skip) {
+
+	const int V = output_depth / 16;
+	__m512 conv_res[block][V];
+	for (int b = 0; b < block; b++) {
+		for (int v = 0; v < V; v++) {
+			conv_res[b][v] = _mm512_loadu_ps(bias + v * 16);
+		}
+	}
+	for (int tap = 0; tap < taps.count; tap++) {
+		const float* pixel_vec = taps.input[tap];
+		const float* weights = taps.weights[tap];
+		const int rows = compact ? taps.rows[tap] : input_depth;
+		for (int row = 0; row < rows; row++) {
+			const int win_chn = compact ? taps.channels[tap][row] : row;
+			__m512 weight[V];
+			for (int v = 0; v < V; v++) {
+				weight[v] = _mm512_loadu_ps(weights + row * output_depth + v * 16);
+			}
+			for (int b = 0; b < block; b++) {
+				const __m512 pixel_val = _mm512_set1_ps(pixel_vec[b * input_depth + win_chn]);
+				for (int v = 0; v < V; v++) {
+					conv_res[b][v] = _mm512_fmadd_ps(weight[v], pixel_val, conv_res[b][v]);
+				}
+			}
+		}
+	}
+	const __m512 zero = _mm512_setzero_ps();
+	for (int b = 0; b < block; b++) {
+		float* out = output + b * stride * output_depth;
+		for (int v = 0; v < V; v++) {
+			__m512 value = _mm512_max_ps(conv_res[b][v], zero);
+			if (skip != nullptr) {
+				value = _mm512_max_ps(_mm512_add_ps(value, _mm512_loadu_ps(skip + b * stride * output_depth + v * 16)), zero);
+			}
+			_mm512_storeu_ps(out + v * 16, value);
+		}
+	}
+}
+
+//Both column phases of block input columns of one output row: output pixels 2*(b+p) and 2*(b+p)+1 for p < block.
+//Input pixel (in_x, c) feeds kernel column 0 of output 2c, column 1 of output 2c+1 and column 2 of output 2c+2, so each
+//broadcast input value is used by three FMAs. rows[r] is the input row of kernel row win_x[r], row_weights[r] its weights,
+//[3][row_depths[r]][output_depth] for input channels row_channels[r] on a compacted kernel.
+template <int block, int input_depth, int output_depth, bool compact>
+__attribute__((target("avx512f")))
+void gather_pairs_avx512(const float* const rows[2], const float* const row_weights[2], const int* const row_channels[2], const int row_depths[2], int row_count, int b, const float* bias, float* output, const float* skip) {
+
+	const int V = output_depth / 16;
+	__m512 even_res[block][V], odd_res[block][V];
+	for (int p = 0; p < block; p++) {
+		for (int v = 0; v < V; v++) {
+			even_res[p][v] = _mm512_loadu_ps(bias + v * 16);
+			odd_res[p][v] = even_res[p][v];
+		}
+	}
+	for (int r = 0; r < row_count; r++) {
+		const float* pixel_vec = rows[r] + b * input_depth;
+		const float* weights = row_weights[r];
+		const int depth = compact ? row_depths[r] : input_depth;
+		for (int row = 0; row < depth; row++) {
+			const int win_chn = compact ? row_channels[r][row] : row;
+			__m512 weight[3][V];
+			for (int win_y = 0; win_y < 3; win_y++) {
+				for (int v = 0; v < V; v++) {
+					weight[win_y][v] = _mm512_loadu_ps(weights + (win_y * depth + row) * output_depth + v * 16);
+				}
+			}
+			if (b >= 1) {
+				const __m512 left_val = _mm512_set1_ps(pixel_vec[win_chn - input_depth]);
+				for (int v = 0; v < V; v++) {
+					even_res[0][v] = _mm512_fmadd_ps(weight[2][v], left_val, even_res[0][v]);
+				}
+			}
+			for (int p = 0; p < block; p++) {
+				const __m512 pixel_val = _mm512_set1_ps(pixel_vec[p * input_depth + win_chn]);
+				for (int v = 0; v < V; v++) {
+					even_res[p][v] = _mm512_fmadd_ps(weight[0][v], pixel_val, even_res[p][v]);
+					odd_res[p][v] = _mm512_fmadd_ps(weight[1][v], pixel_val, odd_res[p][v]);
+					if (p + 1 < block) {
+						even_res[p + 1][v] = _mm512_fmadd_ps(weight[2][v], pixel_val, even_res[p + 1][v]);
+					}
+				}
+			}
+		}
+	}
+	const __m512 zero = _mm512_setzero_ps();
+	for (int p = 0; p < block; p++) {
+		for (int v = 0; v < V; v++) {
+			__m512 even_val = _mm512_max_ps(even_res[p][v], zero);
+			__m512 odd_val = _mm512_max_ps(odd_res[p][v], zero);
+			if (skip != nullptr) {
+				even_val = _mm512_max_ps(_mm512_add_ps(even_val, _mm512_loadu_ps(skip + (2 * p) * output_depth + v * 16)), zero);
+				odd_val = _mm512_max_ps(_mm512_add_ps(odd_val, _mm512_loadu_ps(skip + (2 * p + 1) * output_depth + v * 16)), zero);
+			}
+			_mm512_storeu_ps(output + (2 * p) * output_depth + v * 16, even_val);
+			_mm512_storeu_ps(output + (2 * p + 1) * output_depth + v * 16, odd_val);
+		}
+	}
+}
+
+template <int input_depth, int output_depth, bool compact>
+__attribute__((target("avx512f")))
+void subpixel_pairs_avx512(const float* input, float* output, int width, int first_row, int last_row, const float* weight_filt, const CompactKernel* kernel, const float* bias, const float* skip) {
+
+	//10 or 20 accumulators plus the three kernel columns of weights (measured best for 16 and 32 outputs).
+	const int block = 5;
+	const int output_width = width * stride;
+	for (int out_x = first_row; out_x < last_row; out_x++) {
+		const float* rows[2];
+		const float* row_weights[2];
+		const int* row_channels[2];
+		int row_depths[2];
+		int row_count = 0;
+		//Input row in_x through kernel row win_x.
+		auto add_row = [&](int in_x, int win_x) {
+			rows[row_count] = input + (long)in_x * width * input_depth;
+			if (compact) {
+				row_weights[row_count] = kernel->row_weights[win_x].data();
+				row_channels[row_count] = kernel->row_channels[win_x].data();
+				row_depths[row_count] = (int)kernel->row_channels[win_x].size();
+			}
+			else {
+				row_weights[row_count] = weight_filt + win_x * kernel_size * input_depth * output_depth;
+			}
+			row_count++;
+		};
+		if (out_x % stride == 0) {
+			if (out_x >= stride) {
+				add_row(out_x / stride - 1, 2);
+			}
+			add_row(out_x / stride, 0);
+		}
+		else {
+			add_row(out_x / stride, 1);
+		}
+		const long row_offset = (long)out_x * output_width * output_depth;
+		int b = 0;
+		for (; b + block <= width; b += block) {
+			const long offset = row_offset + (long)b * stride * output_depth;
+			gather_pairs_avx512<block, input_depth, output_depth, compact>(rows, row_weights, row_channels, row_depths, row_count, b, bias, output + offset, skip == nullptr ? nullptr : skip + offset);
+		}
+		for (; b < width; b++) {
+			const long offset = row_offset + (long)b * stride * output_depth;
+			gather_pairs_avx512<1, input_depth, output_depth, compact>(rows, row_weights, row_channels, row_depths, row_count, b, bias, output + offset, skip == nullptr ? nullptr : skip + offset);
+		}
+	}
+}
+
+template <int input_depth, int output_depth, bool compact>
+__attribute__((target("avx512f")))
+void subpixel_avx512(const float* input, float* output, int width, int first_row, int last_row, const float* weight_filt, const CompactKernel* kernel, const float* bias, const float* skip) {
+
+	//24 accumulators of the 32 zmm registers: 6 pixels for 64 outputs, 8 for 48, 12 for 32, 24 for 16.
+	const int block = 24 / (output_depth / 16);
+	subpixel_rows<block, input_depth, output_depth>(input, output, width, first_row, last_row, weight_filt, kernel, skip,
+		[&](const PhaseTaps& taps, float* out, const float* skip_out) {
+			gather_block_avx512<block, input_depth, output_depth, compact>(taps, bias, out, skip_out);
+		},
+		[&](const PhaseTaps& taps, float* out, const float* skip_out) {
+			gather_block_avx512<1, input_depth, output_depth, compact>(taps, bias, out, skip_out);
+		});
+}
+#endif
+
+//Dispatches a dense (kernel null) or compacted transposed convolution to the kernels of isa.
+template <int input_depth, int output_depth, bool compact>
+void dispatch_transposed(const float* input, float* output, int width, const float* weight_filt, const CompactKernel* kernel, const float* bias, const float* skip, int first_row, int last_row, Isa isa) {
+
+	static_assert(output_depth % 16 == 0, "output depth must be a multiple of 16");
+	if (!isa_supported(isa)) {
+		isa = Isa::scalar;
+	}
+	switch (isa) {
+#ifdef FLARENET_X86_SIMD
+	case Isa::avx512:
+		//With few output channels the per-phase tile is bound by input broadcasts; computing both column phases of a row
+		//together reuses each broadcast three times. With 48 or 64 channels the per-phase tile is faster.
+		if (output_depth <= 32) {
+			subpixel_pairs_avx512<input_depth, output_depth, compact>(input, output, width, first_row, last_row, weight_filt, kernel, bias, skip);
+		}
+		else {
+			subpixel_avx512<input_depth, output_depth, compact>(input, output, width, first_row, last_row, weight_filt, kernel, bias, skip);
+		}
+		break;
+	case Isa::avx2:
+		//On the dense 64->64 layer the scatter form is faster than the gather tile: 0.31 against 0.40 ms for a 32x32 output
+		//(FlareNetKernelBenchmark, FLARENET_NATIVE_ARCH off).
+		if (!compact and input_depth == 64 and output_depth == 64) {
+			scatter_avx2<input_depth, output_depth>(input, output, width, first_row, last_row, weight_filt, bias, skip);
+		}
+		else {
+			subpixel_avx2<input_depth, output_depth, compact>(input, output, width, first_row, last_row, weight_filt, kernel, bias, skip);
+		}
+		break;
+#endif
+	default:
+		subpixel_vec<input_depth, output_depth, compact>(input, output, width, first_row, last_row, weight_filt, kernel, bias, skip);
+		break;
+	}
+}
+
+//Banded calls must stay within the 2*height output rows: the kernels read input rows up to (last_row - 1) / 2 + 1.
+void check_rows(int height, int first_row, int last_row) {
+	if (first_row < 0 or first_row > last_row or last_row > height * stride) {
+		throw std::invalid_argument("subpixel_conv2d_transposed: output rows outside of 0 .. 2*height");
+	}
+}
+
+}
+
+int CompactKernel::rows() const {
+	int count = 0;
+	for (const std::vector<int>& channels : tap_channels) {
+		count += (int)channels.size();
+	}
+	return count;
+}
+
+CompactKernel compact_kernel(const float* weight_filt, int input_depth, int output_depth) {
+
+	auto zero_row = [&](int tap, int win_chn) {
+		const float* row = weight_filt + ((long)tap * input_depth + win_chn) * output_depth;
+		return std::all_of(row, row + output_depth, [](float weight) { return weight == 0.0f; });
+	};
+	CompactKernel kernel;
+	kernel.input_depth = input_depth;
+	kernel.output_depth = output_depth;
+	for (int tap = 0; tap < kernel_size * kernel_size; tap++) {
+		for (int win_chn = 0; win_chn < input_depth; win_chn++) {
+			if (!zero_row(tap, win_chn)) {
+				const float* row = weight_filt + ((long)tap * input_depth + win_chn) * output_depth;
+				kernel.tap_channels[tap].push_back(win_chn);
+				kernel.tap_weights[tap].insert(kernel.tap_weights[tap].end(), row, row + output_depth);
+			}
+		}
+	}
+	//Kernel rows keep an input channel while any of their three taps has a nonzero row for it (zero rows included).
+	for (int win_x = 0; win_x < kernel_size; win_x++) {
+		std::vector<int>& channels = kernel.row_channels[win_x];
+		for (int win_chn = 0; win_chn < input_depth; win_chn++) {
+			if (!zero_row(win_x * kernel_size, win_chn) or !zero_row(win_x * kernel_size + 1, win_chn) or !zero_row(win_x * kernel_size + 2, win_chn)) {
+				channels.push_back(win_chn);
+			}
+		}
+		for (int win_y = 0; win_y < kernel_size; win_y++) {
+			for (int win_chn : channels) {
+				const float* row = weight_filt + ((long)(win_x * kernel_size + win_y) * input_depth + win_chn) * output_depth;
+				kernel.row_weights[win_x].insert(kernel.row_weights[win_x].end(), row, row + output_depth);
+			}
+		}
+	}
+	return kernel;
+}
+
+template <int input_depth, int output_depth>
+void subpixel_conv2d_transposed(const float* input, float* output, int height, int width, const float* weight_filt, const float* bias, const float* skip, Isa isa) {
+	subpixel_conv2d_transposed<input_depth, output_depth>(input, output, height, width, weight_filt, bias, skip, 0, height * stride, isa);
+}
+
+template <int input_depth, int output_depth>
+void subpixel_conv2d_transposed(const float* input, float* output, int height, int width, const float* weight_filt, const float* bias, const float* skip, int first_row, int last_row, Isa isa) {
+	check_rows(height, first_row, last_row);
+	dispatch_transposed<input_depth, output_depth, false>(input, output, width, weight_filt, nullptr, bias, skip, first_row, last_row, isa);
+}
+
+template <int input_depth, int output_depth>
+void subpixel_conv2d_transposed(const float* input, float* output, int height, int width, const CompactKernel& kernel, const float* bias, const float* skip, int first_row, int last_row, Isa isa) {
+
+	if (kernel.input_depth != input_depth or kernel.output_depth != output_depth) {
+		throw std::invalid_argument("subpixel_conv2d_transposed: compacted kernel of another layer");
+	}
+	check_rows(height, first_row, last_row);
+	dispatch_transposed<input_depth, output_depth, true>(input, output, width, nullptr, &kernel, bias, skip, first_row, last_row, isa);
+}
+
+template void subpixel_conv2d_transposed<64, 64>(const float*, float*, int, int, const float*, const float*, const float*, Isa);
+template void subpixel_conv2d_transposed<64, 64>(const float*, float*, int, int, const float*, const float*, const float*, int, int, Isa);
+template void subpixel_conv2d_transposed<64, 64>(const float*, float*, int, int, const CompactKernel&, const float*, const float*, int, int, Isa);
+template void subpixel_conv2d_transposed<64, 48>(const float*, float*, int, int, const float*, const float*, const float*, Isa);
+template void subpixel_conv2d_transposed<64, 48>(const float*, float*, int, int, const float*, const float*, const float*, int, int, Isa);
+template void subpixel_conv2d_transposed<64, 48>(const float*, float*, int, int, const CompactKernel&, const float*, const float*, int, int, Isa);
+template void subpixel_conv2d_transposed<48, 32>(const float*, float*, int, int, const float*, const float*, const float*, Isa);
+template void subpixel_conv2d_transposed<48, 32>(const float*, float*, int, int, const float*, const float*, const float*, int, int, Isa);
+template void subpixel_conv2d_transposed<48, 32>(const float*, float*, int, int, const CompactKernel&, const float*, const float*, int, int, Isa);
+template void subpixel_conv2d_transposed<32, 16>(const float*, float*, int, int, const float*, const float*, const float*, Isa);
+template void subpixel_conv2d_transposed<32, 16>(const float*, float*, int, int, const float*, const float*, const float*, int, int, Isa);
+template void subpixel_conv2d_transposed<32, 16>(const float*, float*, int, int, const CompactKernel&, const float*, const float*, int, int, Isa);
+
+}
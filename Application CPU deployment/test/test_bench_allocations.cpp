@@ -0,0 +1,84 @@
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <string>
+#include <vector>
+#include "FlareNetEngine.h"
+
+// Counts the heap allocations of Engine::run() and Engine::run_batch(), which must make none: every activation tensor
+// and the scratch tile of every thread live in the arena allocated at construction, and the thread pool calls its loop
+// bodies without copying them. Global operator new is replaced for the whole test, and the count must stay unchanged
+// across the first frame (when per-thread buffers would be created) and the following ones, single- and multithreaded,
+// with fp32 and 16-bit skip storage and for all three data paths.
+
+static std::atomic<long> allocations(0);
+
+void* operator new(std::size_t size) {
+	allocations++;
+	void* memory = std::malloc(size == 0 ? 1 : size);
+	if (memory == nullptr) {
+		throw std::bad_alloc();
+	}
+	return memory;
+}
+
+void* operator new[](std::size_t size) {
+	return operator new(size);
+}
+
+void operator delete(void* memory) noexcept {
+	std::free(memory);
+}
+
+void operator delete[](void* memory) noexcept {
+	std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept {
+	std::free(memory);
+}
+
+void operator delete[](void* memory, std::size_t) noexcept {
+	std::free(memory);
+}
+
+int main() {
+
+	const int frames = 2;
+	const int height = 64, width = 96;
+	int ret = 0;
+	for (flarenet::ActivationStorage storage : {flarenet::ActivationStorage::fp32, flarenet::ActivationStorage::fp16}) {
+		for (int threads : {1, 4}) {
+			flarenet::Engine engine(threads, frames, height, width, storage);
+			std::vector<float> in(frames * engine.frame_values()), out(frames * engine.frame_values());
+			std::vector<uint8_t> pixels_in(frames * engine.frame_values()), pixels_out(frames * engine.frame_values());
+			for (size_t value = 0; value < in.size(); value++) {
+				pixels_in[value] = (uint8_t)(value * 7 % 256);
+				in[value] = pixels_in[value] / 255.0f;
+			}
+			const long before = allocations;
+			for (int repeat = 0; repeat < 2; repeat++) {
+				engine.run(in.data(), out.data());
+				engine.run(in.data(), pixels_out.data());
+				engine.run(pixels_in.data(), pixels_out.data());
+				engine.run_batch(in.data(), out.data(), frames);
+				engine.run_batch(pixels_in.data(), pixels_out.data(), frames);
+			}
+			const long made = allocations - before;
+			const std::string name = std::string(storage == flarenet::ActivationStorage::fp32 ? "fp32" : "fp16") + ", " + std::to_string(threads) + " threads";
+			std::cout << name << ": " << made << " heap allocations in 14 frames, arena " << engine.activations().peak_bytes() << " bytes\n";
+			if (made != 0) {
+				ret = 1;
+			}
+		}
+	}
+
+	if (ret != 0) {
+		std::cout << "Test failed  !!!\n";
+	} else {
+		std::cout << "Test passed !\n";
+	}
+	return ret;
+}
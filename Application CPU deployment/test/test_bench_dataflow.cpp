@@ -0,0 +1,131 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "DataflowEngine.h"
+#include "FlareNetEngine.h"
+
+using namespace std::chrono;
+
+// Runs the four test images through DataflowEngine, one process per thread connected by bounded streams, as single
+// frames and as one batch of four (consecutive frames overlapping in the pipeline). Both must give the Engine output bit
+// for bit, and so within the golden tolerance of test_bench_engine. Every stream must have carried its tensor once per
+// frame without exceeding its capacity; the occupancy of each stream after the batch is reported, with the time per
+// frame. Streams of a single row and a non-square 48x80 frame must work too (against Engine at that size).
+
+static const float max_abs_error = 2.0f;
+static const float mean_abs_error = 0.25f;
+
+static bool read_values(const std::string& path, std::vector<float>& values) {
+	std::ifstream in_fw(path, std::ifstream::in);
+	std::string line;
+	if (!in_fw.is_open()) {
+		return false;
+	}
+	values.clear();
+	while (std::getline(in_fw, line)) {
+		if (!line.empty()) {
+			values.push_back(std::stof(line));
+		}
+	}
+	return true;
+}
+
+int main(int argc, char** argv) {
+
+	const std::string data_directory = argc > 1 ? argv[1] : "data";
+	const int num_values = flarenet::Engine::input_size * flarenet::Engine::input_size * flarenet::Engine::input_depth;
+	flarenet::Engine engine;
+	flarenet::DataflowEngine dataflow_engine;
+	std::vector<float> input, golden, reference(num_values), output(num_values);
+	std::vector<float> batch_input, batch_reference;
+	int ret = 0;
+
+	for (int image = 1; image <= 4; image++) {
+		const std::string index = std::to_string(image);
+		if (!read_values(data_directory + "/input_" + index + ".txt", input) or !read_values(data_directory + "/golden_" + index + ".txt", golden)) {
+			std::cout << "Could not open test data in " << data_directory << '\n';
+			return 1;
+		}
+		if ((int)input.size() != num_values or (int)golden.size() != num_values) {
+			std::cout << "Unexpected test data size for image " << index << '\n';
+			return 1;
+		}
+		for (float& value : input) {
+			value /= 255.0f;
+		}
+		engine.run(input.data(), reference.data());
+		dataflow_engine.run(input.data(), output.data());
+		double max_error = 0;
+		double sum_error = 0;
+		for (int x = 0; x < num_values; x++) {
+			const double error = std::fabs(output[x] - golden[x]);
+			max_error = std::max(max_error, error);
+			sum_error += error;
+		}
+		const double mean_error = sum_error / num_values;
+		const bool identical = output == reference;
+		std::cout << "image " << index << ": max abs error " << max_error << ", mean abs error " << mean_error << (identical ? ", identical to Engine\n" : ", DIFFERS from Engine\n");
+		if (!identical or max_error > max_abs_error or mean_error > mean_abs_error) {
+			ret = 1;
+		}
+		batch_input.insert(batch_input.end(), input.begin(), input.end());
+		batch_reference.insert(batch_reference.end(), reference.begin(), reference.end());
+	}
+
+	std::vector<float> batch_output(batch_input.size());
+	dataflow_engine.reset_stream_stats();
+	auto start = high_resolution_clock::now();
+	dataflow_engine.run_batch(batch_input.data(), batch_output.data(), 4);
+	const double batch_ms = duration_cast<microseconds>(high_resolution_clock::now() - start).count() / 1000.0;
+	std::cout << "batch of 4 frames: " << batch_ms / 4 << " ms per frame" << (batch_output == batch_reference ? ", identical to Engine\n" : ", DIFFERS from Engine\n");
+	if (batch_output != batch_reference) {
+		ret = 1;
+	}
+	//Values per frame of every stream, in the order of stream_stats().
+	const long pixels = 256 * 256;
+	const long frame_stream_values[14] = {pixels * 3, pixels * 16, pixels / 4 * 16, pixels / 16 * 32, pixels / 16 * 48, pixels / 64 * 48, pixels / 256 * 64,
+		pixels / 64 * 64, pixels / 16 * 48, pixels / 16 * 48, pixels / 4 * 32, pixels * 16, pixels * 16, pixels * 3};
+	const std::vector<flarenet::StreamStats> stats = dataflow_engine.stream_stats();
+	for (size_t s = 0; s < stats.size(); s++) {
+		const flarenet::StreamStats& stream = stats[s];
+		std::cout << stream.name << ": capacity " << stream.capacity << ", max occupancy " << stream.max_occupancy << " (" << 100.0 * stream.max_occupancy / stream.capacity << "%), mean " << stream.mean_occupancy << ", waits " << stream.full_waits << " full / " << stream.empty_waits << " empty\n";
+		if (stream.values != 4 * frame_stream_values[s] or stream.max_occupancy > stream.capacity) {
+			std::cout << stream.name << ": " << stream.values << " values written\n";
+			ret = 1;
+		}
+	}
+
+	flarenet::DataflowEngine narrow_engine(256, 256, 1);
+	narrow_engine.run_batch(batch_input.data(), batch_output.data(), 2);
+	if (!std::equal(batch_output.begin(), batch_output.begin() + 2 * num_values, batch_reference.begin())) {
+		std::cout << "streams of one row: output differs from Engine\n";
+		ret = 1;
+	}
+
+	const int crop_height = 48, crop_width = 80;
+	std::vector<float> crop;
+	for (int x = 0; x < crop_height; x++) {
+		crop.insert(crop.end(), batch_input.begin() + (x + 64) * 256 * 3 + 32 * 3, batch_input.begin() + (x + 64) * 256 * 3 + (32 + crop_width) * 3);
+	}
+	flarenet::Engine crop_engine(1, 1, crop_height, crop_width);
+	flarenet::DataflowEngine crop_dataflow_engine(crop_height, crop_width);
+	std::vector<float> crop_reference(crop.size()), crop_output(crop.size());
+	crop_engine.run(crop.data(), crop_reference.data());
+	crop_dataflow_engine.run(crop.data(), crop_output.data());
+	if (crop_output != crop_reference) {
+		std::cout << crop_height << "x" << crop_width << " frame: output differs from Engine\n";
+		ret = 1;
+	}
+
+	if (ret != 0) {
+		std::cout << "Test failed  !!!\n";
+	}
+	else {
+		std::cout << "Test passed !\n";
+	}
+	return ret;
+}
@@ -0,0 +1,326 @@
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "FlareNetEngine.h"
+#include "Layers.h"
+#include "ModelWeights.h"
+
+// Runs the native float engine on data/input_*.txt and compares against the ap_fixed<18,8> golden outputs, then checks
+// every other engine feature against those single-threaded float outputs, one check_*() function per feature.
+// The float engine matches a double-precision C-simulation of FlareNet.cpp to ~1e-5, but the golden logits come
+// from the fixed-point design, which truncates after every multiply-accumulate and drifts towards negative values.
+// On the four test images that drift is at most 1.55 (mean 0.12 - 0.20) in logit units, hence the tolerance below.
+
+static const float max_abs_error = 2.0f;
+static const float mean_abs_error = 0.25f;
+static const float max_algorithm_error = 1e-4f;
+static const float max_storage_error[2] = {0.02f, 0.2f};
+
+//FlareNet() at any frame size with the reference layer templates, one full tensor per stream.
+static std::vector<float> reference_output(const std::vector<float>& input, int height, int width) {
+
+	const flarenet::ModelWeights& model = flarenet::model_weights();
+	auto f = [](const std::vector<double>& values) { return std::vector<float>(values.begin(), values.end()); };
+	const long pixels = (long)height * width;
+	std::vector<float> stream_0(pixels * 16), stream_1(pixels / 4 * 16), stream_2(pixels / 4 * 32), stream_3(pixels / 16 * 32);
+	std::vector<float> stream_4(pixels / 16 * 48), stream_5(pixels / 64 * 48), stream_6(pixels / 64 * 64), stream_7(pixels / 256 * 64);
+	std::vector<float> stream_8(pixels / 64 * 64), stream_9(pixels / 16 * 48), stream_10(pixels / 16 * 48), stream_11(pixels / 4 * 32);
+	std::vector<float> stream_12(pixels * 16), stream_13(pixels * 16), output(pixels * 3);
+	flarenet::Conv2D_relu<3, 3, 16>(input.data(), stream_0.data(), height, width, f(model.weights_0).data(), f(model.bias_0).data());
+	flarenet::MaxPooling2D<2, 16>(stream_0.data(), stream_1.data(), height, width);
+	flarenet::SeparableDW2D_relu<3, 16, 32>(stream_1.data(), stream_2.data(), height / 2, width / 2, f(model.depth_weights_1).data(), f(model.point_weights_1).data(), f(model.bias_1).data());
+	flarenet::MaxPooling2D<2, 32>(stream_2.data(), stream_3.data(), height / 2, width / 2);
+	flarenet::SeparableDW2D_relu<3, 32, 48>(stream_3.data(), stream_4.data(), height / 4, width / 4, f(model.depth_weights_2).data(), f(model.point_weights_2).data(), f(model.bias_2).data());
+	flarenet::MaxPooling2D<2, 48>(stream_4.data(), stream_5.data(), height / 4, width / 4);
+	flarenet::SeparableDW2D_relu<3, 48, 64>(stream_5.data(), stream_6.data(), height / 8, width / 8, f(model.depth_weights_3).data(), f(model.point_weights_3).data(), f(model.bias_3).data());
+	flarenet::MaxPooling2D<2, 64>(stream_6.data(), stream_7.data(), height / 8, width / 8);
+	flarenet::Conv2D_transposed<3, 2, 64, 64>(stream_7.data(), stream_8.data(), height / 16, width / 16, f(model.weights_4).data(), f(model.bias_4).data());
+	flarenet::Conv2D_transposed<3, 2, 64, 48>(stream_8.data(), stream_9.data(), height / 8, width / 8, f(model.weights_5).data(), f(model.bias_5).data());
+	flarenet::Add<48>(stream_9.data(), stream_4.data(), stream_10.data(), height / 4, width / 4);
+	flarenet::Conv2D_transposed<3, 2, 48, 32>(stream_10.data(), stream_11.data(), height / 4, width / 4, f(model.weights_6).data(), f(model.bias_6).data());
+	flarenet::Conv2D_transposed<3, 2, 32, 16>(stream_11.data(), stream_12.data(), height / 2, width / 2, f(model.weights_7).data(), f(model.bias_7).data());
+	flarenet::Add<16>(stream_12.data(), stream_0.data(), stream_13.data(), height, width);
+	flarenet::Conv2D_sigmoid<16, 3>(stream_13.data(), output.data(), height, width, f(model.weights_8).data(), f(model.bias_8).data());
+	return output;
+}
+
+static bool read_values(const std::string& path, std::vector<float>& values) {
+	std::ifstream in_fw(path, std::ifstream::in);
+	std::string line;
+	if (!in_fw.is_open()) {
+		return false;
+	}
+	values.clear();
+	while (std::getline(in_fw, line)) {
+		if (!line.empty()) {
+			values.push_back(std::stof(line));
+		}
+	}
+	return true;
+}
+
+//A test image: its 8-bit pixels, the same pixels normalized between 0 and 1 (as the HLS test bench does), and its golden
+//logits.
+struct TestImage {
+	std::vector<uint8_t> pixels;
+	std::vector<float> input;
+	std::vector<float> golden;
+};
+
+static const int num_values = flarenet::Engine::input_size * flarenet::Engine::input_size * flarenet::Engine::input_depth;
+
+static bool read_image(const std::string& data_directory, int image, TestImage& test_image) {
+	const std::string index = std::to_string(image);
+	if (!read_values(data_directory + "/input_" + index + ".txt", test_image.input) or !read_values(data_directory + "/golden_" + index + ".txt", test_image.golden)) {
+		std::cout << "Could not open test data in " << data_directory << '\n';
+		return false;
+	}
+	if ((int)test_image.input.size() != num_values or (int)test_image.golden.size() != num_values) {
+		std::cout << "Unexpected test data size for image " << index << '\n';
+		return false;
+	}
+	test_image.pixels.resize(num_values);
+	for (int x = 0; x < num_values; x++) {
+		test_image.pixels[x] = (uint8_t)test_image.input[x];
+		test_image.input[x] = test_image.input[x] / 255.0f;
+	}
+	return true;
+}
+
+static double max_abs_difference(const std::vector<float>& result, const std::vector<float>& reference) {
+	double max_error = 0;
+	for (size_t x = 0; x < reference.size(); x++) {
+		max_error = std::max(max_error, (double)std::fabs(result[x] - reference[x]));
+	}
+	return max_error;
+}
+
+//PSNR of the sigmoid of logits against the sigmoid of the golden logits, in 8-bit pixel units.
+static double sigmoid_psnr(const std::vector<float>& logits, const std::vector<float>& golden) {
+	double squared_error = 0;
+	for (int x = 0; x < num_values; x++) {
+		const double error = 255 / (1 + std::exp(-(double)logits[x])) - 255 / (1 + std::exp(-(double)golden[x]));
+		squared_error += error * error;
+	}
+	return 10 * std::log10(255.0 * 255.0 * num_values / squared_error);
+}
+
+//The activation arena must reach its lower bound (the largest set of tensors live at the same time) whatever the thread
+//count, batch size or skip storage.
+static int check_activation_memory() {
+	int ret = 0;
+	std::vector<std::unique_ptr<flarenet::Engine>> engines;
+	engines.emplace_back(new flarenet::Engine());
+	engines.emplace_back(new flarenet::Engine(24));
+	engines.emplace_back(new flarenet::Engine(2, 3));
+	for (flarenet::ActivationStorage storage : {flarenet::ActivationStorage::fp16, flarenet::ActivationStorage::bf16}) {
+		engines.emplace_back(new flarenet::Engine(1, 1, flarenet::Engine::input_size, flarenet::Engine::input_size, storage));
+	}
+	for (const std::unique_ptr<flarenet::Engine>& checked : engines) {
+		const flarenet::ActivationArena& activations = checked->activations();
+		std::cout << checked->threads() << " thread(s), " << checked->batch_frames() << " frame(s), " << flarenet::storage_name(checked->activation_storage()) << ": activation memory " << activations.peak_bytes() << " bytes (lower bound " << activations.lower_bound_bytes() << ", without reuse " << activations.total_bytes() << ")\n";
+		if (activations.peak_bytes() != activations.lower_bound_bytes()) {
+			ret = 1;
+		}
+	}
+	return ret;
+}
+
+//The float logits must be within max_abs_error and mean_abs_error of the golden logits.
+static int check_golden(const TestImage& image, const std::vector<float>& logits, const std::string& index) {
+	double max_error = 0;
+	double sum_error = 0;
+	for (int x = 0; x < num_values; x++) {
+		const double error = std::fabs(logits[x] - image.golden[x]);
+		max_error = std::max(max_error, error);
+		sum_error += error;
+	}
+	const double mean_error = sum_error / num_values;
+	std::cout << "image " << index << ": max abs error " << max_error << ", mean abs error " << mean_error << '\n';
+	return max_error > max_abs_error or mean_error > mean_abs_error ? 1 : 0;
+}
+
+//Row-band parallelism, with more threads than bands for the smallest layers, must give the single-threaded output bit
+//for bit.
+static int check_threads(flarenet::Engine& threaded_engine, const TestImage& image, const std::vector<float>& logits, const std::string& index) {
+	std::vector<float> threaded_output(num_values);
+	threaded_engine.run(image.input.data(), threaded_output.data());
+	if (threaded_output != logits) {
+		std::cout << "image " << index << ": multithreaded output differs from the single-threaded output\n";
+		return 1;
+	}
+	return 0;
+}
+
+//The Winograd and direct input convolutions differ by rounding only, so the engine on the algorithm that is not the
+//default on this host must agree to max_algorithm_error logits.
+static int check_input_conv_algorithm(flarenet::Engine& alternate_engine, const TestImage& image, const std::vector<float>& logits, const std::string& index) {
+	std::vector<float> alternate_output(num_values);
+	alternate_engine.run(image.input.data(), alternate_output.data());
+	const double algorithm_error = max_abs_difference(alternate_output, logits);
+	std::cout << "image " << index << ": direct and Winograd input convolution differ by at most " << algorithm_error << '\n';
+	return algorithm_error > max_algorithm_error ? 1 : 0;
+}
+
+//The 8-bit pixel output must be within 1 LSB of the rounded sigmoid of the float logits; its PSNR against the sigmoid of
+//the golden logits is reported next to the PSNR of the float sigmoid.
+static int check_pixel_output(const std::vector<uint8_t>& pixels, const TestImage& image, const std::vector<float>& logits, const std::string& index) {
+	int pixel_error = 0;
+	double squared_error = 0;
+	for (int x = 0; x < num_values; x++) {
+		pixel_error = std::max(pixel_error, std::abs(pixels[x] - (int)std::lround(255 / (1 + std::exp(-(double)logits[x])))));
+		const double golden_pixel = 255 / (1 + std::exp(-(double)image.golden[x]));
+		squared_error += (pixels[x] - golden_pixel) * (pixels[x] - golden_pixel);
+	}
+	const double psnr = 10 * std::log10(255.0 * 255.0 * num_values / squared_error);
+	std::cout << "image " << index << ": 8-bit pixels within " << pixel_error << " LSB of the float sigmoid, PSNR " << psnr << " dB against the golden\n";
+	std::cout << "image " << index << ": fp32 sigmoid PSNR " << sigmoid_psnr(logits, image.golden) << " dB against the golden\n";
+	return pixel_error > 1 ? 1 : 0;
+}
+
+//The 8-bit data path (8-bit input, normalization folded into the weights) must give the pixels of the float input
+//within 1 LSB.
+static int check_pixel_input(const std::vector<uint8_t>& path_pixels, const std::vector<uint8_t>& pixels, const std::string& index) {
+	int path_error = 0;
+	for (int x = 0; x < num_values; x++) {
+		path_error = std::max(path_error, std::abs(path_pixels[x] - pixels[x]));
+	}
+	std::cout << "image " << index << ": 8-bit input within " << path_error << " LSB of the float input\n";
+	return path_error > 1 ? 1 : 0;
+}
+
+//With the skip connections stored in fp16 or bf16 the logits must stay within max_storage_error of the fp32 engine, and
+//multithreaded bands must give the same output bit for bit. The PSNR of their pixels against the golden is reported.
+static int check_skip_storage(int s, flarenet::Engine& storage_engine, flarenet::Engine& threaded_storage_engine, const TestImage& image, const std::vector<float>& logits, const std::string& index) {
+	std::vector<float> storage_output(num_values), threaded_storage_output(num_values);
+	storage_engine.run(image.input.data(), storage_output.data());
+	threaded_storage_engine.run(image.input.data(), threaded_storage_output.data());
+	const double storage_error = max_abs_difference(storage_output, logits);
+	std::cout << "image " << index << ", " << flarenet::storage_name(storage_engine.activation_storage()) << " skip connections: max abs error " << storage_error << " against fp32, PSNR " << sigmoid_psnr(storage_output, image.golden) << " dB against the golden\n";
+	return storage_error > max_storage_error[s] or threaded_storage_output != storage_output ? 1 : 0;
+}
+
+//run_batch() in batches of 3 (a full batch and a partial one) must reproduce the single-frame outputs bit for bit, for
+//float and 8-bit frames.
+static int check_batch(const std::vector<TestImage>& images, const std::vector<std::vector<float>>& logits, const std::vector<std::vector<uint8_t>>& path_pixels) {
+	flarenet::Engine batch_engine(2, 3);
+	std::vector<float> batch_input, batch_reference;
+	std::vector<uint8_t> batch_pixel_input, batch_pixel_reference;
+	for (size_t image = 0; image < images.size(); image++) {
+		batch_input.insert(batch_input.end(), images[image].input.begin(), images[image].input.end());
+		batch_reference.insert(batch_reference.end(), logits[image].begin(), logits[image].end());
+		batch_pixel_input.insert(batch_pixel_input.end(), images[image].pixels.begin(), images[image].pixels.end());
+		batch_pixel_reference.insert(batch_pixel_reference.end(), path_pixels[image].begin(), path_pixels[image].end());
+	}
+	int ret = 0;
+	std::vector<float> batch_output(batch_reference.size());
+	batch_engine.run_batch(batch_input.data(), batch_output.data(), (int)images.size());
+	if (batch_output != batch_reference) {
+		std::cout << "run_batch output differs from the single-frame outputs\n";
+		ret = 1;
+	}
+	std::vector<uint8_t> batch_pixel_output(batch_pixel_reference.size());
+	batch_engine.run_batch(batch_pixel_input.data(), batch_pixel_output.data(), (int)images.size());
+	if (batch_pixel_output != batch_pixel_reference) {
+		std::cout << "8-bit run_batch output differs from the single-frame outputs\n";
+		ret = 1;
+	}
+	return ret;
+}
+
+//Other frame sizes have no golden outputs: a non-square 48x80 crop of an image is compared against the unfused reference
+//layers of Layers.h, single- and multithreaded.
+static int check_crop(const TestImage& image) {
+	const int crop_height = 48, crop_width = 80;
+	std::vector<float> crop;
+	for (int x = 0; x < crop_height; x++) {
+		crop.insert(crop.end(), image.input.begin() + (x + 64) * 256 * 3 + 32 * 3, image.input.begin() + (x + 64) * 256 * 3 + (32 + crop_width) * 3);
+	}
+	const std::vector<float> crop_reference = reference_output(crop, crop_height, crop_width);
+	std::vector<float> crop_output(crop_reference.size()), threaded_crop_output(crop_reference.size());
+	flarenet::Engine crop_engine(1, 1, crop_height, crop_width);
+	flarenet::Engine threaded_crop_engine(5, 1, crop_height, crop_width);
+	crop_engine.run(crop.data(), crop_output.data());
+	threaded_crop_engine.run(crop.data(), threaded_crop_output.data());
+	double crop_error = 0;
+	for (size_t x = 0; x < crop_reference.size(); x++) {
+		crop_error = std::max(crop_error, (double)std::fabs(crop_output[x] - crop_reference[x]) / (1.0 + std::fabs(crop_reference[x])));
+	}
+	std::cout << crop_height << "x" << crop_width << " frame: max relative error " << crop_error << " against the reference layers\n";
+	if (crop_error > 1e-4 or threaded_crop_output != crop_output) {
+		std::cout << crop_height << "x" << crop_width << " frame: output differs from the reference or between thread counts\n";
+		return 1;
+	}
+	return 0;
+}
+
+//A frame size that is not a multiple of Engine::size_multiple must be rejected.
+static int check_invalid_size() {
+	try {
+		flarenet::Engine invalid_engine(1, 1, 1080, 1920);
+		std::cout << "1080x1920 frame was not rejected\n";
+		return 1;
+	}
+	catch (const std::invalid_argument&) {
+	}
+	return 0;
+}
+
+int main(int argc, char** argv) {
+
+	const std::string data_directory = argc > 1 ? argv[1] : "data";
+	std::vector<TestImage> images(4);
+	for (int image = 0; image < 4; image++) {
+		if (!read_image(data_directory, image + 1, images[image])) {
+			return 1;
+		}
+	}
+
+	flarenet::Engine engine;
+	flarenet::Engine threaded_engine(24);
+	//The input convolution with the algorithm that is not the default on this host (direct or Winograd).
+	flarenet::Engine alternate_engine;
+	const bool winograd_default = engine.input_conv_algorithm() == flarenet::Engine::ConvAlgorithm::winograd;
+	alternate_engine.set_input_conv_algorithm(winograd_default ? flarenet::Engine::ConvAlgorithm::direct : flarenet::Engine::ConvAlgorithm::winograd);
+	//16-bit skip connections, single-threaded and in bands.
+	std::vector<std::unique_ptr<flarenet::Engine>> storage_engines, threaded_storage_engines;
+	for (flarenet::ActivationStorage storage : {flarenet::ActivationStorage::fp16, flarenet::ActivationStorage::bf16}) {
+		storage_engines.emplace_back(new flarenet::Engine(1, 1, flarenet::Engine::input_size, flarenet::Engine::input_size, storage));
+		threaded_storage_engines.emplace_back(new flarenet::Engine(5, 1, flarenet::Engine::input_size, flarenet::Engine::input_size, storage));
+	}
+	int ret = check_activation_memory();
+
+	//Single-threaded float logits and 8-bit outputs of every image, the references of the other checks.
+	std::vector<std::vector<float>> logits(images.size(), std::vector<float>(num_values));
+	std::vector<std::vector<uint8_t>> pixels(images.size(), std::vector<uint8_t>(num_values)), path_pixels(images.size(), std::vector<uint8_t>(num_values));
+	for (size_t image = 0; image < images.size(); image++) {
+		const std::string index = std::to_string(image + 1);
+		engine.run(images[image].input.data(), logits[image].data());
+		engine.run(images[image].input.data(), pixels[image].data());
+		engine.run(images[image].pixels.data(), path_pixels[image].data());
+		ret |= check_golden(images[image], logits[image], index);
+		ret |= check_threads(threaded_engine, images[image], logits[image], index);
+		ret |= check_input_conv_algorithm(alternate_engine, images[image], logits[image], index);
+		ret |= check_pixel_output(pixels[image], images[image], logits[image], index);
+		ret |= check_pixel_input(path_pixels[image], pixels[image], index);
+		for (int s = 0; s < 2; s++) {
+			ret |= check_skip_storage(s, *storage_engines[s], *threaded_storage_engines[s], images[image], logits[image], index);
+		}
+	}
+	ret |= check_batch(images, logits, path_pixels);
+	ret |= check_crop(images[0]);
+	ret |= check_invalid_size();
+
+	if (ret != 0) {
+		std::cout << "Test failed  !!!\n";
+	}
+	else {
+		std::cout << "Test passed !\n";
+	}
+	return ret;
+}
@@ -0,0 +1,86 @@
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "FixedEngine.h"
+
+using namespace std::chrono;
+
+// Runs the fixed-point engine on data/input_*.txt and requires bit-identical outputs to the ap_fixed<18,8>
+// C-simulation in data/golden_*.txt. The files print every value with 6 significant digits, which identifies the
+// underlying multiple of 2^-10 exactly for the range of FlareNet outputs. The 8-bit pixel output must equal the sigmoid
+// table lookup of the golden logits, as FlareNet() built with FLARENET_PIXEL_OUTPUT computes it.
+
+static bool read_values(const std::string& path, std::vector<double>& values) {
+	std::ifstream in_fw(path, std::ifstream::in);
+	std::string line;
+	if (!in_fw.is_open()) {
+		return false;
+	}
+	values.clear();
+	while (std::getline(in_fw, line)) {
+		if (!line.empty()) {
+			values.push_back(std::stod(line));
+		}
+	}
+	return true;
+}
+
+int main(int argc, char** argv) {
+
+	const std::string data_directory = argc > 1 ? argv[1] : "data";
+	const int num_values = flarenet::FixedEngine::input_size * flarenet::FixedEngine::input_size * flarenet::FixedEngine::input_depth;
+	flarenet::FixedEngine engine;
+	std::vector<double> input_values, golden;
+	std::vector<int32_t> input(num_values), output(num_values);
+	std::vector<uint8_t> pixels(num_values);
+	int ret = 0;
+
+	for (int image = 1; image <= 4; image++) {
+		const std::string index = std::to_string(image);
+		if (!read_values(data_directory + "/input_" + index + ".txt", input_values) or !read_values(data_directory + "/golden_" + index + ".txt", golden)) {
+			std::cout << "Could not open test data in " << data_directory << '\n';
+			return 1;
+		}
+		if ((int)input_values.size() != num_values or (int)golden.size() != num_values) {
+			std::cout << "Unexpected test data size for image " << index << '\n';
+			return 1;
+		}
+		//Normalize RGB values as the HLS test bench does (norm_value = int_value/255.0).
+		for (int x = 0; x < num_values; x++) {
+			input[x] = flarenet::FixedEngine::quantize(input_values[x] / 255.0);
+		}
+
+		auto start_inference = high_resolution_clock::now();
+		engine.run(input.data(), output.data());
+		auto duration_inference = duration_cast<microseconds>(high_resolution_clock::now() - start_inference);
+
+		int mismatches = 0;
+		for (int x = 0; x < num_values; x++) {
+			if (output[x] != (int32_t)std::lround(golden[x] * 1024)) {
+				mismatches++;
+			}
+		}
+		engine.run(input.data(), pixels.data());
+		int pixel_mismatches = 0;
+		for (int x = 0; x < num_values; x++) {
+			if (pixels[x] != flarenet::FixedEngine::sigmoid_pixel((int32_t)std::lround(golden[x] * 1024))) {
+				pixel_mismatches++;
+			}
+		}
+		std::cout << "image " << index << ": " << mismatches << " mismatching values, " << pixel_mismatches << " mismatching pixels, duration_inference: " << duration_inference.count() << " us\n";
+		if (mismatches != 0 or pixel_mismatches != 0) {
+			ret = 1;
+		}
+	}
+
+	if (ret != 0) {
+		std::cout << "Test failed  !!!\n";
+	}
+	else {
+		std::cout << "Test passed !\n";
+	}
+	return ret;
+}
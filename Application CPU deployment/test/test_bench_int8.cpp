@@ -0,0 +1,122 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+#include "FlareNetEngine.h"
+#include "Int8Engine.h"
+
+// Accuracy report of the int8 engine on data/input_*.txt: logit errors against the ap_fixed<18,8> golden outputs and
+// against the float engine, and the PSNR of the sigmoid output image against the float engine (8-bit pixel units).
+// Activation scales are calibrated on image 1 only, so images 2-4 show the error on frames the scales have not seen.
+// The engine is then saved to a weight cache file and reloaded: the loaded engine must give the same outputs bit for
+// bit, and a truncated cache must be rejected.
+
+static const float max_mean_abs_error = 0.5f;
+static const float min_psnr = 25.0f;
+
+static bool read_values(const std::string& path, std::vector<float>& values) {
+	std::ifstream in_fw(path, std::ifstream::in);
+	std::string line;
+	if (!in_fw.is_open()) {
+		return false;
+	}
+	values.clear();
+	while (std::getline(in_fw, line)) {
+		if (!line.empty()) {
+			values.push_back(std::stof(line));
+		}
+	}
+	return true;
+}
+
+static double sigmoid(double value) {
+	return 1.0 / (1.0 + std::exp(-value));
+}
+
+int main(int argc, char** argv) {
+
+	const std::string data_directory = argc > 1 ? argv[1] : "data";
+	const int num_values = flarenet::Int8Engine::input_size * flarenet::Int8Engine::input_size * flarenet::Int8Engine::input_depth;
+	std::vector<std::vector<float>> inputs(4), goldens(4);
+	for (int image = 0; image < 4; image++) {
+		const std::string index = std::to_string(image + 1);
+		if (!read_values(data_directory + "/input_" + index + ".txt", inputs[image]) or !read_values(data_directory + "/golden_" + index + ".txt", goldens[image])) {
+			std::cout << "Could not open test data in " << data_directory << '\n';
+			return 1;
+		}
+		if ((int)inputs[image].size() != num_values or (int)goldens[image].size() != num_values) {
+			std::cout << "Unexpected test data size for image " << index << '\n';
+			return 1;
+		}
+		//Normalize RGB values between 0 and 1, as the HLS test bench does.
+		for (float& value : inputs[image]) {
+			value = value / 255.0f;
+		}
+	}
+
+	flarenet::Engine engine;
+	flarenet::Int8Engine int8_engine({inputs[0].data()});
+	std::vector<float> output(num_values), reference(num_values);
+	int ret = 0;
+
+	for (int image = 0; image < 4; image++) {
+		engine.run(inputs[image].data(), reference.data());
+		int8_engine.run(inputs[image].data(), output.data());
+
+		double max_golden_error = 0, sum_golden_error = 0, max_float_error = 0, sum_float_error = 0, sum_squared_pixel_error = 0;
+		for (int x = 0; x < num_values; x++) {
+			const double golden_error = std::fabs(output[x] - goldens[image][x]);
+			const double float_error = std::fabs(output[x] - reference[x]);
+			const double pixel_error = 255.0 * (sigmoid(output[x]) - sigmoid(reference[x]));
+			max_golden_error = std::max(max_golden_error, golden_error);
+			sum_golden_error += golden_error;
+			max_float_error = std::max(max_float_error, float_error);
+			sum_float_error += float_error;
+			sum_squared_pixel_error += pixel_error * pixel_error;
+		}
+		const double mean_golden_error = sum_golden_error / num_values;
+		const double psnr = 10.0 * std::log10(255.0 * 255.0 / std::max(sum_squared_pixel_error / num_values, 1e-12));
+		std::cout << "image " << image + 1 << ": golden max abs error " << max_golden_error << ", mean abs error " << mean_golden_error
+		          << " | float engine max abs error " << max_float_error << ", mean abs error " << sum_float_error / num_values
+		          << " | sigmoid PSNR " << psnr << " dB\n";
+		if (mean_golden_error > max_mean_abs_error or psnr < min_psnr) {
+			ret = 1;
+		}
+	}
+
+	const std::string cache_path = "int8_weights.cache";
+	int8_engine.save(cache_path);
+	flarenet::Int8Engine cached_engine(cache_path);
+	std::vector<float> cached_output(num_values);
+	for (int image = 0; image < 4; image++) {
+		int8_engine.run(inputs[image].data(), output.data());
+		cached_engine.run(inputs[image].data(), cached_output.data());
+		if (cached_output != output) {
+			std::cout << "image " << image + 1 << ": engine loaded from the weight cache differs\n";
+			ret = 1;
+		}
+	}
+	std::ifstream cache_file(cache_path, std::ifstream::binary);
+	const std::string cache((std::istreambuf_iterator<char>(cache_file)), std::istreambuf_iterator<char>());
+	std::ofstream(cache_path, std::ofstream::binary).write(cache.data(), cache.size() / 2);
+	try {
+		flarenet::Int8Engine truncated_engine(cache_path);
+		std::cout << "truncated weight cache was not rejected\n";
+		ret = 1;
+	}
+	catch (const std::runtime_error&) {
+	}
+	std::remove(cache_path.c_str());
+
+	if (ret != 0) {
+		std::cout << "Test failed  !!!\n";
+	}
+	else {
+		std::cout << "Test passed !\n";
+	}
+	return ret;
+}
@@ -0,0 +1,123 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "FlareNetEngine.h"
+#include "ModelWeights.h"
+#include "Pruning.h"
+
+using namespace std::chrono;
+
+// Speed/accuracy sweep of structured pruning (Pruning.h) on the four test images. For every threshold the weights are
+// pruned, an Engine is built from them (compacting the transposed convolutions) and the four images are run: the sweep
+// reports the rows and output channels pruned per layer, the time per frame (best of timing_runs runs over the four
+// images), the logit error against the golden outputs and against the unpruned engine, and the PSNR of the sigmoid
+// output against the sigmoid of the golden logits. Threshold 0 must prune nothing and give the unpruned output bit for
+// bit. Pruned engines must stay within the golden tolerance of test_bench_engine up to max_accurate_threshold; past it
+// the error is only reported.
+
+static const float max_abs_error = 2.0f;
+static const float mean_abs_error = 0.25f;
+static const double max_accurate_threshold = 0.1;
+static const int timing_runs = 5;
+
+static bool read_values(const std::string& path, std::vector<float>& values) {
+	std::ifstream in_fw(path, std::ifstream::in);
+	std::string line;
+	if (!in_fw.is_open()) {
+		return false;
+	}
+	values.clear();
+	while (std::getline(in_fw, line)) {
+		if (!line.empty()) {
+			values.push_back(std::stof(line));
+		}
+	}
+	return true;
+}
+
+static double sigmoid_pixel(double logit) {
+	return 255 / (1 + std::exp(-logit));
+}
+
+int main(int argc, char** argv) {
+
+	const std::string data_directory = argc > 1 ? argv[1] : "data";
+	const int num_values = flarenet::Engine::input_size * flarenet::Engine::input_size * flarenet::Engine::input_depth;
+	std::vector<std::vector<float>> inputs(4), goldens(4), references(4);
+	flarenet::Engine engine;
+	for (int image = 0; image < 4; image++) {
+		const std::string index = std::to_string(image + 1);
+		if (!read_values(data_directory + "/input_" + index + ".txt", inputs[image]) or !read_values(data_directory + "/golden_" + index + ".txt", goldens[image])) {
+			std::cout << "Could not open test data in " << data_directory << '\n';
+			return 1;
+		}
+		if ((int)inputs[image].size() != num_values or (int)goldens[image].size() != num_values) {
+			std::cout << "Unexpected test data size for image " << index << '\n';
+			return 1;
+		}
+		for (float& value : inputs[image]) {
+			value /= 255.0f;
+		}
+		references[image].resize(num_values);
+		engine.run(inputs[image].data(), references[image].data());
+	}
+
+	std::vector<float> output(num_values);
+	int ret = 0;
+	for (double threshold : {0.0, 0.01, 0.02, 0.05, 0.1, 0.2, 0.3, 0.5}) {
+		flarenet::PruningReport report;
+		flarenet::Engine pruned_engine(flarenet::prune_weights(flarenet::model_weights(), threshold, &report));
+		std::cout << "threshold " << threshold << ": " << report.zero_weights() << " of " << report.weights() << " weights zero, " << pruned_engine.skipped_weight_rows() << " transposed convolution rows skipped\n";
+		for (const flarenet::LayerPruning& layer : report.layers) {
+			if (layer.pruned_rows != 0 or layer.pruned_output_channels != 0) {
+				std::cout << "  " << layer.name << ": " << layer.pruned_rows << " of " << layer.rows << " rows, " << layer.pruned_output_channels << " of " << layer.output_channels << " output channels\n";
+			}
+		}
+
+		double best_ms = 1e9;
+		for (int run = 0; run < timing_runs; run++) {
+			auto start = high_resolution_clock::now();
+			for (int image = 0; image < 4; image++) {
+				pruned_engine.run(inputs[image].data(), output.data());
+			}
+			best_ms = std::min(best_ms, duration_cast<microseconds>(high_resolution_clock::now() - start).count() / 4000.0);
+		}
+
+		double max_error = 0, sum_error = 0, max_change = 0, squared_error = 0;
+		bool identical = true;
+		for (int image = 0; image < 4; image++) {
+			pruned_engine.run(inputs[image].data(), output.data());
+			identical = identical and output == references[image];
+			for (int x = 0; x < num_values; x++) {
+				const double error = std::fabs(output[x] - goldens[image][x]);
+				max_error = std::max(max_error, error);
+				sum_error += error;
+				max_change = std::max(max_change, (double)std::fabs(output[x] - references[image][x]));
+				const double pixel_error = sigmoid_pixel(output[x]) - sigmoid_pixel(goldens[image][x]);
+				squared_error += pixel_error * pixel_error;
+			}
+		}
+		const double mean_error = sum_error / (4.0 * num_values);
+		const double psnr = 10 * std::log10(255.0 * 255.0 * 4 * num_values / squared_error);
+		std::cout << "  " << best_ms << " ms per frame, max abs error " << max_error << ", mean abs error " << mean_error << ", max change " << max_change << ", PSNR " << psnr << " dB against the golden\n";
+		if (threshold == 0 and (report.zero_weights() != 0 or pruned_engine.skipped_weight_rows() != 0 or !identical)) {
+			std::cout << "threshold 0 changed the weights or the output\n";
+			ret = 1;
+		}
+		if (threshold <= max_accurate_threshold and (max_error > max_abs_error or mean_error > mean_abs_error)) {
+			ret = 1;
+		}
+	}
+
+	if (ret != 0) {
+		std::cout << "Test failed  !!!\n";
+	}
+	else {
+		std::cout << "Test passed !\n";
+	}
+	return ret;
+}
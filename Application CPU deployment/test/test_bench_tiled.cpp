@@ -0,0 +1,119 @@
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "FlareNetEngine.h"
+#include "TiledEngine.h"
+
+// Runs a 512x768 mosaic of the four test images (two rows of three, the fourth image repeating the first ones) through
+// TiledEngine with 256x256 tiles and compares it against the whole frame on Engine. With no overlap the cuts are visible
+// (tiles see zero padding where the frame continues). The default overlap exceeds the receptive field, so it must give the
+// whole-frame output up to rounding, and bit for bit the same output with more threads. A 200x520 frame, shorter than a
+// tile and not a multiple of 16, checks the padding and the last tile moved back to the border. Tile sizes that are not
+// positive multiples of 16 or not larger than the overlap must be rejected.
+
+static const float max_abs_error = 1e-4f;
+
+static bool read_values(const std::string& path, std::vector<float>& values) {
+	std::ifstream in_fw(path, std::ifstream::in);
+	std::string line;
+	if (!in_fw.is_open()) {
+		return false;
+	}
+	values.clear();
+	while (std::getline(in_fw, line)) {
+		if (!line.empty()) {
+			values.push_back(std::stof(line));
+		}
+	}
+	return true;
+}
+
+int main(int argc, char** argv) {
+
+	const std::string data_directory = argc > 1 ? argv[1] : "data";
+	const int size = flarenet::Engine::input_size;
+	const int depth = flarenet::Engine::input_depth;
+	const int height = 2 * size, width = 3 * size;
+	std::vector<float> mosaic((long)height * width * depth), image;
+	for (int tile = 0; tile < 6; tile++) {
+		const std::string index = std::to_string(tile % 4 + 1);
+		if (!read_values(data_directory + "/input_" + index + ".txt", image) or (int)image.size() != size * size * depth) {
+			std::cout << "Could not open test data in " << data_directory << '\n';
+			return 1;
+		}
+		for (int x = 0; x < size; x++) {
+			for (int value = 0; value < size * depth; value++) {
+				mosaic[((long)(tile / 3 * size + x) * width + tile % 3 * size) * depth + value] = image[x * size * depth + value] / 255.0f;
+			}
+		}
+	}
+
+	flarenet::Engine engine(1, 1, height, width);
+	std::vector<float> reference(mosaic.size()), output(mosaic.size()), threaded_output(mosaic.size());
+	engine.run(mosaic.data(), reference.data());
+	int ret = 0;
+
+	for (int overlap : {0, 16, 32, 48, 64, 128}) {
+		flarenet::TiledEngine tiled_engine(height, width, 1, size, overlap);
+		tiled_engine.run(mosaic.data(), output.data());
+		double max_error = 0;
+		double sum_error = 0;
+		for (size_t x = 0; x < reference.size(); x++) {
+			const double error = std::fabs(output[x] - reference[x]);
+			max_error = std::max(max_error, error);
+			sum_error += error;
+		}
+		const double mean_error = sum_error / reference.size();
+		std::cout << "overlap " << overlap << " (" << tiled_engine.tiles() << " tiles, " << tiled_engine.memory_bytes() / 1e6 << " MB): max abs error " << max_error << ", mean abs error " << mean_error << '\n';
+		if (overlap == flarenet::TiledEngine::default_overlap) {
+			if (max_error > max_abs_error) {
+				ret = 1;
+			}
+			flarenet::TiledEngine threaded_engine(height, width, 3, size, overlap);
+			threaded_engine.run(mosaic.data(), threaded_output.data());
+			if (threaded_output != output) {
+				std::cout << "multithreaded output differs from the single-threaded output\n";
+				ret = 1;
+			}
+		}
+	}
+
+	const int crop_height = 200, crop_width = 520;
+	std::vector<float> crop, crop_output((long)crop_height * crop_width * depth), threaded_crop_output(crop_output.size());
+	for (int x = 0; x < crop_height; x++) {
+		crop.insert(crop.end(), mosaic.begin() + (long)x * width * depth, mosaic.begin() + ((long)x * width + crop_width) * depth);
+	}
+	flarenet::TiledEngine crop_engine(crop_height, crop_width);
+	flarenet::TiledEngine threaded_crop_engine(crop_height, crop_width, 2);
+	crop_engine.run(crop.data(), crop_output.data());
+	threaded_crop_engine.run(crop.data(), threaded_crop_output.data());
+	const bool finite = std::all_of(crop_output.begin(), crop_output.end(), [](float value) { return std::isfinite(value); });
+	std::cout << crop_height << "x" << crop_width << " frame: " << crop_engine.tiles() << " tiles\n";
+	if (!finite or threaded_crop_output != crop_output) {
+		std::cout << crop_height << "x" << crop_width << " frame: invalid output or output differs between thread counts\n";
+		ret = 1;
+	}
+	//{tile_size, overlap}: tile_size 0 with overlap 0 used to loop forever in tile_starts().
+	const int invalid_tilings[][2] = {{0, 0}, {-16, 0}, {40, 0}, {16, 16}};
+	for (const auto& tiling : invalid_tilings) {
+		try {
+			flarenet::TiledEngine invalid_engine(crop_height, crop_width, 1, tiling[0], tiling[1]);
+			std::cout << "tile size " << tiling[0] << " with overlap " << tiling[1] << " was not rejected\n";
+			ret = 1;
+		}
+		catch (const std::invalid_argument&) {
+		}
+	}
+
+	if (ret != 0) {
+		std::cout << "Test failed  !!!\n";
+	}
+	else {
+		std::cout << "Test passed !\n";
+	}
+	return ret;
+}
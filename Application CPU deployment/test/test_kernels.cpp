@@ -0,0 +1,447 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "ActivationStorage.h"
+#include "InputConv.h"
+#include "Int8Kernels.h"
+#include "Kernels.h"
+#include "Layers.h"
+#include "SeparableConv.h"
+#include "TransposedConv.h"
+
+// Compares every blocked kernel of Kernels.h against the reference layer templates of Layers.h on random
+// tensors. Sizes are odd on purpose so that partial pixel blocks and both borders are exercised.
+
+static std::vector<float> random_values(size_t count, float low, float high) {
+	std::vector<float> values(count);
+	for (float& value : values) {
+		value = low + (high - low) * (std::rand() / (float)RAND_MAX);
+	}
+	return values;
+}
+
+static int check(const char* name, const std::vector<float>& result, const std::vector<float>& reference) {
+	double max_error = 0;
+	for (size_t x = 0; x < reference.size(); x++) {
+		max_error = std::max(max_error, (double)std::fabs(result[x] - reference[x]) / (1.0 + std::fabs(reference[x])));
+	}
+	std::cout << name << ": max relative error " << max_error << '\n';
+	return max_error > 1e-5 ? 1 : 0;
+}
+
+//Checks the fused separable kernel on every supported instruction set, on the whole tensor and in bands of 4 rows;
+//13x11 pixels leave a partial last pixel block.
+template <int input_depth, int output_depth>
+static int check_fused_separable(int height, int width) {
+	std::vector<float> input = random_values(height * width * input_depth, 0, 1), depth_weights = random_values(3 * 3 * input_depth, -1, 1);
+	std::vector<float> point_weights = random_values(input_depth * output_depth, -1, 1), bias = random_values(output_depth, -1, 1);
+	std::vector<float> result(height * width * output_depth), reference(height * width * output_depth);
+	flarenet::SeparableDW2D_relu<3, input_depth, output_depth>(input.data(), reference.data(), height, width, depth_weights.data(), point_weights.data(), bias.data());
+	int ret = 0;
+	for (flarenet::Isa isa : {flarenet::Isa::scalar, flarenet::Isa::avx2, flarenet::Isa::avx512}) {
+		if (!flarenet::isa_supported(isa)) {
+			continue;
+		}
+		flarenet::fused_separable_dw2d_relu<input_depth, output_depth>(input.data(), result.data(), height, width, depth_weights.data(), point_weights.data(), bias.data(), isa);
+		const std::string name = "fused_separable_dw2d_relu<" + std::to_string(input_depth) + ", " + std::to_string(output_depth) + "> " + flarenet::isa_name(isa);
+		ret |= check(name.c_str(), result, reference);
+		std::fill(result.begin(), result.end(), -1.0f);
+		for (int first_row = 0; first_row < height; first_row += 4) {
+			flarenet::fused_separable_dw2d_relu<input_depth, output_depth>(input.data(), result.data(), height, width, depth_weights.data(), point_weights.data(), bias.data(), first_row, std::min(first_row + 4, height), isa);
+		}
+		ret |= check((name + " bands").c_str(), result, reference);
+	}
+	return ret;
+}
+
+//Checks the separable layer fused with 2x2 max pooling against the reference layer followed by MaxPooling2D, with and
+//without the full-resolution skip output, on every supported instruction set.
+template <int input_depth, int output_depth>
+static int check_separable_maxpool(int height, int width) {
+	std::vector<float> input = random_values(height * width * input_depth, 0, 1), depth_weights = random_values(3 * 3 * input_depth, -1, 1);
+	std::vector<float> point_weights = random_values(input_depth * output_depth, -1, 1), bias = random_values(output_depth, -1, 1);
+	std::vector<float> skip(height * width * output_depth), reference(height * width * output_depth);
+	std::vector<float> result((height / 2) * (width / 2) * output_depth), reference_pool((height / 2) * (width / 2) * output_depth);
+	flarenet::SeparableDW2D_relu<3, input_depth, output_depth>(input.data(), reference.data(), height, width, depth_weights.data(), point_weights.data(), bias.data());
+	flarenet::MaxPooling2D<2, output_depth>(reference.data(), reference_pool.data(), height, width);
+	int ret = 0;
+	for (flarenet::Isa isa : {flarenet::Isa::scalar, flarenet::Isa::avx2, flarenet::Isa::avx512}) {
+		if (!flarenet::isa_supported(isa)) {
+			continue;
+		}
+		const std::string name = "fused_separable_dw2d_relu_maxpool<" + std::to_string(input_depth) + ", " + std::to_string(output_depth) + "> " + flarenet::isa_name(isa);
+		flarenet::fused_separable_dw2d_relu_maxpool<input_depth, output_depth>(input.data(), result.data(), nullptr, height, width, depth_weights.data(), point_weights.data(), bias.data(), isa);
+		ret |= check(name.c_str(), result, reference_pool);
+		flarenet::fused_separable_dw2d_relu_maxpool<input_depth, output_depth>(input.data(), result.data(), skip.data(), height, width, depth_weights.data(), point_weights.data(), bias.data(), isa);
+		ret |= check((name + " + skip").c_str(), result, reference_pool);
+		ret |= check((name + " skip").c_str(), skip, reference);
+	}
+	return ret;
+}
+
+//Checks the sub-pixel transposed convolution, with and without the fused Add layer, on every supported instruction set,
+//on the whole tensor and in bands of 3 output rows (so that bands start on both row phases).
+template <int input_depth, int output_depth>
+static int check_subpixel_transposed(int height, int width) {
+	std::vector<float> input = random_values(height * width * input_depth, 0, 1), weights = random_values(3 * 3 * input_depth * output_depth, -1, 1);
+	std::vector<float> bias = random_values(output_depth, -1, 1), skip = random_values(height * width * 4 * output_depth, -1, 1);
+	std::vector<float> result(height * width * 4 * output_depth), reference(height * width * 4 * output_depth), reference_add(height * width * 4 * output_depth);
+	flarenet::Conv2D_transposed<3, 2, input_depth, output_depth>(input.data(), reference.data(), height, width, weights.data(), bias.data());
+	flarenet::Add<output_depth>(skip.data(), reference.data(), reference_add.data(), height * 2, width * 2);
+	int ret = 0;
+	for (flarenet::Isa isa : {flarenet::Isa::scalar, flarenet::Isa::avx2, flarenet::Isa::avx512}) {
+		if (!flarenet::isa_supported(isa)) {
+			continue;
+		}
+		const std::string name = "subpixel_conv2d_transposed<" + std::to_string(input_depth) + ", " + std::to_string(output_depth) + "> " + flarenet::isa_name(isa);
+		flarenet::subpixel_conv2d_transposed<input_depth, output_depth>(input.data(), result.data(), height, width, weights.data(), bias.data(), nullptr, isa);
+		ret |= check(name.c_str(), result, reference);
+		flarenet::subpixel_conv2d_transposed<input_depth, output_depth>(input.data(), result.data(), height, width, weights.data(), bias.data(), skip.data(), isa);
+		ret |= check((name + " + add").c_str(), result, reference_add);
+		std::fill(result.begin(), result.end(), -1.0f);
+		for (int first_row = 0; first_row < height * 2; first_row += 3) {
+			flarenet::subpixel_conv2d_transposed<input_depth, output_depth>(input.data(), result.data(), height, width, weights.data(), bias.data(), skip.data(), first_row, std::min(first_row + 3, height * 2), isa);
+		}
+		ret |= check((name + " + add bands").c_str(), result, reference_add);
+	}
+	return ret;
+}
+
+//Checks the transposed convolution on a compacted kernel against the dense kernel with the same zero rows, on every
+//supported instruction set and in bands of 3 output rows. Rows are dropped at random from every tap, and all rows of
+//one input channel, so that some kernel rows also lose channels.
+template <int input_depth, int output_depth>
+static int check_compact_transposed(int height, int width) {
+	std::vector<float> input = random_values(height * width * input_depth, 0, 1), weights = random_values(3 * 3 * input_depth * output_depth, -1, 1);
+	std::vector<float> bias = random_values(output_depth, -1, 1), skip = random_values(height * width * 4 * output_depth, -1, 1);
+	for (int row = 0; row < 9 * input_depth; row++) {
+		if (std::rand() % 3 == 0 or row % input_depth == 1) {
+			std::fill(weights.begin() + row * output_depth, weights.begin() + (row + 1) * output_depth, 0.0f);
+		}
+	}
+	const flarenet::CompactKernel kernel = flarenet::compact_kernel(weights.data(), input_depth, output_depth);
+	std::vector<float> result(height * width * 4 * output_depth), reference(height * width * 4 * output_depth);
+	flarenet::Conv2D_transposed<3, 2, input_depth, output_depth>(input.data(), result.data(), height, width, weights.data(), bias.data());
+	flarenet::Add<output_depth>(skip.data(), result.data(), reference.data(), height * 2, width * 2);
+	int ret = 0;
+	std::cout << "compact_kernel<" << input_depth << ", " << output_depth << ">: " << kernel.rows() << " of " << 9 * input_depth << " rows\n";
+	for (flarenet::Isa isa : {flarenet::Isa::scalar, flarenet::Isa::avx2, flarenet::Isa::avx512}) {
+		if (!flarenet::isa_supported(isa)) {
+			continue;
+		}
+		const std::string name = "compact subpixel_conv2d_transposed<" + std::to_string(input_depth) + ", " + std::to_string(output_depth) + "> " + flarenet::isa_name(isa);
+		std::fill(result.begin(), result.end(), -1.0f);
+		for (int first_row = 0; first_row < height * 2; first_row += 3) {
+			flarenet::subpixel_conv2d_transposed<input_depth, output_depth>(input.data(), result.data(), height, width, kernel, bias.data(), skip.data(), first_row, std::min(first_row + 3, height * 2), isa);
+		}
+		ret |= check((name + " + add bands").c_str(), result, reference);
+	}
+	return ret;
+}
+
+static std::vector<uint8_t> random_bytes(size_t count) {
+	std::vector<uint8_t> values(count);
+	for (uint8_t& value : values) {
+		value = (uint8_t)(std::rand() % 256);
+	}
+	return values;
+}
+
+static int check_bytes(const std::string& name, const std::vector<uint8_t>& result, const std::vector<uint8_t>& reference) {
+	const bool equal = result == reference;
+	std::cout << name << (equal ? ": identical\n" : ": MISMATCH\n");
+	return equal ? 0 : 1;
+}
+
+static std::vector<double> random_weights(size_t count) {
+	std::vector<double> values(count);
+	for (double& value : values) {
+		value = std::rand() / (double)RAND_MAX - 0.5;
+	}
+	return values;
+}
+
+//The int8 kernels must produce the same bytes on every instruction set.
+template <int input_depth, int output_depth>
+static int check_int8_separable(int height, int width) {
+	const flarenet::Int8Separable layer = flarenet::quantize_int8_separable(random_weights(3 * 3 * input_depth), random_weights(input_depth * output_depth), random_weights(output_depth), input_depth, output_depth, 0.02, 0.03, 0.05);
+	const std::vector<uint8_t> input = random_bytes(height * width * input_depth);
+	std::vector<uint8_t> result(height * width * output_depth), reference(height * width * output_depth);
+	flarenet::int8_separable_dw2d_relu<input_depth, output_depth>(input.data(), reference.data(), height, width, layer, flarenet::Isa::scalar);
+	int ret = 0;
+	for (flarenet::Isa isa : {flarenet::Isa::avx2, flarenet::Isa::avx512}) {
+		if (flarenet::isa_supported(isa)) {
+			flarenet::int8_separable_dw2d_relu<input_depth, output_depth>(input.data(), result.data(), height, width, layer, isa);
+			ret |= check_bytes("int8_separable_dw2d_relu<" + std::to_string(input_depth) + ", " + std::to_string(output_depth) + "> " + flarenet::isa_name(isa), result, reference);
+		}
+	}
+	return ret;
+}
+
+template <int input_depth, int output_depth>
+static int check_int8_transposed(int height, int width) {
+	const flarenet::Int8Conv layer = flarenet::quantize_int8_conv(random_weights(3 * 3 * input_depth * output_depth), random_weights(output_depth), 9, input_depth, output_depth, 0.02, 0.2);
+	const std::vector<uint8_t> input = random_bytes(height * width * input_depth), skip = random_bytes(height * width * 4 * output_depth);
+	std::vector<uint8_t> result(height * width * 4 * output_depth), reference(height * width * 4 * output_depth);
+	flarenet::int8_subpixel_conv2d_transposed<input_depth, output_depth>(input.data(), reference.data(), height, width, layer, skip.data(), 0.7f, flarenet::Isa::scalar);
+	int ret = 0;
+	for (flarenet::Isa isa : {flarenet::Isa::avx2, flarenet::Isa::avx512}) {
+		if (flarenet::isa_supported(isa)) {
+			flarenet::int8_subpixel_conv2d_transposed<input_depth, output_depth>(input.data(), result.data(), height, width, layer, skip.data(), 0.7f, isa);
+			ret |= check_bytes("int8_subpixel_conv2d_transposed<" + std::to_string(input_depth) + ", " + std::to_string(output_depth) + "> " + flarenet::isa_name(isa), result, reference);
+		}
+	}
+	return ret;
+}
+
+//Converts values spanning every float exponent (and zeros, denormals, ties) to 16 bits on every supported instruction set:
+//the SIMD variants must give the scalar bits, and the round trip must be within half a unit in the last place.
+static int check_activation_storage(flarenet::ActivationStorage storage) {
+
+	std::vector<float> values = {0.0f, -0.0f, 1e-40f, 5.96e-8f, 6.1e-5f, 1.0f + 1.0f / 2048, 1.0f + 3.0f / 2048, 1.0f + 1.0f / 256, 65504.0f, 65519.0f, 1e5f};
+	for (int exponent = -30; exponent <= 30; exponent++) {
+		for (float value : random_values(24, -1, 1)) {
+			values.push_back(std::ldexp(value, exponent));
+		}
+	}
+	const int significant_bits = storage == flarenet::ActivationStorage::fp16 ? 11 : 8;
+	std::vector<uint16_t> reference(values.size()), stored(values.size());
+	std::vector<float> loaded(values.size()), reference_loaded(values.size());
+	flarenet::store_activations(values.data(), reference.data(), (long)values.size(), storage, flarenet::Isa::scalar);
+	flarenet::load_activations(reference.data(), reference_loaded.data(), (long)values.size(), storage, flarenet::Isa::scalar);
+	int ret = 0;
+	double max_error = 0;
+	for (size_t x = 0; x < values.size(); x++) {
+		//Relative to the value, for values in the normal range of the format.
+		const double magnitude = std::fabs(values[x]);
+		const bool normal = storage == flarenet::ActivationStorage::bf16 ? magnitude >= 1.2e-38 : (magnitude >= 6.11e-5 and magnitude <= 65504);
+		if (normal) {
+			max_error = std::max(max_error, std::fabs(reference_loaded[x] - values[x]) / magnitude);
+		}
+	}
+	std::cout << flarenet::storage_name(storage) << ": max relative round-trip error " << max_error << '\n';
+	ret |= max_error > std::ldexp(1.0, -significant_bits) ? 1 : 0;
+	for (flarenet::Isa isa : {flarenet::Isa::avx2, flarenet::Isa::avx512}) {
+		if (!flarenet::isa_supported(isa)) {
+			continue;
+		}
+		flarenet::store_activations(values.data(), stored.data(), (long)values.size(), storage, isa);
+		flarenet::load_activations(stored.data(), loaded.data(), (long)values.size(), storage, isa);
+		const bool equal = stored == reference and std::equal(loaded.begin(), loaded.end(), reference_loaded.begin(), [](float a, float b) { return std::memcmp(&a, &b, sizeof(a)) == 0; });
+		std::cout << flarenet::storage_name(storage) << " " << flarenet::isa_name(isa) << (equal ? ": identical\n" : ": MISMATCH\n");
+		ret |= equal ? 0 : 1;
+	}
+	return ret;
+}
+
+int main() {
+
+	const int height = 13;
+	const int width = 11;
+	int ret = 0;
+	std::srand(1);
+
+	{
+		std::vector<float> input = random_values(height * width * 3, 0, 1), weights = random_values(3 * 3 * 3 * 16, -1, 1), bias = random_values(16, -1, 1);
+		std::vector<float> result(height * width * 16), reference(height * width * 16);
+		flarenet::conv2d_relu<3, 3, 16>(input.data(), result.data(), height, width, weights.data(), bias.data());
+		flarenet::Conv2D_relu<3, 3, 16>(input.data(), reference.data(), height, width, weights.data(), bias.data());
+		ret |= check("conv2d_relu", result, reference);
+	}
+	{
+		//Wide enough for full SIMD pixel blocks plus leftover interior pixels on every row.
+		const int input_width = 41;
+		std::vector<float> input = random_values(height * input_width * 3, 0, 1), weights = random_values(3 * 3 * 3 * 16, -1, 1), bias = random_values(16, -1, 1);
+		std::vector<float> result(height * input_width * 16), skip(height * input_width * 16), reference(height * input_width * 16);
+		flarenet::Conv2D_relu<3, 3, 16>(input.data(), reference.data(), height, input_width, weights.data(), bias.data());
+		for (flarenet::Isa isa : {flarenet::Isa::scalar, flarenet::Isa::avx2, flarenet::Isa::avx512}) {
+			if (!flarenet::isa_supported(isa)) {
+				continue;
+			}
+			flarenet::input_conv2d_relu(input.data(), result.data(), skip.data(), height, input_width, weights.data(), bias.data(), isa);
+			ret |= check((std::string("input_conv2d_relu ") + flarenet::isa_name(isa)).c_str(), result, reference);
+			ret |= check("input_conv2d_relu skip", skip, result);
+			std::fill(result.begin(), result.end(), -1.0f);
+			for (int first_row = 0; first_row < height; first_row += 4) {
+				flarenet::input_conv2d_relu(input.data(), result.data(), nullptr, height, input_width, weights.data(), bias.data(), first_row, std::min(first_row + 4, height), isa);
+			}
+			ret |= check((std::string("input_conv2d_relu bands ") + flarenet::isa_name(isa)).c_str(), result, reference);
+		}
+		//Pooled over the first height - 1 rows and 40 columns (even sizes); the skip rows are the same rows of reference.
+		const int pool_height = height - 1;
+		const int pool_width = input_width - 1;
+		std::vector<float> pool_input((long)pool_height * pool_width * 3), pool_reference(pool_height * pool_width * 16);
+		for (int x = 0; x < pool_height; x++) {
+			std::copy(input.begin() + (long)x * input_width * 3, input.begin() + ((long)x * input_width + pool_width) * 3, pool_input.begin() + (long)x * pool_width * 3);
+		}
+		std::vector<float> pool_skip(pool_height * pool_width * 16), pooled((pool_height / 2) * (pool_width / 2) * 16), pooled_reference((pool_height / 2) * (pool_width / 2) * 16);
+		flarenet::Conv2D_relu<3, 3, 16>(pool_input.data(), pool_reference.data(), pool_height, pool_width, weights.data(), bias.data());
+		flarenet::MaxPooling2D<2, 16>(pool_reference.data(), pooled_reference.data(), pool_height, pool_width);
+		for (flarenet::Isa isa : {flarenet::Isa::scalar, flarenet::Isa::avx2, flarenet::Isa::avx512}) {
+			if (!flarenet::isa_supported(isa)) {
+				continue;
+			}
+			flarenet::input_conv2d_relu_maxpool(pool_input.data(), pooled.data(), pool_skip.data(), pool_height, pool_width, weights.data(), bias.data(), isa);
+			ret |= check((std::string("input_conv2d_relu_maxpool ") + flarenet::isa_name(isa)).c_str(), pooled, pooled_reference);
+			ret |= check("input_conv2d_relu_maxpool skip", pool_skip, pool_reference);
+		}
+		//Winograd F(2x2, 3x3) on the same tensors, whole and in bands of 3 pooled rows (every tile row, the zero padding and
+		//the border tiles).
+		const std::vector<float> winograd_weights = flarenet::input_winograd_weights(weights.data());
+		for (flarenet::Isa isa : {flarenet::Isa::scalar, flarenet::Isa::avx2, flarenet::Isa::avx512}) {
+			if (!flarenet::isa_supported(isa)) {
+				continue;
+			}
+			const std::string name = std::string("input_conv2d_relu_maxpool_winograd ") + flarenet::isa_name(isa);
+			flarenet::input_conv2d_relu_maxpool_winograd(pool_input.data(), pooled.data(), pool_skip.data(), pool_height, pool_width, winograd_weights.data(), bias.data(), isa);
+			ret |= check(name.c_str(), pooled, pooled_reference);
+			ret |= check((name + " skip").c_str(), pool_skip, pool_reference);
+			std::fill(pooled.begin(), pooled.end(), -1.0f);
+			for (int first_row = 0; first_row < pool_height / 2; first_row += 3) {
+				flarenet::input_conv2d_relu_maxpool_winograd(pool_input.data(), pooled.data(), nullptr, pool_height, pool_width, winograd_weights.data(), bias.data(), first_row, std::min(first_row + 3, pool_height / 2), isa);
+			}
+			ret |= check((name + " bands").c_str(), pooled, pooled_reference);
+		}
+		//8-bit input with the 1/255 normalization folded into the weights, in bands of 5 pooled rows (a band of more than
+		//one conversion chunk and a band of one row).
+		const std::vector<uint8_t> pixels = random_bytes(pool_input.size());
+		std::vector<float> normalized(pool_input.size()), pixel_weights(weights.size());
+		for (size_t x = 0; x < pixels.size(); x++) {
+			normalized[x] = pixels[x] / 255.0f;
+		}
+		for (size_t x = 0; x < weights.size(); x++) {
+			pixel_weights[x] = weights[x] / 255.0f;
+		}
+		flarenet::Conv2D_relu<3, 3, 16>(normalized.data(), pool_reference.data(), pool_height, pool_width, weights.data(), bias.data());
+		flarenet::MaxPooling2D<2, 16>(pool_reference.data(), pooled_reference.data(), pool_height, pool_width);
+		const std::vector<float> pixel_winograd_weights = flarenet::input_winograd_weights(pixel_weights.data());
+		std::vector<float> scratch(flarenet::input_conv_scratch(pool_width));
+		for (flarenet::Isa isa : {flarenet::Isa::scalar, flarenet::Isa::avx2, flarenet::Isa::avx512}) {
+			if (!flarenet::isa_supported(isa)) {
+				continue;
+			}
+			for (bool winograd : {false, true}) {
+				const std::string name = std::string(winograd ? "input_conv2d_relu_maxpool_winograd uint8 " : "input_conv2d_relu_maxpool uint8 ") + flarenet::isa_name(isa);
+				std::fill(pooled.begin(), pooled.end(), -1.0f);
+				std::fill(pool_skip.begin(), pool_skip.end(), -1.0f);
+				for (int first_row = 0; first_row < pool_height / 2; first_row += 5) {
+					const int last_row = std::min(first_row + 5, pool_height / 2);
+					if (winograd) {
+						flarenet::input_conv2d_relu_maxpool_winograd(pixels.data(), pooled.data(), pool_skip.data(), pool_height, pool_width, pixel_winograd_weights.data(), bias.data(), first_row, last_row, scratch.data(), isa);
+					}
+					else {
+						flarenet::input_conv2d_relu_maxpool(pixels.data(), pooled.data(), pool_skip.data(), pool_height, pool_width, pixel_weights.data(), bias.data(), first_row, last_row, scratch.data(), isa);
+					}
+				}
+				ret |= check(name.c_str(), pooled, pooled_reference);
+				ret |= check((name + " skip").c_str(), pool_skip, pool_reference);
+			}
+		}
+	}
+	{
+		std::vector<float> input = random_values(height * width * 32, 0, 1), depth_weights = random_values(3 * 3 * 32, -1, 1);
+		std::vector<float> point_weights = random_values(32 * 48, -1, 1), bias = random_values(48, -1, 1);
+		std::vector<float> result(height * width * 48), reference(height * width * 48);
+		flarenet::separable_dw2d_relu<3, 32, 48>(input.data(), result.data(), height, width, depth_weights.data(), point_weights.data(), bias.data());
+		flarenet::SeparableDW2D_relu<3, 32, 48>(input.data(), reference.data(), height, width, depth_weights.data(), point_weights.data(), bias.data());
+		ret |= check("separable_dw2d_relu", result, reference);
+	}
+	ret |= check_fused_separable<16, 32>(height, width);
+	ret |= check_fused_separable<32, 48>(height, width);
+	ret |= check_fused_separable<48, 64>(height, width);
+	//Even sizes for the pooling layers.
+	ret |= check_separable_maxpool<16, 32>(height + 1, width - 1);
+	ret |= check_separable_maxpool<32, 48>(height + 1, width - 1);
+	ret |= check_separable_maxpool<48, 64>(height + 1, width - 1);
+	{
+		std::vector<float> input = random_values(height * width * 48, 0, 1), weights = random_values(3 * 3 * 48 * 32, -1, 1), bias = random_values(32, -1, 1);
+		std::vector<float> skip = random_values(height * width * 4 * 32, -1, 1);
+		std::vector<float> result(height * width * 4 * 32), reference(height * width * 4 * 32);
+		flarenet::conv2d_transposed<3, 2, 48, 32>(input.data(), result.data(), height, width, weights.data(), bias.data());
+		flarenet::Conv2D_transposed<3, 2, 48, 32>(input.data(), reference.data(), height, width, weights.data(), bias.data());
+		ret |= check("conv2d_transposed", result, reference);
+		flarenet::conv2d_transposed<3, 2, 48, 32>(input.data(), result.data(), height, width, weights.data(), bias.data(), skip.data());
+		flarenet::Add<32>(skip.data(), reference.data(), reference.data(), height * 2, width * 2);
+		ret |= check("conv2d_transposed + add", result, reference);
+	}
+	ret |= check_subpixel_transposed<64, 64>(height, width);
+	ret |= check_subpixel_transposed<64, 48>(height, width);
+	ret |= check_subpixel_transposed<48, 32>(height, width);
+	ret |= check_subpixel_transposed<32, 16>(height, width);
+	ret |= check_compact_transposed<64, 64>(height, width);
+	ret |= check_compact_transposed<64, 48>(height, width);
+	ret |= check_compact_transposed<48, 32>(height, width);
+	ret |= check_compact_transposed<32, 16>(height, width);
+	ret |= check_int8_separable<16, 32>(height, width);
+	ret |= check_int8_separable<48, 64>(height, width);
+	ret |= check_int8_transposed<64, 48>(height, width);
+	ret |= check_int8_transposed<32, 16>(height, width);
+	{
+		const flarenet::Int8Conv input_conv = flarenet::quantize_int8_conv(random_weights(3 * 3 * 3 * 16), random_weights(16), 3, 9, 16, 1.0 / 255, 0.01);
+		const flarenet::Int8Conv logits = flarenet::quantize_int8_conv(random_weights(16 * 3), random_weights(3), 1, 16, 3, 0.05, 0);
+		const std::vector<uint8_t> input = random_bytes(height * width * 3), features = random_bytes(height * width * 16);
+		std::vector<uint8_t> reference(height * width * 16), result(height * width * 16);
+		std::vector<float> logits_reference(height * width * 3), logits_result(height * width * 3);
+		flarenet::int8_input_conv2d_relu(input.data(), reference.data(), height, width, input_conv, flarenet::Isa::scalar);
+		flarenet::int8_conv2d_logits(features.data(), logits_reference.data(), height, width, logits, flarenet::Isa::scalar);
+		for (flarenet::Isa isa : {flarenet::Isa::avx2, flarenet::Isa::avx512}) {
+			if (!flarenet::isa_supported(isa)) {
+				continue;
+			}
+			flarenet::int8_input_conv2d_relu(input.data(), result.data(), height, width, input_conv, isa);
+			ret |= check_bytes(std::string("int8_input_conv2d_relu ") + flarenet::isa_name(isa), result, reference);
+			flarenet::int8_conv2d_logits(features.data(), logits_result.data(), height, width, logits, isa);
+			ret |= check((std::string("int8_conv2d_logits ") + flarenet::isa_name(isa)).c_str(), logits_result, logits_reference);
+		}
+	}
+	{
+		std::vector<float> input = random_values(height * 2 * width * 2 * 64, 0, 1);
+		std::vector<float> result(height * width * 64), reference(height * width * 64);
+		flarenet::max_pooling2d<2, 64>(input.data(), result.data(), height * 2, width * 2);
+		flarenet::MaxPooling2D<2, 64>(input.data(), reference.data(), height * 2, width * 2);
+		ret |= check("max_pooling2d", result, reference);
+	}
+	{
+		std::vector<float> input_1 = random_values(height * width * 16, -1, 1), input_2 = random_values(height * width * 16, -1, 1);
+		std::vector<float> result(height * width * 16), reference(height * width * 16);
+		flarenet::add_relu<16>(input_1.data(), input_2.data(), result.data(), height, width);
+		flarenet::Add<16>(input_1.data(), input_2.data(), reference.data(), height, width);
+		ret |= check("add_relu", result, reference);
+	}
+	{
+		std::vector<float> input = random_values(height * width * 16, 0, 1), weights = random_values(16 * 3, -1, 1), bias = random_values(3, -1, 1);
+		std::vector<float> result(height * width * 3), reference(height * width * 3);
+		flarenet::conv2d_sigmoid<16, 3>(input.data(), result.data(), height, width, weights.data(), bias.data());
+		flarenet::Conv2D_sigmoid<16, 3>(input.data(), reference.data(), height, width, weights.data(), bias.data());
+		ret |= check("conv2d_sigmoid", result, reference);
+	}
+	{
+		//Logits over the whole range of the sigmoid and past its clamp: within 1 LSB of the rounded sigmoid of the logits.
+		std::vector<float> input = random_values(height * width * 16, 0, 1), weights = random_values(16 * 3, -3, 3), bias = random_values(3, -8, 8);
+		std::vector<float> reference(height * width * 3);
+		std::vector<uint8_t> result(height * width * 3);
+		flarenet::conv2d_sigmoid_uint8<16, 3>(input.data(), result.data(), height, width, weights.data(), bias.data());
+		flarenet::Conv2D_sigmoid<16, 3>(input.data(), reference.data(), height, width, weights.data(), bias.data());
+		int max_error = 0;
+		for (size_t x = 0; x < reference.size(); x++) {
+			max_error = std::max(max_error, std::abs(result[x] - (int)std::lround(255 / (1 + std::exp(-(double)reference[x])))));
+		}
+		std::cout << "conv2d_sigmoid_uint8: max error " << max_error << " LSB\n";
+		ret |= max_error > 1 ? 1 : 0;
+	}
+
+	ret |= check_activation_storage(flarenet::ActivationStorage::fp16);
+	ret |= check_activation_storage(flarenet::ActivationStorage::bf16);
+
+	if (ret != 0) {
+		std::cout << "Test failed  !!!\n";
+	}
+	else {
+		std::cout << "Test passed !\n";
+	}
+	return ret;
+}
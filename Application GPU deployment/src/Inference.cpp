@@ -7,15 +7,72 @@ using namespace cv;
 using namespace std;
 using namespace std::chrono;
 
+//Tile origins along an axis of size pixels: every tile - overlap pixels, with the last tile ending on the border (or up to
+//15 pixels past it, so that tiles stay on the 16-pixel grid of the pooling layers).
+static vector<int> tile_starts(int size, int tile, int overlap)
+{
+    vector<int> starts;
+    int start = 0;
+    for (; start + tile < size; start += tile - overlap) {
+        starts.push_back(start);
+    }
+    starts.push_back((max(size - tile, 0) + 15) / 16 * 16);
+    return starts;
+}
+
+//Feather weights of the pixels of a tile starting at start (see TiledEngine.cpp in the CPU deployment): zero over the
+//first 32 and last 16 pixels next to an edge that has a neighbour (they lack context), then a linear ramp to one.
+static vector<float> tile_weights(int start, int size, int tile, int overlap)
+{
+    const int before = 32, after = 16;
+    const int ramp = overlap > before + after ? overlap - before - after : overlap / 3;
+    const int leading_margin = (overlap - ramp) * before / (before + after);
+    const int trailing_margin = (overlap - ramp) * after / (before + after);
+    vector<float> weights(tile);
+    for (int i = 0; i < tile; i++) {
+        float weight = start + i < size ? 1.0f : 0.0f;
+        if (start > 0) {
+            weight = min(weight, min(1.0f, max(0.0f, (i + 1 - leading_margin) / float(ramp + 1))));
+        }
+        if (start + tile < size) {
+            weight = min(weight, min(1.0f, max(0.0f, (tile - i - trailing_margin) / float(ramp + 1))));
+        }
+        weights[i] = weight;
+    }
+    return weights;
+}
+
+//Feather weights of all tiles of an axis, divided by their sum at every pixel: the product of a tile's row and column
+//weights then sums to one over the tiles covering a pixel.
+static vector<vector<float>> normalized_weights(const vector<int>& starts, int size, int tile, int overlap)
+{
+    vector<vector<float>> weights;
+    vector<float> sums(size);
+    for (int start : starts) {
+        weights.push_back(tile_weights(start, size, tile, overlap));
+        for (int i = 0; i < tile && start + i < size; i++) {
+            sums[start + i] += weights.back()[i];
+        }
+    }
+    for (size_t t = 0; t < starts.size(); t++) {
+        for (int i = 0; i < tile && starts[t] + i < size; i++) {
+            weights[t][i] /= sums[starts[t] + i];
+        }
+    }
+    return weights;
+}
+
 int main()
 {
     // ----- ONNX Model Variables Initialization ----- //
     Ort::Env env;
     Ort::RunOptions runOptions;
     Ort::Session session(nullptr);
-    //Define Image dimension (W,H,C).
+    //Define model input dimension (W,H,C). Larger images are processed as overlapping tiles of this size.
     constexpr int64_t width = 256;
     constexpr int64_t height = 256;
+    //Overlap of neighbouring tiles; 64 pixels cover the receptive field, so tiles blend without seams.
+    constexpr int tile_overlap = 64;
     constexpr int64_t num_channels = 3;
     //Define Output dimension (W,H,C=classes).
     constexpr int64_t num_classes = 3;
@@ -45,35 +102,63 @@ int main()
     // ----- Image Variables Initialization ----- //
     auto start_inference = high_resolution_clock::now();
     auto duration_inference = duration_cast<microseconds>(high_resolution_clock::now() - start_inference);
+    cv::Mat img_result;
+    cv::Mat img_blend;
     for (int i=0; i < 1000; i++) {
         start_inference = high_resolution_clock::now();
+        //8-bit RGB image at the camera resolution. It is normalized (between 0 and 1) tile by tile as it is copied into
+        //the input tensor, so no float copy of the whole image is made.
         cv::Mat image = imread("/PATH/img_in_XXXjpg");
-        //Resize image to 255x255.
-        resize(image, image, Size(width, height));
-        //Reshape image to 1D vector.
-        image = image.reshape(1, 1);
-        //Normailze image RGB values (between 0 and 1). Convert to vector<float> from cv::Mat.
-        vector<float> image_vec;
-        image.convertTo(image_vec, CV_32FC3, 1. / 255);
-        copy(image_vec.begin(), image_vec.end(), input);
-        //Run inference by calling ONNX session.
-        try {
-             session.Run(runOptions, input_names.data(), &input_tensor, 1, output_names.data(), &output_tensor, 1);
-        }
-        catch (Ort::Exception& e) {
-             cout << e.what() << endl;
-             return 1;
+        //Feather-blended sum of the tile outputs, already scaled to 0 - 255.
+        img_blend = cv::Mat::zeros(image.rows, image.cols, CV_32FC3);
+        const vector<int> row_starts = tile_starts(image.rows, height, tile_overlap);
+        const vector<int> col_starts = tile_starts(image.cols, width, tile_overlap);
+        const vector<vector<float>> all_row_weights = normalized_weights(row_starts, image.rows, height, tile_overlap);
+        const vector<vector<float>> all_col_weights = normalized_weights(col_starts, image.cols, width, tile_overlap);
+        for (size_t row_tile = 0; row_tile < row_starts.size(); row_tile++) {
+            const int row_start = row_starts[row_tile];
+            const vector<float>& row_weights = all_row_weights[row_tile];
+            for (size_t col_tile = 0; col_tile < col_starts.size(); col_tile++) {
+                const int col_start = col_starts[col_tile];
+                const vector<float>& col_weights = all_col_weights[col_tile];
+                //Copy the normalized tile into the input tensor, zero padding whatever lies past the image.
+                const int rows = min<int>(height, image.rows - row_start);
+                const int cols = min<int>(width, image.cols - col_start);
+                fill(input, input + num_in_classes, 0.0f);
+                for (int x = 0; x < rows; x++) {
+                    const uchar* row = image.ptr<uchar>(row_start + x) + col_start * num_channels;
+                    float* input_row = input + x * width * num_channels;
+                    for (int value = 0; value < cols * num_channels; value++) {
+                        input_row[value] = row[value] * (1.0f / 255);
+                    }
+                }
+                //Run inference by calling ONNX session.
+                try {
+                     session.Run(runOptions, input_names.data(), &input_tensor, 1, output_names.data(), &output_tensor, 1);
+                }
+                catch (Ort::Exception& e) {
+                     cout << e.what() << endl;
+                     return 1;
+                }
+                //Blend the tile into the image, with the scaling back to RGB values between 0 and 255 folded into
+                //the weights.
+                for (int x = 0; x < rows; x++) {
+                    float* out_row = img_blend.ptr<float>(row_start + x) + col_start * num_classes;
+                    for (int y = 0; y < cols; y++) {
+                        const float weight = 255 * row_weights[x] * col_weights[y];
+                        for (int c = 0; c < num_classes; c++) {
+                            out_row[y * num_classes + c] += weight * results[(x * width + y) * num_classes + c];
+                        }
+                    }
+                }
+            }
         }
+        //8-bit RGB result, rounded and saturated in the same pass.
+        img_blend.convertTo(img_result, CV_8UC3);
         duration_inference = duration_cast<microseconds>(duration_inference + duration_cast<microseconds>(high_resolution_clock::now() - start_inference));
     }
 
-     //Rstore RGB values back to normal scale (between 0 and 255).
-     for (size_t col = 0; col < num_out_classes; col++) {
-          results[col] = int(results[col] * 255);
-     }
-     
      //Write inference image into file.
-     cv::Mat img_result = cv::Mat(256, 256, CV_32FC3, results);
      mean_duration_inference = duration_inference.count() / 1000;
      const std::string write_path = "/PATH/img_out_xxx.jpg";
      cv::imwrite(write_path, img_result);
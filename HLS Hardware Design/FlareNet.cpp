@@ -1,192 +1,122 @@
 #include <hls_stream.h>
 #include <stdio.h>
 #include "FlareNet.h"
+#include "SkipBuffer.h"
+#include "sigmoid_table.h"
 #include "weights.h"
 
-// ############# Max-Pooling Buffer Initialize Function ############# //
-template <int kernel_size, int input_size, int depth>
-void init_buffer_and_window_maxpool(hls::stream<model_type_input>& input_stream, model_type_input input_buffer[kernel_size-1][input_size-kernel_size][depth], model_type_input window[kernel_size][kernel_size][depth]) {
+// ############# Stream Word Write Function ############# //
+//Writes the PF output channels computed in parallel as one transaction: a model_word when PF > 1, the channel itself when
+//PF = 1 (non-template overload), so layer instances with PF = 1 keep their scalar output streams.
+template <int PF>
+void write_word(hls::stream<model_word<PF> >& output_stream, const model_type_output values[PF]) {
 
-	model_type_input pixel_val = 0;
-	for (int x = 0; x < kernel_size-1; x++) {
-		for (int y = 0; y < input_size; y++) {
-			for (int chn = 0; chn < depth; chn++) {
-				#pragma HLS PIPELINE
-				input_stream >> pixel_val;
-				//Store the next values outside the window kernel size (inside the window the values will be shifted left).
-				if (y > kernel_size-1 and x < kernel_size-1){
-					input_buffer[x][y-kernel_size][chn] = pixel_val;
-				}
-				//Initialize window
-				if (y < kernel_size) {
-					window[x][y][chn] = pixel_val;
-				}
-			}
-		}
-	}
-	//Initialize lower side of window.
-	for (int y = 0; y < kernel_size; y++) {
-		for (int chn = 0; chn < depth; chn++) {
-			#pragma HLS PIPELINE
-			input_stream >> pixel_val;
-			window[kernel_size-1][y][chn] = pixel_val;
-		}
+	model_word<PF> word;
+	for (int pf = 0; pf < PF; pf++) {
+		#pragma HLS UNROLL
+		word.data[pf] = values[pf];
 	}
+	output_stream << word;
 }
 
-// ############# Zero-padding Buffer Initialize Function ############# //
-template <int kernel_size, int input_size, int depth>
-void init_buffer_and_window_zeropadd(hls::stream<model_type_input>& input_stream, model_type_input input_buffer[kernel_size][input_size-kernel_size+2][depth], model_type_input window[kernel_size][kernel_size][depth]) {
+void write_word(hls::stream<model_type_output>& output_stream, const model_type_output values[1]) {
+	output_stream << values[0];
+}
 
-	model_type_input pixel_val = 0;
-	//Fill values along column for the kernel size.
-	for (int x = 0; x < kernel_size; x++) {
-		//Fill values along the kernel width size (+1 because of the padding)
-		for (int y = 0; y < input_size+1; y++) {
-			//Fill all depth channel values.
-			for (int chn = 0; chn < depth; chn++) {
-				#pragma HLS PIPELINE
-				//If first row or first column, then pixel is 0 (zero padding).
-				if (x < 1) {
-					pixel_val = 0;
-				}
-				else if (y < 1) {
-					pixel_val = 0;
-				}
-				else {
-					input_stream >> pixel_val;
-				}
-				//Store the next values outside the window kernel size (inside the window the values will be shifted left).
-				if (y > kernel_size-1) {
-					if (y == input_size) {
-						//Fill zero padding on last column.
-						input_buffer[x][y-kernel_size+1][chn] = 0;
-					}
-					input_buffer[x][y-kernel_size][chn] = pixel_val;
-				}
-				//Initialize window
-				if (y < kernel_size) {
-					window[x][y][chn] = pixel_val;
-				}
-			}
-		}
+// ############# Stream Word Read Function ############# //
+//Reads the PF channels of one transaction, from a model_word when PF > 1 or a scalar stream when PF = 1, the counterpart
+//of write_word() for the layers that consume PF channels per transaction.
+template <int PF>
+void read_word(hls::stream<model_word<PF> >& input_stream, model_type_input values[PF]) {
+
+	model_word<PF> word;
+	input_stream >> word;
+	for (int pf = 0; pf < PF; pf++) {
+		#pragma HLS UNROLL
+		values[pf] = word.data[pf];
 	}
 }
 
-// ############# Max-pooling Buffer Update Function ############# //
-template <int kernel_size, int input_size, int depth>
-void update_buffer_and_window_maxpool(hls::stream<model_type_input>& input_stream, model_type_input input_buffer[kernel_size-1][input_size-kernel_size][depth], model_type_input window[kernel_size][kernel_size][depth]) {
+void read_word(hls::stream<model_type_input>& input_stream, model_type_input values[1]) {
+	input_stream >> values[0];
+}
 
-	model_type_input pixel_val = 0;
-	//Update window by shifting columns left.
-	for (int x = 0; x < kernel_size; x++) {
-		for (int y = 0; y < kernel_size; y++) {
-			for (int chn = 0; chn < depth; chn++) {
+// ############# Line Buffer Initialize Function ############# //
+//The line buffer keeps the kernel_size input rows around the current output row in circular order: input row r is stored in
+//slot (r + kernel_size/2) % kernel_size, so every new row overwrites the oldest one in place and no buffer value is ever shifted.
+//The input stream carries IPF (a divisor of depth) channels per word, stored in parallel: the line buffer of the layer is
+//partitioned cyclically by IPF over the channels.
+template <int kernel_size, int input_size, int depth, int IPF>
+void init_line_buffer_zeropadd(hls::stream<typename model_stream_word<IPF>::type>& input_stream, model_type_input line_buffer[kernel_size][input_size][depth]) {
+
+	model_type_input pixel_vals[IPF];
+	#pragma HLS ARRAY_PARTITION variable=pixel_vals complete
+	//Fill the rows below the center of the first window (the rows above it are zero padding and are never stored).
+	for (int x = 0; x < kernel_size/2; x++) {
+		for (int y = 0; y < input_size; y++) {
+			for (int chn = 0; chn < depth; chn += IPF) {
 				#pragma HLS PIPELINE
-				//First column of window update.
-				if (y < kernel_size-1) {
-					//Shift window kernel values to the left.
-					window[x][y][chn] = window[x][y+1][chn];
-				}
-				if (y == kernel_size-1) {
-					//Upper right corner of window update.
-					if (x < kernel_size-1) {
-						window[x][y][chn] = input_buffer[0][0][chn];
-					}
-					//Lower right corner of window update.
-					else {
-						input_stream >> pixel_val;
-						window[x][y][chn] = pixel_val;
-					}
+				read_word(input_stream, pixel_vals);
+				for (int ipf = 0; ipf < IPF; ipf++) {
+					#pragma HLS UNROLL
+					line_buffer[x+kernel_size/2][y][chn+ipf] = pixel_vals[ipf];
 				}
 			}
 		}
 	}
+}
 
-	//Update buffer by shifting the buffer to the left and inputing new column value.
-	for (int x = 0; x < kernel_size-1; x++) {
-		for (int y = 0; y < input_size-kernel_size; y++) {
-			for (int chn = 0; chn < depth; chn++) {
-				#pragma HLS PIPELINE
-				//Shift all row buffer values to the left.
-				if (y < input_size-kernel_size-1) {
-					input_buffer[x][y][chn] = input_buffer[x][y+1][chn];
-				}
+// ############# Line Buffer and Window Update Function ############# //
+//Moves the window of output row x one column to the right, so that its last column becomes input column col.
+//top_slot is the line buffer slot of the upper window row (input row x-kernel_size/2).
+template <int kernel_size, int input_size, int depth, int IPF>
+void update_line_buffer_and_window_zeropadd(hls::stream<typename model_stream_word<IPF>::type>& input_stream, model_type_input line_buffer[kernel_size][input_size][depth], model_type_input window[kernel_size][kernel_size][depth], int x, int col, int top_slot) {
+
+	model_type_input pixel_vals[IPF];
+	#pragma HLS ARRAY_PARTITION variable=pixel_vals complete
+	int row = 0;
+	int slot = 0;
+	//Circular write pointer: the lower window row (input row x+kernel_size/2) replaces the row that just left the window.
+	int write_slot = (top_slot == 0) ? kernel_size-1 : top_slot-1;
+
+	//Read the next pixel of the lower window row, unless it lies outside the input tensor (zero padding).
+	if ((x+kernel_size/2 < input_size) and (col >= 0) and (col < input_size)) {
+		for (int chn = 0; chn < depth; chn += IPF) {
+			#pragma HLS PIPELINE
+			read_word(input_stream, pixel_vals);
+			for (int ipf = 0; ipf < IPF; ipf++) {
+				#pragma HLS UNROLL
+				line_buffer[write_slot][col][chn+ipf] = pixel_vals[ipf];
 			}
 		}
 	}
-}
-
-// ############# Zero-padding Buffer Update Function ############# //
-template <int kernel_size, int input_size, int depth>
-void update_buffer_and_window_zeropadd(hls::stream<model_type_input>& input_stream, model_type_input input_buffer[kernel_size][input_size-kernel_size+2][depth], model_type_input window[kernel_size][kernel_size][depth], int last_row, int last_col, int first_col, int max_pool_flag) {
 
-	model_type_input temporal[kernel_size-1][depth];
-
-	//Update window by shifting columns left.
-	for (int x = 0; x < kernel_size; x++) {
-		for (int y = 0; y < kernel_size; y++) {
+	//Update window by shifting columns left and loading the last column from the line buffer.
+	for (int win_x = 0; win_x < kernel_size; win_x++) {
+		row = x - kernel_size/2 + win_x;
+		slot = top_slot + win_x;
+		if (slot >= kernel_size) {
+			slot -= kernel_size;
+		}
+		for (int win_y = 0; win_y < kernel_size; win_y++) {
 			for (int chn = 0; chn < depth; chn++) {
 				#pragma HLS PIPELINE
-				if ((y == 0) and (x > 0) and (max_pool_flag == 0)) {
-					//Save first column and last two rows.
-					temporal[x-1][chn] = window[x][y][chn];
-				}
-				if (y < kernel_size-1) {
+				if (win_y < kernel_size-1) {
 					//Shift window kernel values to the left.
-					window[x][y][chn] = window[x][y+1][chn];
-				}
-				else {
-					//Update last window kernel column with first column value from Buffer.
-					window[x][y][chn] = input_buffer[x][0][chn];
+					window[win_x][win_y][chn] = window[win_x][win_y+1][chn];
 				}
-			}
-		}
-	}
-
-	model_type_input pixel_val = 0;
-	//Update buffer by shifting the buffer to the left and inputing new column value.
-	for (int x = 0; x < kernel_size; x++) {
-		for (int y = 0; y < input_size-kernel_size+2; y++) {
-			for (int chn = 0; chn < depth; chn++) {
-				#pragma HLS PIPELINE
-				//Shift all row buffer values to the left.
-				if (y < input_size-kernel_size+1) {
-					input_buffer[x][y][chn] = input_buffer[x][y+1][chn];
+				else if ((row < 0) or (row >= input_size) or (col < 0) or (col >= input_size)) {
+					//Zero padding outside the input tensor.
+					window[win_x][win_y][chn] = 0;
 				}
-				//If in last buffer column, update column values.
 				else {
-					if (max_pool_flag == 0) {
-						//For all row values except last one (2 out of 3 for the 3x3 kernel for example - upper corner), insert temporal values.
-						if (x < kernel_size-1) {
-							input_buffer[x][y][chn] = temporal[x][chn]; //x=0
-						}
-						//For the last column and last row, update with new value from stream.
-						else {
-							if (last_row != 1) {
-								//If not in last row of input tensor.
-								if (last_col == 1 or first_col == 1) {
-									//If in last column or first column insert zeros.
-									pixel_val = 0;
-								}
-								else {
-									input_stream >> pixel_val;
-								}
-								input_buffer[x][y][chn] = pixel_val;
-							}
-							//In last row of tensor, input zeros.
-							else {
-								input_buffer[x][y][chn] = 0;
-							}
-						}
-					}
+					window[win_x][win_y][chn] = line_buffer[slot][col][chn];
 				}
 			}
 		}
 	}
 }
 
-
 // ############# Transpose Buffer Initialize Function ############# //
 template <int kernel_size, int output_size, int output_depth>
 void init_tranpose_buffer(model_type_input tran_buff[kernel_size][output_size+1][output_depth], const model_type_weights bias[output_depth] ) {
@@ -203,177 +133,181 @@ void init_tranpose_buffer(model_type_input tran_buff[kernel_size][output_size+1]
 }
 
 // ############# 1D Buffer Initialize Function ############# //
-template <int depth>
-void init_1D_window(hls::stream<model_type_input>& input_stream, model_type_input window[depth]) {
+template <int depth, int IPF>
+void init_1D_window(hls::stream<typename model_stream_word<IPF>::type>& input_stream, model_type_input window[depth]) {
 
-	//Fill pixel channel values.
-	model_type_input pixel_val = 0;
-	for (int chn = 0; chn < depth; chn++) {
+	//Fill pixel channel values, IPF channels per word.
+	model_type_input pixel_vals[IPF];
+	#pragma HLS ARRAY_PARTITION variable=pixel_vals complete
+	for (int chn = 0; chn < depth; chn += IPF) {
 		#pragma HLS PIPELINE
-		input_stream >> pixel_val;
-		window[chn] = pixel_val;
+		read_word(input_stream, pixel_vals);
+		for (int ipf = 0; ipf < IPF; ipf++) {
+			#pragma HLS UNROLL
+			window[chn+ipf] = pixel_vals[ipf];
+		}
 	}
 }
 
 //############# 2D Convolutional Layer - RELU #############//
-template <int input_size, int kernel_size, int input_depth, int output_depth>
-void Conv2D_relu(hls::stream<model_type_input>& input_stream, hls::stream<model_type_output>& output_stream, const model_type_weights weight_filt[kernel_size][kernel_size][input_depth][output_depth], const model_type_weights bias[output_depth]) {
-
-	model_type_input input_buffer[kernel_size][input_size-kernel_size+2][input_depth];
+//PF (parallel filters, a divisor of output_depth) output channels are computed per pipeline iteration and written as one
+//PF-wide stream word. The weights and bias are partitioned cyclically by PF over the output channels, so each of the PF
+//filters reads its own bank. Every channel accumulates in the same order for any PF, so the results do not depend on it.
+//The input stream carries IPF (a divisor of input_depth) channels per word, the PF of the layer that writes it, so packed
+//words run from layer to layer without unpacking.
+template <int input_size, int kernel_size, int input_depth, int output_depth, int IPF, int PF>
+void Conv2D_relu(hls::stream<typename model_stream_word<IPF>::type>& input_stream, hls::stream<typename model_stream_word<PF>::type>& output_stream, const model_type_weights weight_filt[kernel_size][kernel_size][input_depth][output_depth], const model_type_weights bias[output_depth]) {
+	#pragma HLS ARRAY_PARTITION variable=weight_filt cyclic factor=PF dim=4
+	#pragma HLS ARRAY_PARTITION variable=bias cyclic factor=PF dim=1
+
+	model_type_input line_buffer[kernel_size][input_size][input_depth];
+	#pragma HLS ARRAY_PARTITION variable=line_buffer cyclic factor=IPF dim=3
 	model_type_input window[kernel_size][kernel_size][input_depth];
-	model_type_input window_conv_result = 0;
-	int last_row = 0;
-	int last_col = 0;
-	int first_col = 0;
-	int max_pool_flag = 0;
+	model_type_output window_conv_result[PF];
+	#pragma HLS ARRAY_PARTITION variable=window_conv_result complete
+	int top_slot = 0;
 
-	init_buffer_and_window_zeropadd<kernel_size, input_size, input_depth>(input_stream, input_buffer, window);
+	init_line_buffer_zeropadd<kernel_size, input_size, input_depth, IPF>(input_stream, line_buffer);
 
 	//Iterate through all rows of input tensor.
 	for (int x = 0; x < input_size; x++) {
+		//Load the left zero padding and the first columns of the row into the window.
+		for (int col = -(kernel_size/2); col < kernel_size/2; col++) {
+			update_line_buffer_and_window_zeropadd<kernel_size, input_size, input_depth, IPF>(input_stream, line_buffer, window, x, col, top_slot);
+		}
 		//Iterate through all columns of input tensor.
 		for (int y = 0; y < input_size; y++) {
-			//Convolution for every output filter and window.
-			for (int filter = 0; filter < output_depth; filter++) {
+			//Move the window to the next column.
+			update_line_buffer_and_window_zeropadd<kernel_size, input_size, input_depth, IPF>(input_stream, line_buffer, window, x, y+kernel_size/2, top_slot);
+			//Convolution for every group of PF output filters and window.
+			for (int filter = 0; filter < output_depth; filter += PF) {
 				#pragma HLS PIPELINE
-				//Convolution between window and respective output depth filter.
-				window_conv_result = 0;
-				for (int win_chn = 0; win_chn < input_depth; win_chn++) {
-					for (int win_x = 0; win_x < kernel_size; win_x++) {
-						//#pragma HLS PIPELINE //does not generate latency improvements.
-						for (int win_y = 0; win_y < kernel_size; win_y++) {
+				for (int pf = 0; pf < PF; pf++) {
+					#pragma HLS UNROLL
+					//Convolution between window and respective output depth filter.
+					window_conv_result[pf] = 0;
+					for (int win_chn = 0; win_chn < input_depth; win_chn++) {
+						for (int win_x = 0; win_x < kernel_size; win_x++) {
 							//#pragma HLS PIPELINE //does not generate latency improvements.
-							window_conv_result += weight_filt[win_x][win_y][win_chn][filter] * window[win_x][win_y][win_chn];
+							for (int win_y = 0; win_y < kernel_size; win_y++) {
+								//#pragma HLS PIPELINE //does not generate latency improvements.
+								window_conv_result[pf] += weight_filt[win_x][win_y][win_chn][filter+pf] * window[win_x][win_y][win_chn];
+							}
 						}
 					}
-				}
 
-				//Add respective bias.
-				window_conv_result += bias[filter];
+					//Add respective bias.
+					window_conv_result[pf] += bias[filter+pf];
 
-				//Apply ReLU activation function.
-				if (window_conv_result < 0) {
-					window_conv_result = 0;
+					//Apply ReLU activation function.
+					if (window_conv_result[pf] < 0) {
+						window_conv_result[pf] = 0;
+					}
 				}
 
 				//Write into sequential output_stream.
-				output_stream << window_conv_result;
+				write_word(output_stream, window_conv_result);
 
 			}
-			//Evaluate if border of input tensor.
-			if (x == (input_size-kernel_size+1) or x == (input_size-kernel_size+2)) {
-				last_row = 1;
-			}
-			else {
-				last_row = 0;
-			}
-			if (y == 0) {
-				first_col = 1;
-			}
-			else {
-				first_col = 0;
-			}
-			update_buffer_and_window_zeropadd<kernel_size, input_size, input_depth>(input_stream, input_buffer, window, last_row, last_col, first_col, max_pool_flag);
-			last_col = 0;
-		}
-		//In order to shift twice when in border section.
-		for (int sec=0; sec<kernel_size-1; sec++){
-			if (sec == (kernel_size-2)) {
-				last_col = 1;
-			}
-			else {
-				last_col = 0;
-			}
-			update_buffer_and_window_zeropadd<kernel_size, input_size, input_depth>(input_stream, input_buffer, window, last_row, last_col, first_col, max_pool_flag);
-			last_col = 0;
 		}
+		//Advance the circular read pointer: the upper window row is no longer needed.
+		top_slot = (top_slot == kernel_size-1) ? 0 : top_slot+1;
 	}
 }
 
 //############# 2DConvolutional Layer - RELU #############//
-template <int input_size, int kernel_size, int input_depth, int output_depth>
-void Conv2D_relu_2streams(hls::stream<model_type_input>& input_stream, hls::stream<model_type_output>& output_stream, hls::stream<model_type_output>& output_stream_2, const model_type_weights weight_filt[kernel_size][kernel_size][input_depth][output_depth], const model_type_weights bias[output_depth]) {
-
-	model_type_input input_buffer[kernel_size][input_size-kernel_size+2][input_depth];
+//Conv2D_relu writing its output to two streams, with the same PF output channels per stream word.
+template <int input_size, int kernel_size, int input_depth, int output_depth, int IPF, int PF>
+void Conv2D_relu_2streams(hls::stream<typename model_stream_word<IPF>::type>& input_stream, hls::stream<typename model_stream_word<PF>::type>& output_stream, hls::stream<typename model_stream_word<PF>::type>& output_stream_2, const model_type_weights weight_filt[kernel_size][kernel_size][input_depth][output_depth], const model_type_weights bias[output_depth]) {
+	#pragma HLS ARRAY_PARTITION variable=weight_filt cyclic factor=PF dim=4
+	#pragma HLS ARRAY_PARTITION variable=bias cyclic factor=PF dim=1
+
+	model_type_input line_buffer[kernel_size][input_size][input_depth];
+	#pragma HLS ARRAY_PARTITION variable=line_buffer cyclic factor=IPF dim=3
 	model_type_input window[kernel_size][kernel_size][input_depth];
-	model_type_input window_conv_result = 0;
-	int last_row = 0;
-	int last_col = 0;
-	int first_col = 0;
-	int max_pool_flag = 0;
+	model_type_output window_conv_result[PF];
+	#pragma HLS ARRAY_PARTITION variable=window_conv_result complete
+	int top_slot = 0;
 
-	init_buffer_and_window_zeropadd<kernel_size, input_size, input_depth>(input_stream, input_buffer, window);
+	init_line_buffer_zeropadd<kernel_size, input_size, input_depth, IPF>(input_stream, line_buffer);
 
 	//Iterate through all rows of input tensor.
 	for (int x = 0; x < input_size; x++) {
+		//Load the left zero padding and the first columns of the row into the window.
+		for (int col = -(kernel_size/2); col < kernel_size/2; col++) {
+			update_line_buffer_and_window_zeropadd<kernel_size, input_size, input_depth, IPF>(input_stream, line_buffer, window, x, col, top_slot);
+		}
 		//Iterate through all columns of input tensor.
 		for (int y = 0; y < input_size; y++) {
-			//Convolution for every output filter and window.
-			for (int filter = 0; filter < output_depth; filter++) {
-				#pragma HLS PIPELINE //to produce one output value per clock cycle.
-				//Convolution between window and respective output depth filter.
-				window_conv_result = 0;
-				for (int win_chn = 0; win_chn < input_depth; win_chn++) {
-					for (int win_x = 0; win_x < kernel_size; win_x++) {
-						//#pragma HLS PIPELINE //does not generate latency improvements.
-						for (int win_y = 0; win_y < kernel_size; win_y++) {
-							#pragma HLS PIPELINE //does not generate latency improvements.
-							window_conv_result += weight_filt[win_x][win_y][win_chn][filter] * window[win_x][win_y][win_chn];
+			//Move the window to the next column.
+			update_line_buffer_and_window_zeropadd<kernel_size, input_size, input_depth, IPF>(input_stream, line_buffer, window, x, y+kernel_size/2, top_slot);
+			//Convolution for every group of PF output filters and window.
+			for (int filter = 0; filter < output_depth; filter += PF) {
+				#pragma HLS PIPELINE //to produce PF output values per clock cycle.
+				for (int pf = 0; pf < PF; pf++) {
+					#pragma HLS UNROLL
+					//Convolution between window and respective output depth filter.
+					window_conv_result[pf] = 0;
+					for (int win_chn = 0; win_chn < input_depth; win_chn++) {
+						for (int win_x = 0; win_x < kernel_size; win_x++) {
+							//#pragma HLS PIPELINE //does not generate latency improvements.
+							for (int win_y = 0; win_y < kernel_size; win_y++) {
+								#pragma HLS PIPELINE //does not generate latency improvements.
+								window_conv_result[pf] += weight_filt[win_x][win_y][win_chn][filter+pf] * window[win_x][win_y][win_chn];
+							}
 						}
 					}
-				}
-				//Add respective bias.
-				window_conv_result += bias[filter];
+					//Add respective bias.
+					window_conv_result[pf] += bias[filter+pf];
 
-				//Apply ReLU activation function.
-				if (window_conv_result < 0) {
-					window_conv_result = 0;
+					//Apply ReLU activation function.
+					if (window_conv_result[pf] < 0) {
+						window_conv_result[pf] = 0;
+					}
 				}
 
 				//Write into sequential output_stream.
-				output_stream << window_conv_result;
+				write_word(output_stream, window_conv_result);
 				//Write into skip-connection output_stream.
-				output_stream_2 << window_conv_result;
+				write_word(output_stream_2, window_conv_result);
 
 			}
-			//Evaluate if border of input tensor.
-			if (x == (input_size-kernel_size+1) or x == (input_size-kernel_size+2)) {
-				last_row = 1;
-			}
-			else {
-				last_row = 0;
-			}
-			if (y == 0) {
-				first_col = 1;
-			}
-			else {
-				first_col = 0;
-			}
-			update_buffer_and_window_zeropadd<kernel_size, input_size, input_depth>(input_stream, input_buffer, window, last_row, last_col, first_col, max_pool_flag);
-			last_col = 0;
-		}
-		//In order to shift twice when in border section.
-		for (int sec=0; sec<kernel_size-1; sec++){
-			if (sec == (kernel_size-2)) {
-				last_col = 1;
-			}
-			else {
-				last_col = 0;
-			}
-			update_buffer_and_window_zeropadd<kernel_size, input_size, input_depth>(input_stream, input_buffer, window, last_row, last_col, first_col, max_pool_flag);
-			last_col = 0;
 		}
+		//Advance the circular read pointer: the upper window row is no longer needed.
+		top_slot = (top_slot == kernel_size-1) ? 0 : top_slot+1;
+	}
+}
+
+// ############# Sigmoid Output Function ############# //
+//round(255 / (1 + exp(-logit))) from a 400-entry ROM over |logit| (sigmoid_table.h), within 1 of the exact value.
+//Saturates to 0 and 255 beyond |logit| = 6.25, with no exp, divider or multiplier in the datapath.
+model_type_pixel sigmoid_pixel(model_type_output logit) {
+
+	//One more integer bit, so that the magnitude of -128 does not wrap.
+	ap_fixed<19, 9> magnitude = logit;
+	if (logit < 0) {
+		magnitude = -magnitude;
 	}
+	model_type_pixel pixel = 255;
+	const int step = (magnitude * sigmoid_table_steps).to_int();
+	if (step < sigmoid_table_size) {
+		pixel = sigmoid_table[step];
+	}
+	if (logit < 0) {
+		pixel = 255 - pixel;
+	}
+	return pixel;
 }
 
 //############# 2DConvolutional Layer - SIGMOID #############//
-template <int input_size, int kernel_size, int input_depth, int output_depth>
-void Conv2D_sigmoid(hls::stream<model_type_input>& input_stream, hls::stream<model_type_output>& output_stream, const model_type_weights weight_filt[kernel_size][kernel_size][input_depth][output_depth], const model_type_weights bias[output_depth]) {
+//The input stream carries IPF (a divisor of input_depth) channels per word.
+template <int input_size, int kernel_size, int input_depth, int output_depth, int IPF>
+void Conv2D_sigmoid(hls::stream<typename model_stream_word<IPF>::type>& input_stream, hls::stream<model_type_result>& output_stream, const model_type_weights weight_filt[kernel_size][kernel_size][input_depth][output_depth], const model_type_weights bias[output_depth]) {
 
 	model_type_input window[input_depth];
 	model_type_input window_conv_result = 0;
 
-	init_1D_window<input_depth>(input_stream, window);
+	init_1D_window<input_depth, IPF>(input_stream, window);
 
 	//Iterate through input tensor.
 	for (int x = 0; x < (input_size * input_size); x++) {
@@ -394,37 +328,48 @@ void Conv2D_sigmoid(hls::stream<model_type_input>& input_stream, hls::stream<mod
 			//Add respective bias.
 			window_conv_result += bias[filter];
 
-			//window_conv_result = 1 / (1 + exp(-window_conv_result));
+#ifdef FLARENET_PIXEL_OUTPUT
+			output_stream << sigmoid_pixel(window_conv_result);
+#else
 			output_stream << window_conv_result;
+#endif
 
 		}
 		if (x != input_size * input_size - 1) {
-			init_1D_window<input_depth>(input_stream, window);
+			init_1D_window<input_depth, IPF>(input_stream, window);
 		}
 	}
 }
 
 // ############# Depthwise Separable 2DConvolutional Layer ############# //
-template <int input_size, int kernel_size, int input_depth, int output_depth>
-void SeparableDW2D_relu(hls::stream<model_type_input>& input_stream, hls::stream<model_type_output>& output_stream, const model_type_weights weight_depth_filt[kernel_size][kernel_size][input_depth], const model_type_weights weight_point_filt[input_depth][output_depth], const model_type_weights bias[output_depth]) {
-
-	model_type_input input_buffer[kernel_size][input_size-kernel_size+2][input_depth];
+//The point-wise convolution computes PF (a divisor of output_depth) output channels per input channel and cycle and writes
+//them as one PF-wide stream word; the point-wise weights and bias are partitioned cyclically by PF over the output channels.
+template <int input_size, int kernel_size, int input_depth, int output_depth, int IPF, int PF>
+void SeparableDW2D_relu(hls::stream<typename model_stream_word<IPF>::type>& input_stream, hls::stream<typename model_stream_word<PF>::type>& output_stream, const model_type_weights weight_depth_filt[kernel_size][kernel_size][input_depth], const model_type_weights weight_point_filt[input_depth][output_depth], const model_type_weights bias[output_depth]) {
+	#pragma HLS ARRAY_PARTITION variable=weight_point_filt cyclic factor=PF dim=2
+	#pragma HLS ARRAY_PARTITION variable=bias cyclic factor=PF dim=1
+
+	model_type_input line_buffer[kernel_size][input_size][input_depth];
+	#pragma HLS ARRAY_PARTITION variable=line_buffer cyclic factor=IPF dim=3
 	model_type_input window[kernel_size][kernel_size][input_depth];
 	model_type_input depthwise_vector[input_depth];
 	model_type_input depthwise_res = 0;
-	model_type_input pointwise_res = 0;
-	model_type_input last_row = 0;
-	model_type_input last_col = 0;
-	model_type_input first_col = 0;
-	model_type_input max_pool_flag = 0;
+	model_type_output pointwise_res[PF];
+	#pragma HLS ARRAY_PARTITION variable=pointwise_res complete
+	int top_slot = 0;
 
-	init_buffer_and_window_zeropadd<kernel_size, input_size, input_depth>(input_stream, input_buffer, window);
+	init_line_buffer_zeropadd<kernel_size, input_size, input_depth, IPF>(input_stream, line_buffer);
 
 	//Iterate through all rows of input tensor.
 	for (int x = 0; x < input_size; x++) {
-		last_col = 0;
+		//Load the left zero padding and the first columns of the row into the window.
+		for (int col = -(kernel_size/2); col < kernel_size/2; col++) {
+			update_line_buffer_and_window_zeropadd<kernel_size, input_size, input_depth, IPF>(input_stream, line_buffer, window, x, col, top_slot);
+		}
 		//Iterate through all columns of input tensor.
 		for (int y = 0; y < input_size; y++) {
+			//Move the window to the next column.
+			update_line_buffer_and_window_zeropadd<kernel_size, input_size, input_depth, IPF>(input_stream, line_buffer, window, x, y+kernel_size/2, top_slot);
 			//Depth-wise convolution for every input depth filter and window.
 			for (int win_chn = 0; win_chn < input_depth; win_chn++) {
 				depthwise_res = 0;
@@ -439,76 +384,70 @@ void SeparableDW2D_relu(hls::stream<model_type_input>& input_stream, hls::stream
 				//Storing results in 1D vector for each input channel.
 				depthwise_vector[win_chn] = depthwise_res;
 			}
-			//Point-wise convolution between depthwise_vector and respective output depth filter.
-			for (int filter = 0; filter < output_depth; filter++) {
-				pointwise_res = 0;
+			//Point-wise convolution between depthwise_vector and every group of PF output depth filters.
+			for (int filter = 0; filter < output_depth; filter += PF) {
+				for (int pf = 0; pf < PF; pf++) {
+					#pragma HLS UNROLL
+					pointwise_res[pf] = 0;
+				}
 				//#pragma HLS PIPELINE //(does not improve performance, only increases resource utilization).
 				for (int win_chn = 0; win_chn < input_depth; win_chn++) {
 					#pragma HLS PIPELINE
-					pointwise_res += weight_point_filt[win_chn][filter] * depthwise_vector[win_chn];
+					//One input channel per cycle, multiplied into the PF output filters of the group.
+					for (int pf = 0; pf < PF; pf++) {
+						#pragma HLS UNROLL
+						pointwise_res[pf] += weight_point_filt[win_chn][filter+pf] * depthwise_vector[win_chn];
+					}
 				}
 
-				//Add respective bias.
-				pointwise_res += bias[filter];
+				for (int pf = 0; pf < PF; pf++) {
+					#pragma HLS UNROLL
+					//Add respective bias.
+					pointwise_res[pf] += bias[filter+pf];
 
-				//Apply ReLU activation function.
-				if (pointwise_res < 0){
-					pointwise_res = 0;
+					//Apply ReLU activation function.
+					if (pointwise_res[pf] < 0){
+						pointwise_res[pf] = 0;
+					}
 				}
 
 				//Write into sequential output_stream.
-				output_stream << pointwise_res;
+				write_word(output_stream, pointwise_res);
 
 			}
-			//Evaluate if border of input tensor.
-			if (x == (input_size-kernel_size+1) or x == (input_size-kernel_size+2)) {
-				last_row = 1;
-			}
-			else {
-				last_row = 0;
-			}
-			if (y == 0) {
-				first_col = 1;
-			}
-			else {
-				first_col = 0;
-			}
-			update_buffer_and_window_zeropadd<kernel_size, input_size, input_depth>(input_stream, input_buffer, window, last_row, last_col, first_col, max_pool_flag);
-		}
-		//In order to shift twice when in border section.
-		for (int sec=0; sec<kernel_size-1; sec++){
-			if (sec == (kernel_size-2)) {
-				last_col = 1;
-			}
-			else {
-				last_col = 0;
-			}
-			update_buffer_and_window_zeropadd<kernel_size, input_size, input_depth>(input_stream, input_buffer, window, last_row, last_col, first_col, max_pool_flag);
 		}
+		//Advance the circular read pointer: the upper window row is no longer needed.
+		top_slot = (top_slot == kernel_size-1) ? 0 : top_slot+1;
 	}
 }
 
 // ############# Depthwise Separable 2DConvolutional Layer ############# //
-template <int input_size, int kernel_size, int input_depth, int output_depth>
-void SeparableDW2D_relu_2streams(hls::stream<model_type_input>& input_stream, hls::stream<model_type_output>& output_stream, hls::stream<model_type_output>& output_stream_2, const model_type_weights weight_depth_filt[kernel_size][kernel_size][input_depth], const model_type_weights weight_point_filt[input_depth][output_depth], const model_type_weights bias[output_depth]) {
+template <int input_size, int kernel_size, int input_depth, int output_depth, int IPF, int PF>
+void SeparableDW2D_relu_2streams(hls::stream<typename model_stream_word<IPF>::type>& input_stream, hls::stream<typename model_stream_word<PF>::type>& output_stream, hls::stream<typename model_stream_word<PF>::type>& output_stream_2, const model_type_weights weight_depth_filt[kernel_size][kernel_size][input_depth], const model_type_weights weight_point_filt[input_depth][output_depth], const model_type_weights bias[output_depth]) {
+	#pragma HLS ARRAY_PARTITION variable=weight_point_filt cyclic factor=PF dim=2
+	#pragma HLS ARRAY_PARTITION variable=bias cyclic factor=PF dim=1
 
-	model_type_input input_buffer[kernel_size][input_size-kernel_size+2][input_depth];
+	model_type_input line_buffer[kernel_size][input_size][input_depth];
+	#pragma HLS ARRAY_PARTITION variable=line_buffer cyclic factor=IPF dim=3
 	model_type_input window[kernel_size][kernel_size][input_depth];
 	model_type_input depthwise_vector[input_depth];
 	model_type_input depthwise_res = 0;
-	model_type_input pointwise_res = 0;
-	model_type_input last_row = 0;
-	model_type_input last_col = 0;
-	model_type_input first_col = 0;
-	model_type_input max_pool_flag = 0;
+	model_type_output pointwise_res[PF];
+	#pragma HLS ARRAY_PARTITION variable=pointwise_res complete
+	int top_slot = 0;
 
-	init_buffer_and_window_zeropadd<kernel_size, input_size, input_depth>(input_stream, input_buffer, window);
+	init_line_buffer_zeropadd<kernel_size, input_size, input_depth, IPF>(input_stream, line_buffer);
 
 	//Iterate through all rows of input tensor.
 	for (int x = 0; x < input_size; x++) {
-		last_col = 0;
+		//Load the left zero padding and the first columns of the row into the window.
+		for (int col = -(kernel_size/2); col < kernel_size/2; col++) {
+			update_line_buffer_and_window_zeropadd<kernel_size, input_size, input_depth, IPF>(input_stream, line_buffer, window, x, col, top_slot);
+		}
 		//Iterate through all columns of input tensor.
 		for (int y = 0; y < input_size; y++) {
+			//Move the window to the next column.
+			update_line_buffer_and_window_zeropadd<kernel_size, input_size, input_depth, IPF>(input_stream, line_buffer, window, x, y+kernel_size/2, top_slot);
 			//Depth-wise convolution for every input depth filter and window.
 			for (int win_chn = 0; win_chn < input_depth; win_chn++) {
 				depthwise_res = 0;
@@ -523,65 +462,350 @@ void SeparableDW2D_relu_2streams(hls::stream<model_type_input>& input_stream, hl
 				//Storing results in 1D vector.
 				depthwise_vector[win_chn] = depthwise_res;
 			}
-			//Point-wise convolution between depthwise_vector and respective output depth filter.
-			for (int filter = 0; filter < output_depth; filter++) {
+			//Point-wise convolution between depthwise_vector and every group of PF output depth filters.
+			for (int filter = 0; filter < output_depth; filter += PF) {
+				for (int pf = 0; pf < PF; pf++) {
+					#pragma HLS UNROLL
+					pointwise_res[pf] = 0;
+				}
 				//#pragma HLS PIPELINE //(does not improve performance, only increases resource utilization).
-				pointwise_res = 0;
 				for (int win_chn = 0; win_chn < input_depth; win_chn++) {
 					#pragma HLS PIPELINE
-					pointwise_res += weight_point_filt[win_chn][filter] * depthwise_vector[win_chn];
+					//One input channel per cycle, multiplied into the PF output filters of the group.
+					for (int pf = 0; pf < PF; pf++) {
+						#pragma HLS UNROLL
+						pointwise_res[pf] += weight_point_filt[win_chn][filter+pf] * depthwise_vector[win_chn];
+					}
 				}
 
-				//Add respective bias.
-				pointwise_res += bias[filter];
+				for (int pf = 0; pf < PF; pf++) {
+					#pragma HLS UNROLL
+					//Add respective bias.
+					pointwise_res[pf] += bias[filter+pf];
 
-				//Apply ReLU activation function.
-				if (pointwise_res < 0){
-					pointwise_res = 0;
+					//Apply ReLU activation function.
+					if (pointwise_res[pf] < 0){
+						pointwise_res[pf] = 0;
+					}
 				}
 
 				//Write into sequential output_stream.
-				output_stream << pointwise_res;
+				write_word(output_stream, pointwise_res);
 				//Write into skip-connection output_stream.
-				output_stream_2 << pointwise_res;
+				write_word(output_stream_2, pointwise_res);
 
 			}
-			//Evaluate if border of input tensor.
-			if (x == (input_size-kernel_size+1) or x == (input_size-kernel_size+2)) {
-				last_row = 1;
-			}
-			else {
-				last_row = 0;
+		}
+		//Advance the circular read pointer: the upper window row is no longer needed.
+		top_slot = (top_slot == kernel_size-1) ? 0 : top_slot+1;
+	}
+}
+
+
+//############# 2DConvolutional Layer - RELU + 2D Max Pooling #############//
+//Conv2D_relu_2streams fused with the following MaxPooling2D<input_size, pool_size, output_depth>: output_stream carries
+//the pooled tensor and only the skip-connection output_stream_2 carries the full-resolution activation. The maximum of
+//every pooling window is kept per column in maxpool_buff while the pool_size rows of the window are computed. Both
+//streams carry PF output channels per word, as in Conv2D_relu.
+template <int input_size, int kernel_size, int input_depth, int output_depth, int pool_size, int IPF, int PF>
+void Conv2D_relu_maxpool_2streams(hls::stream<typename model_stream_word<IPF>::type>& input_stream, hls::stream<typename model_stream_word<PF>::type>& output_stream, hls::stream<typename model_stream_word<PF>::type>& output_stream_2, const model_type_weights weight_filt[kernel_size][kernel_size][input_depth][output_depth], const model_type_weights bias[output_depth]) {
+	#pragma HLS ARRAY_PARTITION variable=weight_filt cyclic factor=PF dim=4
+	#pragma HLS ARRAY_PARTITION variable=bias cyclic factor=PF dim=1
+
+	model_type_input line_buffer[kernel_size][input_size][input_depth];
+	#pragma HLS ARRAY_PARTITION variable=line_buffer cyclic factor=IPF dim=3
+	model_type_input maxpool_buff[input_size/pool_size][output_depth];
+	#pragma HLS ARRAY_PARTITION variable=maxpool_buff cyclic factor=PF dim=2
+	model_type_input window[kernel_size][kernel_size][input_depth];
+	model_type_output window_conv_result[PF];
+	model_type_output pooled_result[PF];
+	#pragma HLS ARRAY_PARTITION variable=window_conv_result complete
+	#pragma HLS ARRAY_PARTITION variable=pooled_result complete
+	int top_slot = 0;
+
+	init_line_buffer_zeropadd<kernel_size, input_size, input_depth, IPF>(input_stream, line_buffer);
+
+	//Iterate through all rows of input tensor.
+	for (int x = 0; x < input_size; x++) {
+		//Load the left zero padding and the first columns of the row into the window.
+		for (int col = -(kernel_size/2); col < kernel_size/2; col++) {
+			update_line_buffer_and_window_zeropadd<kernel_size, input_size, input_depth, IPF>(input_stream, line_buffer, window, x, col, top_slot);
+		}
+		//Iterate through all columns of input tensor.
+		for (int y = 0; y < input_size; y++) {
+			//Move the window to the next column.
+			update_line_buffer_and_window_zeropadd<kernel_size, input_size, input_depth, IPF>(input_stream, line_buffer, window, x, y+kernel_size/2, top_slot);
+			//Convolution for every group of PF output filters and window.
+			for (int filter = 0; filter < output_depth; filter += PF) {
+				#pragma HLS PIPELINE //to produce PF output values per clock cycle.
+				for (int pf = 0; pf < PF; pf++) {
+					#pragma HLS UNROLL
+					//Convolution between window and respective output depth filter.
+					window_conv_result[pf] = 0;
+					for (int win_chn = 0; win_chn < input_depth; win_chn++) {
+						for (int win_x = 0; win_x < kernel_size; win_x++) {
+							//#pragma HLS PIPELINE //does not generate latency improvements.
+							for (int win_y = 0; win_y < kernel_size; win_y++) {
+								#pragma HLS PIPELINE //does not generate latency improvements.
+								window_conv_result[pf] += weight_filt[win_x][win_y][win_chn][filter+pf] * window[win_x][win_y][win_chn];
+							}
+						}
+					}
+					//Add respective bias.
+					window_conv_result[pf] += bias[filter+pf];
+
+					//Apply ReLU activation function.
+					if (window_conv_result[pf] < 0) {
+						window_conv_result[pf] = 0;
+					}
+				}
+
+				//Write into skip-connection output_stream.
+				write_word(output_stream_2, window_conv_result);
+
+				for (int pf = 0; pf < PF; pf++) {
+					#pragma HLS UNROLL
+					//Max pooling: the first value of a pooling window initializes the pooling buffer, the others keep the maximum.
+					if ((x%pool_size == 0) and (y%pool_size == 0)) {
+						maxpool_buff[y/pool_size][filter+pf] = window_conv_result[pf];
+					}
+					else if (maxpool_buff[y/pool_size][filter+pf] < window_conv_result[pf]) {
+						maxpool_buff[y/pool_size][filter+pf] = window_conv_result[pf];
+					}
+					pooled_result[pf] = maxpool_buff[y/pool_size][filter+pf];
+				}
+				//Write the pooled values into output_stream once their window is complete.
+				if ((x%pool_size == pool_size-1) and (y%pool_size == pool_size-1)) {
+					write_word(output_stream, pooled_result);
+				}
+
 			}
-			if (y == 0) {
-				first_col = 1;
+		}
+		//Advance the circular read pointer: the upper window row is no longer needed.
+		top_slot = (top_slot == kernel_size-1) ? 0 : top_slot+1;
+	}
+}
+
+// ############# Depthwise Separable 2DConvolutional Layer + 2D Max Pooling ############# //
+//SeparableDW2D_relu fused with the following MaxPooling2D<input_size, pool_size, output_depth>: output_stream carries
+//the pooled tensor, so the full-resolution activation never goes through a stream FIFO. The maximum of every pooling
+//window is kept per column in maxpool_buff while the pool_size rows of the window are computed.
+template <int input_size, int kernel_size, int input_depth, int output_depth, int pool_size, int IPF, int PF>
+void SeparableDW2D_relu_maxpool(hls::stream<typename model_stream_word<IPF>::type>& input_stream, hls::stream<typename model_stream_word<PF>::type>& output_stream, const model_type_weights weight_depth_filt[kernel_size][kernel_size][input_depth], const model_type_weights weight_point_filt[input_depth][output_depth], const model_type_weights bias[output_depth]) {
+	#pragma HLS ARRAY_PARTITION variable=weight_point_filt cyclic factor=PF dim=2
+	#pragma HLS ARRAY_PARTITION variable=bias cyclic factor=PF dim=1
+
+	model_type_input line_buffer[kernel_size][input_size][input_depth];
+	#pragma HLS ARRAY_PARTITION variable=line_buffer cyclic factor=IPF dim=3
+	model_type_input maxpool_buff[input_size/pool_size][output_depth];
+	#pragma HLS ARRAY_PARTITION variable=maxpool_buff cyclic factor=PF dim=2
+	model_type_input window[kernel_size][kernel_size][input_depth];
+	model_type_input depthwise_vector[input_depth];
+	model_type_input depthwise_res = 0;
+	model_type_output pointwise_res[PF];
+	model_type_output pooled_result[PF];
+	#pragma HLS ARRAY_PARTITION variable=pointwise_res complete
+	#pragma HLS ARRAY_PARTITION variable=pooled_result complete
+	int top_slot = 0;
+
+	init_line_buffer_zeropadd<kernel_size, input_size, input_depth, IPF>(input_stream, line_buffer);
+
+	//Iterate through all rows of input tensor.
+	for (int x = 0; x < input_size; x++) {
+		//Load the left zero padding and the first columns of the row into the window.
+		for (int col = -(kernel_size/2); col < kernel_size/2; col++) {
+			update_line_buffer_and_window_zeropadd<kernel_size, input_size, input_depth, IPF>(input_stream, line_buffer, window, x, col, top_slot);
+		}
+		//Iterate through all columns of input tensor.
+		for (int y = 0; y < input_size; y++) {
+			//Move the window to the next column.
+			update_line_buffer_and_window_zeropadd<kernel_size, input_size, input_depth, IPF>(input_stream, line_buffer, window, x, y+kernel_size/2, top_slot);
+			//Depth-wise convolution for every input depth filter and window.
+			for (int win_chn = 0; win_chn < input_depth; win_chn++) {
+				depthwise_res = 0;
+				//#pragma HLS PIPELINE (does not improve performance, only increases resource utilization).
+				for (int win_x = 0; win_x < kernel_size; win_x++) {
+					//#pragma HLS PIPELINE (does not improve performance, only increases resource utilization).
+					for (int win_y = 0; win_y < kernel_size; win_y++) {
+					#pragma HLS PIPELINE
+					depthwise_res += weight_depth_filt[win_x][win_y][win_chn] * window[win_x][win_y][win_chn];
+					}
+				}
+				//Storing results in 1D vector for each input channel.
+				depthwise_vector[win_chn] = depthwise_res;
 			}
-			else {
-				first_col = 0;
+			//Point-wise convolution between depthwise_vector and every group of PF output depth filters.
+			for (int filter = 0; filter < output_depth; filter += PF) {
+				for (int pf = 0; pf < PF; pf++) {
+					#pragma HLS UNROLL
+					pointwise_res[pf] = 0;
+				}
+				//#pragma HLS PIPELINE //(does not improve performance, only increases resource utilization).
+				for (int win_chn = 0; win_chn < input_depth; win_chn++) {
+					#pragma HLS PIPELINE
+					//One input channel per cycle, multiplied into the PF output filters of the group.
+					for (int pf = 0; pf < PF; pf++) {
+						#pragma HLS UNROLL
+						pointwise_res[pf] += weight_point_filt[win_chn][filter+pf] * depthwise_vector[win_chn];
+					}
+				}
+
+				for (int pf = 0; pf < PF; pf++) {
+					#pragma HLS UNROLL
+					//Add respective bias.
+					pointwise_res[pf] += bias[filter+pf];
+
+					//Apply ReLU activation function.
+					if (pointwise_res[pf] < 0){
+						pointwise_res[pf] = 0;
+					}
+				}
+
+				for (int pf = 0; pf < PF; pf++) {
+					#pragma HLS UNROLL
+					//Max pooling: the first value of a pooling window initializes the pooling buffer, the others keep the maximum.
+					if ((x%pool_size == 0) and (y%pool_size == 0)) {
+						maxpool_buff[y/pool_size][filter+pf] = pointwise_res[pf];
+					}
+					else if (maxpool_buff[y/pool_size][filter+pf] < pointwise_res[pf]) {
+						maxpool_buff[y/pool_size][filter+pf] = pointwise_res[pf];
+					}
+					pooled_result[pf] = maxpool_buff[y/pool_size][filter+pf];
+				}
+				//Write the pooled values into output_stream once their window is complete.
+				if ((x%pool_size == pool_size-1) and (y%pool_size == pool_size-1)) {
+					write_word(output_stream, pooled_result);
+				}
+
 			}
-			update_buffer_and_window_zeropadd<kernel_size, input_size, input_depth>(input_stream, input_buffer, window, last_row, last_col, first_col, max_pool_flag);
 		}
-		//In order to shift twice when in border section.
-		for (int sec=0; sec<kernel_size-1; sec++){
-			if (sec == (kernel_size-2)) {
-				last_col = 1;
+		//Advance the circular read pointer: the upper window row is no longer needed.
+		top_slot = (top_slot == kernel_size-1) ? 0 : top_slot+1;
+	}
+}
+
+// ############# Depthwise Separable 2DConvolutional Layer + 2D Max Pooling ############# //
+//SeparableDW2D_relu_2streams fused with the following MaxPooling2D<input_size, pool_size, output_depth>: output_stream carries
+//the pooled tensor and only the skip-connection output_stream_2 carries the full-resolution activation. The maximum of
+//every pooling window is kept per column in maxpool_buff while the pool_size rows of the window are computed.
+template <int input_size, int kernel_size, int input_depth, int output_depth, int pool_size, int IPF, int PF>
+void SeparableDW2D_relu_maxpool_2streams(hls::stream<typename model_stream_word<IPF>::type>& input_stream, hls::stream<typename model_stream_word<PF>::type>& output_stream, hls::stream<typename model_stream_word<PF>::type>& output_stream_2, const model_type_weights weight_depth_filt[kernel_size][kernel_size][input_depth], const model_type_weights weight_point_filt[input_depth][output_depth], const model_type_weights bias[output_depth]) {
+	#pragma HLS ARRAY_PARTITION variable=weight_point_filt cyclic factor=PF dim=2
+	#pragma HLS ARRAY_PARTITION variable=bias cyclic factor=PF dim=1
+
+	model_type_input line_buffer[kernel_size][input_size][input_depth];
+	#pragma HLS ARRAY_PARTITION variable=line_buffer cyclic factor=IPF dim=3
+	model_type_input maxpool_buff[input_size/pool_size][output_depth];
+	#pragma HLS ARRAY_PARTITION variable=maxpool_buff cyclic factor=PF dim=2
+	model_type_input window[kernel_size][kernel_size][input_depth];
+	model_type_input depthwise_vector[input_depth];
+	model_type_input depthwise_res = 0;
+	model_type_output pointwise_res[PF];
+	model_type_output pooled_result[PF];
+	#pragma HLS ARRAY_PARTITION variable=pointwise_res complete
+	#pragma HLS ARRAY_PARTITION variable=pooled_result complete
+	int top_slot = 0;
+
+	init_line_buffer_zeropadd<kernel_size, input_size, input_depth, IPF>(input_stream, line_buffer);
+
+	//Iterate through all rows of input tensor.
+	for (int x = 0; x < input_size; x++) {
+		//Load the left zero padding and the first columns of the row into the window.
+		for (int col = -(kernel_size/2); col < kernel_size/2; col++) {
+			update_line_buffer_and_window_zeropadd<kernel_size, input_size, input_depth, IPF>(input_stream, line_buffer, window, x, col, top_slot);
+		}
+		//Iterate through all columns of input tensor.
+		for (int y = 0; y < input_size; y++) {
+			//Move the window to the next column.
+			update_line_buffer_and_window_zeropadd<kernel_size, input_size, input_depth, IPF>(input_stream, line_buffer, window, x, y+kernel_size/2, top_slot);
+			//Depth-wise convolution for every input depth filter and window.
+			for (int win_chn = 0; win_chn < input_depth; win_chn++) {
+				depthwise_res = 0;
+				//#pragma HLS PIPELINE (does not improve performance, only increases resource utilization).
+				for (int win_x = 0; win_x < kernel_size; win_x++) {
+					//#pragma HLS PIPELINE (does not improve performance, only increases resource utilization).
+					for (int win_y = 0; win_y < kernel_size; win_y++) {
+					#pragma HLS PIPELINE
+					depthwise_res += weight_depth_filt[win_x][win_y][win_chn] * window[win_x][win_y][win_chn];
+					}
+				}
+				//Storing results in 1D vector.
+				depthwise_vector[win_chn] = depthwise_res;
 			}
-			else {
-				last_col = 0;
+			//Point-wise convolution between depthwise_vector and every group of PF output depth filters.
+			for (int filter = 0; filter < output_depth; filter += PF) {
+				for (int pf = 0; pf < PF; pf++) {
+					#pragma HLS UNROLL
+					pointwise_res[pf] = 0;
+				}
+				//#pragma HLS PIPELINE //(does not improve performance, only increases resource utilization).
+				for (int win_chn = 0; win_chn < input_depth; win_chn++) {
+					#pragma HLS PIPELINE
+					//One input channel per cycle, multiplied into the PF output filters of the group.
+					for (int pf = 0; pf < PF; pf++) {
+						#pragma HLS UNROLL
+						pointwise_res[pf] += weight_point_filt[win_chn][filter+pf] * depthwise_vector[win_chn];
+					}
+				}
+
+				for (int pf = 0; pf < PF; pf++) {
+					#pragma HLS UNROLL
+					//Add respective bias.
+					pointwise_res[pf] += bias[filter+pf];
+
+					//Apply ReLU activation function.
+					if (pointwise_res[pf] < 0){
+						pointwise_res[pf] = 0;
+					}
+				}
+
+				//Write into skip-connection output_stream.
+				write_word(output_stream_2, pointwise_res);
+
+				for (int pf = 0; pf < PF; pf++) {
+					#pragma HLS UNROLL
+					//Max pooling: the first value of a pooling window initializes the pooling buffer, the others keep the maximum.
+					if ((x%pool_size == 0) and (y%pool_size == 0)) {
+						maxpool_buff[y/pool_size][filter+pf] = pointwise_res[pf];
+					}
+					else if (maxpool_buff[y/pool_size][filter+pf] < pointwise_res[pf]) {
+						maxpool_buff[y/pool_size][filter+pf] = pointwise_res[pf];
+					}
+					pooled_result[pf] = maxpool_buff[y/pool_size][filter+pf];
+				}
+				//Write the pooled values into output_stream once their window is complete.
+				if ((x%pool_size == pool_size-1) and (y%pool_size == pool_size-1)) {
+					write_word(output_stream, pooled_result);
+				}
+
 			}
-			update_buffer_and_window_zeropadd<kernel_size, input_size, input_depth>(input_stream, input_buffer, window, last_row, last_col, first_col, max_pool_flag);
 		}
+		//Advance the circular read pointer: the upper window row is no longer needed.
+		top_slot = (top_slot == kernel_size-1) ? 0 : top_slot+1;
 	}
 }
 
 
 // ############# Transposed 2D Convolutional Layer ############# //
-template <int output_size, int kernel_size, int stride, int input_depth, int output_depth>
-void Conv2D_transposed(hls::stream<model_type_input>& input_stream, hls::stream<model_type_output>& output_stream, const model_type_weights weight_filt[kernel_size][kernel_size][output_depth][input_depth], const model_type_weights bias[output_depth]) {
+//PF (a divisor of output_depth) output channels are accumulated per input channel and cycle, and the rows leaving the
+//transpose buffer are written PF channels per stream word. The weights, bias and transpose buffer are partitioned
+//cyclically by PF over the output channels, so each of the PF filters reads and updates its own bank. Every input pixel
+//is read IPF channels per word, as in Conv2D_relu.
+template <int output_size, int kernel_size, int stride, int input_depth, int output_depth, int IPF, int PF>
+void Conv2D_transposed(hls::stream<typename model_stream_word<IPF>::type>& input_stream, hls::stream<typename model_stream_word<PF>::type>& output_stream, const model_type_weights weight_filt[kernel_size][kernel_size][output_depth][input_depth], const model_type_weights bias[output_depth]) {
+	#pragma HLS ARRAY_PARTITION variable=weight_filt cyclic factor=PF dim=3
+	#pragma HLS ARRAY_PARTITION variable=bias cyclic factor=PF dim=1
 
 	model_type_input pixel_vec[input_depth];
+	#pragma HLS ARRAY_PARTITION variable=pixel_vec cyclic factor=IPF
+	model_type_input pixel_vals[IPF];
+	#pragma HLS ARRAY_PARTITION variable=pixel_vals complete
 	model_type_input tran_buff[kernel_size][output_size+1][output_depth];
-	model_type_input conv_res = 0;
+	#pragma HLS ARRAY_PARTITION variable=tran_buff cyclic factor=PF dim=3
+	model_type_output conv_res[PF];
+	model_type_output output_res[PF];
+	#pragma HLS ARRAY_PARTITION variable=conv_res complete
+	#pragma HLS ARRAY_PARTITION variable=output_res complete
 
 	init_tranpose_buffer<kernel_size, output_size, output_depth>(tran_buff, bias);
 
@@ -589,21 +813,34 @@ void Conv2D_transposed(hls::stream<model_type_input>& input_stream, hls::stream<
 	for (int x = 0; x < output_size; x += stride) {
 		//Iterate through all columns of input tensor.
 		for (int y = 0; y < output_size; y += stride) {
-				//Read pixel channel values.
-				for (int chn = 0; chn < input_depth; chn++) {
+				//Read pixel channel values, IPF channels per word.
+				for (int chn = 0; chn < input_depth; chn += IPF) {
 					#pragma HLS PIPELINE
-					input_stream >> pixel_vec[chn];
+					read_word(input_stream, pixel_vals);
+					for (int ipf = 0; ipf < IPF; ipf++) {
+						#pragma HLS UNROLL
+						pixel_vec[chn+ipf] = pixel_vals[ipf];
+					}
 			}
-			//Convolution for every output filter and input pixel values.
-			for (int filter = 0; filter < output_depth; filter++) {
+			//Convolution for every group of PF output filters and input pixel values.
+			for (int filter = 0; filter < output_depth; filter += PF) {
 				for (int win_x = 0; win_x < kernel_size; win_x++) {
 					for (int win_y = 0; win_y < kernel_size; win_y++) {
-						conv_res = 0;
+						for (int pf = 0; pf < PF; pf++) {
+							#pragma HLS UNROLL
+							conv_res[pf] = 0;
+						}
 						for (int win_chn = 0; win_chn < input_depth; win_chn++) {
 							#pragma HLS PIPELINE
-							conv_res += weight_filt[win_x][win_y][filter][win_chn] * pixel_vec[win_chn];
+							for (int pf = 0; pf < PF; pf++) {
+								#pragma HLS UNROLL
+								conv_res[pf] += weight_filt[win_x][win_y][filter+pf][win_chn] * pixel_vec[win_chn];
+							}
+						}
+						for (int pf = 0; pf < PF; pf++) {
+							#pragma HLS UNROLL
+							tran_buff[win_x][y+win_y][filter+pf] += conv_res[pf];
 						}
-						tran_buff[win_x][y+win_y][filter] += conv_res;
 					}
 				}
 			}
@@ -611,35 +848,29 @@ void Conv2D_transposed(hls::stream<model_type_input>& input_stream, hls::stream<
 
 		for (int tran_x = 0; tran_x < kernel_size; tran_x++) {
 			for (int tran_y = 0; tran_y < output_size; tran_y++) {
-				for (int tran_f = 0; tran_f < output_depth; tran_f++) {
+				for (int tran_f = 0; tran_f < output_depth; tran_f += PF) {
 					#pragma HLS PIPELINE
-					//If first row, then write to output stream and shift last kernel row to first row.
-					if (tran_x == 0) {
-						//Apply ReLU activation function.
-						if (tran_buff[tran_x][tran_y][tran_f] < 0) {
-							//Write into sequential output_stream.
-							output_stream  << 0;
+					for (int pf = 0; pf < PF; pf++) {
+						#pragma HLS UNROLL
+						//Apply ReLU activation function to the rows written to the output stream (first and middle row).
+						if (tran_buff[tran_x][tran_y][tran_f+pf] < 0) {
+							output_res[pf] = 0;
 						}
 						else {
-							//Write into sequential output_stream.
-							output_stream << tran_buff[tran_x][tran_y][tran_f];
+							output_res[pf] = tran_buff[tran_x][tran_y][tran_f+pf];
 						}
-						tran_buff[tran_x][tran_y][tran_f] = tran_buff[tran_x+stride][tran_y][tran_f];
-					}
-					//If middle row, then write to output and change to bias value.
-					else if (tran_x == 1) {
-						//Apply ReLU activation function.
-						if (tran_buff[tran_x][tran_y][tran_f] < 0) {
-							output_stream  << 0;
+						//If first row, then shift last kernel row to first row.
+						if (tran_x == 0) {
+							tran_buff[tran_x][tran_y][tran_f+pf] = tran_buff[tran_x+stride][tran_y][tran_f+pf];
 						}
+						//If middle or last row, then change to bias value.
 						else {
-							output_stream << tran_buff[tran_x][tran_y][tran_f];
+							tran_buff[tran_x][tran_y][tran_f+pf] = bias[tran_f+pf];
 						}
-						tran_buff[tran_x][tran_y][tran_f] = bias[tran_f];
 					}
-					//If last row, then change to bias value.
-					else {
-						tran_buff[tran_x][tran_y][tran_f] = bias[tran_f];
+					//Write first and middle row into sequential output_stream.
+					if (tran_x < 2) {
+						write_word(output_stream, output_res);
 					}
 				//Reset last col in buffer to avoid overfloating.
 				//tran_buff[tran_x][tran_y+1][tran_f] = 0;
@@ -650,102 +881,249 @@ void Conv2D_transposed(hls::stream<model_type_input>& input_stream, hls::stream<
 }
 
 // ############# 2D Max Pooling Layer ############# //
-template <int input_size, int pool_size, int depth>
-void MaxPooling2D(hls::stream<model_type_input>& input_stream, hls::stream<model_type_output>& output_stream) {
-
-	model_type_input input_buffer[pool_size-1][input_size-pool_size][depth];
-	model_type_input window[pool_size][pool_size][depth];
-	model_type_input maxpool_val = 0;
-	int last_col = 0;
-
-	init_buffer_and_window_maxpool<pool_size, input_size, depth>(input_stream, input_buffer, window);
-
-	//Iterate through all rows of input tensor.
+//Not instantiated by FlareNet(), whose convolutions pool on the fly (see Conv2D_relu_maxpool_2streams); kept for other
+//topologies. Pooling is channel-wise, so the input and output streams carry the same PF (a divisor of depth) channels
+//per word and PF windows are completed in parallel; a Repack<..., IPF, PF> in front adapts a producer with another IPF.
+template <int input_size, int pool_size, int depth, int PF>
+void MaxPooling2D(hls::stream<typename model_stream_word<PF>::type>& input_stream, hls::stream<typename model_stream_word<PF>::type>& output_stream) {
+
+	//Pooling windows do not overlap, so the line buffer only keeps the first pool_size-1 rows of each window row.
+	model_type_input line_buffer[pool_size-1][input_size][depth];
+	model_type_input maxpool_vec[depth];
+	model_type_input pixel_vals[PF];
+	model_type_output pooled_result[PF];
+	#pragma HLS ARRAY_PARTITION variable=line_buffer cyclic factor=PF dim=3
+	#pragma HLS ARRAY_PARTITION variable=maxpool_vec cyclic factor=PF dim=1
+	#pragma HLS ARRAY_PARTITION variable=pixel_vals complete
+	#pragma HLS ARRAY_PARTITION variable=pooled_result complete
+
+	//Iterate through all window rows of input tensor.
 	for (int x = 0; x < (input_size/pool_size); x++) {
-		//Iterate through all columns of input tensor.
-		for (int y = 0; y < input_size-pool_size+1; y++) {
-			if (y%pool_size == 0) { // The window has moved by one stride.
-				//Calculate max value per channel.
-				for (int win_chn = 0; win_chn < depth; win_chn++) {
+		//Store the upper rows of the pooling windows.
+		for (int win_x = 0; win_x < pool_size-1; win_x++) {
+			for (int y = 0; y < input_size; y++) {
+				for (int chn = 0; chn < depth; chn += PF) {
 					#pragma HLS PIPELINE
-					maxpool_val = 0;
-					for (int win_x = 0; win_x < pool_size; win_x++) {
-						#pragma HLS PIPELINE
-						for (int win_y = 0; win_y < pool_size; win_y++) {
-								if (maxpool_val < window[win_x][win_y][win_chn] ) {
-									maxpool_val = window[win_x][win_y][win_chn];
+					read_word(input_stream, pixel_vals);
+					for (int pf = 0; pf < PF; pf++) {
+						#pragma HLS UNROLL
+						line_buffer[win_x][y][chn+pf] = pixel_vals[pf];
+					}
+				}
+			}
+		}
+		//Complete every pooling window while its last row is read.
+		for (int y = 0; y < input_size; y++) {
+			for (int win_chn = 0; win_chn < depth; win_chn += PF) {
+				#pragma HLS PIPELINE
+				read_word(input_stream, pixel_vals);
+				for (int pf = 0; pf < PF; pf++) {
+					#pragma HLS UNROLL
+					if (y%pool_size == 0) { // The window has moved by one stride.
+						//Calculate max value of the buffered rows.
+						maxpool_vec[win_chn+pf] = 0;
+						for (int win_x = 0; win_x < pool_size-1; win_x++) {
+							for (int win_y = 0; win_y < pool_size; win_y++) {
+								if (maxpool_vec[win_chn+pf] < line_buffer[win_x][y+win_y][win_chn+pf]) {
+									maxpool_vec[win_chn+pf] = line_buffer[win_x][y+win_y][win_chn+pf];
 								}
 							}
 						}
+					}
+					if (maxpool_vec[win_chn+pf] < pixel_vals[pf]) {
+						maxpool_vec[win_chn+pf] = pixel_vals[pf];
+					}
+					pooled_result[pf] = maxpool_vec[win_chn+pf];
+				}
+				if (y%pool_size == pool_size-1) {
 					//Write into sequential output_stream.
-					output_stream << maxpool_val;
+					write_word(output_stream, pooled_result);
 				}
 			}
-			if (y != input_size-pool_size) {
-				//Shift window and buffer, no new reads.
-				update_buffer_and_window_maxpool<pool_size, input_size, depth>(input_stream, input_buffer, window);
-			}
-		}
-		//Load next block of 2 rows.
-		if (x != ((input_size/pool_size)-1)) {
-			init_buffer_and_window_maxpool<pool_size, input_size, depth>(input_stream, input_buffer, window);
 		}
 	}
 }
 
 // ############# 2D Adding Layer ############# //
-template <int input_size, int depth>
-void Add(hls::stream<model_type_input>& input_stream_1, hls::stream<model_type_input>& input_stream_2, hls::stream<model_type_output>& output_stream) {
+//Both input streams and the output stream carry PF (a divisor of depth) channels per word, added in parallel.
+template <int input_size, int depth, int PF>
+void Add(hls::stream<typename model_stream_word<PF>::type>& input_stream_1, hls::stream<typename model_stream_word<PF>::type>& input_stream_2, hls::stream<typename model_stream_word<PF>::type>& output_stream) {
 
-	model_type_input pixel_val_1 = 0;
-	model_type_input pixel_val_2 = 0;
-	model_type_input adding_result = 0;
+	model_type_input pixel_vals_1[PF];
+	model_type_input pixel_vals_2[PF];
+	model_type_output adding_result[PF];
+	#pragma HLS ARRAY_PARTITION variable=pixel_vals_1 complete
+	#pragma HLS ARRAY_PARTITION variable=pixel_vals_2 complete
+	#pragma HLS ARRAY_PARTITION variable=adding_result complete
 
 	//Iterate through all rows of input tensor.
 	for (int x = 0; x < input_size; x++) {
 		//Iterate through all columns of input tensor.
 		for (int y = 0; y < input_size; y++) {
-			for (int win_chn = 0; win_chn < depth; win_chn++) {
+			for (int win_chn = 0; win_chn < depth; win_chn += PF) {
 				#pragma HLS PIPELINE
-				input_stream_1 >> pixel_val_1;
-				input_stream_2 >> pixel_val_2;
-				adding_result = pixel_val_1 + pixel_val_2;
-				//Apply ReLU activation function.
-				if (adding_result < 0) {
-					adding_result = 0;
+				read_word(input_stream_1, pixel_vals_1);
+				read_word(input_stream_2, pixel_vals_2);
+				for (int pf = 0; pf < PF; pf++) {
+					#pragma HLS UNROLL
+					adding_result[pf] = pixel_vals_1[pf] + pixel_vals_2[pf];
+					//Apply ReLU activation function.
+					if (adding_result[pf] < 0) {
+						adding_result[pf] = 0;
+					}
 				}
 
 				//Write into sequential output_stream.
-				output_stream << adding_result;
+				write_word(output_stream, adding_result);
 
 			}
 		}
 	}
 }
 
-void FlareNet(model_type_input input_image[196608], model_type_output output_image[196608]) {
+// ############# Stream Word Repacking Layer ############# //
+//Converts a stream of IPF channels per word into a stream of PF channels per word (divisors of depth, one a multiple of
+//the other, 1 for a scalar stream), for two layers whose word widths differ. The channel order is unchanged. Every iteration moves the channels of
+//the narrower word, so the adapter keeps up with the narrower of the two streams.
+template <int input_size, int depth, int IPF, int PF>
+void Repack(hls::stream<typename model_stream_word<IPF>::type>& input_stream, hls::stream<typename model_stream_word<PF>::type>& output_stream) {
 
-	//Input and Output Streams
-	hls::stream<model_type_input> input_stream;
-	hls::stream<model_type_output> output_stream;
-	//Encoder Internal Streams
-	hls::stream<model_type_input> stream_0;
+	const int step = (IPF < PF) ? IPF : PF;
+	model_type_input input_vals[IPF];
+	model_type_output output_vals[PF];
+	#pragma HLS ARRAY_PARTITION variable=input_vals complete
+	#pragma HLS ARRAY_PARTITION variable=output_vals complete
+
+	//Iterate through all rows of input tensor.
+	for (int x = 0; x < input_size; x++) {
+		//Iterate through all columns of input tensor.
+		for (int y = 0; y < input_size; y++) {
+			for (int win_chn = 0; win_chn < depth; win_chn += step) {
+				#pragma HLS PIPELINE
+				//Read a word every IPF channels.
+				if (win_chn%IPF == 0) {
+					read_word(input_stream, input_vals);
+				}
+				for (int i = 0; i < step; i++) {
+					#pragma HLS UNROLL
+					output_vals[(win_chn+i)%PF] = input_vals[(win_chn+i)%IPF];
+				}
+				//Write a word every PF channels.
+				if ((win_chn+step)%PF == 0) {
+					write_word(output_stream, output_vals);
+				}
+			}
+		}
+	}
+}
+
+// ############# Input Normalization Function ############# //
+//pixel/255 truncated to the fraction bits of model_type_input, the value the test bench computes as int_value/255.0.
+//Computed on the raw bits as an integer division by a constant, which synthesizes to a multiplication: dividing
+//conv2d_weights_0 by 255 instead would leave the small weights with 2 or 3 significant bits in ap_fixed<18, 8>.
+model_type_input normalize_pixel(model_type_pixel pixel) {
+
+	const int fraction_bits = model_type_input::width - model_type_input::iwidth;
+	model_type_input value = 0;
+	value.range() = (ap_uint<model_type_input::width>(pixel) << fraction_bits) / 255;
+	return value;
+}
+
+// ############# FlareNet Layers ############# //
+//The internal streams and layer instances of FlareNet-simple, from the normalized input_stream to output_stream. Inlined
+//into the DATAFLOW region of the top level that calls it (FlareNet() or FlareNet_video()), where every layer instance
+//remains a process of its own.
+#ifdef FLARENET_SKIP_DDR
+void FlareNet_layers(hls::stream<model_type_input>& input_stream, hls::stream<model_type_result>& output_stream, model_type_input skip_write_1[skip_buffer_frames*model_size_skip_1], const model_type_input skip_read_1[skip_buffer_frames*model_size_skip_1], model_type_input skip_write_2[skip_buffer_frames*model_size_skip_2], const model_type_input skip_read_2[skip_buffer_frames*model_size_skip_2]) {
+#else
+void FlareNet_layers(hls::stream<model_type_input>& input_stream, hls::stream<model_type_result>& output_stream) {
+#endif
+	#pragma HLS INLINE
+
+	//Encoder Internal Streams (the full-resolution stream_0, stream_2, stream_4 and stream_6 are pooled inside the fused
+	//encoder stages; only the skip connections keep a full-resolution stream). A stream between two layers carries as many
+	//channels per word as the PF of its writer, and its reader takes them at that width (IPF).
 	hls::stream<model_type_input> stream_skip_1;
 	hls::stream<model_type_input> stream_1;
-	hls::stream<model_type_input> stream_2;
-	hls::stream<model_type_input> stream_3;
-	hls::stream<model_type_input> stream_4;
+	hls::stream<model_word<2> > stream_3;
 	hls::stream<model_type_input> stream_skip_2;
 	hls::stream<model_type_input> stream_5;
-	hls::stream<model_type_input> stream_6;
 	hls::stream<model_type_input> stream_7;
 	//Decoder Internal Streams
 	hls::stream<model_type_input> stream_8;
-	hls::stream<model_type_input> stream_9;
-	hls::stream<model_type_input> stream_10;
-	hls::stream<model_type_input> stream_11;
-	hls::stream<model_type_input> stream_12;
-	hls::stream<model_type_input> stream_13;
+	hls::stream<model_word<4> > stream_9;
+	hls::stream<model_word<4> > stream_10;
+	hls::stream<model_word<8> > stream_11;
+	hls::stream<model_word<8> > stream_12;
+	hls::stream<model_word<8> > stream_13;
+	//Skip connections repacked to the word width of the Add that reads them
+	hls::stream<model_word<4> > stream_skip_2_words;
+	hls::stream<model_word<8> > stream_skip_1_words;
+#ifdef FLARENET_SKIP_DDR
+	//Skip connections read back from external memory, and a token per row the encoder has written there
+	hls::stream<model_type_input> stream_skip_1_read;
+	hls::stream<model_type_input> stream_skip_2_read;
+	hls::stream<bool> skip_rows_1;
+	hls::stream<bool> skip_rows_2;
+	#pragma HLS STREAM variable=skip_rows_1 depth=256
+	#pragma HLS STREAM variable=skip_rows_2 depth=64
+#endif
+
+	//The last two template arguments of every convolution are its IPF (channels per input word) and PF (output channels
+	//computed in parallel and written per word). PF is chosen to balance the dataflow pipeline: the frame interval is set by
+	//the slowest process. With one output channel per cycle, Conv2D_transposed<256, ...> needs about 76M cycles per frame,
+	//Conv2D_transposed<128, ...> 57M and Conv2D_transposed<64, ...> 28M, while the encoder needs at most 13M. With the PF
+	//below no process needs more than about 10M cycles per frame. The packed streams then run from layer to layer, and only
+	//the skip connections are repacked.
+	//Encoder Layers (every convolution is fused with the MaxPooling2D<..., 2, ...> that follows it)
+	Conv2D_relu_maxpool_2streams<256, 3, 3, 16, 2, 1, 1>(input_stream, stream_1, stream_skip_1, conv2d_weights_0, conv2d_bias_0);
+#ifdef FLARENET_SKIP_DDR
+	SkipBuffer<256, 256*16, skip_burst_length>::write(stream_skip_1, skip_write_1, skip_rows_1);
+#endif
+	SeparableDW2D_relu_maxpool<128, 3, 16, 32, 2, 1, 2>(stream_1, stream_3, conv2d_depth_weights_1, conv2d_point_weights_1, conv2d_depthwise_bias_1);
+	SeparableDW2D_relu_maxpool_2streams<64, 3, 32, 48, 2, 2, 1>(stream_3, stream_5, stream_skip_2, conv2d_depth_weights_2, conv2d_point_weights_2, conv2d_depthwise_bias_2);
+#ifdef FLARENET_SKIP_DDR
+	SkipBuffer<64, 64*48, skip_burst_length>::write(stream_skip_2, skip_write_2, skip_rows_2);
+#endif
+	SeparableDW2D_relu_maxpool<32, 3, 48, 64, 2, 1, 1>(stream_5, stream_7, conv2d_depth_weights_3, conv2d_point_weights_3, conv2d_depthwise_bias_3);
+	//Decoder Layers
+	Conv2D_transposed<32, 3, 2, 64, 64, 1, 1> (stream_7, stream_8, conv2d_weights_4, conv2d_bias_4);
+	Conv2D_transposed<64, 3, 2, 64, 48, 1, 4> (stream_8, stream_9, conv2d_weights_5, conv2d_bias_5);
+#ifdef FLARENET_SKIP_DDR
+	SkipBuffer<64, 64*48, skip_burst_length>::read(skip_read_2, skip_rows_2, stream_skip_2_read);
+	Repack<64, 48, 1, 4>(stream_skip_2_read, stream_skip_2_words);
+#else
+	Repack<64, 48, 1, 4>(stream_skip_2, stream_skip_2_words);
+#endif
+	Add<64, 48, 4>(stream_skip_2_words, stream_9, stream_10);
+	Conv2D_transposed<128, 3, 2, 48, 32, 4, 8> (stream_10, stream_11, conv2d_weights_6, conv2d_bias_6);
+	Conv2D_transposed<256, 3, 2, 32, 16, 8, 8> (stream_11, stream_12, conv2d_weights_7, conv2d_bias_7);
+#ifdef FLARENET_SKIP_DDR
+	SkipBuffer<256, 256*16, skip_burst_length>::read(skip_read_1, skip_rows_1, stream_skip_1_read);
+	Repack<256, 16, 1, 8>(stream_skip_1_read, stream_skip_1_words);
+#else
+	Repack<256, 16, 1, 8>(stream_skip_1, stream_skip_1_words);
+#endif
+	Add<256, 16, 8>(stream_skip_1_words, stream_12, stream_13);
+	Conv2D_sigmoid<256, 1, 16, 3, 8> (stream_13, output_stream, conv2d_weights_8, conv2d_bias_8);
+
+}
+
+#ifdef FLARENET_SKIP_DDR
+void FlareNet(model_type_source input_image[196608], model_type_result output_image[196608], model_type_input skip_write_1[skip_buffer_frames*model_size_skip_1], const model_type_input skip_read_1[skip_buffer_frames*model_size_skip_1], model_type_input skip_write_2[skip_buffer_frames*model_size_skip_2], const model_type_input skip_read_2[skip_buffer_frames*model_size_skip_2]) {
+	#pragma HLS INTERFACE m_axi port=skip_write_1 bundle=gmem_skip_1 depth=skip_buffer_frames*model_size_skip_1 max_write_burst_length=skip_burst_length
+	#pragma HLS INTERFACE m_axi port=skip_read_1 bundle=gmem_skip_1 depth=skip_buffer_frames*model_size_skip_1 max_read_burst_length=skip_burst_length
+	#pragma HLS INTERFACE m_axi port=skip_write_2 bundle=gmem_skip_2 depth=skip_buffer_frames*model_size_skip_2 max_write_burst_length=skip_burst_length
+	#pragma HLS INTERFACE m_axi port=skip_read_2 bundle=gmem_skip_2 depth=skip_buffer_frames*model_size_skip_2 max_read_burst_length=skip_burst_length
+#else
+void FlareNet(model_type_source input_image[196608], model_type_result output_image[196608]) {
+#endif
+	//Consecutive calls overlap: the next frame can start once the input loop has read this one.
+	#pragma HLS INTERFACE ap_ctrl_chain port=return
+
+	//Input and Output Streams
+	hls::stream<model_type_input> input_stream;
+	hls::stream<model_type_result> output_stream;
 
 	#pragma HLS DATAFLOW //enables task-level pipelining, allowing functions and loops to overlap in their operation,
 	//increasing the concurrency of the RTL implementation and increasing the overall throughput of the design.
@@ -753,27 +1131,19 @@ void FlareNet(model_type_input input_image[196608], model_type_output output_ima
 	//Read image vector from TB into the input stream.
 	for (int x = 0; x < model_size_input * model_size_input * model_depth_input; x++) {
 			#pragma HLS PIPELINE
+#ifdef FLARENET_PIXEL_INPUT
+			input_stream << normalize_pixel(input_image[x]);
+#else
 			input_stream << input_image[x];
+#endif
 	}
 
 	//Instantiate FlareNet-simple architecture.
-	//Encoder Layers
-	Conv2D_relu_2streams<256, 3, 3, 16>(input_stream, stream_0, stream_skip_1, conv2d_weights_0, conv2d_bias_0);
-	MaxPooling2D<256, 2, 16>(stream_0, stream_1);
-	SeparableDW2D_relu<128, 3, 16, 32>(stream_1, stream_2, conv2d_depth_weights_1, conv2d_point_weights_1, conv2d_depthwise_bias_1);
-	MaxPooling2D<128, 2, 32>(stream_2, stream_3);
-	SeparableDW2D_relu_2streams<64, 3, 32, 48>(stream_3, stream_4, stream_skip_2, conv2d_depth_weights_2, conv2d_point_weights_2, conv2d_depthwise_bias_2);
-	MaxPooling2D<64, 2, 48>(stream_4, stream_5);
-	SeparableDW2D_relu<32, 3, 48, 64>(stream_5, stream_6, conv2d_depth_weights_3, conv2d_point_weights_3, conv2d_depthwise_bias_3);
-	MaxPooling2D<32, 2, 64>(stream_6, stream_7);
-	//Decoder Layers
-	Conv2D_transposed<32, 3, 2, 64, 64> (stream_7, stream_8, conv2d_weights_4, conv2d_bias_4);
-	Conv2D_transposed<64, 3, 2, 64, 48> (stream_8, stream_9, conv2d_weights_5, conv2d_bias_5);
-	Add<64, 48>(stream_skip_2, stream_9, stream_10);
-	Conv2D_transposed<128, 3, 2, 48, 32> (stream_10, stream_11, conv2d_weights_6, conv2d_bias_6);
-	Conv2D_transposed<256, 3, 2, 32, 16> (stream_11, stream_12, conv2d_weights_7, conv2d_bias_7);
-	Add<256, 16>(stream_skip_1, stream_12, stream_13);
-	Conv2D_sigmoid<256, 1, 16, 3> (stream_13, output_stream, conv2d_weights_8, conv2d_bias_8);
+#ifdef FLARENET_SKIP_DDR
+	FlareNet_layers(input_stream, output_stream, skip_write_1, skip_read_1, skip_write_2, skip_read_2);
+#else
+	FlareNet_layers(input_stream, output_stream);
+#endif
 
 	//Write output stream after inference into the output vector to return to TB.
 	for (int x = 0; x < model_size_output * model_size_output * model_depth_output; x++) {
@@ -781,3 +1151,122 @@ void FlareNet(model_type_input input_image[196608], model_type_output output_ima
 			output_stream >> output_image[x];
 	}
 }
+
+// ############# Video Input Function ############# //
+//Reads one frame of AXI4-Stream video (24-bit RGB as in UG934: G in bits 7:0, B in 15:8, R in 23:16) into input_stream,
+//normalized and in the channel order of the model (R, G, B), as each pixel arrives. Beats before the start of frame
+//(TUSER) are dropped, and so are the beats of a line beyond model_size_input up to its end of line (TLAST), so the input
+//locks onto the next frame after a partial one. Lines must hold at least model_size_input pixels.
+void read_video_frame(hls::stream<model_type_video>& video_in, hls::stream<model_type_input>& input_stream) {
+
+	model_type_video pixel;
+	model_type_pixel channels[model_depth_input];
+	#pragma HLS ARRAY_PARTITION variable=channels complete
+
+	//Wait for the start of frame.
+	do {
+		video_in >> pixel;
+	} while (pixel.user == 0);
+
+	//Iterate through all rows of the frame.
+	for (int x = 0; x < model_size_input; x++) {
+		//Iterate through all columns of the frame.
+		for (int y = 0; y < model_size_input; y++) {
+			#pragma HLS PIPELINE II=model_depth_input //one channel per clock cycle into input_stream.
+			//The first pixel of the frame has been read with its start of frame.
+			if ((x > 0) or (y > 0)) {
+				video_in >> pixel;
+			}
+			channels[0] = pixel.data(23, 16);
+			channels[1] = pixel.data(7, 0);
+			channels[2] = pixel.data(15, 8);
+			for (int chn = 0; chn < model_depth_input; chn++) {
+				input_stream << normalize_pixel(channels[chn]);
+			}
+		}
+		//Drop the rest of a line longer than the model input.
+		while (pixel.last == 0) {
+			video_in >> pixel;
+		}
+	}
+}
+
+// ############# Video Output Function ############# //
+//Writes one frame from output_stream as AXI4-Stream video, in the pixel format of read_video_frame(): TUSER marks the
+//first pixel of the frame (start of frame) and TLAST the last pixel of every line (end of line). The logits of the
+//default build go through sigmoid_pixel() on the way out; FLARENET_PIXEL_OUTPUT builds already stream pixels.
+void write_video_frame(hls::stream<model_type_result>& output_stream, hls::stream<model_type_video>& video_out) {
+
+	model_type_video pixel;
+	model_type_result result = 0;
+	model_type_pixel channels[model_depth_output];
+	#pragma HLS ARRAY_PARTITION variable=channels complete
+
+	//Iterate through all rows of the frame.
+	for (int x = 0; x < model_size_output; x++) {
+		//Iterate through all columns of the frame.
+		for (int y = 0; y < model_size_output; y++) {
+			#pragma HLS PIPELINE II=model_depth_output //one channel per clock cycle from output_stream.
+			for (int chn = 0; chn < model_depth_output; chn++) {
+				output_stream >> result;
+#ifdef FLARENET_PIXEL_OUTPUT
+				channels[chn] = result;
+#else
+				channels[chn] = sigmoid_pixel(result);
+#endif
+			}
+			pixel.data(23, 16) = channels[0];
+			pixel.data(7, 0) = channels[1];
+			pixel.data(15, 8) = channels[2];
+			pixel.keep = -1;
+			pixel.strb = -1;
+			pixel.id = 0;
+			pixel.dest = 0;
+			pixel.user = (x == 0) and (y == 0);
+			pixel.last = (y == model_size_output-1);
+			video_out << pixel;
+		}
+	}
+}
+
+// ############# AXI4-Stream Video Top Level ############# //
+//Alternative top level for a camera video pipeline: frames arrive and leave as AXI4-Stream video with start of frame
+//and end of line, so no frame buffer is needed on either side. Every pixel enters the first layer as it arrives and
+//every output pixel leaves as Conv2D_sigmoid produces it: the latency is that of the layers (a few lines of each
+//feature map), where FlareNet() adds the copies of a whole input and output frame.
+//One start runs a sequence of frames. The frame loop is a dataflow region with ap_ctrl_chain, so its iterations
+//overlap: each process starts on frame N+1 as soon as it is done with frame N, and the encoder works on the next frame
+//while the decoder and Conv2D_sigmoid finish the last one. The frame interval is that of the slowest process instead of
+//the latency of the whole network. With auto-restart set, the kernel runs over an unbounded sequence.
+#ifdef FLARENET_SKIP_DDR
+void FlareNet_video(hls::stream<model_type_video>& video_in, hls::stream<model_type_video>& video_out, int frames, model_type_input skip_write_1[skip_buffer_frames*model_size_skip_1], const model_type_input skip_read_1[skip_buffer_frames*model_size_skip_1], model_type_input skip_write_2[skip_buffer_frames*model_size_skip_2], const model_type_input skip_read_2[skip_buffer_frames*model_size_skip_2]) {
+	#pragma HLS INTERFACE m_axi port=skip_write_1 bundle=gmem_skip_1 depth=skip_buffer_frames*model_size_skip_1 max_write_burst_length=skip_burst_length
+	#pragma HLS INTERFACE m_axi port=skip_read_1 bundle=gmem_skip_1 depth=skip_buffer_frames*model_size_skip_1 max_read_burst_length=skip_burst_length
+	#pragma HLS INTERFACE m_axi port=skip_write_2 bundle=gmem_skip_2 depth=skip_buffer_frames*model_size_skip_2 max_write_burst_length=skip_burst_length
+	#pragma HLS INTERFACE m_axi port=skip_read_2 bundle=gmem_skip_2 depth=skip_buffer_frames*model_size_skip_2 max_read_burst_length=skip_burst_length
+#else
+void FlareNet_video(hls::stream<model_type_video>& video_in, hls::stream<model_type_video>& video_out, int frames) {
+#endif
+	#pragma HLS INTERFACE axis port=video_in
+	#pragma HLS INTERFACE axis port=video_out
+	#pragma HLS INTERFACE s_axilite port=frames
+	#pragma HLS INTERFACE s_axilite port=return
+	#pragma HLS INTERFACE ap_ctrl_chain port=return
+
+	//Iterate through all frames of the sequence.
+	for (int frame = 0; frame < frames; frame++) {
+		#pragma HLS DATAFLOW //every frame overlaps with the next one.
+
+		//Input and Output Streams
+		hls::stream<model_type_input> input_stream;
+		hls::stream<model_type_result> output_stream;
+
+		read_video_frame(video_in, input_stream);
+#ifdef FLARENET_SKIP_DDR
+		FlareNet_layers(input_stream, output_stream, skip_write_1, skip_read_1, skip_write_2, skip_read_2);
+#else
+		FlareNet_layers(input_stream, output_stream);
+#endif
+		write_video_frame(output_stream, video_out);
+	}
+}
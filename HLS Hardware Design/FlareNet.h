@@ -1,16 +1,84 @@
 #pragma once
 
+#ifndef FLARENET_HOST
 #include <ap_fixed.h>
+#include <ap_int.h>
+#include <ap_axi_sdata.h>
+#include <hls_stream.h>
+#endif
 
 #define model_size_input (256)
 #define model_size_output (256)
 #define model_depth_input (3)
 #define model_depth_output (3)
+//Values of the skip connections stream_skip_1 and stream_skip_2, and the AXI burst length and frame slots of their
+//SkipBuffer (FLARENET_SKIP_DDR): a skip buffer in memory holds skip_buffer_frames * model_size_skip_* values.
+#define model_size_skip_1 (1048576)
+#define model_size_skip_2 (196608)
+#define skip_burst_length (64)
+#define skip_buffer_frames (2)
 
+#ifdef FLARENET_HOST
+//Host builds (CPU deployment) read weights.h as plain doubles and convert them at load time.
+typedef double model_type_weights;
+#else
 typedef ap_fixed<18, 8> model_type_input;
 typedef ap_fixed<18, 8> model_type_output;
 typedef ap_fixed<18, 8> model_type_weights;
+typedef ap_uint<8> model_type_pixel;
 
-void FlareNet(model_type_input input_image[196608], model_type_output output_image[196608]);
+//Output of FlareNet(): the logits of the last 1x1 layer (as in golden_*.txt) by default or, built with
+//FLARENET_PIXEL_OUTPUT, their sigmoid as 8-bit pixels (sigmoid_pixel()), ready to display without a float pass.
+#ifdef FLARENET_PIXEL_OUTPUT
+typedef model_type_pixel model_type_result;
+#else
+typedef model_type_output model_type_result;
+#endif
+
+//Input of FlareNet(): RGB values normalized between 0 and 1 by default or, built with FLARENET_PIXEL_INPUT, the 8-bit
+//RGB pixels themselves, normalized as they enter the input stream (normalize_pixel()).
+#ifdef FLARENET_PIXEL_INPUT
+typedef model_type_pixel model_type_source;
+#else
+typedef model_type_input model_type_source;
+#endif
+
+//Beat of the AXI4-Stream video ports of FlareNet_video(): a 24-bit RGB pixel with start of frame (user) and end of line
+//(last).
+typedef ap_axiu<24, 1, 1, 1> model_type_video;
+
+//Stream word of a layer instance that computes PF output channels in parallel: PF consecutive channels of a pixel per
+//transaction, read at the same width by the next layer. Instances with PF = 1 keep writing one model_type_output per
+//transaction (model_stream_word<1>).
+template <int PF>
+struct model_word {
+	model_type_output data[PF];
+};
+
+template <int PF>
+struct model_stream_word {
+	typedef model_word<PF> type;
+};
+
+template <>
+struct model_stream_word<1> {
+	typedef model_type_output type;
+};
+
+model_type_input normalize_pixel(model_type_pixel pixel);
+model_type_pixel sigmoid_pixel(model_type_output logit);
+//Top levels: FlareNet() reads and writes a whole frame in memory, FlareNet_video() streams a sequence of frames as
+//AXI4-Stream video. Both let consecutive frames overlap (ap_ctrl_chain).
+#ifdef FLARENET_SKIP_DDR
+//Built with FLARENET_SKIP_DDR, the skip connections live in external memory (SkipBuffer.h) instead of on-chip FIFOs.
+//The host passes each skip buffer twice: as the write port of the encoder (skip_write_*) and as the read port of the
+//decoder (skip_read_*), so that every m_axi argument is accessed by a single dataflow process.
+void FlareNet(model_type_source input_image[196608], model_type_result output_image[196608], model_type_input skip_write_1[skip_buffer_frames*model_size_skip_1], const model_type_input skip_read_1[skip_buffer_frames*model_size_skip_1], model_type_input skip_write_2[skip_buffer_frames*model_size_skip_2], const model_type_input skip_read_2[skip_buffer_frames*model_size_skip_2]);
+void FlareNet_video(hls::stream<model_type_video>& video_in, hls::stream<model_type_video>& video_out, int frames, model_type_input skip_write_1[skip_buffer_frames*model_size_skip_1], const model_type_input skip_read_1[skip_buffer_frames*model_size_skip_1], model_type_input skip_write_2[skip_buffer_frames*model_size_skip_2], const model_type_input skip_read_2[skip_buffer_frames*model_size_skip_2]);
+#else
+void FlareNet(model_type_source input_image[196608], model_type_result output_image[196608]);
+void FlareNet_video(hls::stream<model_type_video>& video_in, hls::stream<model_type_video>& video_out, int frames);
+#endif
+#endif
 
 
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <hls_stream.h>
+#include "FlareNet.h"
+
+// ############# Skip-Connection Buffer in External Memory ############# //
+//A skip connection is written by the encoder long before the decoder adds it back, so as a FIFO it would have to hold
+//most of its tensor on chip. SkipBuffer keeps it in external memory instead: write() runs next to the encoder and copies
+//the stream into memory one row at a time, read() runs next to the Add layer and streams the rows back in the same order.
+//Both move burst_length consecutive values per AXI burst (a divisor of row_values, at most the max_read_burst_length
+//and max_write_burst_length of the m_axi port). Each burst is first collected in an on-chip buffer, so the bus never
+//waits on a stream.
+//write() sends a token on row_tokens once a row is in memory (the write responses of the row loop have returned), and
+//read() waits for that token before it reads the row: the decoder therefore never reads a row the encoder has not
+//written yet, whatever the schedule of the dataflow processes.
+//The memory holds skip_buffer_frames (2) tensors, used by alternate frames, so that consecutive frames can overlap
+//(ap_ctrl_chain): write() fills one slot with frame N+1 while read() is still reading frame N from the other. row_tokens
+//needs a depth of rows. Then write() can only be a frame ahead of read(): before it writes row r of frame N+2 into the slot
+//of frame N, read() has taken the token of row r-1 of frame N+1 and has therefore read all of frame N up to row r.
+//In C-simulation the memory is a plain host array.
+//rows x row_values is the tensor in stream order (HWC): rows = height, row_values = width * depth.
+template <int rows, int row_values, int burst_length>
+struct SkipBuffer {
+
+	static void write(hls::stream<model_type_input>& input_stream, model_type_input memory[skip_buffer_frames*rows*row_values], hls::stream<bool>& row_tokens) {
+
+		//Slot of the frame, alternating from call to call.
+		static int slot = 0;
+		const int offset = slot*rows*row_values;
+		model_type_input burst_buff[burst_length];
+
+		//Iterate through all rows of the skip tensor.
+		for (int x = 0; x < rows; x++) {
+			for (int burst = 0; burst < row_values; burst += burst_length) {
+				//Collect a burst from the stream.
+				for (int i = 0; i < burst_length; i++) {
+					#pragma HLS PIPELINE
+					input_stream >> burst_buff[i];
+				}
+				//Write it to memory as one burst.
+				for (int i = 0; i < burst_length; i++) {
+					#pragma HLS PIPELINE
+					memory[offset + x*row_values + burst + i] = burst_buff[i];
+				}
+			}
+			//The row is in memory.
+			row_tokens << true;
+		}
+		slot = (slot == skip_buffer_frames-1) ? 0 : slot+1;
+	}
+
+	static void read(const model_type_input memory[skip_buffer_frames*rows*row_values], hls::stream<bool>& row_tokens, hls::stream<model_type_output>& output_stream) {
+
+		//Slot of the frame, alternating from call to call as in write().
+		static int slot = 0;
+		const int offset = slot*rows*row_values;
+		model_type_input burst_buff[burst_length];
+		bool row_written = false;
+
+		//Iterate through all rows of the skip tensor.
+		for (int x = 0; x < rows; x++) {
+			//Wait until the row is in memory.
+			row_tokens >> row_written;
+			for (int burst = 0; burst < row_values; burst += burst_length) {
+				//Read a burst from memory.
+				for (int i = 0; i < burst_length; i++) {
+					#pragma HLS PIPELINE
+					burst_buff[i] = memory[offset + x*row_values + burst + i];
+				}
+				//Write it into the sequential output_stream.
+				for (int i = 0; i < burst_length; i++) {
+					#pragma HLS PIPELINE
+					output_stream << burst_buff[i];
+				}
+			}
+		}
+		slot = (slot == skip_buffer_frames-1) ? 0 : slot+1;
+	}
+};
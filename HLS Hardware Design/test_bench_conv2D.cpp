@@ -1,6 +1,7 @@
 #include <hls_stream.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <cmath>
 #include <hls_print.h>
 #include "FlareNet.h"
 #include <iostream>
@@ -11,8 +12,13 @@ using namespace std::chrono;
 
 int main() {
 
- model_type_input input[196608];
- model_type_output output[196608];
+ model_type_source input[196608];
+ model_type_result output[196608];
+#ifdef FLARENET_SKIP_DDR
+ //Host memory standing in for the external memory of the skip connections.
+ static model_type_input skip_memory_1[skip_buffer_frames*model_size_skip_1];
+ static model_type_input skip_memory_2[skip_buffer_frames*model_size_skip_2];
+#endif
 
   int ret=0;
   int x = 0;
@@ -25,8 +31,13 @@ int main() {
 	  while (in_fw) {
 	    std::getline (in_fw, line);
 	    int_value = std::stoi(line);
+#ifdef FLARENET_PIXEL_INPUT
+	    //FlareNet() normalizes the 8-bit pixels itself.
+	    input[x] = int_value;
+#else
 	    norm_value = int_value/255.0;
 	    input[x] = norm_value;
+#endif
 	    x++;
 	  }
   }
@@ -34,7 +45,12 @@ int main() {
 
   auto start_inference = high_resolution_clock::now();
   for (int i=0; i<1; i++){
+#ifdef FLARENET_SKIP_DDR
+	  //The same buffer is the write and the read port of its skip connection.
+	  FlareNet(input, output, skip_memory_1, skip_memory_1, skip_memory_2, skip_memory_2);
+#else
 	  FlareNet(input, output);
+#endif
   }
 
   auto total_execution_time = duration_cast<microseconds>(high_resolution_clock::now() - start_inference);
@@ -50,7 +66,23 @@ int main() {
   }
   fw.close();
 
+#ifdef FLARENET_PIXEL_OUTPUT
+  //The golden files hold logits printed with 6 digits: round them to the nearest model_type_output (assigning the double
+  //would truncate it) and compare the pixels against their sigmoid.
+  ifstream golden_fw("C:\\Users\\David\\Desktop\\FlareNet_with_aptfixed_values\\golden_2.txt", std::ifstream::in);
+  const int fraction_bits = model_type_output::width - model_type_output::iwidth;
+  model_type_output golden_logit = 0;
+  for (int x=0; x< model_size_output * model_size_output * model_depth_output; x++) {
+		  std::getline (golden_fw, line);
+		  golden_logit = std::ldexp(std::round(std::ldexp(std::stod(line), fraction_bits)), -fraction_bits);
+		  if (output[x] != sigmoid_pixel(golden_logit)) {
+			  ret = 1;
+		  }
+  }
+  golden_fw.close();
+#else
   ret = system("diff --brief -w C:\\Users\\David\\Desktop\\FlareNet_with_aptfixed_values\\results_2.txt C:\\Users\\David\\Desktop\\FlareNet_with_aptfixed_values\\golden_2.txt");
+#endif
   if (ret != 0) {
         printf("Test failed  !!!\n");
         ret=1;
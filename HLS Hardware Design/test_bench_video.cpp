@@ -0,0 +1,118 @@
+#include <hls_stream.h>
+#include <stdio.h>
+#include <cmath>
+#include <iostream>
+#include <string>
+#include <fstream>
+#include "FlareNet.h"
+
+//Folder of input_*.txt and golden_*.txt, relative to the C-simulation run or set with -DFLARENET_DATA_DIR.
+#ifndef FLARENET_DATA_DIR
+#define FLARENET_DATA_DIR "data/"
+#endif
+
+#define test_frames (4)
+
+//Pushes the four test images through FlareNet_video() as one sequence in a single invocation and checks every output
+//frame against the sigmoid of its golden logits, pixel for pixel, and its start of frame and end of line flags.
+int main() {
+
+  hls::stream<model_type_video> video_in;
+  hls::stream<model_type_video> video_out;
+  model_type_video pixel;
+  int channels[model_depth_input];
+#ifdef FLARENET_SKIP_DDR
+  //Host memory standing in for the external memory of the skip connections.
+  static model_type_input skip_memory_1[skip_buffer_frames*model_size_skip_1];
+  static model_type_input skip_memory_2[skip_buffer_frames*model_size_skip_2];
+#endif
+  std::string line;
+  int ret = 0;
+
+  //Stream the input frames: 24-bit RGB (G in bits 7:0, B in 15:8, R in 23:16), TUSER on the first pixel of a frame and
+  //TLAST on the last pixel of a line.
+  for (int frame = 1; frame <= test_frames; frame++) {
+	  std::ifstream in_fw(FLARENET_DATA_DIR "input_" + std::to_string(frame) + ".txt", std::ifstream::in);
+	  if (!in_fw.is_open()) {
+		  printf("Cannot open input_%d.txt\n", frame);
+		  return 1;
+	  }
+	  for (int x = 0; x < model_size_input; x++) {
+		  for (int y = 0; y < model_size_input; y++) {
+			  for (int chn = 0; chn < model_depth_input; chn++) {
+				  std::getline(in_fw, line);
+				  channels[chn] = std::stoi(line);
+			  }
+			  pixel.data(23, 16) = channels[0];
+			  pixel.data(7, 0) = channels[1];
+			  pixel.data(15, 8) = channels[2];
+			  pixel.keep = -1;
+			  pixel.strb = -1;
+			  pixel.id = 0;
+			  pixel.dest = 0;
+			  pixel.user = (x == 0) and (y == 0);
+			  pixel.last = (y == model_size_input-1);
+			  video_in << pixel;
+		  }
+	  }
+	  in_fw.close();
+  }
+
+#ifdef FLARENET_SKIP_DDR
+  FlareNet_video(video_in, video_out, test_frames, skip_memory_1, skip_memory_1, skip_memory_2, skip_memory_2);
+#else
+  FlareNet_video(video_in, video_out, test_frames);
+#endif
+
+  //The golden files hold logits printed with 6 digits: round them to the nearest model_type_output and compare the
+  //pixels against their sigmoid.
+  const int fraction_bits = model_type_output::width - model_type_output::iwidth;
+  model_type_output golden_logit = 0;
+  for (int frame = 1; frame <= test_frames; frame++) {
+	  std::ifstream golden_fw(FLARENET_DATA_DIR "golden_" + std::to_string(frame) + ".txt", std::ifstream::in);
+	  if (!golden_fw.is_open()) {
+		  printf("Cannot open golden_%d.txt\n", frame);
+		  return 1;
+	  }
+	  int errors = 0;
+	  for (int x = 0; x < model_size_output; x++) {
+		  for (int y = 0; y < model_size_output; y++) {
+			  if (video_out.empty()) {
+				  printf("Frame %d: output ends at pixel %d\n", frame, x*model_size_output + y);
+				  return 1;
+			  }
+			  video_out >> pixel;
+			  if ((pixel.user != ((x == 0) and (y == 0))) or (pixel.last != (y == model_size_output-1))) {
+				  errors++;
+			  }
+			  channels[0] = pixel.data(23, 16);
+			  channels[1] = pixel.data(7, 0);
+			  channels[2] = pixel.data(15, 8);
+			  for (int chn = 0; chn < model_depth_output; chn++) {
+				  std::getline(golden_fw, line);
+				  golden_logit = std::ldexp(std::round(std::ldexp(std::stod(line), fraction_bits)), -fraction_bits);
+				  if (channels[chn] != sigmoid_pixel(golden_logit)) {
+					  errors++;
+				  }
+			  }
+		  }
+	  }
+	  golden_fw.close();
+	  printf("Frame %d: %d mismatches\n", frame, errors);
+	  if (errors != 0) {
+		  ret = 1;
+	  }
+  }
+  if (!video_out.empty()) {
+	  printf("More output pixels than frames\n");
+	  ret = 1;
+  }
+
+  if (ret != 0) {
+        printf("Test failed  !!!\n");
+  } else {
+        printf("Test passed !\n");
+  }
+
+  return (ret);
+}